@@ -0,0 +1,119 @@
+# Упаковка прошивки для OTA TKWifiManager: py extras/tkwm_pack_fw.py firmware.bin [--lz] [-o out]
+# Без --lz — gzip (firmware.bin.gz, окно 32 КБ на устройстве), с --lz — TKLZ (heatshrink, окно 2^W байт).
+# Устройство распознаёт формат по первым байтам; обычный .bin по-прежнему принимается как есть.
+#   TKLZ: 'T','K','L','Z', W, L, 0, 0, длина образа (u32 LE), CRC32 образа (u32 LE), поток heatshrink
+import argparse
+import gzip
+import pathlib
+import struct
+import zlib
+
+
+def lz_pack(data, w, l):
+    win, maxlen = 1 << w, 1 << l
+    # Бэкреф выгоднее литералов, только если длиннее порога (литерал — 9 бит, ссылка — 1 + W + L).
+    minlen = (1 + w + l) // 9 + 1
+    out = bytearray()
+    acc = nbits = 0
+
+    def put(v, n):
+        nonlocal acc, nbits
+        acc = (acc << n) | v
+        nbits += n
+        while nbits >= 8:
+            nbits -= 8
+            out.append((acc >> nbits) & 0xFF)
+        acc &= (1 << nbits) - 1
+
+    heads = {}
+    i, n = 0, len(data)
+    while i < n:
+        best_len = best_dist = 0
+        key = data[i:i + 3]
+        if len(key) == 3:
+            chain = heads.get(key, [])
+            for j in reversed(chain[-64:]):
+                if i - j > win:
+                    break
+                m = 0
+                while m < maxlen and i + m < n and data[j + m] == data[i + m]:
+                    m += 1
+                if m > best_len:
+                    best_len, best_dist = m, i - j
+                    if m == maxlen:
+                        break
+        step = best_len if best_len >= minlen else 1
+        if step > 1:
+            put(0, 1)
+            put(best_dist - 1, w)
+            put(best_len - 1, l)
+        else:
+            put(1, 1)
+            put(data[i], 8)
+        for k in range(i, i + step):
+            kk = data[k:k + 3]
+            if len(kk) == 3:
+                chain = heads.setdefault(kk, [])
+                chain.append(k)
+                if len(chain) > 128:
+                    del chain[:64]
+        i += step
+    if nbits:
+        out.append((acc << (8 - nbits)) & 0xFF)
+    return bytes(out)
+
+
+def lz_unpack(stream, w, l, size):
+    win, mask = bytearray(1 << w), (1 << w) - 1
+    pos, out = 0, bytearray()
+    bits = nb = 0
+    it = iter(stream)
+
+    def get(n):
+        nonlocal bits, nb
+        while nb < n:
+            bits = (bits << 8) | next(it)
+            nb += 8
+        nb -= n
+        return (bits >> nb) & ((1 << n) - 1)
+
+    while len(out) < size:
+        if get(1):
+            seq = [get(8)]
+        else:
+            dist, cnt = get(w) + 1, get(l) + 1
+            seq = []
+            for _ in range(cnt):
+                seq.append(win[(pos - dist) & mask])
+                win[pos] = seq[-1]
+                pos = (pos + 1) & mask
+            out += bytes(seq)
+            continue
+        win[pos] = seq[0]
+        pos = (pos + 1) & mask
+        out += bytes(seq)
+    return bytes(out[:size])
+
+
+ap = argparse.ArgumentParser()
+ap.add_argument("bin", type=pathlib.Path)
+ap.add_argument("-o", "--out", type=pathlib.Path)
+ap.add_argument("--lz", action="store_true", help="TKLZ (мало RAM на устройстве) вместо gzip")
+ap.add_argument("--window", type=int, default=10, help="TKLZ: окно 2^W байт (4..14)")
+ap.add_argument("--lookahead", type=int, default=5, help="TKLZ: длина ссылки до 2^L байт (3..W-1)")
+args = ap.parse_args()
+
+raw = args.bin.read_bytes()
+if args.lz:
+    w, l = args.window, args.lookahead
+    if not (4 <= w <= 14 and 3 <= l < w):
+        ap.error("нужно 4 <= W <= 14 и 3 <= L < W")
+    body = lz_pack(raw, w, l)
+    assert lz_unpack(body, w, l, len(raw)) == raw, "TKLZ: проверка распаковки не прошла"
+    packed = b"TKLZ" + struct.pack("<BBHII", w, l, 0, len(raw), zlib.crc32(raw)) + body
+    out = args.out or args.bin.with_suffix(args.bin.suffix + ".lz")
+else:
+    packed = gzip.compress(raw, compresslevel=9, mtime=0)
+    out = args.out or args.bin.with_suffix(args.bin.suffix + ".gz")
+out.write_bytes(packed)
+print("%s: %d -> %d bytes (%.0f%%)" % (out, len(raw), len(packed), 100.0 * len(packed) / max(len(raw), 1)))
@@ -0,0 +1,12 @@
+#pragma once
+// Хост-замена DNSServer: captive-DNS не поднимается, запросы не приходят.
+#include <IPAddress.h>
+class DNSServer {
+public:
+    bool start(uint16_t, const String&, const IPAddress&) { _on = true; return true; }
+    void stop() { _on = false; }
+    void processNextRequest() {}
+    bool running() const { return _on; }
+private:
+    bool _on = false;
+};
@@ -0,0 +1,83 @@
+#pragma once
+// Хост-замена FS ядра ESP32: файлы и каталоги в каталоге ПК текущего устройства (tkwmHost::Device::fsRoot).
+#include <Arduino.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+struct FileImpl;
+typedef std::shared_ptr<FileImpl> FileImplPtr;
+
+class File : public Stream {
+public:
+    File(FileImplPtr p = FileImplPtr()) : _p(std::move(p)) {}
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t n) override;
+    using Print::write;
+    int    available() override;
+    int    read() override;
+    int    peek() override;
+    void   flush() override;
+    size_t read(uint8_t* buf, size_t n);
+    size_t readBytes(char* buf, size_t n) override { return read((uint8_t*)buf, n); }
+    bool   seek(uint32_t pos, SeekMode mode);
+    bool   seek(uint32_t pos) { return seek(pos, SeekSet); }
+    size_t position() const;
+    size_t size() const;
+    bool   setBufferSize(size_t) { return true; }
+    void   close();
+    operator bool() const;
+    time_t getLastWrite();
+    const char* path() const;
+    const char* name() const;
+    boolean isDirectory();
+    File    openNextFile(const char* mode = FILE_READ);
+    String  getNextFileName();
+    void    rewindDirectory();
+
+private:
+    FileImplPtr _p;
+};
+
+class FS {
+public:
+    File open(const char* path, const char* mode = FILE_READ, const bool create = false);
+    File open(const String& path, const char* mode = FILE_READ, const bool create = false) { return open(path.c_str(), mode, create); }
+    bool exists(const char* path);
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool remove(const char* path);
+    bool remove(const String& path) { return remove(path.c_str()); }
+    bool rename(const char* from, const char* to);
+    bool rename(const String& from, const String& to) { return rename(from.c_str(), to.c_str()); }
+    bool mkdir(const char* path);
+    bool mkdir(const String& path) { return mkdir(path.c_str()); }
+    bool rmdir(const char* path);
+    bool rmdir(const String& path) { return rmdir(path.c_str()); }
+};
+
+} // namespace fs
+
+using fs::FS;
+using fs::File;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+
+// LittleFS/SPIFFS: монтирование каталога устройства
+class TkwmHostFS : public fs::FS {
+public:
+    bool   begin(bool formatOnFail = false, const char* basePath = "/littlefs", uint8_t maxOpenFiles = 10, const char* label = nullptr);
+    bool   format();
+    void   end();
+    size_t totalBytes();
+    size_t usedBytes();
+};
@@ -0,0 +1,80 @@
+#pragma once
+// Хост-замена HTTPClient ядра ESP32 (2.x): запрос и разбор заголовков как у оригинала — keep-alive при
+// setReuse(true), тело chunked в getString(), только собранные через collectHeaders() заголовки.
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <vector>
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_NO_STREAM (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM (-8)
+#define HTTPC_ERROR_ENCODING (-9)
+#define HTTPC_ERROR_STREAM_WRITE (-10)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+#define HTTPCLIENT_DEFAULT_TCP_TIMEOUT (5000)
+
+typedef enum { HTTPC_TE_IDENTITY, HTTPC_TE_CHUNKED } transferEncoding_t;
+
+class HTTPClient {
+public:
+    HTTPClient() {}
+    ~HTTPClient() {}
+
+    bool begin(WiFiClient& client, String url);
+    bool begin(String url);
+    void end();
+    bool connected();
+
+    void setReuse(bool reuse) { _reuse = reuse; }
+    void useHTTP10(bool on) { _useHTTP10 = on; _reuse = !on; }
+    void setTimeout(uint16_t ms);
+    void setConnectTimeout(int32_t ms) { _connectTimeout = ms; }
+    void setUserAgent(const String& ua) { _userAgent = ua; }
+
+    void addHeader(const String& name, const String& value, bool first = false, bool replace = true);
+    void collectHeaders(const char* headerKeys[], const size_t headerKeysCount);
+    String header(const char* name);
+    String header(size_t i);
+    String headerName(size_t i);
+    int    headers() { return (int)_resp.size(); }
+    bool   hasHeader(const char* name);
+
+    int GET();
+    int POST(uint8_t* payload, size_t size);
+    int POST(const String& payload) { return POST((uint8_t*)payload.c_str(), payload.length()); }
+    int PUT(const String& payload) { return sendRequest("PUT", (uint8_t*)payload.c_str(), payload.length()); }
+    int sendRequest(const char* type, uint8_t* payload = nullptr, size_t size = 0);
+
+    int         getSize() { return _size; }
+    WiFiClient& getStream() { return *_client; }
+    WiFiClient* getStreamPtr() { return connected() ? _client : nullptr; }
+    String      getString();
+    int         writeToStream(Stream* stream);
+    static String errorToString(int error);
+
+private:
+    struct Kv {
+        String key, value;
+    };
+    bool connect();
+    void disconnect(bool preserveClient = false);
+    void clear();
+    int  handleHeaderResponse();
+    bool readLine(String& line);
+
+    WiFiClient* _client = nullptr;
+    std::unique_ptr<WiFiClient> _own;  // begin(url) без клиента
+    String   _host, _uri, _protocol, _headers, _userAgent = "ESP32HTTPClient";
+    uint16_t _port = 80;
+    bool     _reuse = true, _canReuse = false, _useHTTP10 = false;
+    uint16_t _tcpTimeout = HTTPCLIENT_DEFAULT_TCP_TIMEOUT;
+    int32_t  _connectTimeout = -1;
+    int      _returnCode = 0, _size = -1;
+    transferEncoding_t _te = HTTPC_TE_IDENTITY;
+    std::vector<Kv> _resp;
+};
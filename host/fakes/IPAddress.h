@@ -0,0 +1,33 @@
+#pragma once
+// Хост-замена IPAddress (IPv4): байты в сетевом порядке, uint32_t — как в ядре ESP32 (первый октет — младший байт).
+#include "Arduino.h"
+
+class IPAddress {
+public:
+    IPAddress() {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _b{a, b, c, d} {}
+    IPAddress(uint32_t v) { memcpy(_b, &v, 4); }
+    IPAddress(const uint8_t* p) { memcpy(_b, p, 4); }
+    operator uint32_t() const { uint32_t v; memcpy(&v, _b, 4); return v; }
+    bool operator==(const IPAddress& o) const { return memcmp(_b, o._b, 4) == 0; }
+    bool operator!=(const IPAddress& o) const { return !(*this == o); }
+    bool operator==(uint32_t v) const { return (uint32_t)*this == v; }
+    uint8_t operator[](int i) const { return _b[i & 3]; }
+    uint8_t& operator[](int i) { return _b[i & 3]; }
+    String toString() const {
+        char s[16];
+        snprintf(s, sizeof(s), "%u.%u.%u.%u", _b[0], _b[1], _b[2], _b[3]);
+        return s;
+    }
+    bool fromString(const char* s) {
+        unsigned a, b, c, d;
+        char tail;
+        if (!s || sscanf(s, "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) != 4 || a > 255 || b > 255 || c > 255 || d > 255) return false;
+        _b[0] = (uint8_t)a; _b[1] = (uint8_t)b; _b[2] = (uint8_t)c; _b[3] = (uint8_t)d;
+        return true;
+    }
+    bool fromString(const String& s) { return fromString(s.c_str()); }
+
+private:
+    uint8_t _b[4] = {0, 0, 0, 0};
+};
@@ -0,0 +1,60 @@
+#pragma once
+// Хост-замена Preferences (NVS): типизированные ключи в памяти текущего устройства, счётчики операций
+// и стоимость чтения/записи в виртуальном времени (tkwmHost::Nvs).
+#include <Arduino.h>
+#include <string>
+
+namespace tkwmHost { struct Nvs; }
+
+class Preferences {
+public:
+    bool   begin(const char* name, bool readOnly = false, const char* partition = nullptr);
+    void   end();
+    bool   clear();
+    bool   remove(const char* key);
+    bool   isKey(const char* key);
+
+    size_t putChar(const char* key, int8_t v) { return put(key, 'c', &v, 1); }
+    size_t putUChar(const char* key, uint8_t v) { return put(key, 'C', &v, 1); }
+    size_t putShort(const char* key, int16_t v) { return put(key, 'h', &v, 2); }
+    size_t putUShort(const char* key, uint16_t v) { return put(key, 'H', &v, 2); }
+    size_t putInt(const char* key, int32_t v) { return put(key, 'i', &v, 4); }
+    size_t putUInt(const char* key, uint32_t v) { return put(key, 'I', &v, 4); }
+    size_t putLong(const char* key, int32_t v) { return putInt(key, v); }
+    size_t putULong(const char* key, uint32_t v) { return putUInt(key, v); }
+    size_t putLong64(const char* key, int64_t v) { return put(key, 'q', &v, 8); }
+    size_t putULong64(const char* key, uint64_t v) { return put(key, 'Q', &v, 8); }
+    size_t putFloat(const char* key, float v) { return put(key, 'B', &v, 4); }
+    size_t putDouble(const char* key, double v) { return put(key, 'B', &v, 8); }
+    size_t putBool(const char* key, bool v) { return putUChar(key, v ? 1 : 0); }
+    size_t putString(const char* key, const char* v) { return put(key, 's', v, strlen(v)); }
+    size_t putString(const char* key, const String& v) { return put(key, 's', v.c_str(), v.length()); }
+    size_t putBytes(const char* key, const void* v, size_t n) { return put(key, 'B', v, n); }
+
+    int8_t   getChar(const char* key, int8_t d = 0) { get(key, 'c', &d, 1); return d; }
+    uint8_t  getUChar(const char* key, uint8_t d = 0) { get(key, 'C', &d, 1); return d; }
+    int16_t  getShort(const char* key, int16_t d = 0) { get(key, 'h', &d, 2); return d; }
+    uint16_t getUShort(const char* key, uint16_t d = 0) { get(key, 'H', &d, 2); return d; }
+    int32_t  getInt(const char* key, int32_t d = 0) { get(key, 'i', &d, 4); return d; }
+    uint32_t getUInt(const char* key, uint32_t d = 0) { get(key, 'I', &d, 4); return d; }
+    int32_t  getLong(const char* key, int32_t d = 0) { return getInt(key, d); }
+    uint32_t getULong(const char* key, uint32_t d = 0) { return getUInt(key, d); }
+    int64_t  getLong64(const char* key, int64_t d = 0) { get(key, 'q', &d, 8); return d; }
+    uint64_t getULong64(const char* key, uint64_t d = 0) { get(key, 'Q', &d, 8); return d; }
+    float    getFloat(const char* key, float d = 0) { get(key, 'B', &d, 4); return d; }
+    double   getDouble(const char* key, double d = 0) { get(key, 'B', &d, 8); return d; }
+    bool     getBool(const char* key, bool d = false) { return getUChar(key, d ? 1 : 0) != 0; }
+    String   getString(const char* key, const String& d = String());
+    size_t   getString(const char* key, char* buf, size_t maxLen);
+    size_t   getBytesLength(const char* key);
+    size_t   getBytes(const char* key, void* buf, size_t maxLen);
+    size_t   freeEntries() { return 500; }
+
+private:
+    tkwmHost::Nvs* _nvs = nullptr;
+    std::string    _ns;
+    bool           _readOnly = false;
+    size_t put(const char* key, char type, const void* v, size_t n);
+    bool   get(const char* key, char type, void* out, size_t n);
+    const std::string* find(const char* key, char type);
+};
@@ -0,0 +1,48 @@
+#pragma once
+// Хост-замена Update (ядро ESP32): образ пишется в tkwmHost::Device::flash секторами по 4 КБ;
+// проверки как на устройстве — размер раздела, магический байт 0xE9, end() без всех байт.
+#include <Arduino.h>
+
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+#define U_FLASH 0
+#define U_SPIFFS 100
+
+#define UPDATE_ERROR_OK              (0)
+#define UPDATE_ERROR_WRITE           (1)
+#define UPDATE_ERROR_ERASE           (2)
+#define UPDATE_ERROR_READ            (3)
+#define UPDATE_ERROR_SPACE           (4)
+#define UPDATE_ERROR_SIZE            (5)
+#define UPDATE_ERROR_STREAM          (6)
+#define UPDATE_ERROR_MD5             (7)
+#define UPDATE_ERROR_MAGIC_BYTE      (8)
+#define UPDATE_ERROR_ACTIVATE        (9)
+#define UPDATE_ERROR_NO_PARTITION    (10)
+#define UPDATE_ERROR_BAD_ARGUMENT    (11)
+#define UPDATE_ERROR_ABORT           (12)
+
+class UpdateClass {
+public:
+    bool        begin(size_t size = UPDATE_SIZE_UNKNOWN, int command = U_FLASH, int ledPin = -1, uint8_t ledOn = 0, const char* label = nullptr);
+    size_t      write(uint8_t* data, size_t len);
+    bool        end(bool evenIfRemaining = false);
+    void        abort();
+    bool        hasError() { return _error != UPDATE_ERROR_OK; }
+    uint8_t     getError() { return _error; }
+    void        clearError() { _error = UPDATE_ERROR_OK; }
+    const char* errorString();
+    bool        isRunning() { return _size > 0; }
+    bool        isFinished() { return _progress == _size; }
+    size_t      size() { return _size; }
+    size_t      progress() { return _progress; }
+    size_t      remaining() { return _size - _progress; }
+
+private:
+    size_t  _size = 0, _progress = 0;
+    uint8_t _error = UPDATE_ERROR_OK;
+    uint8_t _buf[4096];
+    size_t  _bufLen = 0;
+    bool    flushSector();
+    void    reset();
+};
+extern UpdateClass Update;
@@ -0,0 +1,147 @@
+#pragma once
+// Хост-замена Arduino String поверх std::string (API ядра ESP32, которое использует библиотека).
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <algorithm>
+#include <string>
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+
+class String {
+public:
+    String() {}
+    String(const char* c) { if (c) _s = c; }
+    String(const char* c, unsigned n) { if (c) _s.assign(c, n); }
+    String(const std::string& s) : _s(s) {}
+    String(const __FlashStringHelper* f) : String(reinterpret_cast<const char*>(f)) {}
+    explicit String(char c) : _s(1, c) {}
+    explicit String(unsigned char v, unsigned char base = 10) : _s(num(v, base)) {}
+    explicit String(int v, unsigned char base = 10) : _s(base == 10 ? std::to_string(v) : num((unsigned)v, base)) {}
+    explicit String(unsigned v, unsigned char base = 10) : _s(num(v, base)) {}
+    explicit String(long v, unsigned char base = 10) : _s(base == 10 ? std::to_string(v) : num((unsigned long)v, base)) {}
+    explicit String(unsigned long v, unsigned char base = 10) : _s(num(v, base)) {}
+    explicit String(long long v, unsigned char base = 10) : _s(base == 10 ? std::to_string(v) : num((unsigned long long)v, base)) {}
+    explicit String(unsigned long long v, unsigned char base = 10) : _s(num(v, base)) {}
+    explicit String(float v, unsigned decimals = 2) : _s(fmt(v, decimals)) {}
+    explicit String(double v, unsigned decimals = 2) : _s(fmt(v, decimals)) {}
+
+    String& operator=(const char* c) { _s = c ? c : ""; return *this; }
+    String& operator=(const __FlashStringHelper* f) { return *this = reinterpret_cast<const char*>(f); }
+
+    bool concat(const String& o) { _s += o._s; return true; }
+    bool concat(const char* c) { if (c) _s += c; return true; }
+    bool concat(const char* c, unsigned n) { if (c) _s.append(c, n); return true; }
+    bool concat(const uint8_t* c, unsigned n) { return concat((const char*)c, n); }
+    bool concat(char c) { _s += c; return true; }
+    bool concat(unsigned char v) { return concat(String(v)); }
+    bool concat(int v) { return concat(String(v)); }
+    bool concat(unsigned v) { return concat(String(v)); }
+    bool concat(long v) { return concat(String(v)); }
+    bool concat(unsigned long v) { return concat(String(v)); }
+    bool concat(long long v) { return concat(String(v)); }
+    bool concat(unsigned long long v) { return concat(String(v)); }
+    bool concat(float v) { return concat(String(v)); }
+    bool concat(double v) { return concat(String(v)); }
+    bool concat(const __FlashStringHelper* f) { return concat(reinterpret_cast<const char*>(f)); }
+    template <typename T> String& operator+=(const T& v) { concat(v); return *this; }
+
+    unsigned length() const { return (unsigned)_s.size(); }
+    const char* c_str() const { return _s.c_str(); }
+    char* begin() { return &_s[0]; }
+    char* end() { return &_s[0] + _s.size(); }
+    const char* begin() const { return _s.data(); }
+    const char* end() const { return _s.data() + _s.size(); }
+    bool isEmpty() const { return _s.empty(); }
+    bool reserve(unsigned n) { _s.reserve(n); return true; }
+    explicit operator bool() const { return true; }
+
+    char operator[](unsigned i) const { return i < _s.size() ? _s[i] : 0; }
+    char& operator[](unsigned i) { static char dummy; return i < _s.size() ? _s[i] : (dummy = 0); }
+    char charAt(unsigned i) const { return (*this)[i]; }
+    void setCharAt(unsigned i, char c) { if (i < _s.size()) _s[i] = c; }
+
+    int compareTo(const String& o) const { return _s.compare(o._s); }
+    bool equals(const String& o) const { return _s == o._s; }
+    bool equals(const char* o) const { return _s == (o ? o : ""); }
+    bool equalsIgnoreCase(const String& o) const { return strcasecmp(_s.c_str(), o._s.c_str()) == 0; }
+    bool operator==(const String& o) const { return _s == o._s; }
+    bool operator==(const char* o) const { return equals(o); }
+    bool operator!=(const String& o) const { return _s != o._s; }
+    bool operator!=(const char* o) const { return !equals(o); }
+    bool operator<(const String& o) const { return _s < o._s; }
+    bool operator>(const String& o) const { return _s > o._s; }
+    bool operator<=(const String& o) const { return _s <= o._s; }
+    bool operator>=(const String& o) const { return _s >= o._s; }
+    bool startsWith(const String& p) const { return _s.compare(0, p._s.size(), p._s) == 0 && _s.size() >= p._s.size(); }
+    bool startsWith(const String& p, unsigned off) const { return off <= _s.size() && _s.compare(off, p._s.size(), p._s) == 0 && _s.size() - off >= p._s.size(); }
+    bool endsWith(const String& p) const { return _s.size() >= p._s.size() && _s.compare(_s.size() - p._s.size(), p._s.size(), p._s) == 0; }
+
+    int indexOf(char c, unsigned from = 0) const { return pos(_s.find(c, from)); }
+    int indexOf(const String& o, unsigned from = 0) const { return pos(_s.find(o._s, from)); }
+    int indexOf(const char* o, unsigned from = 0) const { return pos(_s.find(o, from)); }
+    int lastIndexOf(char c) const { return pos(_s.rfind(c)); }
+    int lastIndexOf(char c, unsigned from) const { return pos(_s.rfind(c, from)); }
+    int lastIndexOf(const String& o) const { return pos(_s.rfind(o._s)); }
+    int lastIndexOf(const String& o, unsigned from) const { return pos(_s.rfind(o._s, from)); }
+    String substring(unsigned a) const { return a >= _s.size() ? String() : String(_s.substr(a)); }
+    String substring(unsigned a, unsigned b) const {
+        if (a > b) { unsigned t = a; a = b; b = t; }
+        if (a >= _s.size()) return String();
+        return String(_s.substr(a, b - a));
+    }
+
+    void replace(char a, char b) { for (auto& c : _s) if (c == a) c = b; }
+    void replace(const String& a, const String& b) {
+        if (a._s.empty()) return;
+        for (size_t p = 0; (p = _s.find(a._s, p)) != std::string::npos; p += b._s.size()) _s.replace(p, a._s.size(), b._s);
+    }
+    void remove(unsigned i) { if (i < _s.size()) _s.erase(i); }
+    void remove(unsigned i, unsigned n) { if (i < _s.size()) _s.erase(i, n); }
+    void toLowerCase() { for (auto& c : _s) c = (char)tolower((unsigned char)c); }
+    void toUpperCase() { for (auto& c : _s) c = (char)toupper((unsigned char)c); }
+    void trim() {
+        size_t a = 0, b = _s.size();
+        while (a < b && isspace((unsigned char)_s[a])) a++;
+        while (b > a && isspace((unsigned char)_s[b - 1])) b--;
+        _s = _s.substr(a, b - a);
+    }
+
+    long toInt() const { return atol(_s.c_str()); }
+    float toFloat() const { return (float)atof(_s.c_str()); }
+    double toDouble() const { return atof(_s.c_str()); }
+    void getBytes(unsigned char* buf, unsigned n, unsigned index = 0) const {
+        if (!n || !buf) return;
+        size_t k = index < _s.size() ? std::min<size_t>(n - 1, _s.size() - index) : 0;
+        if (k) memcpy(buf, _s.data() + index, k);
+        buf[k] = 0;
+    }
+    void toCharArray(char* buf, unsigned n, unsigned index = 0) const { getBytes((unsigned char*)buf, n, index); }
+
+    const std::string& str() const { return _s; }
+
+private:
+    std::string _s;
+    static int pos(size_t p) { return p == std::string::npos ? -1 : (int)p; }
+    static std::string num(unsigned long long v, unsigned base) {
+        if (base < 2 || base > 36) base = 10;
+        char b[72]; int i = 71; b[i] = 0;
+        do { const unsigned d = (unsigned)(v % base); b[--i] = (char)(d < 10 ? '0' + d : 'a' + d - 10); v /= base; } while (v);
+        return b + i;
+    }
+    static std::string fmt(double v, unsigned decimals) {
+        char b[64];
+        snprintf(b, sizeof(b), "%.*f", (int)decimals, v);
+        return b;
+    }
+};
+
+template <typename T> inline String operator+(const String& a, const T& b) { String r(a); r.concat(b); return r; }
+inline String operator+(const char* a, const String& b) { String r(a); r.concat(b); return r; }
+inline String operator+(char a, const String& b) { String r(a); r.concat(b); return r; }
+inline bool operator==(const char* a, const String& b) { return b == a; }
+inline bool operator!=(const char* a, const String& b) { return b != a; }
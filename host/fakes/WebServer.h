@@ -0,0 +1,159 @@
+#pragma once
+// Хост-замена WebServer ядра ESP32 (2.x): те же сигнатуры и та же модель обслуживания — один клиент за раз,
+// ожидание данных до HTTP_MAX_DATA_WAIT, заголовки ответа с «Connection: close», chunked при CONTENT_LENGTH_UNKNOWN,
+// собираются только заголовки из collectHeaders(). Соединения — из памяти (tkwmHost::request) или настоящий
+// TCP на 127.0.0.1 (WebServer::hostListen(true) до begin()).
+#include <Arduino.h>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+enum HTTPUploadStatus { UPLOAD_FILE_START, UPLOAD_FILE_WRITE, UPLOAD_FILE_END, UPLOAD_FILE_ABORTED };
+
+#define HTTP_DOWNLOAD_UNIT_SIZE 1436
+#define HTTP_UPLOAD_BUFLEN 1436
+#define HTTP_MAX_DATA_WAIT 5000
+#define HTTP_MAX_POST_WAIT 5000
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+#define CONTENT_LENGTH_NOT_SET ((size_t)-2)
+
+typedef struct {
+    HTTPUploadStatus status;
+    String  filename;
+    String  name;
+    String  type;
+    size_t  totalSize;
+    size_t  currentSize;
+    uint8_t buf[HTTP_UPLOAD_BUFLEN];
+} HTTPUpload;
+
+namespace tkwmHost {
+// Одно HTTP-соединение: входящие байты (память или сокет), исходящие, признак закрытия сервером.
+struct HttpConn {
+    std::string in;
+    size_t      pos  = 0;
+    std::string out;
+    bool        done = false;                        // сервер закрыл соединение
+    bool        eof  = false;                        // клиент закрыл свою сторону
+    bool        discard  = false;                    // только считать исходящие байты (замеры кучи)
+    size_t      outBytes = 0;
+    int         fd   = -1;
+    ~HttpConn();
+    bool   ready();                                  // есть непрочитанные байты
+    bool   fill();                                   // дочитать из сокета, что уже пришло
+    bool   peerOpen();                               // клиент ещё не закрыл соединение
+    size_t read(char* buf, size_t n, uint32_t waitMs);
+    bool   readLine(std::string& line, uint32_t waitMs);
+    void   write(const char* p, size_t n);
+    void   close();
+};
+}
+
+class WebServer {
+public:
+    typedef std::function<void(void)> THandlerFunction;
+
+    explicit WebServer(int port = 80);
+    virtual ~WebServer();
+
+    void begin();
+    void begin(uint16_t port);
+    void handleClient();
+    void close();
+    void stop() { close(); }
+
+    void on(const String& uri, THandlerFunction fn) { on(uri, HTTP_ANY, fn); }
+    void on(const String& uri, HTTPMethod method, THandlerFunction fn) { on(uri, method, fn, nullptr); }
+    void on(const String& uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn);
+    void onNotFound(THandlerFunction fn) { _notFound = fn; }
+    void onFileUpload(THandlerFunction fn) { _fileUpload = fn; }
+
+    String      uri() { return _uri; }
+    HTTPMethod  method() { return _method; }
+    HTTPUpload& upload() { return *_upload; }
+
+    String arg(const String& name);
+    String arg(int i);
+    String argName(int i);
+    int    args() { return (int)_args.size(); }
+    bool   hasArg(const String& name);
+
+    void   collectHeaders(const char* headerKeys[], const size_t headerKeysCount);
+    String header(const String& name);
+    String header(int i);
+    String headerName(int i);
+    int    headers() { return (int)_headers.size(); }
+    bool   hasHeader(const String& name);
+    String hostHeader() { return _hostHeader; }
+
+    void send(int code, const char* content_type = nullptr, const String& content = String(""));
+    void send(int code, char* content_type, const String& content) { send(code, (const char*)content_type, content); }
+    void send(int code, const String& content_type, const String& content) { send(code, content_type.c_str(), content); }
+    void send(int code, const char* content_type, const char* content) { send(code, content_type, content, strlen(content)); }
+    void send(int code, const char* content_type, const char* content, size_t len);
+    void send(int code, const char* content_type, const uint8_t* content, size_t len) { send(code, content_type, (const char*)content, len); }
+    void send_P(int code, PGM_P content_type, PGM_P content) { send(code, content_type, content); }
+    void send_P(int code, PGM_P content_type, PGM_P content, size_t len) { send(code, content_type, content, len); }
+
+    void enableDelay(bool value) { _nullDelay = value; }
+    void enableCORS(bool value = true) { _cors = value; }
+    void enableCrossOrigin(bool value = true) { enableCORS(value); }
+
+    void setContentLength(const size_t contentLength) { _contentLength = contentLength; }
+    void sendHeader(const String& name, const String& value, bool first = false);
+    void sendContent(const String& content) { sendContent(content.c_str(), content.length()); }
+    void sendContent(const char* content, size_t len);
+    void sendContent_P(PGM_P content) { sendContent(content, strlen(content)); }
+    void sendContent_P(PGM_P content, size_t len) { sendContent(content, len); }
+
+    // ===== только хост =====
+    std::shared_ptr<tkwmHost::HttpConn> hostQueue(const std::string& raw); // запрос из памяти
+    uint16_t    hostPort() const { return _port; }                          // фактический порт после begin()
+    static void hostListen(bool on);                                        // следующие begin() слушают TCP
+    uint32_t    hostServed() const { return _served; }
+
+private:
+    struct Handler {
+        String           uri;
+        HTTPMethod       method;
+        THandlerFunction fn, ufn;
+    };
+    struct Kv {
+        String key, value;
+    };
+
+    bool  parseRequest();
+    void  handleRequest();
+    void  finish();
+    void  prepareHeader(String& out, int code, const char* type, size_t len);
+    void  parseArgs(const std::string& q);
+    bool  parseMultipart(const std::string& body, const std::string& boundary);
+    void  writeOut(const char* p, size_t n);
+    int   findHandler() const;
+
+    uint16_t _port;
+    int      _listenFd = -1;
+    bool     _nullDelay = true;
+    bool     _cors      = false;
+    uint32_t _served    = 0;
+
+    std::vector<Handler> _handlers;
+    THandlerFunction     _notFound, _fileUpload;
+    std::vector<String>  _collect;
+
+    std::deque<std::shared_ptr<tkwmHost::HttpConn>> _pending;
+    std::shared_ptr<tkwmHost::HttpConn>             _cur;
+    uint32_t _curSince = 0;
+    bool     _waitClose = false;                     // ответ отдан, ждём закрытия клиентом (HC_WAIT_CLOSE)
+    int      _curHandler = -1;
+
+    String              _uri, _hostHeader, _responseHeaders;
+    HTTPMethod          _method = HTTP_ANY;
+    std::vector<Kv>     _args, _headers;
+    std::unique_ptr<HTTPUpload> _upload;
+    size_t              _contentLength = CONTENT_LENGTH_NOT_SET;
+    bool                _chunked = false;
+};
@@ -0,0 +1,55 @@
+#pragma once
+// Хост-замена WebSocketsServer (arduinoWebSockets): клиенты живут в памяти процесса (tkwmHost::wsConnect),
+// события доставляет loop(), как у настоящей библиотеки.
+#include <Arduino.h>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+typedef enum {
+    WStype_ERROR, WStype_DISCONNECTED, WStype_CONNECTED, WStype_TEXT, WStype_BIN,
+    WStype_FRAGMENT_TEXT_START, WStype_FRAGMENT_BIN_START, WStype_FRAGMENT, WStype_FRAGMENT_FIN,
+    WStype_PING, WStype_PONG
+} WStype_t;
+
+#define WEBSOCKETS_SERVER_CLIENT_MAX 5
+
+class WebSocketsServer {
+public:
+    typedef std::function<void(uint8_t num, WStype_t type, uint8_t* payload, size_t length)> WebSocketServerEvent;
+
+    explicit WebSocketsServer(uint16_t port, const String& origin = "", const String& protocol = "arduino") : _port(port) {}
+    virtual ~WebSocketsServer() {}
+
+    void begin() { _running = true; }
+    void close() { _running = false; }
+    void loop();
+    void onEvent(WebSocketServerEvent cb) { _cb = cb; }
+
+    bool sendTXT(uint8_t num, const uint8_t* payload, size_t length = 0);
+    bool sendTXT(uint8_t num, const char* payload, size_t length = 0) { return sendTXT(num, (const uint8_t*)payload, length); }
+    bool sendTXT(uint8_t num, const String& payload) { return sendTXT(num, payload.c_str(), payload.length()); }
+    bool broadcastTXT(const uint8_t* payload, size_t length = 0);
+    bool broadcastTXT(const char* payload, size_t length = 0) { return broadcastTXT((const uint8_t*)payload, length); }
+    bool broadcastTXT(const String& payload) { return broadcastTXT(payload.c_str(), payload.length()); }
+    void disconnect(uint8_t num);
+    uint8_t connectedClients(bool ping = false);
+
+    // ===== только хост =====
+    struct HostClient {
+        bool connected = false;
+        std::deque<std::pair<WStype_t, std::string>> toServer; // ждут доставки в loop()
+        std::vector<std::string> received;                      // отправленное сервером
+    };
+    std::map<uint8_t, HostClient>& hostClients() { return _clients; }
+    uint64_t hostTxBytes() const { return _tx; }
+
+private:
+    uint16_t             _port;
+    bool                 _running = false;
+    WebSocketServerEvent _cb;
+    std::map<uint8_t, HostClient> _clients;
+    uint64_t             _tx = 0;
+};
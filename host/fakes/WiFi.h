@@ -0,0 +1,99 @@
+#pragma once
+// Хост-замена WiFi (ядро ESP32): вызовы уходят в эмулятор радио текущего устройства (host_sim.h).
+#include <Arduino.h>
+#include <IPAddress.h>
+#include "esp_wifi.h"
+
+typedef enum {
+    WL_NO_SHIELD = 255, WL_IDLE_STATUS = 0, WL_NO_SSID_AVAIL, WL_SCAN_COMPLETED, WL_CONNECTED,
+    WL_CONNECT_FAILED, WL_CONNECTION_LOST, WL_DISCONNECTED
+} wl_status_t;
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+
+typedef enum {
+    ARDUINO_EVENT_WIFI_READY = 0, ARDUINO_EVENT_WIFI_SCAN_DONE, ARDUINO_EVENT_WIFI_STA_START, ARDUINO_EVENT_WIFI_STA_STOP,
+    ARDUINO_EVENT_WIFI_STA_CONNECTED, ARDUINO_EVENT_WIFI_STA_DISCONNECTED, ARDUINO_EVENT_WIFI_STA_AUTHMODE_CHANGE,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP, ARDUINO_EVENT_WIFI_STA_GOT_IP6, ARDUINO_EVENT_WIFI_STA_LOST_IP,
+    ARDUINO_EVENT_WIFI_AP_START, ARDUINO_EVENT_WIFI_AP_STOP, ARDUINO_EVENT_MAX
+} arduino_event_id_t;
+
+typedef struct { uint8_t ssid[33]; uint8_t ssid_len; uint8_t bssid[6]; uint8_t reason; } wifi_event_sta_disconnected_t;
+typedef struct { uint8_t ssid[33]; uint8_t ssid_len; uint8_t bssid[6]; uint8_t channel; } wifi_event_sta_connected_t;
+typedef struct { uint32_t status; uint8_t number; uint8_t scan_id; } wifi_event_sta_scan_done_t;
+typedef union {
+    wifi_event_sta_disconnected_t wifi_sta_disconnected;
+    wifi_event_sta_connected_t    wifi_sta_connected;
+    wifi_event_sta_scan_done_t    wifi_scan_done;
+} arduino_event_info_t;
+typedef arduino_event_id_t   WiFiEvent_t;
+typedef arduino_event_info_t WiFiEventInfo_t;
+typedef size_t               wifi_event_id_t;
+typedef std::function<void(arduino_event_id_t event, arduino_event_info_t info)> WiFiEventFuncCb;
+
+class WiFiClass {
+public:
+    // режим
+    bool        mode(wifi_mode_t m);
+    wifi_mode_t getMode();
+    bool        enableSTA(bool on);
+    bool        enableAP(bool on);
+    bool        setSleep(bool on);
+    bool        setAutoReconnect(bool on);
+    bool        getAutoReconnect();
+    bool        setHostname(const char*) { return true; }
+
+    // STA
+    wl_status_t status();
+    wl_status_t begin(const char* ssid, const char* pass = nullptr, int32_t channel = 0, const uint8_t* bssid = nullptr, bool connect = true);
+    wl_status_t begin(const String& ssid, const String& pass = String(), int32_t channel = 0, const uint8_t* bssid = nullptr, bool connect = true) {
+        return begin(ssid.c_str(), pass.c_str(), channel, bssid, connect);
+    }
+    bool disconnect(bool wifioff = false, bool eraseap = false);
+    bool reconnect();
+    bool isConnected() { return status() == WL_CONNECTED; }
+    bool config(IPAddress ip, IPAddress gw, IPAddress mask, IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress());
+    IPAddress localIP();
+    IPAddress gatewayIP();
+    IPAddress subnetMask();
+    IPAddress dnsIP(uint8_t n = 0);
+    String    SSID();
+    String    psk();
+    int8_t    RSSI();
+    int32_t   channel();
+    uint8_t*  BSSID();
+    String    BSSIDstr();
+    String    macAddress();
+    uint8_t*  macAddress(uint8_t* mac);
+
+    // скан
+    int16_t scanNetworks(bool async = false, bool showHidden = false, bool passive = false, uint32_t maxMsPerChan = 300,
+                         uint8_t channel = 0, const char* ssid = nullptr, const uint8_t* bssid = nullptr);
+    int16_t scanComplete();
+    void    scanDelete();
+    String  SSID(uint8_t i);
+    int32_t RSSI(uint8_t i);
+    int32_t channel(uint8_t i);
+    uint8_t* BSSID(uint8_t i);
+    String  BSSIDstr(uint8_t i);
+    wifi_auth_mode_t encryptionType(uint8_t i);
+
+    // AP
+    bool      softAP(const char* ssid, const char* pass = nullptr, int channel = 1, int hidden = 0, int maxConn = 4);
+    bool      softAP(const String& ssid, const String& pass = String(), int channel = 1, int hidden = 0, int maxConn = 4) {
+        return softAP(ssid.c_str(), pass.length() ? pass.c_str() : nullptr, channel, hidden, maxConn);
+    }
+    bool      softAPConfig(IPAddress ip, IPAddress gw, IPAddress mask);
+    bool      softAPdisconnect(bool wifioff = false);
+    IPAddress softAPIP();
+    uint8_t   softAPgetStationNum();
+    String    softAPSSID();
+
+    // события
+    wifi_event_id_t onEvent(WiFiEventFuncCb cb, arduino_event_id_t event = ARDUINO_EVENT_MAX);
+    void            removeEvent(wifi_event_id_t id);
+
+    int hostByName(const char* host, IPAddress& out);
+};
+extern WiFiClass WiFi;
@@ -0,0 +1,41 @@
+#pragma once
+// Хост-замена WiFiClient ядра ESP32: TCP-сокет ПК. Копии разделяют один сокет, read()/available() не блокируют
+// (как приёмный буфер ядра), ожидание с таймаутом — через Stream::timedRead.
+#include <Arduino.h>
+#include <IPAddress.h>
+#include <memory>
+#include <string>
+
+class WiFiClient : public Stream {
+public:
+    WiFiClient();
+    explicit WiFiClient(int fd);
+    virtual ~WiFiClient();
+
+    virtual int connect(IPAddress ip, uint16_t port) { return connect(ip, port, 3000); }
+    virtual int connect(IPAddress ip, uint16_t port, int32_t timeoutMs);
+    virtual int connect(const char* host, uint16_t port) { return connect(host, port, 3000); }
+    virtual int connect(const char* host, uint16_t port, int32_t timeoutMs);
+
+    size_t  write(uint8_t c) override { return write(&c, 1); }
+    size_t  write(const uint8_t* buf, size_t n) override;
+    int     available() override;
+    int     read() override;
+    virtual int read(uint8_t* buf, size_t n);
+    int     peek() override;
+    void    flush() override {}
+    virtual void    stop();
+    virtual uint8_t connected();
+    explicit operator bool() { return connected(); }
+
+    int       setTimeout(uint32_t seconds) { Stream::setTimeout(seconds * 1000); return 0; }
+    int       setNoDelay(bool on);
+    int       fd() const;
+    IPAddress remoteIP() const;
+    uint16_t  remotePort() const;
+
+protected:
+    struct Sock;
+    std::shared_ptr<Sock> _s;
+    bool fill();
+};
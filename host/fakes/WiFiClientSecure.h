@@ -0,0 +1,18 @@
+#pragma once
+// Хост-замена WiFiClientSecure: TLS на ПК не эмулируется — соединение открытое (стенд отвечает по HTTP).
+#include <WiFiClient.h>
+
+class WiFiClientSecure : public WiFiClient {
+public:
+    void setInsecure() { _insecure = true; }
+    void setCACert(const char* ca) { _ca = ca; }
+    using WiFiClient::connect;
+    int connect(IPAddress ip, uint16_t port, const char* host, const char* ca, const char* cert, const char* key) {
+        (void)host; (void)ca; (void)cert; (void)key;
+        return WiFiClient::connect(ip, port, 15000);
+    }
+
+private:
+    bool        _insecure = false;
+    const char* _ca       = nullptr;
+};
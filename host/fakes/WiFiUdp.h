@@ -0,0 +1,21 @@
+#pragma once
+// Хост-замена WiFiUDP: discovery-пакеты не приходят, ответы отбрасываются.
+#include <IPAddress.h>
+class WiFiUDP : public Stream {
+public:
+    uint8_t   begin(uint16_t) { return 1; }
+    void      stop() {}
+    int       parsePacket() { return 0; }
+    int       available() override { return 0; }
+    int       read() override { return -1; }
+    int       read(char*, size_t) { return 0; }
+    int       read(uint8_t*, size_t) { return 0; }
+    int       peek() override { return -1; }
+    IPAddress remoteIP() { return IPAddress(); }
+    uint16_t  remotePort() { return 0; }
+    int       beginPacket(IPAddress, uint16_t) { return 1; }
+    int       endPacket() { return 1; }
+    size_t    write(uint8_t) override { return 1; }
+    size_t    write(const uint8_t*, size_t n) override { return n; }
+    using Print::write;
+};
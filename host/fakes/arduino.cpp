@@ -0,0 +1,287 @@
+// Ядро Arduino на ПК: Print/Stream, Serial, время, случайные числа, ESP.*, FreeRTOS поверх pthread.
+#include "host_sim.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <pthread.h>
+#include <random>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace tkwmHost {
+void pumpReal();
+}
+
+// ===================== Print / Stream =====================
+size_t Print::printf(const char* fmt, ...) {
+    char    small[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(small, sizeof(small), fmt, ap);
+    va_end(ap);
+    if (n < 0) return 0;
+    if ((size_t)n < sizeof(small)) return write((const uint8_t*)small, n);
+    std::string big((size_t)n + 1, '\0');
+    va_start(ap, fmt);
+    vsnprintf(&big[0], big.size(), fmt, ap);
+    va_end(ap);
+    return write((const uint8_t*)big.data(), n);
+}
+
+int Stream::timedRead() {
+    const unsigned long t0 = millis();
+    do {
+        const int c = read();
+        if (c >= 0) return c;
+        delay(1);
+    } while (millis() - t0 < _timeout);
+    return -1;
+}
+
+int Stream::timedPeek() {
+    const unsigned long t0 = millis();
+    do {
+        const int c = peek();
+        if (c >= 0) return c;
+        delay(1);
+    } while (millis() - t0 < _timeout);
+    return -1;
+}
+
+size_t Stream::readBytes(char* buf, size_t n) {
+    size_t k = 0;
+    while (k < n) {
+        const int c = timedRead();
+        if (c < 0) break;
+        buf[k++] = (char)c;
+    }
+    return k;
+}
+
+size_t Stream::readBytesUntil(char term, char* buf, size_t n) {
+    size_t k = 0;
+    while (k < n) {
+        const int c = timedRead();
+        if (c < 0 || c == term) break;
+        buf[k++] = (char)c;
+    }
+    return k;
+}
+
+String Stream::readString() {
+    String s;
+    for (int c; (c = timedRead()) >= 0;) s += (char)c;
+    return s;
+}
+
+String Stream::readStringUntil(char term) {
+    String s;
+    for (int c; (c = timedRead()) >= 0 && c != term;) s += (char)c;
+    return s;
+}
+
+bool Stream::find(const char* target) {
+    const size_t n = strlen(target);
+    size_t       k = 0;
+    for (int c; n && (c = timedRead()) >= 0;) {
+        k = (c == target[k]) ? k + 1 : (c == target[0] ? 1 : 0);
+        if (k == n) return true;
+    }
+    return !n;
+}
+
+// ===================== Serial =====================
+HardwareSerial Serial;
+
+namespace {
+std::mutex  g_serialMu;
+std::string g_serialBuf;
+int         g_serialEcho = -1;
+
+bool serialEchoOn() {
+    if (g_serialEcho < 0) {
+        const char* e = getenv("TKWM_HOST_SERIAL");
+        g_serialEcho  = (e && *e && *e != '0') ? 1 : 0;
+    }
+    return g_serialEcho == 1;
+}
+}
+
+size_t HardwareSerial::write(uint8_t c) { return write(&c, 1); }
+
+size_t HardwareSerial::write(const uint8_t* b, size_t n) {
+    std::lock_guard<std::mutex> lk(g_serialMu);
+    if (serialEchoOn()) {
+        fwrite(b, 1, n, stderr);
+        return n;
+    }
+    g_serialBuf.append((const char*)b, n);
+    if (g_serialBuf.size() > 256 * 1024) g_serialBuf.erase(0, g_serialBuf.size() - 128 * 1024); // хвост журнала
+    return n;
+}
+
+void tkwmHost::serialEcho(bool on) { g_serialEcho = on ? 1 : 0; }
+
+std::string tkwmHost::serialTake() {
+    std::lock_guard<std::mutex> lk(g_serialMu);
+    std::string s;
+    s.swap(g_serialBuf);
+    return s;
+}
+
+// ===================== время, случайные числа, CRC =====================
+unsigned long millis() {
+    tkwmHost::pumpReal();
+    return (unsigned long)(uint32_t)(tkwmHost::nowUs() / 1000);
+}
+
+unsigned long micros() { return (unsigned long)(uint32_t)tkwmHost::nowUs(); }
+
+void delay(uint32_t ms) { tkwmHost::advanceUs((uint64_t)ms * 1000); }
+
+void delayMicroseconds(uint32_t us) { tkwmHost::advanceUs(us); }
+
+void yield() { tkwmHost::advanceUs(0); }
+
+static std::mt19937& tkwmHostRng_() {
+    static std::mt19937 rng(12345); // воспроизводимые прогоны
+    return rng;
+}
+
+long random(long howbig) { return howbig > 0 ? (long)(tkwmHostRng_()() % (uint32_t)howbig) : 0; }
+long random(long a, long b) { return b > a ? a + random(b - a) : a; }
+void randomSeed(unsigned long seed) { tkwmHostRng_().seed((uint32_t)seed); }
+extern "C" uint32_t esp_random() { return tkwmHostRng_()(); }
+
+// ROM ESP32: crc32_le(0, …) совпадает с crc32 zlib (отражённый полином, инверсия на входе и выходе).
+extern "C" uint32_t crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len) { return (uint32_t)crc32(crc, buf, len); }
+
+// ===================== ESP / heap =====================
+EspClass ESP;
+
+static const uint32_t kTkwmHostHeap = 320 * 1024; // DRAM типичного ESP32 после старта Wi-Fi
+
+void EspClass::restart() { tkwmHost::device().restarts++; }
+
+uint64_t EspClass::getEfuseMac() {
+    uint64_t v = 0;
+    for (int i = 5; i >= 0; i--) v = (v << 8) | tkwmHost::device().mac[i];
+    return v;
+}
+
+uint32_t EspClass::getHeapSize() { return kTkwmHostHeap; }
+uint32_t EspClass::getFreeHeap() { return kTkwmHostHeap - (uint32_t)std::min<size_t>(tkwmHost::heapUsed(), kTkwmHostHeap); }
+uint32_t EspClass::getMinFreeHeap() { return kTkwmHostHeap - (uint32_t)std::min<size_t>(tkwmHost::heapPeak(), kTkwmHostHeap); }
+uint32_t EspClass::getMaxAllocHeap() { return getFreeHeap() / 4 * 3; }
+
+size_t heap_caps_get_free_size(uint32_t) { return ESP.getFreeHeap(); }
+size_t heap_caps_get_largest_free_block(uint32_t) { return ESP.getMaxAllocHeap(); }
+size_t heap_caps_get_minimum_free_size(uint32_t) { return ESP.getMinFreeHeap(); }
+
+// ===================== FreeRTOS =====================
+namespace {
+struct Task {
+    TaskFunction_t fn;
+    void*          arg;
+    pthread_t      th;
+    UBaseType_t    prio;
+};
+thread_local Task* t_task = nullptr;
+
+void* taskMain(void* p) {
+    t_task = (Task*)p;
+    t_task->fn(t_task->arg);
+    return nullptr; // задача FreeRTOS не возвращается — выход без vTaskDelete тоже завершает поток
+}
+
+struct Queue {
+    std::mutex              mu;
+    std::condition_variable cv;
+    std::deque<std::string> items;
+    size_t                  len, itemSize;
+    bool                    mutex = false;
+
+    // Ожидание в ms (portMAX_DELAY — бесконечно), в реальном времени: очередь связывает потоки ПК.
+    template <typename P> bool waitFor(std::unique_lock<std::mutex>& lk, TickType_t wait, P pred) {
+        if (wait == portMAX_DELAY) {
+            cv.wait(lk, pred);
+            return true;
+        }
+        return cv.wait_for(lk, std::chrono::milliseconds(wait), pred);
+    }
+};
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char*, uint32_t, void* arg, UBaseType_t prio, TaskHandle_t* out) {
+    Task* t = new Task{fn, arg, {}, prio};
+    if (pthread_create(&t->th, nullptr, taskMain, t) != 0) {
+        delete t;
+        return pdFAIL;
+    }
+    pthread_detach(t->th);
+    if (out) *out = t;
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* arg, UBaseType_t prio, TaskHandle_t* out, BaseType_t) {
+    return xTaskCreate(fn, name, stack, arg, prio, out);
+}
+
+void vTaskDelete(TaskHandle_t t) {
+    if (t && t != t_task) return; // удалять чужие задачи библиотека не умеет и не просит
+    if (!t_task) return;          // основной поток (loopTask) не завершаем
+    pthread_exit(nullptr);
+}
+
+void vTaskDelay(TickType_t ticks) { delay(ticks * portTICK_PERIOD_MS); }
+TickType_t xTaskGetTickCount() { return (TickType_t)millis(); }
+TaskHandle_t xTaskGetCurrentTaskHandle() { return t_task; }
+UBaseType_t uxTaskPriorityGet(TaskHandle_t t) { Task* k = t ? (Task*)t : t_task; return k ? k->prio : 1; }
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 2048; }
+
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t itemSize) {
+    Queue* q    = new Queue;
+    q->len      = len;
+    q->itemSize = itemSize;
+    return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t h, const void* item, TickType_t wait) {
+    Queue* q = (Queue*)h;
+    std::unique_lock<std::mutex> lk(q->mu);
+    if (!q->waitFor(lk, wait, [q] { return q->items.size() < q->len; })) return pdFALSE;
+    q->items.push_back(q->itemSize ? std::string((const char*)item, q->itemSize) : std::string());
+    q->cv.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t h, void* item, TickType_t wait) {
+    Queue* q = (Queue*)h;
+    std::unique_lock<std::mutex> lk(q->mu);
+    if (!q->waitFor(lk, wait, [q] { return !q->items.empty(); })) return pdFALSE;
+    if (q->itemSize) memcpy(item, q->items.front().data(), q->itemSize);
+    q->items.pop_front();
+    q->cv.notify_all();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t h) {
+    Queue* q = (Queue*)h;
+    std::lock_guard<std::mutex> lk(q->mu);
+    return (UBaseType_t)q->items.size();
+}
+
+void vQueueDelete(QueueHandle_t h) { delete (Queue*)h; }
+
+SemaphoreHandle_t xSemaphoreCreateBinary() { return xQueueCreate(1, 0); }
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    Queue* q = (Queue*)xQueueCreate(1, 0);
+    q->mutex = true;
+    q->items.emplace_back(); // мьютекс создаётся свободным
+    return q;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait) { return xQueueReceive(s, nullptr, wait); }
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s) { return xQueueSend(s, nullptr, 0); }
+void vSemaphoreDelete(SemaphoreHandle_t s) { vQueueDelete(s); }
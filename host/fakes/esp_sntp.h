@@ -0,0 +1,5 @@
+#pragma once
+// Хост-замена esp_sntp.h: уведомление о синхронизации приходит через 50 мс виртуального времени, если есть IP.
+#include <sys/time.h>
+typedef void (*sntp_sync_time_cb_t)(struct timeval* tv);
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t cb);
@@ -0,0 +1,221 @@
+// FS поверх каталога ПК: путь "/a/b" устройства → <fsRoot>/a/b. Поведение как у LittleFS ядра ESP32:
+// открытие отсутствующего файла на чтение — пустой File, name() — последний компонент пути.
+#include "host_sim.h"
+#include <FS.h>
+#include <LittleFS.h>
+#include <SPIFFS.h>
+#include <dirent.h>
+#include <filesystem>
+#include <sys/stat.h>
+#include <unistd.h>
+
+LittleFSFS LittleFS;
+SPIFFSFS   SPIFFS;
+
+namespace stdfs = std::filesystem;
+
+namespace fs {
+
+struct FileImpl {
+    FILE*       f = nullptr;
+    bool        dir = false;
+    std::string path, host, name;
+    std::vector<std::string> entries;   // каталог: имена при открытии
+    size_t      next = 0;
+    ~FileImpl() {
+        if (f) fclose(f);
+    }
+};
+
+} // namespace fs
+
+namespace {
+
+bool mounted() { return tkwmHost::device().fsMounted; }
+
+std::string norm(const char* p) {
+    std::string s = p ? p : "";
+    if (s.empty() || s[0] != '/') s = "/" + s;
+    while (s.size() > 1 && s.back() == '/') s.pop_back();
+    return s;
+}
+
+std::string hostPath(const std::string& p) { return tkwmHost::device().fsRoot + (p == "/" ? "" : p); }
+
+fs::FileImplPtr openImpl(const std::string& path, const char* mode) {
+    const std::string h = hostPath(path);
+    struct stat st;
+    const bool exists = stat(h.c_str(), &st) == 0;
+    auto impl  = std::make_shared<fs::FileImpl>();
+    impl->path = path;
+    impl->host = h;
+    impl->name = path == "/" ? "/" : path.substr(path.rfind('/') + 1);
+    if (exists && S_ISDIR(st.st_mode)) {
+        impl->dir = true;
+        if (DIR* d = opendir(h.c_str())) {
+            while (dirent* e = readdir(d))
+                if (strcmp(e->d_name, ".") && strcmp(e->d_name, "..")) impl->entries.push_back(e->d_name);
+            closedir(d);
+        }
+        std::sort(impl->entries.begin(), impl->entries.end());
+        return impl;
+    }
+    if (!exists && mode[0] == 'r') return nullptr;
+    std::string m = mode;
+    if (m.find('b') == std::string::npos) m += 'b';
+    impl->f = fopen(h.c_str(), m.c_str());
+    return impl->f ? impl : nullptr;
+}
+
+} // namespace
+
+namespace fs {
+
+size_t File::write(uint8_t c) { return write(&c, 1); }
+size_t File::write(const uint8_t* buf, size_t n) { return _p && _p->f ? fwrite(buf, 1, n, _p->f) : 0; }
+
+int File::available() {
+    if (!_p || !_p->f) return 0;
+    const long s = (long)size(), p = ftell(_p->f);
+    return s > p ? (int)(s - p) : 0;
+}
+
+int File::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek() {
+    if (!_p || !_p->f) return -1;
+    const int c = fgetc(_p->f);
+    if (c != EOF) ungetc(c, _p->f);
+    return c == EOF ? -1 : c;
+}
+
+void File::flush() {
+    if (_p && _p->f) fflush(_p->f);
+}
+
+size_t File::read(uint8_t* buf, size_t n) { return _p && _p->f ? fread(buf, 1, n, _p->f) : 0; }
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+    if (!_p || !_p->f) return false;
+    const int w = mode == SeekSet ? SEEK_SET : mode == SeekCur ? SEEK_CUR : SEEK_END;
+    if (mode == SeekSet && pos > size()) return false;
+    return fseek(_p->f, (long)pos, w) == 0;
+}
+
+size_t File::position() const { return _p && _p->f ? (size_t)ftell(_p->f) : 0; }
+
+size_t File::size() const {
+    if (!_p || !_p->f) return 0;
+    fflush(_p->f);
+    struct stat st;
+    return fstat(fileno(_p->f), &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+void File::close() { _p.reset(); }
+
+File::operator bool() const { return (bool)_p; }
+
+time_t File::getLastWrite() {
+    if (!_p) return 0;
+    if (_p->f) fflush(_p->f);
+    struct stat st;
+    return stat(_p->host.c_str(), &st) == 0 ? st.st_mtime : 0;
+}
+
+const char* File::path() const { return _p ? _p->path.c_str() : nullptr; }
+const char* File::name() const { return _p ? _p->name.c_str() : nullptr; }
+boolean File::isDirectory() { return _p && _p->dir; }
+
+File File::openNextFile(const char* mode) {
+    if (!_p || !_p->dir) return File();
+    while (_p->next < _p->entries.size()) {
+        const std::string child = (_p->path == "/" ? "" : _p->path) + "/" + _p->entries[_p->next++];
+        if (auto impl = openImpl(child, mode)) return File(impl);
+    }
+    return File();
+}
+
+String File::getNextFileName() {
+    if (!_p || !_p->dir || _p->next >= _p->entries.size()) return String();
+    return String((_p->path == "/" ? "" : _p->path) + "/" + _p->entries[_p->next++]);
+}
+
+void File::rewindDirectory() {
+    if (_p) _p->next = 0;
+}
+
+File FS::open(const char* path, const char* mode, const bool create) {
+    if (!mounted() || !path) return File();
+    const std::string p = norm(path);
+    if (create && mode[0] != 'r') {
+        std::error_code ec;
+        stdfs::create_directories(stdfs::path(hostPath(p)).parent_path(), ec);
+    }
+    return File(openImpl(p, mode));
+}
+
+bool FS::exists(const char* path) {
+    struct stat st;
+    return mounted() && path && stat(hostPath(norm(path)).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char* path) {
+    if (!mounted() || !path) return false;
+    const std::string h = hostPath(norm(path));
+    struct stat st;
+    return stat(h.c_str(), &st) == 0 && !S_ISDIR(st.st_mode) && unlink(h.c_str()) == 0;
+}
+
+bool FS::rename(const char* from, const char* to) {
+    return mounted() && from && to && ::rename(hostPath(norm(from)).c_str(), hostPath(norm(to)).c_str()) == 0;
+}
+
+bool FS::mkdir(const char* path) {
+    if (!mounted() || !path) return false;
+    const std::string h = hostPath(norm(path));
+    struct stat st;
+    if (stat(h.c_str(), &st) == 0) return S_ISDIR(st.st_mode);
+    return ::mkdir(h.c_str(), 0755) == 0;
+}
+
+bool FS::rmdir(const char* path) { return mounted() && path && ::rmdir(hostPath(norm(path)).c_str()) == 0; }
+
+} // namespace fs
+
+bool TkwmHostFS::begin(bool, const char*, uint8_t, const char*) {
+    tkwmHost::Device& d = tkwmHost::device();
+    if (d.fsRoot.empty()) {
+        char tmpl[] = "/tmp/tkwm-fs-XXXXXX";
+        if (!mkdtemp(tmpl)) return false;
+        d.fsRoot = tmpl;
+        d.fsTemp = true;
+    }
+    std::error_code ec;
+    stdfs::create_directories(d.fsRoot, ec);
+    d.fsMounted = stdfs::is_directory(d.fsRoot, ec);
+    return d.fsMounted;
+}
+
+bool TkwmHostFS::format() {
+    tkwmHost::Device& d = tkwmHost::device();
+    if (d.fsRoot.empty()) return false;
+    std::error_code ec;
+    for (auto& e : stdfs::directory_iterator(d.fsRoot, ec)) stdfs::remove_all(e.path(), ec);
+    return !ec;
+}
+
+void TkwmHostFS::end() { tkwmHost::device().fsMounted = false; }
+
+size_t TkwmHostFS::totalBytes() { return 1408 * 1024; } // раздел spiffs схемы «default» (4 МБ flash)
+
+size_t TkwmHostFS::usedBytes() {
+    size_t used = 0;
+    std::error_code ec;
+    if (!mounted()) return 0;
+    for (auto& e : stdfs::recursive_directory_iterator(tkwmHost::device().fsRoot, ec))
+        used += e.is_regular_file(ec) ? (e.file_size(ec) + 4095) / 4096 * 4096 : 4096; // блоки LittleFS по 4 КБ
+    return used;
+}
@@ -0,0 +1,59 @@
+// Учёт кучи: malloc/free процесса перехватываются, ESP.getFreeHeap() и тесты видят занятое и пик.
+#include "host_sim.h"
+#include <atomic>
+#include <errno.h>
+#include <malloc.h>
+
+extern "C" {
+void* __libc_malloc(size_t);
+void* __libc_calloc(size_t, size_t);
+void* __libc_realloc(void*, size_t);
+void* __libc_memalign(size_t, size_t);
+void  __libc_free(void*);
+}
+
+namespace {
+std::atomic<size_t> g_used{0}, g_peak{0}, g_failSize{0};
+
+void* counted(void* p) {
+    if (p) {
+        const size_t u = g_used += malloc_usable_size(p);
+        size_t pk = g_peak;
+        while (u > pk && !g_peak.compare_exchange_weak(pk, u)) {}
+    }
+    return p;
+}
+
+void uncount(void* p) {
+    if (p) g_used -= malloc_usable_size(p);
+}
+}
+
+extern "C" {
+void* malloc(size_t n) { return n && n == g_failSize ? nullptr : counted(__libc_malloc(n)); }
+void* calloc(size_t a, size_t b) { return counted(__libc_calloc(a, b)); }
+void  free(void* p) {
+    uncount(p);
+    __libc_free(p);
+}
+void* realloc(void* p, size_t n) {
+    const size_t old = p ? malloc_usable_size(p) : 0;
+    void* q = __libc_realloc(p, n);
+    if (!q) return q == p ? q : nullptr;
+    g_used -= old;
+    return counted(q);
+}
+void* memalign(size_t al, size_t n) { return counted(__libc_memalign(al, n)); }
+void* aligned_alloc(size_t al, size_t n) { return counted(__libc_memalign(al, n)); }
+int   posix_memalign(void** out, size_t al, size_t n) {
+    void* p = counted(__libc_memalign(al, n));
+    if (!p) return ENOMEM;
+    *out = p;
+    return 0;
+}
+}
+
+size_t tkwmHost::heapUsed() { return g_used; }
+size_t tkwmHost::heapPeak() { return g_peak; }
+void   tkwmHost::heapPeakReset() { g_peak = g_used.load(); }
+void   tkwmHost::heapFailSize(size_t n) { g_failSize = n; }
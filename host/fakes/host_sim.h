@@ -0,0 +1,155 @@
+#pragma once
+// Управление хост-симуляцией: виртуальное время, эфир (точки доступа), устройства (радио, NVS, FS, flash),
+// HTTP/WS-запросы без сокетов. Подключается тестами и драйвером; сама библиотека о нём не знает.
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WebServer.h>
+#include <WebSocketsServer.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tkwmHost {
+
+// ===== время =====
+// Виртуальные часы в мкс: millis()/micros() читают их, delay() и advance() двигают и доставляют события эфира.
+// realTime(true) — монотонные часы ПК (нужны, когда участвуют настоящие сокеты и потоки).
+uint64_t nowUs();
+inline uint32_t nowMs() { return (uint32_t)(nowUs() / 1000); }
+void advanceUs(uint64_t us);
+inline void advance(uint32_t ms) { advanceUs((uint64_t)ms * 1000); }
+void realTime(bool on);
+bool isRealTime();
+
+// ===== эфир =====
+struct Ap {
+    String   ssid, pass;            // pass пустой — открытая сеть
+    uint8_t  bssid[6] = {};
+    uint8_t  ch       = 1;
+    int8_t   rssi     = -55;
+    bool     up       = true;
+    uint32_t assocMs    = 150;      // эфирное время AP на одну ассоциацию; очередь обслуживается по одной
+    uint32_t dhcpMs     = 250;      // от ассоциации до IP
+    uint32_t probeMs    = 3;        // эфирное время ответов на один активный скан
+    uint32_t queueMaxMs = 3000;     // дольше клиент ассоциацию не ждёт — провал WIFI_REASON_AUTH_EXPIRE
+    uint32_t bootMs     = 0;        // после apSet(up=true) столько мс не отвечает (перезагрузка точки)
+    uint16_t rttMs      = 4;        // ping шлюза
+    uint8_t  failReason = 0;        // !=0 — любая попытка проваливается с этой причиной
+    // статистика
+    uint32_t assocOk = 0, assocFail = 0, probes = 0;
+    uint64_t busyUntilUs = 0, upAtUs = 0;
+};
+
+struct Air {
+    std::vector<Ap> aps;
+    uint32_t scanMs       = 2200;   // активный скан всех каналов
+    uint32_t findMs       = 1200;   // WiFi.begin без канала: поиск точки по каналам
+    uint32_t directMs     = 60;     // WiFi.begin с каналом и BSSID
+    uint32_t beaconLossMs = 6000;   // точка пропала → STA_DISCONNECTED (BEACON_TIMEOUT)
+    // Приём WiFiClient: скорость канала и TCP-окно lwIP. Непрочитанного приложением не больше окна —
+    // заполненное окно простаивает канал, как на устройстве. linkBps 0 — без ограничения.
+    uint32_t linkBps = 0;           // байт/с
+    uint32_t tcpWnd  = 5744;        // CONFIG_LWIP_TCP_WND_DEFAULT ядра 2.x
+};
+Air& air();
+int  addAp(const Ap& a);            // индекс точки
+Ap&  ap(int i);
+void apSet(int i, bool up);         // выключение рвёт подключённых через beaconLossMs
+void clearAir();
+
+// ===== устройство =====
+struct Nvs {
+    struct Entry { char type; std::string data; };
+    struct Stats {
+        uint32_t reads = 0, writes = 0, erases = 0, skipped = 0; // skipped — запись того же значения (NVS её не делает)
+        uint64_t bytesWritten = 0;
+        uint64_t us = 0;                                         // виртуальное время операций
+    };
+    std::map<std::string, std::map<std::string, Entry>> ns;
+    uint32_t reads = 0, writes = 0, erases = 0, skipped = 0;
+    uint64_t bytesWritten = 0;
+    std::map<std::string, Stats> perNs;   // те же счётчики по namespace
+    uint32_t readUs = 80, writeUs = 3000; // стоимость операции в виртуальном времени
+    void resetStats() {
+        reads = writes = erases = skipped = 0;
+        bytesWritten = 0;
+        perNs.clear();
+    }
+};
+
+struct Flash {
+    std::vector<uint8_t> image;     // записанное Update.write()
+    uint32_t writeUsPer4k = 0;      // задержка записи сектора (стирание + программирование)
+    uint32_t slowEvery = 0;         // каждый slowEvery-й сектор пишется slowUsPer4k (разброс стирания NOR)
+    uint32_t slowUsPer4k = 0;
+    uint32_t writes = 0;
+    bool     committed = false;
+};
+
+struct Radio;
+
+struct Device {
+    explicit Device(uint32_t id = 0);
+    ~Device();
+    Device(const Device&) = delete;
+    Device& operator=(const Device&) = delete;
+    uint32_t    id;
+    uint8_t     mac[6];
+    Nvs         nvs;
+    Flash       flash;
+    std::string fsRoot;             // каталог ПК под FS; пустой — временный, создаётся при LittleFS.begin()
+    bool        fsTemp    = false;  // fsRoot создан симуляцией — удаляется вместе с устройством
+    bool        fsMounted = false;
+    uint32_t    restarts = 0;       // ESP.restart()
+    Radio*      radio;
+
+    // Перезагрузка питанием: радио (подписки на события, ассоциация, скан, soft AP) и его отложенные события
+    // сбрасываются, NVS/FS/flash остаются. Прежний TKWifiManager к этому моменту должен быть уничтожен.
+    void reboot();
+
+    // наблюдение за радио
+    bool     staConnected() const;  // есть IP
+    int      staAp() const;         // индекс точки или -1
+    uint32_t beginN() const;        // вызовов WiFi.begin/reconnect
+    uint32_t scanN() const;
+    bool     softAp() const;
+};
+Device& device();                   // текущее (по умолчанию — встроенное, id 0)
+void    use(Device& d);
+
+// ===== HTTP без сокетов =====
+struct Response {
+    int code = 0;
+    std::map<std::string, std::string> headers;  // имена в нижнем регистре
+    std::string body;                             // chunked уже собран
+    bool chunked = false;
+    std::string header(const std::string& lowerName) const {
+        auto it = headers.find(lowerName);
+        return it == headers.end() ? std::string() : it->second;
+    }
+};
+bool parseResponse(const std::string& raw, Response& out);
+
+// Запрос кладётся в очередь WebServer и обслуживается его handleClient(); tick() — шаг владельца (loop()).
+Response request(WebServer& web, const std::string& raw, const std::function<void()>& tick, uint32_t maxTicks = 2000);
+std::string rawRequest(const char* method, const std::string& uri, const std::string& body = std::string(),
+                       const std::string& extraHeaders = std::string(), const char* contentType = nullptr);
+
+// ===== WebSocket без сокетов =====
+uint8_t wsConnect(WebSocketsServer& ws);         // событие CONNECTED доставит ws.loop()
+void    wsSend(WebSocketsServer& ws, uint8_t id, const std::string& text);
+void    wsClose(WebSocketsServer& ws, uint8_t id);
+std::vector<std::string> wsTake(WebSocketsServer& ws, uint8_t id); // принятое клиентом с прошлого вызова
+
+// ===== heap =====
+size_t heapUsed();
+size_t heapPeak();
+void   heapPeakReset();
+void   heapFailSize(size_t n);      // malloc ровно n байт возвращает nullptr (0 — выкл.): запасные пути без памяти
+
+// ===== журнал Serial =====
+void serialEcho(bool on);           // по умолчанию — переменная окружения TKWM_HOST_SERIAL
+std::string serialTake();           // накопленный вывод (если эхо выключено)
+
+} // namespace tkwmHost
@@ -0,0 +1,412 @@
+// WiFiClient и HTTPClient ядра ESP32 поверх сокетов ПК.
+#include "host_sim.h"
+#include <HTTPClient.h>
+#include <WiFiClient.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// ===================== WiFiClient =====================
+struct WiFiClient::Sock {
+    int         fd = -1;
+    std::string buf;
+    size_t      pos = 0;
+    // канал tkwmHost::air().linkBps: сколько байт всего «пришло по эфиру» (не больше прочитанного + окно)
+    double      arrived = 0;
+    uint64_t    taken = 0, linkUs = tkwmHost::nowUs();
+    ~Sock() {
+        if (fd >= 0) ::close(fd);
+    }
+    // Доступно приложению: принятое сокетом ПК, но не больше пропущенного каналом.
+    size_t visible() {
+        const size_t        have = buf.size() - pos;
+        const tkwmHost::Air& a   = tkwmHost::air();
+        if (!a.linkBps) return have;
+        const uint64_t now = tkwmHost::nowUs();
+        arrived = std::min(arrived + (double)a.linkBps * (double)(now - linkUs) / 1e6, (double)(taken + a.tcpWnd));
+        linkUs  = now;
+        return std::min(have, (size_t)(arrived - (double)taken));
+    }
+};
+
+WiFiClient::WiFiClient() {}
+
+WiFiClient::WiFiClient(int fd) : _s(std::make_shared<Sock>()) { _s->fd = fd; }
+
+WiFiClient::~WiFiClient() {}
+
+int WiFiClient::connect(const char* host, uint16_t port, int32_t timeoutMs) {
+    IPAddress ip;
+    if (!WiFi.hostByName(host, ip)) return 0;
+    return connect(ip, port, timeoutMs);
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port, int32_t timeoutMs) {
+    stop();
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return 0;
+    sockaddr_in a{};
+    a.sin_family      = AF_INET;
+    a.sin_port        = htons(port);
+    a.sin_addr.s_addr = (uint32_t)ip;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    int r = ::connect(fd, (sockaddr*)&a, sizeof(a));
+    if (r != 0 && errno == EINPROGRESS) {
+        pollfd p{fd, POLLOUT, 0};
+        int       err = 0;
+        socklen_t len = sizeof(err);
+        r = (poll(&p, 1, timeoutMs > 0 ? timeoutMs : 3000) > 0 && getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && !err) ? 0 : -1;
+    }
+    if (r != 0) {
+        ::close(fd);
+        return 0;
+    }
+    const int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    _s     = std::make_shared<Sock>();
+    _s->fd = fd;
+    return 1;
+}
+
+// Непрочитанное из сокета — в буфер без ожидания; false — соединение закрыто или ошибка.
+bool WiFiClient::fill() {
+    if (!_s || _s->fd < 0) return false;
+    if (_s->pos == _s->buf.size()) {
+        _s->buf.clear();
+        _s->pos = 0;
+    }
+    char b[4096];
+    for (;;) {
+        const ssize_t n = recv(_s->fd, b, sizeof(b), MSG_DONTWAIT);
+        if (n > 0) {
+            _s->buf.append(b, (size_t)n);
+            if ((size_t)n < sizeof(b)) return true;
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        if (n < 0 && errno == EINTR) continue;
+        ::close(_s->fd);
+        _s->fd = -1;
+        return false;
+    }
+}
+
+size_t WiFiClient::write(const uint8_t* p, size_t n) {
+    if (!_s || _s->fd < 0) return 0;
+    size_t sent = 0;
+    while (sent < n) {
+        const ssize_t k = send(_s->fd, p + sent, n - sent, MSG_NOSIGNAL);
+        if (k > 0) {
+            sent += (size_t)k;
+            continue;
+        }
+        if (k < 0 && errno == EAGAIN) {
+            pollfd q{_s->fd, POLLOUT, 0};
+            if (poll(&q, 1, (int)getTimeout()) > 0) continue;
+        }
+        break;
+    }
+    return sent;
+}
+
+int WiFiClient::available() {
+    if (!_s) return 0;
+    fill();
+    return (int)_s->visible();
+}
+
+int WiFiClient::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t* buf, size_t n) {
+    if (!_s) return -1;
+    if (_s->pos == _s->buf.size() && !fill()) return -1;
+    const size_t k = std::min(n, _s->visible());
+    memcpy(buf, _s->buf.data() + _s->pos, k);
+    _s->pos += k;
+    _s->taken += k;
+    return (int)k;
+}
+
+int WiFiClient::peek() {
+    if (!available()) return -1;
+    return (uint8_t)_s->buf[_s->pos];
+}
+
+void WiFiClient::stop() {
+    if (_s && _s->fd >= 0) {
+        ::close(_s->fd);
+        _s->fd = -1;
+    }
+    _s.reset();
+}
+
+uint8_t WiFiClient::connected() {
+    if (!_s) return 0;
+    if (_s->pos < _s->buf.size()) return 1;
+    fill();
+    return _s->fd >= 0 || _s->pos < _s->buf.size();
+}
+
+int WiFiClient::setNoDelay(bool on) {
+    const int v = on;
+    return _s && _s->fd >= 0 ? setsockopt(_s->fd, IPPROTO_TCP, TCP_NODELAY, &v, sizeof(v)) : -1;
+}
+
+int WiFiClient::fd() const { return _s ? _s->fd : -1; }
+
+IPAddress WiFiClient::remoteIP() const {
+    sockaddr_in a{};
+    socklen_t   len = sizeof(a);
+    if (!_s || _s->fd < 0 || getpeername(_s->fd, (sockaddr*)&a, &len) != 0) return IPAddress();
+    return IPAddress((uint32_t)a.sin_addr.s_addr);
+}
+
+uint16_t WiFiClient::remotePort() const {
+    sockaddr_in a{};
+    socklen_t   len = sizeof(a);
+    if (!_s || _s->fd < 0 || getpeername(_s->fd, (sockaddr*)&a, &len) != 0) return 0;
+    return ntohs(a.sin_port);
+}
+
+// ===================== HTTPClient =====================
+bool HTTPClient::begin(WiFiClient& client, String url) {
+    if (_client != &client) _own.reset();
+    _client = &client;
+    clear();
+    const int s = url.indexOf("://");
+    if (s < 0) return false;
+    _protocol = url.substring(0, s);
+    url       = url.substring(s + 3);
+    int e     = url.indexOf('/');
+    String hp = e < 0 ? url : url.substring(0, e);
+    _uri      = e < 0 ? String("/") : url.substring(e);
+    const int c = hp.indexOf(':');
+    _host     = c < 0 ? hp : hp.substring(0, c);
+    _port     = c < 0 ? (_protocol == "https" ? 443 : 80) : (uint16_t)hp.substring(c + 1).toInt();
+    return _protocol == "http" || _protocol == "https";
+}
+
+bool HTTPClient::begin(String url) {
+    if (!_own) _own.reset(new WiFiClient);
+    WiFiClient* own = _own.get();
+    _client         = nullptr;
+    return begin(*own, url);
+}
+
+void HTTPClient::clear() {
+    _returnCode = 0;
+    _size       = -1;
+    _headers    = String();
+    _te         = HTTPC_TE_IDENTITY;
+}
+
+void HTTPClient::setTimeout(uint16_t ms) {
+    _tcpTimeout = ms;
+    if (connected()) _client->setTimeout((ms + 500) / 1000);
+}
+
+bool HTTPClient::connected() { return _client && (_client->available() > 0 || _client->connected()); }
+
+bool HTTPClient::connect() {
+    if (connected()) {
+        while (_client->available() > 0) _client->read(); // хвост прошлого ответа
+        return true;
+    }
+    if (!_client) return false;
+    if (!_client->connect(_host.c_str(), _port, _connectTimeout)) return false;
+    _client->setTimeout((_tcpTimeout + 500) / 1000);
+    return true;
+}
+
+void HTTPClient::disconnect(bool preserveClient) {
+    if (connected()) {
+        while (_client->available() > 0) _client->read();
+        if (_reuse && _canReuse) return;
+        _client->stop();
+    }
+    (void)preserveClient;
+}
+
+void HTTPClient::end() {
+    disconnect(false);
+    clear();
+}
+
+void HTTPClient::addHeader(const String& name, const String& value, bool first, bool replace) {
+    if (name.equalsIgnoreCase("Connection") || name.equalsIgnoreCase("User-Agent") || name.equalsIgnoreCase("Host")) return;
+    const String line = name + ": " + value + "\r\n";
+    const int    at   = _headers.indexOf(name + ":");
+    if (at >= 0 && replace) {
+        const int e = _headers.indexOf('\n', at);
+        _headers    = _headers.substring(0, at) + line + _headers.substring(e + 1);
+    } else if (first) _headers = line + _headers;
+    else _headers += line;
+}
+
+void HTTPClient::collectHeaders(const char* keys[], const size_t n) {
+    _resp.clear();
+    for (size_t i = 0; i < n; ++i) _resp.push_back(Kv{keys[i], String()});
+}
+
+String HTTPClient::header(const char* name) {
+    for (auto& h : _resp)
+        if (h.key.equalsIgnoreCase(name)) return h.value;
+    return String();
+}
+String HTTPClient::header(size_t i) { return i < _resp.size() ? _resp[i].value : String(); }
+String HTTPClient::headerName(size_t i) { return i < _resp.size() ? _resp[i].key : String(); }
+bool   HTTPClient::hasHeader(const char* name) { return header(name).length() > 0; }
+
+int HTTPClient::GET() { return sendRequest("GET"); }
+int HTTPClient::POST(uint8_t* payload, size_t size) { return sendRequest("POST", payload, size); }
+
+int HTTPClient::sendRequest(const char* type, uint8_t* payload, size_t size) {
+    if (!connect()) return HTTPC_ERROR_CONNECTION_REFUSED;
+    if (payload && size) addHeader("Content-Length", String((unsigned long)size));
+    String h = String(type) + " " + _uri + (_useHTTP10 ? " HTTP/1.0" : " HTTP/1.1") + "\r\nHost: " + _host;
+    if (_port != 80 && _port != 443) h += String(":") + String((unsigned)_port);
+    h += String("\r\nUser-Agent: ") + _userAgent + "\r\nConnection: " + (_reuse ? "keep-alive" : "close") + "\r\n";
+    if (!_useHTTP10) h += "Accept-Encoding: identity;q=1,chunked;q=0.1,*;q=0\r\n";
+    h += _headers + "\r\n";
+    if (_client->write((const uint8_t*)h.c_str(), h.length()) != h.length()) return HTTPC_ERROR_SEND_HEADER_FAILED;
+    if (payload && size && _client->write(payload, size) != size) return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+    _returnCode = handleHeaderResponse();
+    return _returnCode;
+}
+
+bool HTTPClient::readLine(String& line) {
+    line = String();
+    const uint32_t t0 = millis();
+    for (;;) {
+        const int c = _client->read();
+        if (c < 0) {
+            if (!_client->connected() || millis() - t0 > _tcpTimeout) return false;
+            delay(1);
+            continue;
+        }
+        if (c == '\n') break;
+        if (c != '\r') line += (char)c;
+    }
+    return true;
+}
+
+int HTTPClient::handleHeaderResponse() {
+    if (!connected()) return HTTPC_ERROR_NOT_CONNECTED;
+    _canReuse   = _reuse;
+    _size       = -1;
+    _te         = HTTPC_TE_IDENTITY;
+    for (auto& h : _resp) h.value = String();
+    int    code = 0;
+    String line;
+    for (;;) {
+        if (!readLine(line)) return connected() ? HTTPC_ERROR_READ_TIMEOUT : HTTPC_ERROR_CONNECTION_LOST;
+        if (line.startsWith("HTTP/1.")) {
+            if (_canReuse) _canReuse = line[sizeof "HTTP/1." - 1] != '0';
+            code = line.substring(9, line.indexOf(' ', 9)).toInt();
+            continue;
+        }
+        if (!line.length()) break;
+        const int c = line.indexOf(':');
+        if (c <= 0) continue;
+        const String name = line.substring(0, c);
+        String       v    = line.substring(c + 1);
+        v.trim();
+        if (name.equalsIgnoreCase("Content-Length")) _size = v.toInt();
+        if (_canReuse && name.equalsIgnoreCase("Connection") && v.indexOf("close") >= 0 && v.indexOf("keep-alive") < 0) _canReuse = false;
+        if (name.equalsIgnoreCase("Transfer-Encoding") && v.equalsIgnoreCase("chunked")) _te = HTTPC_TE_CHUNKED;
+        for (auto& h : _resp)
+            if (h.key.equalsIgnoreCase(name)) h.value = v;
+    }
+    if (!code) return HTTPC_ERROR_NO_HTTP_SERVER;
+    if (_te == HTTPC_TE_CHUNKED) _size = -1;
+    return code;
+}
+
+namespace {
+class TkwmHostStringSink : public Stream {
+public:
+    String s;
+    size_t write(uint8_t c) override { s += (char)c; return 1; }
+    size_t write(const uint8_t* b, size_t n) override { s.concat((const char*)b, (unsigned)n); return n; }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+};
+}
+
+// Тело ответа в stream: по Content-Length, chunked-кадрам или до закрытия; затем end(), как у ядра.
+int HTTPClient::writeToStream(Stream* out) {
+    if (!connected()) return HTTPC_ERROR_NOT_CONNECTED;
+    uint8_t buf[1460];
+    int     total = 0;
+    auto copy = [&](int len) -> bool {
+        uint32_t t0 = millis();
+        while (len != 0) {
+            const int want = len < 0 ? (int)sizeof(buf) : std::min<int>(len, sizeof(buf));
+            const int n    = _client->read(buf, (size_t)want);
+            if (n > 0) {
+                out->write(buf, (size_t)n);
+                total += n;
+                if (len > 0) len -= n;
+                t0 = millis();
+                continue;
+            }
+            if (!_client->connected()) return len < 0;
+            if (millis() - t0 > _tcpTimeout) return false;
+            delay(1);
+        }
+        return true;
+    };
+    bool ok;
+    if (_te == HTTPC_TE_IDENTITY) ok = copy(_size);
+    else {
+        ok = true;
+        for (String line; ok;) {
+            if (!readLine(line)) {
+                ok = false;
+                break;
+            }
+            const int n = (int)strtol(line.c_str(), nullptr, 16);
+            if (!n) {
+                while (readLine(line) && line.length()) {}
+                break;
+            }
+            ok = copy(n) && readLine(line);
+        }
+    }
+    if (!ok) _canReuse = false;
+    end();
+    return ok ? total : HTTPC_ERROR_READ_TIMEOUT;
+}
+
+String HTTPClient::getString() {
+    TkwmHostStringSink sink;
+    if (_size > 0) sink.s.reserve(_size);
+    writeToStream(&sink);
+    return sink.s;
+}
+
+String HTTPClient::errorToString(int error) {
+    switch (error) {
+    case HTTPC_ERROR_CONNECTION_REFUSED: return "connection refused";
+    case HTTPC_ERROR_SEND_HEADER_FAILED: return "send header failed";
+    case HTTPC_ERROR_SEND_PAYLOAD_FAILED: return "send payload failed";
+    case HTTPC_ERROR_NOT_CONNECTED: return "not connected";
+    case HTTPC_ERROR_CONNECTION_LOST: return "connection lost";
+    case HTTPC_ERROR_NO_STREAM: return "no stream";
+    case HTTPC_ERROR_NO_HTTP_SERVER: return "no HTTP server";
+    case HTTPC_ERROR_TOO_LESS_RAM: return "too less ram";
+    case HTTPC_ERROR_ENCODING: return "Transfer-Encoding not supported";
+    case HTTPC_ERROR_STREAM_WRITE: return "Stream write error";
+    case HTTPC_ERROR_READ_TIMEOUT: return "read Timeout";
+    default: return String();
+    }
+}
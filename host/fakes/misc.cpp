@@ -0,0 +1,145 @@
+// Update (flash устройства), tinfl поверх zlib.
+#include "host_sim.h"
+#include <Update.h>
+#include <rom/miniz.h>
+#include <zlib.h>
+
+UpdateClass Update;
+
+static const size_t kTkwmHostOtaPartition = 1920 * 1024; // app-раздел схемы «default»
+
+void UpdateClass::reset() {
+    _size = _progress = _bufLen = 0;
+}
+
+bool UpdateClass::begin(size_t size, int command, int, uint8_t, const char*) {
+    if (_size > 0) return false; // уже идёт
+    if (size == 0 || command != U_FLASH) {
+        _error = UPDATE_ERROR_SIZE;
+        return false;
+    }
+    if (size == UPDATE_SIZE_UNKNOWN) size = kTkwmHostOtaPartition;
+    if (size > kTkwmHostOtaPartition) {
+        _error = UPDATE_ERROR_SPACE;
+        return false;
+    }
+    _error = UPDATE_ERROR_OK;
+    _size  = size;
+    tkwmHost::Flash& f = tkwmHost::device().flash;
+    f.image.clear();
+    f.committed = false;
+    return true;
+}
+
+bool UpdateClass::flushSector() {
+    if (!_bufLen) return true;
+    tkwmHost::Flash& f = tkwmHost::device().flash;
+    if (f.image.empty() && _buf[0] != 0xE9) { // ESP_IMAGE_HEADER_MAGIC
+        _error = UPDATE_ERROR_MAGIC_BYTE;
+        reset();
+        return false;
+    }
+    const uint32_t us = f.slowEvery && (f.writes + 1) % f.slowEvery == 0 ? f.slowUsPer4k : f.writeUsPer4k;
+    if (us) delayMicroseconds(us);
+    f.image.insert(f.image.end(), _buf, _buf + _bufLen);
+    f.writes++;
+    _bufLen = 0;
+    return true;
+}
+
+size_t UpdateClass::write(uint8_t* data, size_t len) {
+    if (hasError() || !isRunning()) return 0;
+    if (len > remaining()) {
+        _error = UPDATE_ERROR_SPACE;
+        reset();
+        return 0;
+    }
+    size_t done = 0;
+    while (done < len) {
+        const size_t k = std::min(len - done, sizeof(_buf) - _bufLen);
+        memcpy(_buf + _bufLen, data + done, k);
+        _bufLen += k;
+        done += k;
+        _progress += k;
+        if ((_bufLen == sizeof(_buf) || _progress == _size) && !flushSector()) return 0;
+    }
+    return len;
+}
+
+bool UpdateClass::end(bool evenIfRemaining) {
+    if (hasError() || _size == 0) return false;
+    if (!isFinished() && !evenIfRemaining) {
+        _error = UPDATE_ERROR_ABORT;
+        reset();
+        return false;
+    }
+    if (!flushSector()) return false;
+    tkwmHost::device().flash.committed = true;
+    reset();
+    return true;
+}
+
+void UpdateClass::abort() {
+    reset();
+    _error = UPDATE_ERROR_ABORT;
+}
+
+const char* UpdateClass::errorString() {
+    static const char* const s[] = {"No Error", "Flash Write Failed", "Flash Erase Failed", "Flash Read Failed", "Not Enough Space",
+                                     "Bad Size Given", "Stream Read Timeout", "MD5 Check Failed", "Wrong Magic Byte",
+                                     "Could Not Activate The Firmware", "Partition Could Not be Found", "Bad Argument", "Aborted"};
+    return _error < sizeof(s) / sizeof(s[0]) ? s[_error] : "UNKNOWN";
+}
+
+// Память zlib — подробность подделки (настоящий tinfl держит всё в tinfl_decompressor): мимо учёта кучи.
+extern "C" void* __libc_calloc(size_t, size_t);
+extern "C" void  __libc_free(void*);
+static voidpf tkwmHostZAlloc_(voidpf, uInt n, uInt size) { return __libc_calloc(n, size); }
+static void   tkwmHostZFree_(voidpf, voidpf p) { __libc_free(p); }
+
+static void tkwmHostZDrop_(z_stream* z) {
+    inflateEnd(z);
+    __libc_free(z);
+}
+
+tinfl_status tinfl_decompress(tinfl_decompressor* r, const mz_uint8* in, size_t* inSize, mz_uint8* outStart, mz_uint8* outNext,
+                              size_t* outSize, const mz_uint32 flags) {
+    (void)outStart;
+    if (r->m_state == 3) return TINFL_STATUS_FAILED;
+    z_stream* z = (z_stream*)r->z;
+    if (r->m_state == 0) {
+        z         = (z_stream*)__libc_calloc(1, sizeof(z_stream));
+        z->zalloc = tkwmHostZAlloc_;
+        z->zfree  = tkwmHostZFree_;
+        if (inflateInit2(z, (flags & TINFL_FLAG_PARSE_ZLIB_HEADER) ? 15 : -15) != Z_OK) {
+            __libc_free(z);
+            return TINFL_STATUS_FAILED;
+        }
+        r->z       = z;
+        r->m_state = 1;
+    }
+    if (r->m_state == 2) {
+        *inSize = *outSize = 0;
+        return TINFL_STATUS_DONE;
+    }
+    z->next_in   = (Bytef*)in;
+    z->avail_in  = (uInt)*inSize;
+    z->next_out  = outNext;
+    z->avail_out = (uInt)*outSize;
+    const int rc = inflate(z, Z_SYNC_FLUSH);
+    *inSize  -= z->avail_in;
+    *outSize -= z->avail_out;
+    if (rc == Z_STREAM_END) {
+        tkwmHostZDrop_(z);
+        r->z       = nullptr;
+        r->m_state = 2;
+        return TINFL_STATUS_DONE;
+    }
+    if (rc != Z_OK && rc != Z_BUF_ERROR) {
+        tkwmHostZDrop_(z);
+        r->z       = nullptr;
+        r->m_state = 3;
+        return TINFL_STATUS_FAILED;
+    }
+    return z->avail_out == 0 ? TINFL_STATUS_HAS_MORE_OUTPUT : TINFL_STATUS_NEEDS_MORE_INPUT;
+}
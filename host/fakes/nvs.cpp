@@ -0,0 +1,128 @@
+// Preferences поверх tkwmHost::Nvs: как nvs_*: типы ключей, ключ до 15 символов, одинаковое значение
+// повторно не пишется; каждая операция стоит readUs/writeUs виртуального времени.
+#include "host_sim.h"
+#include <Preferences.h>
+
+namespace {
+// NVS хранит запись кусками по 32 байта: заголовок + данные строк/блобов
+size_t nvsEntries(char type, size_t n) { return (type == 's' || type == 'B') ? 1 + (n + 31) / 32 : 1; }
+
+void opRead(tkwmHost::Nvs& nvs, const std::string& ns) {
+    nvs.reads++;
+    nvs.perNs[ns].reads++;
+    nvs.perNs[ns].us += nvs.readUs;
+    delayMicroseconds(nvs.readUs);
+}
+
+void opErase(tkwmHost::Nvs& nvs, const std::string& ns, uint32_t n) {
+    nvs.erases += n;
+    nvs.perNs[ns].erases += n;
+    nvs.perNs[ns].us += nvs.writeUs;
+    delayMicroseconds(nvs.writeUs);
+}
+}
+
+bool Preferences::begin(const char* name, bool readOnly, const char*) {
+    if (_nvs || !name || strlen(name) > 15) return false;
+    tkwmHost::Nvs& nvs = tkwmHost::device().nvs;
+    opRead(nvs, name);
+    if (readOnly && !nvs.ns.count(name)) return false; // nvs_open(READONLY) на несуществующем namespace — ошибка
+    nvs.ns[name];
+    _nvs      = &nvs;
+    _ns       = name;
+    _readOnly = readOnly;
+    return true;
+}
+
+void Preferences::end() { _nvs = nullptr; }
+
+bool Preferences::clear() {
+    if (!_nvs || _readOnly) return false;
+    auto& m = _nvs->ns[_ns];
+    const uint32_t n = (uint32_t)m.size();
+    m.clear();
+    opErase(*_nvs, _ns, n);
+    return true;
+}
+
+bool Preferences::remove(const char* key) {
+    if (!_nvs || _readOnly || !key) return false;
+    auto& m = _nvs->ns[_ns];
+    auto  it = m.find(key);
+    opRead(*_nvs, _ns);
+    if (it == m.end()) return false;
+    m.erase(it);
+    opErase(*_nvs, _ns, 1);
+    return true;
+}
+
+bool Preferences::isKey(const char* key) {
+    if (!_nvs || !key) return false;
+    opRead(*_nvs, _ns);
+    return _nvs->ns[_ns].count(key) != 0;
+}
+
+const std::string* Preferences::find(const char* key, char type) {
+    if (!_nvs || !key) return nullptr;
+    opRead(*_nvs, _ns);
+    auto& m  = _nvs->ns[_ns];
+    auto  it = m.find(key);
+    if (it == m.end() || it->second.type != type) return nullptr;
+    return &it->second.data;
+}
+
+size_t Preferences::put(const char* key, char type, const void* v, size_t n) {
+    if (!_nvs || _readOnly || !key || strlen(key) > 15) return 0;
+    if ((type == 's' && n > 4000) || (type == 'B' && n > 508000)) return 0;
+    auto& m  = _nvs->ns[_ns];
+    auto  it = m.find(key);
+    const std::string data((const char*)v, n);
+    opRead(*_nvs, _ns);
+    tkwmHost::Nvs::Stats& st = _nvs->perNs[_ns];
+    if (it != m.end() && it->second.type == type && it->second.data == data) {
+        _nvs->skipped++;
+        st.skipped++;
+        return n;
+    }
+    m[key] = {type, data};
+    const size_t   e  = nvsEntries(type, n);
+    const uint32_t us = _nvs->writeUs + (uint32_t)(e - 1) * 100;
+    _nvs->writes++;
+    _nvs->bytesWritten += e * 32;
+    st.writes++;
+    st.bytesWritten += e * 32;
+    st.us += us;
+    delayMicroseconds(us);
+    return n;
+}
+
+bool Preferences::get(const char* key, char type, void* out, size_t n) {
+    const std::string* d = find(key, type);
+    if (!d || d->size() != n) return false;
+    memcpy(out, d->data(), n);
+    return true;
+}
+
+String Preferences::getString(const char* key, const String& d) {
+    const std::string* v = find(key, 's');
+    return v ? String(*v) : d;
+}
+
+size_t Preferences::getString(const char* key, char* buf, size_t maxLen) {
+    const std::string* v = find(key, 's');
+    if (!v || v->size() + 1 > maxLen) return 0;
+    memcpy(buf, v->c_str(), v->size() + 1);
+    return v->size() + 1;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    const std::string* v = find(key, 'B');
+    return v ? v->size() : 0;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+    const std::string* v = find(key, 'B');
+    if (!v || v->size() > maxLen) return 0;
+    memcpy(buf, v->data(), v->size());
+    return v->size();
+}
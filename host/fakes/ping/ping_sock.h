@@ -0,0 +1,33 @@
+#pragma once
+// Хост-замена esp_ping (ping/ping_sock.h): шлюз 192.168.1.1 отвечает за rttMs точки, без линка — таймаут.
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_wifi.h"
+
+typedef void* esp_ping_handle_t;
+typedef struct { union { struct { uint32_t addr; } ip4; } u_addr; uint8_t type; } ip_addr_t;
+#define IPADDR_TYPE_V4 0
+typedef struct {
+    uint32_t count, interval_ms, timeout_ms, data_size;
+    int tos, ttl;
+    ip_addr_t target_addr;
+    uint32_t task_stack_size, task_prio, interface;
+} esp_ping_config_t;
+#define ESP_PING_DEFAULT_CONFIG() { 5, 1000, 1000, 64, 0, 64, {{{0}}, 0}, 2048, 2, 0 }
+#define ESP_PING_COUNT_INFINITE (0)
+typedef struct {
+    void* cb_args;
+    void (*on_ping_success)(esp_ping_handle_t hdl, void* args);
+    void (*on_ping_timeout)(esp_ping_handle_t hdl, void* args);
+    void (*on_ping_end)(esp_ping_handle_t hdl, void* args);
+} esp_ping_callbacks_t;
+typedef enum {
+    ESP_PING_PROF_SEQNO, ESP_PING_PROF_TOS, ESP_PING_PROF_TTL, ESP_PING_PROF_REQUEST, ESP_PING_PROF_REPLY,
+    ESP_PING_PROF_IPADDR, ESP_PING_PROF_SIZE, ESP_PING_PROF_TIMEGAP, ESP_PING_PROF_DURATION
+} esp_ping_profile_t;
+
+esp_err_t esp_ping_new_session(const esp_ping_config_t* config, const esp_ping_callbacks_t* cbs, esp_ping_handle_t* hdl_out);
+esp_err_t esp_ping_delete_session(esp_ping_handle_t hdl);
+esp_err_t esp_ping_start(esp_ping_handle_t hdl);
+esp_err_t esp_ping_stop(esp_ping_handle_t hdl);
+esp_err_t esp_ping_get_profile(esp_ping_handle_t hdl, esp_ping_profile_t profile, void* data, uint32_t size);
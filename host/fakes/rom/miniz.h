@@ -0,0 +1,19 @@
+#pragma once
+// Хост-замена tinfl из ROM ESP32 поверх zlib (raw deflate): тот же контракт tinfl_decompress
+// с кольцевым словарём 32 КБ и TINFL_FLAG_HAS_MORE_INPUT.
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned char mz_uint8;
+typedef uint32_t      mz_uint32;
+#define TINFL_LZ_DICT_SIZE 32768
+enum { TINFL_FLAG_PARSE_ZLIB_HEADER = 1, TINFL_FLAG_HAS_MORE_INPUT = 2, TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF = 4, TINFL_FLAG_COMPUTE_ADLER32 = 8 };
+typedef enum {
+    TINFL_STATUS_BAD_PARAM = -3, TINFL_STATUS_ADLER32_MISMATCH = -2, TINFL_STATUS_FAILED = -1, TINFL_STATUS_DONE = 0,
+    TINFL_STATUS_NEEDS_MORE_INPUT = 1, TINFL_STATUS_HAS_MORE_OUTPUT = 2
+} tinfl_status;
+// Размер как у настоящего tinfl_decompressor (~11 КБ): учёт RAM в тестах не должен врать.
+typedef struct { uint32_t m_state; void* z; uint8_t pad[10992]; } tinfl_decompressor;
+#define tinfl_init(r) do { (r)->m_state = 0; (r)->z = 0; } while (0)
+tinfl_status tinfl_decompress(tinfl_decompressor* r, const mz_uint8* pIn_buf_next, size_t* pIn_buf_size, mz_uint8* pOut_buf_start,
+                              mz_uint8* pOut_buf_next, size_t* pOut_buf_size, const mz_uint32 decomp_flags);
@@ -0,0 +1,662 @@
+// Виртуальное время, эфир и радио устройств; WiFiClass, esp_wifi_*, esp_ping_*, SNTP поверх них.
+#include "host_sim.h"
+#include "esp_sntp.h"
+#include "ping/ping_sock.h"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <thread>
+
+namespace tkwmHost {
+
+// ===================== время и очередь событий =====================
+namespace {
+std::atomic<uint64_t> g_us{500000};   // виртуальные часы стартуют с 0.5 с (как millis() к setup() на ESP32)
+std::atomic<bool>     g_real{false};
+std::chrono::steady_clock::time_point g_realBase;
+uint64_t              g_realOffset = 0;
+std::thread::id       g_mainThread = std::this_thread::get_id();
+std::recursive_mutex  g_evMu;
+
+struct Ev { Radio* owner; std::function<void()> fn; };
+std::multimap<uint64_t, Ev>& evq() { static std::multimap<uint64_t, Ev> q; return q; }
+
+void schedule(Radio* owner, uint64_t atUs, std::function<void()> fn) {
+    std::lock_guard<std::recursive_mutex> lk(g_evMu);
+    evq().emplace(atUs, Ev{owner, std::move(fn)});
+}
+
+Device* g_cur = nullptr;
+Device& defaultDevice() { static Device d(0); return d; }
+
+// Доставить события со сроком не позже upTo (в контексте их устройства).
+void dispatchUpTo(uint64_t upTo, bool moveClock) {
+    for (;;) {
+        Ev ev;
+        uint64_t at;
+        {
+            std::lock_guard<std::recursive_mutex> lk(g_evMu);
+            auto it = evq().begin();
+            if (it == evq().end() || it->first > upTo) break;
+            at = it->first;
+            ev = std::move(it->second);
+            evq().erase(it);
+        }
+        if (moveClock && at > g_us) g_us = at;
+        ev.fn();
+    }
+}
+} // namespace
+
+uint64_t nowUs() {
+    if (!g_real) return g_us;
+    return g_realOffset + (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - g_realBase).count();
+}
+
+void realTime(bool on) {
+    if (on == g_real) return;
+    if (on) {
+        g_realOffset = g_us;
+        g_realBase   = std::chrono::steady_clock::now();
+        g_real       = true;
+    } else {
+        g_us   = nowUs();
+        g_real = false;
+    }
+}
+
+bool isRealTime() { return g_real; }
+
+void advanceUs(uint64_t us) {
+    if (std::this_thread::get_id() != g_mainThread) {
+        // Потоки (задачи FreeRTOS) виртуальные часы не двигают — только уступают процессор.
+        std::this_thread::sleep_for(std::chrono::microseconds(g_real ? us : std::min<uint64_t>(us, 1000)));
+        return;
+    }
+    if (g_real) {
+        if (us) std::this_thread::sleep_for(std::chrono::microseconds(us));
+        dispatchUpTo(nowUs(), false);
+        return;
+    }
+    const uint64_t target = g_us + us;
+    dispatchUpTo(target, true);
+    if (g_us < target) g_us = target;
+}
+
+// millis() в режиме реального времени сам доставляет наступившие события (только из основного потока).
+void pumpReal() {
+    static bool busy = false;
+    if (!g_real || busy || std::this_thread::get_id() != g_mainThread) return;
+    busy = true;
+    dispatchUpTo(nowUs(), false);
+    busy = false;
+}
+
+// ===================== эфир =====================
+Air& air() { static Air a; return a; }
+
+int addAp(const Ap& a) {
+    air().aps.push_back(a);
+    air().aps.back().upAtUs = nowUs();
+    return (int)air().aps.size() - 1;
+}
+
+Ap& ap(int i) { return air().aps.at(i); }
+
+void clearAir() { air().aps.clear(); }
+
+// ===================== радио =====================
+struct Radio {
+    Device*     dev;
+    wifi_mode_t mode   = WIFI_MODE_NULL;
+    wl_status_t status = WL_NO_SHIELD;
+    bool        autoReconnect = true;
+    uint32_t    gen   = 0;       // поколение попытки: события прежних попыток отбрасываются
+    bool        connecting = false;
+    int         ap    = -1;      // ассоциирован с точкой
+    bool        hasIp = false;
+    String      ssid, pass;      // последняя конфигурация WiFi.begin
+    int32_t     ch = 0;
+    uint8_t     bssid[6] = {};
+    bool        bssidSet = false;
+    bool        staticIp = false;
+    IPAddress   sIp, sGw, sMask, sDns;
+    bool        scanRunning = false, scanHasResult = false;
+    struct Net { int ap; int8_t rssi; };
+    std::vector<Net> nets;
+    bool        apOn = false;
+    String      apSsid;
+    IPAddress   apIp{192, 168, 4, 1};
+    struct Handler { wifi_event_id_t id; WiFiEventFuncCb cb; arduino_event_id_t ev; };
+    std::vector<Handler> handlers;
+    wifi_event_id_t nextId = 1;
+    uint32_t    beginN = 0, scanN = 0;
+    uint8_t     infoBssid[6] = {};
+
+    IPAddress dhcpIp() const { return IPAddress(192, 168, 1, (uint8_t)(10 + dev->id % 240)); }
+
+    void emit(arduino_event_id_t e, const arduino_event_info_t& info) {
+        Device* prev = g_cur;
+        g_cur = dev;
+        const std::vector<Handler> hs = handlers;
+        for (const auto& h : hs)
+            if (h.ev == ARDUINO_EVENT_MAX || h.ev == e) h.cb(e, info);
+        g_cur = prev;
+    }
+
+    void disconnected(uint8_t reason) {
+        ap         = -1;
+        hasIp      = false;
+        connecting = false;
+        if (reason == WIFI_REASON_NO_AP_FOUND) status = WL_NO_SSID_AVAIL;
+        else if (reason == WIFI_REASON_AUTH_FAIL) status = WL_CONNECT_FAILED;
+        else if (reason == WIFI_REASON_BEACON_TIMEOUT || reason == WIFI_REASON_HANDSHAKE_TIMEOUT) status = WL_CONNECTION_LOST;
+        else status = WL_DISCONNECTED;
+        arduino_event_info_t info = {};
+        info.wifi_sta_disconnected.reason = reason;
+        memcpy(info.wifi_sta_disconnected.bssid, infoBssid, 6);
+        emit(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, info);
+        // Ядро ESP32 само повторяет WiFi.begin() на «временных» причинах, пока включён autoReconnect.
+        if (autoReconnect && reason != WIFI_REASON_ASSOC_LEAVE && (mode & WIFI_MODE_STA)) {
+            switch (reason) {
+            case WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT: case WIFI_REASON_HANDSHAKE_TIMEOUT: case WIFI_REASON_AUTH_EXPIRE:
+            case WIFI_REASON_ASSOC_EXPIRE: case WIFI_REASON_CONNECTION_FAIL: case WIFI_REASON_BEACON_TIMEOUT:
+            case WIFI_REASON_AUTH_FAIL: case WIFI_REASON_ASSOC_FAIL:
+                attempt();
+                break;
+            default: break;
+            }
+        }
+    }
+
+    // Разорвать текущую ассоциацию/попытку; уведомление (ASSOC_LEAVE) — асинхронно, как из задачи событий.
+    void drop() {
+        const bool notify = ap >= 0 || connecting;
+        gen++;
+        connecting = false;
+        if (ap >= 0) memcpy(infoBssid, air().aps[ap].bssid, 6);
+        ap    = -1;
+        hasIp = false;
+        if (status == WL_CONNECTED || status == WL_IDLE_STATUS) status = WL_DISCONNECTED;
+        if (notify) {
+            const uint32_t g = gen;
+            schedule(this, nowUs() + 2000, [this, g] {
+                if (g == gen) {
+                    disconnected(WIFI_REASON_ASSOC_LEAVE);
+                    return;
+                }
+                // Уже идёт новая попытка: событие доходит, состояние не трогаем (как гонка на железе).
+                arduino_event_info_t info = {};
+                info.wifi_sta_disconnected.reason = WIFI_REASON_ASSOC_LEAVE;
+                emit(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, info);
+            });
+        }
+    }
+
+    void fail(uint32_t g, uint64_t at, uint8_t reason, int apIdx) {
+        schedule(this, at, [this, g, reason, apIdx] {
+            if (g != gen) return;
+            if (apIdx >= 0) {
+                air().aps[apIdx].assocFail++;
+                memcpy(infoBssid, air().aps[apIdx].bssid, 6);
+            }
+            disconnected(reason);
+        });
+    }
+
+    // Попытка по сохранённой конфигурации (ssid/pass/ch/bssid).
+    void attempt() {
+        beginN++;
+        const uint32_t g = ++gen;
+        connecting = true;
+        ap         = -1;
+        hasIp      = false;
+        status     = WL_DISCONNECTED;
+        const uint64_t now   = nowUs();
+        const bool     hint  = ch > 0 && bssidSet;
+        const uint64_t found = now + (uint64_t)(hint ? air().directMs : air().findMs) * 1000;
+        int best = -1;
+        for (size_t i = 0; i < air().aps.size(); i++) {
+            const Ap& a = air().aps[i];
+            if (!a.up || a.upAtUs + (uint64_t)a.bootMs * 1000 > now || a.ssid != ssid) continue;
+            if (bssidSet && memcmp(a.bssid, bssid, 6) != 0) continue;
+            if (ch > 0 && a.ch != ch) continue;
+            if (best < 0 || a.rssi > air().aps[best].rssi) best = (int)i;
+        }
+        if (best < 0) {
+            fail(g, found, WIFI_REASON_NO_AP_FOUND, -1);
+            return;
+        }
+        Ap& a = air().aps[best];
+        const uint64_t start = std::max(found, a.busyUntilUs);
+        if (start - found > (uint64_t)a.queueMaxMs * 1000) {
+            // Точка не успела обслужить: повторы запросов всё равно занимают эфир.
+            a.busyUntilUs += (uint64_t)a.assocMs * 250;
+            fail(g, found + (uint64_t)a.queueMaxMs * 1000, WIFI_REASON_AUTH_EXPIRE, best);
+            return;
+        }
+        a.busyUntilUs = start + (uint64_t)a.assocMs * 1000;
+        const uint64_t assoc = a.busyUntilUs;
+        if (a.failReason) {
+            fail(g, assoc, a.failReason, best);
+            return;
+        }
+        if (a.pass.length() && a.pass != pass) {
+            fail(g, assoc + 1000000, WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT, best);
+            return;
+        }
+        schedule(this, assoc, [this, g, best] {
+            if (g != gen) return;
+            ap     = best;
+            status = WL_IDLE_STATUS;
+            memcpy(infoBssid, air().aps[best].bssid, 6);
+            arduino_event_info_t info = {};
+            memcpy(info.wifi_sta_connected.bssid, air().aps[best].bssid, 6);
+            info.wifi_sta_connected.channel = air().aps[best].ch;
+            emit(ARDUINO_EVENT_WIFI_STA_CONNECTED, info);
+        });
+        schedule(this, assoc + (staticIp ? 5000 : (uint64_t)a.dhcpMs * 1000), [this, g, best] {
+            if (g != gen) return;
+            connecting = false;
+            hasIp      = true;
+            status     = WL_CONNECTED;
+            air().aps[best].assocOk++;
+            arduino_event_info_t info = {};
+            emit(ARDUINO_EVENT_WIFI_STA_GOT_IP, info);
+        });
+    }
+
+    void linkLost(int apIdx) {
+        if (ap != apIdx) return;
+        const uint32_t g = gen;
+        schedule(this, nowUs() + (uint64_t)air().beaconLossMs * 1000, [this, g] {
+            if (g != gen || ap < 0) return;
+            gen++;
+            disconnected(WIFI_REASON_BEACON_TIMEOUT);
+        });
+    }
+};
+
+namespace {
+std::vector<Device*>& devices() { static std::vector<Device*> v; return v; }
+}
+
+void apSet(int i, bool up) {
+    Ap& a = ap(i);
+    if (a.up == up) return;
+    a.up = up;
+    if (up) {
+        a.upAtUs      = nowUs();
+        a.busyUntilUs = a.upAtUs + (uint64_t)a.bootMs * 1000;
+        return;
+    }
+    for (Device* d : devices()) d->radio->linkLost(i);
+}
+
+Device::Device(uint32_t id_) : id(id_), radio(new Radio) {
+    radio->dev = this;
+    // 24:0A:C4 — OUI Espressif; младшие байты из id
+    const uint8_t m[6] = {0x24, 0x0A, 0xC4, (uint8_t)(id >> 16), (uint8_t)(id >> 8), (uint8_t)id};
+    memcpy(mac, m, 6);
+    devices().push_back(this);
+}
+
+namespace {
+void dropEvents(Radio* r) {
+    std::lock_guard<std::recursive_mutex> lk(g_evMu);
+    for (auto it = evq().begin(); it != evq().end();) {
+        if (it->second.owner == r) it = evq().erase(it);
+        else ++it;
+    }
+}
+} // namespace
+
+Device::~Device() {
+    dropEvents(radio);
+    auto& v = devices();
+    v.erase(std::remove(v.begin(), v.end(), this), v.end());
+    if (g_cur == this) g_cur = nullptr;
+    delete radio;
+    if (fsTemp) {
+        std::error_code ec;
+        std::filesystem::remove_all(fsRoot, ec);
+    }
+}
+
+void Device::reboot() {
+    dropEvents(radio);
+    delete radio;
+    radio      = new Radio;
+    radio->dev = this;
+    fsMounted  = false;
+}
+
+bool     Device::staConnected() const { return radio->hasIp; }
+int      Device::staAp() const { return radio->ap; }
+uint32_t Device::beginN() const { return radio->beginN; }
+uint32_t Device::scanN() const { return radio->scanN; }
+bool     Device::softAp() const { return radio->apOn; }
+
+Device& device() { return g_cur ? *g_cur : defaultDevice(); }
+void    use(Device& d) { g_cur = &d; }
+
+Radio& radio() { return *device().radio; }
+
+} // namespace tkwmHost
+
+using tkwmHost::radio;
+using tkwmHost::Radio;
+
+// ===================== WiFiClass =====================
+WiFiClass WiFi;
+
+bool WiFiClass::mode(wifi_mode_t m) {
+    Radio& r = radio();
+    if ((r.mode & WIFI_MODE_STA) && !(m & WIFI_MODE_STA)) {
+        r.drop();
+        r.status = WL_NO_SHIELD;
+    }
+    if (!(r.mode & WIFI_MODE_STA) && (m & WIFI_MODE_STA)) r.status = WL_DISCONNECTED;
+    if (!(m & WIFI_MODE_AP)) r.apOn = false;
+    r.mode = m;
+    return true;
+}
+wifi_mode_t WiFiClass::getMode() { return radio().mode; }
+bool WiFiClass::enableSTA(bool on) { return mode((wifi_mode_t)(on ? (radio().mode | WIFI_MODE_STA) : (radio().mode & ~WIFI_MODE_STA))); }
+bool WiFiClass::enableAP(bool on) { return mode((wifi_mode_t)(on ? (radio().mode | WIFI_MODE_AP) : (radio().mode & ~WIFI_MODE_AP))); }
+bool WiFiClass::setSleep(bool) { return true; }
+bool WiFiClass::setAutoReconnect(bool on) { radio().autoReconnect = on; return true; }
+bool WiFiClass::getAutoReconnect() { return radio().autoReconnect; }
+
+wl_status_t WiFiClass::status() { return radio().status; }
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* pass, int32_t ch, const uint8_t* bssid, bool connect) {
+    Radio& r = radio();
+    if (!(r.mode & WIFI_MODE_STA)) enableSTA(true);
+    if (r.ap >= 0 || r.connecting) r.drop();
+    r.ssid     = ssid ? ssid : "";
+    r.pass     = pass ? pass : "";
+    r.ch       = ch;
+    r.bssidSet = bssid != nullptr;
+    if (bssid) memcpy(r.bssid, bssid, 6);
+    if (connect) r.attempt();
+    return r.status;
+}
+
+bool WiFiClass::disconnect(bool wifioff, bool eraseap) {
+    Radio& r = radio();
+    r.drop();
+    if (eraseap) {
+        r.ssid = r.pass = "";
+        r.bssidSet = false;
+        r.ch = 0;
+    }
+    if (wifioff) mode(WIFI_MODE_NULL);
+    return true;
+}
+
+bool WiFiClass::reconnect() {
+    Radio& r = radio();
+    if (!(r.mode & WIFI_MODE_STA) || !r.ssid.length()) return false;
+    if (r.ap >= 0 || r.connecting) r.drop();
+    r.attempt();
+    return true;
+}
+
+bool WiFiClass::config(IPAddress ip, IPAddress gw, IPAddress mask, IPAddress dns1, IPAddress) {
+    Radio& r = radio();
+    r.staticIp = (uint32_t)ip != 0;
+    r.sIp = ip; r.sGw = gw; r.sMask = mask; r.sDns = dns1;
+    return true;
+}
+
+IPAddress WiFiClass::localIP() { Radio& r = radio(); return r.hasIp ? (r.staticIp ? r.sIp : r.dhcpIp()) : IPAddress(); }
+IPAddress WiFiClass::gatewayIP() { Radio& r = radio(); return r.hasIp ? (r.staticIp ? r.sGw : IPAddress(192, 168, 1, 1)) : IPAddress(); }
+IPAddress WiFiClass::subnetMask() { Radio& r = radio(); return r.hasIp ? (r.staticIp ? r.sMask : IPAddress(255, 255, 255, 0)) : IPAddress(); }
+IPAddress WiFiClass::dnsIP(uint8_t) { Radio& r = radio(); return r.hasIp ? (r.staticIp ? r.sDns : IPAddress(192, 168, 1, 1)) : IPAddress(); }
+String WiFiClass::SSID() { return radio().ssid; }
+String WiFiClass::psk() { return radio().pass; }
+int8_t WiFiClass::RSSI() { Radio& r = radio(); return r.ap >= 0 ? tkwmHost::air().aps[r.ap].rssi : 0; }
+int32_t WiFiClass::channel() { Radio& r = radio(); return r.ap >= 0 ? tkwmHost::air().aps[r.ap].ch : 0; }
+uint8_t* WiFiClass::BSSID() { Radio& r = radio(); return r.ap >= 0 ? tkwmHost::air().aps[r.ap].bssid : nullptr; }
+
+static String tkwmHostMac_(const uint8_t* m) {
+    char s[18];
+    snprintf(s, sizeof(s), "%02X:%02X:%02X:%02X:%02X:%02X", m[0], m[1], m[2], m[3], m[4], m[5]);
+    return s;
+}
+
+String WiFiClass::BSSIDstr() { uint8_t* b = BSSID(); return b ? tkwmHostMac_(b) : String(); }
+String WiFiClass::macAddress() { return tkwmHostMac_(tkwmHost::device().mac); }
+uint8_t* WiFiClass::macAddress(uint8_t* mac) { memcpy(mac, tkwmHost::device().mac, 6); return mac; }
+
+int16_t WiFiClass::scanNetworks(bool async, bool, bool, uint32_t, uint8_t, const char*, const uint8_t*) {
+    Radio& r = radio();
+    if (r.scanRunning) return WIFI_SCAN_RUNNING;
+    if (!(r.mode & WIFI_MODE_STA) || r.connecting) return WIFI_SCAN_FAILED; // ESP_ERR_WIFI_STATE: идёт подключение
+    r.scanRunning   = true;
+    r.scanHasResult = false;
+    r.scanN++;
+    const uint64_t now = tkwmHost::nowUs();
+    for (auto& a : tkwmHost::air().aps) {
+        if (!a.up) continue;
+        a.probes++;
+        a.busyUntilUs = std::max(a.busyUntilUs, now) + (uint64_t)a.probeMs * 1000;
+    }
+    Radio* rp = &r;
+    tkwmHost::schedule(rp, now + (uint64_t)tkwmHost::air().scanMs * 1000, [rp] {
+        const uint64_t t = tkwmHost::nowUs();
+        rp->nets.clear();
+        for (size_t i = 0; i < tkwmHost::air().aps.size(); i++) {
+            const tkwmHost::Ap& a = tkwmHost::air().aps[i];
+            if (a.up && a.upAtUs + (uint64_t)a.bootMs * 1000 <= t) rp->nets.push_back({(int)i, a.rssi});
+        }
+        std::stable_sort(rp->nets.begin(), rp->nets.end(), [](const Radio::Net& x, const Radio::Net& y) { return x.rssi > y.rssi; });
+        rp->scanRunning   = false;
+        rp->scanHasResult = true;
+        arduino_event_info_t info = {};
+        info.wifi_scan_done.number = (uint8_t)rp->nets.size();
+        rp->emit(ARDUINO_EVENT_WIFI_SCAN_DONE, info);
+    });
+    if (async) return WIFI_SCAN_RUNNING;
+    while (r.scanRunning) delay(10);
+    return (int16_t)r.nets.size();
+}
+
+int16_t WiFiClass::scanComplete() {
+    Radio& r = radio();
+    if (r.scanRunning) return WIFI_SCAN_RUNNING;
+    return r.scanHasResult ? (int16_t)r.nets.size() : WIFI_SCAN_FAILED;
+}
+
+void WiFiClass::scanDelete() {
+    Radio& r = radio();
+    r.nets.clear();
+    r.scanHasResult = false;
+}
+
+static const tkwmHost::Ap* tkwmHostNet_(uint8_t i, int8_t* rssi = nullptr) {
+    Radio& r = radio();
+    if (i >= r.nets.size()) return nullptr;
+    if (rssi) *rssi = r.nets[i].rssi;
+    return &tkwmHost::air().aps[r.nets[i].ap];
+}
+
+String WiFiClass::SSID(uint8_t i) { auto a = tkwmHostNet_(i); return a ? a->ssid : String(); }
+int32_t WiFiClass::RSSI(uint8_t i) { int8_t v = 0; return tkwmHostNet_(i, &v) ? v : 0; }
+int32_t WiFiClass::channel(uint8_t i) { auto a = tkwmHostNet_(i); return a ? a->ch : 0; }
+uint8_t* WiFiClass::BSSID(uint8_t i) { auto a = tkwmHostNet_(i); return a ? const_cast<uint8_t*>(a->bssid) : nullptr; }
+String WiFiClass::BSSIDstr(uint8_t i) { auto a = tkwmHostNet_(i); return a ? tkwmHostMac_(a->bssid) : String(); }
+wifi_auth_mode_t WiFiClass::encryptionType(uint8_t i) { auto a = tkwmHostNet_(i); return a && a->pass.length() ? WIFI_AUTH_WPA2_PSK : WIFI_AUTH_OPEN; }
+
+bool WiFiClass::softAP(const char* ssid, const char*, int, int, int) {
+    Radio& r = radio();
+    r.mode   = (wifi_mode_t)(r.mode | WIFI_MODE_AP);
+    r.apOn   = true;
+    r.apSsid = ssid ? ssid : "";
+    return true;
+}
+bool WiFiClass::softAPConfig(IPAddress ip, IPAddress, IPAddress) { radio().apIp = ip; return true; }
+bool WiFiClass::softAPdisconnect(bool wifioff) {
+    Radio& r = radio();
+    r.apOn = false;
+    r.mode = (wifi_mode_t)(r.mode & ~WIFI_MODE_AP);
+    if (wifioff) mode(WIFI_MODE_NULL);
+    return true;
+}
+IPAddress WiFiClass::softAPIP() { Radio& r = radio(); return r.apOn ? r.apIp : IPAddress(); }
+uint8_t WiFiClass::softAPgetStationNum() { return 0; }
+String WiFiClass::softAPSSID() { return radio().apSsid; }
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventFuncCb cb, arduino_event_id_t event) {
+    Radio& r = radio();
+    r.handlers.push_back({r.nextId, std::move(cb), event});
+    return r.nextId++;
+}
+
+void WiFiClass::removeEvent(wifi_event_id_t id) {
+    auto& v = radio().handlers;
+    v.erase(std::remove_if(v.begin(), v.end(), [id](const Radio::Handler& h) { return h.id == id; }), v.end());
+}
+
+int WiFiClass::hostByName(const char* host, IPAddress& out) {
+    addrinfo hints = {}, *res = nullptr;
+    hints.ai_family = AF_INET;
+    if (getaddrinfo(host, nullptr, &hints, &res) != 0 || !res) return 0;
+    out = IPAddress((uint32_t)((sockaddr_in*)res->ai_addr)->sin_addr.s_addr);
+    freeaddrinfo(res);
+    return 1;
+}
+
+// ===================== esp_wifi =====================
+esp_err_t esp_wifi_set_country(const wifi_country_t*) { return ESP_OK; }
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t) { return ESP_OK; }
+
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t* out) {
+    Radio& r = radio();
+    if (r.ap < 0) return ESP_ERR_WIFI_NOT_CONNECT;
+    const tkwmHost::Ap& a = tkwmHost::air().aps[r.ap];
+    memset(out, 0, sizeof(*out));
+    memcpy(out->bssid, a.bssid, 6);
+    memcpy(out->ssid, a.ssid.c_str(), std::min<size_t>(32, a.ssid.length()));
+    out->primary  = a.ch;
+    out->rssi     = a.rssi;
+    out->authmode = a.pass.length() ? WIFI_AUTH_WPA2_PSK : WIFI_AUTH_OPEN;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_mac(wifi_interface_t ifx, uint8_t mac[6]) {
+    memcpy(mac, tkwmHost::device().mac, 6);
+    if (ifx == WIFI_IF_AP) mac[5]++;
+    return ESP_OK;
+}
+
+// ===================== esp_ping: ответ шлюза — rttMs точки, без линка — таймаут =====================
+namespace {
+struct PingSession {
+    esp_ping_config_t    cfg;
+    esp_ping_callbacks_t cb;
+    Radio*               r;
+    uint32_t             gen = 0, seq = 0, lastRtt = 0;
+};
+}
+
+esp_err_t esp_ping_new_session(const esp_ping_config_t* cfg, const esp_ping_callbacks_t* cb, esp_ping_handle_t* out) {
+    PingSession* s = new PingSession{*cfg, *cb, &radio()};
+    *out = s;
+    return ESP_OK;
+}
+
+esp_err_t esp_ping_delete_session(esp_ping_handle_t h) {
+    PingSession* s = (PingSession*)h;
+    s->gen++;
+    // События с этим сеансом могли остаться в очереди — освобождаем после них.
+    tkwmHost::schedule(s->r, tkwmHost::nowUs() + 5000000, [s] { delete s; });
+    return ESP_OK;
+}
+
+esp_err_t esp_ping_start(esp_ping_handle_t h) {
+    PingSession* s = (PingSession*)h;
+    const uint32_t g = ++s->gen;
+    for (uint32_t k = 0; k < (s->cfg.count ? s->cfg.count : 1); k++) {
+        const uint64_t at = tkwmHost::nowUs() + (uint64_t)k * s->cfg.interval_ms * 1000;
+        tkwmHost::schedule(s->r, at, [s, g] {
+            if (g != s->gen) return;
+            Radio* r = s->r;
+            const bool ok = r->hasIp && s->cfg.target_addr.u_addr.ip4.addr == (uint32_t)IPAddress(192, 168, 1, 1) &&
+                            tkwmHost::air().aps[r->ap].up;
+            const uint32_t rtt = ok ? tkwmHost::air().aps[r->ap].rttMs : 0;
+            const uint64_t due = tkwmHost::nowUs() + (uint64_t)(ok ? rtt : s->cfg.timeout_ms) * 1000;
+            tkwmHost::schedule(r, due, [s, g, ok, rtt] {
+                if (g != s->gen) return;
+                s->seq++;
+                s->lastRtt = rtt;
+                if (ok && s->cb.on_ping_success) s->cb.on_ping_success(s, s->cb.cb_args);
+                if (!ok && s->cb.on_ping_timeout) s->cb.on_ping_timeout(s, s->cb.cb_args);
+            });
+        });
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_ping_stop(esp_ping_handle_t h) {
+    ((PingSession*)h)->gen++;
+    return ESP_OK;
+}
+
+esp_err_t esp_ping_get_profile(esp_ping_handle_t h, esp_ping_profile_t p, void* data, uint32_t size) {
+    PingSession* s = (PingSession*)h;
+    uint32_t v = 0;
+    switch (p) {
+    case ESP_PING_PROF_SEQNO: v = s->seq; break;
+    case ESP_PING_PROF_TIMEGAP: v = s->lastRtt; break;
+    case ESP_PING_PROF_IPADDR: v = s->cfg.target_addr.u_addr.ip4.addr; break;
+    case ESP_PING_PROF_SIZE: v = s->cfg.data_size; break;
+    default: break;
+    }
+    memcpy(data, &v, std::min<uint32_t>(size, sizeof(v)));
+    return ESP_OK;
+}
+
+// ===================== SNTP: ответ через 50 мс, если у устройства есть IP =====================
+static sntp_sync_time_cb_t g_sntpCb = nullptr;
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t cb) { g_sntpCb = cb; }
+
+static void tkwmHostSntpStart_() {
+    Radio* r = &radio();
+    tkwmHost::schedule(r, tkwmHost::nowUs() + 50000, [r] {
+        if (!r->hasIp || !g_sntpCb) return;
+        timeval tv;
+        gettimeofday(&tv, nullptr);
+        g_sntpCb(&tv);
+    });
+}
+
+// Как setTimeZone() ядра ESP32: configTime() переписывает TZ смещением.
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char*, const char*, const char*) {
+    const long off = -gmtOffsetSec;
+    char cst[40], cdt[40] = "DST", tz[96];
+    if (off % 3600) snprintf(cst, sizeof(cst), "UTC%ld:%02u:%02u", off / 3600, (unsigned)labs((off % 3600) / 60), (unsigned)labs(off % 60));
+    else snprintf(cst, sizeof(cst), "UTC%ld", off / 3600);
+    if (daylightOffsetSec != 3600) {
+        const long dst = off - daylightOffsetSec;
+        if (dst % 3600) snprintf(cdt, sizeof(cdt), "DST%ld:%02u:%02u", dst / 3600, (unsigned)labs((dst % 3600) / 60), (unsigned)labs(dst % 60));
+        else snprintf(cdt, sizeof(cdt), "DST%ld", dst / 3600);
+    }
+    snprintf(tz, sizeof(tz), "%s%s", cst, cdt);
+    setenv("TZ", tz, 1);
+    tzset();
+    tkwmHostSntpStart_();
+}
+
+void configTzTime(const char* tz, const char*, const char*, const char*) {
+    if (tz) {
+        setenv("TZ", tz, 1);
+        tzset();
+    }
+    tkwmHostSntpStart_();
+}
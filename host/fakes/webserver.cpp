@@ -0,0 +1,538 @@
+// WebServer ядра ESP32 на ПК. Разбор и ответы повторяют WebServer.cpp/Parsing.cpp ядра 2.x настолько,
+// насколько это видно клиенту: порядок заголовков, chunked, multipart с буфером HTTP_UPLOAD_BUFLEN.
+#include "host_sim.h"
+#include <WebServer.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define HTTP_MAX_CLOSE_WAIT 2000
+
+namespace {
+
+bool g_listen = false;
+
+bool ieq(const String& a, const String& b) { return a.equalsIgnoreCase(b); }
+
+std::string urlDecode(const std::string& s) {
+    std::string r;
+    r.reserve(s.size());
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '+') r += ' ';
+        else if (s[i] == '%' && i + 2 < s.size() && isxdigit((uint8_t)s[i + 1]) && isxdigit((uint8_t)s[i + 2])) {
+            r += (char)strtol(s.substr(i + 1, 2).c_str(), nullptr, 16);
+            i += 2;
+        } else r += s[i];
+    }
+    return r;
+}
+
+const char* codeText(int code) {
+    switch (code) {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 206: return "Partial Content";
+    case 301: return "Moved Permanently";
+    case 302: return "Found";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 413: return "Request Entity Too Large";
+    case 416: return "Range Not Satisfiable";
+    case 429: return "Too Many Requests";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default: return "";
+    }
+}
+
+// Ожидание сокета в реальном времени: по ту сторону — поток или процесс ПК.
+bool waitFd(int fd, short ev, uint32_t ms) {
+    pollfd p{fd, ev, 0};
+    return poll(&p, 1, (int)ms) > 0;
+}
+
+} // namespace
+
+// ===================== соединение =====================
+namespace tkwmHost {
+
+HttpConn::~HttpConn() {
+    if (fd >= 0) ::close(fd);
+}
+
+bool HttpConn::ready() { return pos < in.size() || fill(); }
+
+bool HttpConn::fill() {
+    if (fd < 0 || eof || !waitFd(fd, POLLIN, 0)) return false;
+    char    b[4096];
+    ssize_t n = recv(fd, b, sizeof(b), 0);
+    if (n <= 0) {
+        eof = true;
+        return false;
+    }
+    in.append(b, (size_t)n);
+    return true;
+}
+
+bool HttpConn::peerOpen() {
+    if (fd < 0) return false;                    // клиент из памяти уже всё отправил и ничего не ждёт
+    while (!eof && waitFd(fd, POLLIN, 0)) {
+        char b[512];
+        if (recv(fd, b, sizeof(b), 0) <= 0) eof = true;
+    }
+    return !eof;
+}
+
+size_t HttpConn::read(char* buf, size_t n, uint32_t waitMs) {
+    size_t k = 0;
+    while (k < n) {
+        if (pos < in.size()) {
+            const size_t m = std::min(n - k, in.size() - pos);
+            memcpy(buf + k, in.data() + pos, m);
+            pos += m;
+            k += m;
+            continue;
+        }
+        if (fd < 0 || eof || !waitFd(fd, POLLIN, waitMs) || !ready()) break;
+    }
+    return k;
+}
+
+bool HttpConn::readLine(std::string& line, uint32_t waitMs) {
+    line.clear();
+    for (;;) {
+        const size_t nl = in.find('\n', pos);
+        if (nl != std::string::npos) {
+            line.assign(in, pos, nl - pos);
+            pos = nl + 1;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            return true;
+        }
+        // неполная строка уже в in — ready() её считает за данные; дочитываем из сокета
+        if (fd < 0 || eof || !waitFd(fd, POLLIN, waitMs) || !fill()) return false;
+    }
+}
+
+void HttpConn::write(const char* p, size_t n) {
+    outBytes += n;
+    if (discard) return;
+    if (fd < 0) {
+        out.append(p, n);
+        return;
+    }
+    while (n) {
+        const ssize_t k = send(fd, p, n, MSG_NOSIGNAL);
+        if (k < 0 && errno == EAGAIN && waitFd(fd, POLLOUT, 5000)) continue;
+        if (k <= 0) return;
+        p += k;
+        n -= (size_t)k;
+    }
+}
+
+void HttpConn::close() {
+    done = true;
+    if (fd >= 0) {
+        shutdown(fd, SHUT_RDWR);
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+} // namespace tkwmHost
+
+// ===================== WebServer =====================
+WebServer::WebServer(int port) : _port((uint16_t)port) {}
+
+WebServer::~WebServer() { close(); }
+
+void WebServer::hostListen(bool on) { g_listen = on; }
+
+void WebServer::begin(uint16_t port) {
+    _port = port;
+    begin();
+}
+
+void WebServer::begin() {
+    if (!g_listen || _listenFd >= 0) return;
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return;
+    const int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in a{};
+    a.sin_family      = AF_INET;
+    a.sin_port        = htons(_port);
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (sockaddr*)&a, sizeof(a)) != 0 || listen(fd, 16) != 0) {
+        ::close(fd);
+        return;
+    }
+    socklen_t len = sizeof(a);
+    getsockname(fd, (sockaddr*)&a, &len);
+    _port = ntohs(a.sin_port);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    _listenFd = fd;
+}
+
+void WebServer::close() {
+    if (_listenFd >= 0) ::close(_listenFd);
+    _listenFd = -1;
+    if (_cur) _cur->close();
+    _cur.reset();
+}
+
+std::shared_ptr<tkwmHost::HttpConn> WebServer::hostQueue(const std::string& raw) {
+    auto c = std::make_shared<tkwmHost::HttpConn>();
+    c->in  = raw;
+    _pending.push_back(c);
+    return c;
+}
+
+void WebServer::on(const String& uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn) {
+    _handlers.push_back(Handler{uri, method, fn, ufn});
+}
+
+void WebServer::collectHeaders(const char* keys[], const size_t n) {
+    _collect.clear();
+    _collect.push_back("Authorization"); // ядро собирает его всегда
+    for (size_t i = 0; i < n; ++i) _collect.push_back(keys[i]);
+}
+
+String WebServer::arg(const String& name) {
+    for (auto& a : _args)
+        if (a.key == name) return a.value;
+    return String();
+}
+String WebServer::arg(int i) { return i >= 0 && i < (int)_args.size() ? _args[i].value : String(); }
+String WebServer::argName(int i) { return i >= 0 && i < (int)_args.size() ? _args[i].key : String(); }
+bool   WebServer::hasArg(const String& name) {
+    for (auto& a : _args)
+        if (a.key == name) return true;
+    return false;
+}
+
+String WebServer::header(const String& name) {
+    for (auto& h : _headers)
+        if (ieq(h.key, name)) return h.value;
+    return String();
+}
+String WebServer::header(int i) { return i >= 0 && i < (int)_headers.size() ? _headers[i].value : String(); }
+String WebServer::headerName(int i) { return i >= 0 && i < (int)_headers.size() ? _headers[i].key : String(); }
+bool   WebServer::hasHeader(const String& name) {
+    for (auto& h : _headers)
+        if (ieq(h.key, name)) return h.value.length() > 0;
+    return false;
+}
+
+int WebServer::findHandler() const {
+    for (size_t i = 0; i < _handlers.size(); ++i)
+        if ((_handlers[i].method == HTTP_ANY || _handlers[i].method == _method) && _handlers[i].uri == _uri) return (int)i;
+    return -1;
+}
+
+void WebServer::handleClient() {
+    if (!_cur) {
+        if (!_pending.empty()) {
+            _cur = _pending.front();
+            _pending.pop_front();
+        } else if (_listenFd >= 0) {
+            const int fd = accept(_listenFd, nullptr, nullptr);
+            if (fd >= 0) {
+                const int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                _cur     = std::make_shared<tkwmHost::HttpConn>();
+                _cur->fd = fd;
+            }
+        }
+        if (!_cur) {
+            if (_nullDelay) delay(1);
+            return;
+        }
+        _curSince  = millis();
+        _waitClose = false;
+    }
+
+    if (_waitClose) {
+        // HC_WAIT_CLOSE: клиент держит сервер, пока не закроет соединение или не выйдет HTTP_MAX_CLOSE_WAIT
+        if (_cur->peerOpen() && millis() - _curSince <= HTTP_MAX_CLOSE_WAIT) return;
+    } else if (!_cur->ready()) {
+        // HC_WAIT_READ: данных ещё нет — следующий клиент ждёт этого до HTTP_MAX_DATA_WAIT
+        if (!_cur->eof && millis() - _curSince <= HTTP_MAX_DATA_WAIT) {
+            yield();
+            return;
+        }
+    } else if (parseRequest()) {
+        _contentLength = CONTENT_LENGTH_NOT_SET;
+        handleRequest();
+        finish();
+        _served++;
+        _upload.reset();
+        if (_cur->peerOpen()) {
+            _waitClose = true;
+            _curSince  = millis();
+            return;
+        }
+    }
+    _cur->close();
+    _cur.reset();
+    _upload.reset();
+}
+
+bool WebServer::parseRequest() {
+    std::string line;
+    if (!_cur->readLine(line, HTTP_MAX_DATA_WAIT)) return false;
+    const size_t s1 = line.find(' '), s2 = line.rfind(' ');
+    if (s1 == std::string::npos || s2 == s1) return false;
+    const std::string m = line.substr(0, s1), url = line.substr(s1 + 1, s2 - s1 - 1);
+    _method = m == "GET" ? HTTP_GET : m == "HEAD" ? HTTP_HEAD : m == "POST" ? HTTP_POST : m == "PUT" ? HTTP_PUT
+            : m == "PATCH" ? HTTP_PATCH : m == "DELETE" ? HTTP_DELETE : m == "OPTIONS" ? HTTP_OPTIONS : HTTP_ANY;
+    const size_t q = url.find('?');
+    _uri = String(url.substr(0, q));
+    const std::string search = q == std::string::npos ? std::string() : url.substr(q + 1);
+
+    _args.clear();
+    _headers.clear();
+    for (auto& k : _collect) _headers.push_back(Kv{k, String()});
+    _hostHeader      = String();
+    _responseHeaders = String();
+    _chunked         = false;
+
+    std::string ctype;
+    size_t      clen = 0;
+    while (_cur->readLine(line, HTTP_MAX_DATA_WAIT) && !line.empty()) {
+        const size_t c = line.find(':');
+        if (c == std::string::npos) continue;
+        const String name(line.substr(0, c));
+        size_t       v = c + 1;
+        while (v < line.size() && line[v] == ' ') v++;
+        const std::string value = line.substr(v);
+        for (auto& h : _headers)
+            if (ieq(h.key, name)) h.value = String(value);
+        if (ieq(name, "Host")) _hostHeader = String(value);
+        else if (ieq(name, "Content-Type")) ctype = value;
+        else if (ieq(name, "Content-Length")) clen = (size_t)strtoul(value.c_str(), nullptr, 10);
+    }
+
+    _curHandler = findHandler();
+    const bool withBody = _method == HTTP_POST || _method == HTTP_PUT || _method == HTTP_PATCH || _method == HTTP_DELETE;
+    if (!withBody) {
+        parseArgs(search);
+        return true;
+    }
+    std::string body(clen, '\0');
+    body.resize(_cur->read(&body[0], clen, HTTP_MAX_POST_WAIT));
+    if (body.size() < clen) return false;
+
+    if (ctype.compare(0, 19, "multipart/form-data") == 0) {
+        const size_t b = ctype.find("boundary=");
+        if (b == std::string::npos) return false;
+        std::string boundary = ctype.substr(b + 9);
+        if (!boundary.empty() && boundary.front() == '"') boundary = boundary.substr(1, boundary.size() - 2);
+        parseArgs(search);
+        return parseMultipart(body, boundary);
+    }
+    const bool encoded = ctype.compare(0, 33, "application/x-www-form-urlencoded") == 0;
+    parseArgs(encoded ? (search.empty() ? body : search + "&" + body) : search);
+    if (!encoded) _args.push_back(Kv{"plain", String(body)});
+    return true;
+}
+
+void WebServer::parseArgs(const std::string& q) {
+    size_t p = 0;
+    while (p < q.size()) {
+        size_t e = q.find('&', p);
+        if (e == std::string::npos) e = q.size();
+        const std::string part = q.substr(p, e - p);
+        if (!part.empty()) {
+            const size_t eq = part.find('=');
+            _args.push_back(Kv{String(urlDecode(part.substr(0, eq))),
+                               String(eq == std::string::npos ? std::string() : urlDecode(part.substr(eq + 1)))});
+        }
+        p = e + 1;
+    }
+}
+
+bool WebServer::parseMultipart(const std::string& body, const std::string& boundary) {
+    const std::string delim = "--" + boundary;
+    size_t p = body.find(delim);
+    while (p != std::string::npos) {
+        p += delim.size();
+        if (body.compare(p, 2, "--") == 0) return true;
+        if (body.compare(p, 2, "\r\n") == 0) p += 2;
+        const size_t hdrEnd = body.find("\r\n\r\n", p);
+        if (hdrEnd == std::string::npos) return false;
+        const std::string hdr = body.substr(p, hdrEnd - p);
+        const size_t dataAt  = hdrEnd + 4;
+        const size_t next    = body.find("\r\n" + delim, dataAt);
+        if (next == std::string::npos) return false;
+
+        auto attr = [&hdr](const char* key) -> std::string {
+            const size_t k = hdr.find(key);
+            if (k == std::string::npos) return std::string();
+            const size_t v = k + strlen(key), e = hdr.find('"', v);
+            return hdr.substr(v, e - v);
+        };
+        std::string type;
+        const size_t ct = hdr.find("Content-Type:");
+        if (ct != std::string::npos) {
+            size_t v = ct + 13;
+            while (v < hdr.size() && hdr[v] == ' ') v++;
+            type = hdr.substr(v, hdr.find("\r\n", v) - v);
+        }
+        const std::string name = attr("name=\"");
+        const bool        file = hdr.find("filename=\"") != std::string::npos;
+
+        if (!file) {
+            _args.push_back(Kv{String(name), String(body.substr(dataAt, next - dataAt))});
+        } else {
+            const THandlerFunction up = _curHandler >= 0 && _handlers[_curHandler].ufn ? _handlers[_curHandler].ufn : _fileUpload;
+            _upload.reset(new HTTPUpload());
+            _upload->status      = UPLOAD_FILE_START;
+            _upload->filename    = String(attr("filename=\""));
+            _upload->name        = String(name);
+            _upload->type        = String(type);
+            _upload->totalSize   = 0;
+            _upload->currentSize = 0;
+            if (up) up();
+            // как _uploadWriteByte ядра: totalSize растёт после вызова обработчика WRITE
+            for (size_t i = dataAt; i < next;) {
+                const size_t n = std::min<size_t>(HTTP_UPLOAD_BUFLEN, next - i);
+                memcpy(_upload->buf, body.data() + i, n);
+                _upload->status      = UPLOAD_FILE_WRITE;
+                _upload->currentSize = n;
+                if (up) up();
+                _upload->totalSize += n;
+                i += n;
+            }
+            _upload->status      = UPLOAD_FILE_END;
+            _upload->currentSize = 0;
+            if (up) up();
+        }
+        p = next + 2;
+    }
+    return false;
+}
+
+void WebServer::handleRequest() {
+    if (_curHandler >= 0 && _handlers[_curHandler].fn) _handlers[_curHandler].fn();
+    else if (_notFound) _notFound();
+    else send(404, "text/html", String("Not found: ") + _uri);
+}
+
+void WebServer::finish() {
+    if (_chunked) sendContent("", 0);
+}
+
+void WebServer::writeOut(const char* p, size_t n) {
+    if (_cur && n) _cur->write(p, n);
+}
+
+void WebServer::sendHeader(const String& name, const String& value, bool first) {
+    String line = name + ": " + value + "\r\n";
+    if (first) _responseHeaders = line + _responseHeaders;
+    else _responseHeaders += line;
+}
+
+void WebServer::prepareHeader(String& out, int code, const char* type, size_t len) {
+    out = String("HTTP/1.1 ") + String(code) + " " + codeText(code) + "\r\n";
+    sendHeader("Content-Type", type ? type : "text/html", true);
+    if (_contentLength == CONTENT_LENGTH_NOT_SET) sendHeader("Content-Length", String((unsigned long)len));
+    else if (_contentLength != CONTENT_LENGTH_UNKNOWN) sendHeader("Content-Length", String((unsigned long)_contentLength));
+    else {
+        _chunked = true;
+        sendHeader("Accept-Ranges", "none");
+        sendHeader("Transfer-Encoding", "chunked");
+    }
+    if (_cors) sendHeader("Access-Control-Allow-Origin", "*");
+    sendHeader("Connection", "close");
+    out += _responseHeaders;
+    out += "\r\n";
+    _responseHeaders = String();
+}
+
+void WebServer::send(int code, const char* type, const String& content) { send(code, type, content.c_str(), content.length()); }
+
+void WebServer::send(int code, const char* type, const char* content, size_t len) {
+    String hdr;
+    prepareHeader(hdr, code, type, len);
+    writeOut(hdr.c_str(), hdr.length());
+    if (len) sendContent(content, len);
+}
+
+void WebServer::sendContent(const char* content, size_t len) {
+    if (!_chunked) {
+        writeOut(content, len);
+        return;
+    }
+    char head[16];
+    const int n = snprintf(head, sizeof(head), "%zx\r\n", len);
+    writeOut(head, (size_t)n);
+    writeOut(content, len);
+    writeOut("\r\n", 2);
+    if (!len) _chunked = false;
+}
+
+// ===================== запросы из тестов =====================
+namespace tkwmHost {
+
+bool parseResponse(const std::string& raw, Response& out) {
+    out = Response();
+    const size_t he = raw.find("\r\n\r\n");
+    if (raw.compare(0, 5, "HTTP/") != 0 || he == std::string::npos) return false;
+    out.code = atoi(raw.c_str() + raw.find(' ') + 1);
+    size_t p = raw.find("\r\n") + 2;
+    while (p < he) {
+        const size_t e = raw.find("\r\n", p), c = raw.find(':', p);
+        if (c != std::string::npos && c < e) {
+            std::string k = raw.substr(p, c - p), v = raw.substr(c + 1, e - c - 1);
+            std::transform(k.begin(), k.end(), k.begin(), ::tolower);
+            while (!v.empty() && v[0] == ' ') v.erase(0, 1);
+            out.headers[k] = v;
+        }
+        p = e + 2;
+    }
+    const std::string body = raw.substr(he + 4);
+    out.chunked            = out.header("transfer-encoding") == "chunked";
+    if (!out.chunked) {
+        const std::string cl = out.header("content-length");
+        out.body             = cl.empty() ? body : body.substr(0, strtoul(cl.c_str(), nullptr, 10));
+        return true;
+    }
+    for (size_t q = 0;;) {
+        const size_t e = body.find("\r\n", q);
+        if (e == std::string::npos) return false;
+        const size_t n = strtoul(body.substr(q, e - q).c_str(), nullptr, 16);
+        if (!n) return true;
+        out.body.append(body, e + 2, n);
+        q = e + 2 + n + 2;
+    }
+}
+
+Response request(WebServer& web, const std::string& raw, const std::function<void()>& tick, uint32_t maxTicks) {
+    auto c = web.hostQueue(raw);
+    for (uint32_t i = 0; i < maxTicks && !c->done; ++i) tick();
+    Response r;
+    if (c->done) parseResponse(c->out, r);
+    return r;
+}
+
+std::string rawRequest(const char* method, const std::string& uri, const std::string& body, const std::string& extraHeaders,
+                       const char* contentType) {
+    std::string s = std::string(method) + " " + uri + " HTTP/1.1\r\nHost: 192.168.4.1\r\n" + extraHeaders;
+    const bool withBody = !body.empty() || !strcmp(method, "POST") || !strcmp(method, "PUT");
+    if (withBody) {
+        s += "Content-Type: " + std::string(contentType ? contentType : "text/plain") + "\r\n";
+        s += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    }
+    return s + "\r\n" + body;
+}
+
+} // namespace tkwmHost
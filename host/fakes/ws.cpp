@@ -0,0 +1,73 @@
+// WebSocketsServer в памяти: кадры клиентов копятся в очереди и раздаются из loop().
+#include "host_sim.h"
+
+void WebSocketsServer::loop() {
+    if (!_running) return;
+    for (auto it = _clients.begin(); it != _clients.end();) {
+        const uint8_t id = it->first;
+        while (!it->second.toServer.empty()) {
+            auto ev = it->second.toServer.front();
+            it->second.toServer.pop_front();
+            if (ev.first == WStype_CONNECTED) it->second.connected = true;
+            std::string payload = ev.second; // обработчик может дописать в буфер — как у библиотеки, с нулём в конце
+            if (_cb) _cb(id, ev.first, (uint8_t*)&payload[0], ev.second.size());
+            if (ev.first == WStype_DISCONNECTED) break;
+        }
+        auto cur = it++;
+        if (!cur->second.toServer.empty() || cur->second.connected) continue;
+        _clients.erase(cur);
+    }
+}
+
+bool WebSocketsServer::sendTXT(uint8_t num, const uint8_t* payload, size_t length) {
+    auto it = _clients.find(num);
+    if (it == _clients.end() || !it->second.connected) return false;
+    if (!length) length = strlen((const char*)payload);
+    it->second.received.emplace_back((const char*)payload, length);
+    _tx += length;
+    return true;
+}
+
+bool WebSocketsServer::broadcastTXT(const uint8_t* payload, size_t length) {
+    bool ok = true;
+    for (auto& c : _clients)
+        if (c.second.connected) ok = sendTXT(c.first, payload, length) && ok;
+    return ok;
+}
+
+void WebSocketsServer::disconnect(uint8_t num) {
+    auto it = _clients.find(num);
+    if (it != _clients.end()) it->second.toServer.emplace_back(WStype_DISCONNECTED, std::string());
+}
+
+uint8_t WebSocketsServer::connectedClients(bool) {
+    uint8_t n = 0;
+    for (auto& c : _clients) n += c.second.connected;
+    return n;
+}
+
+namespace tkwmHost {
+
+uint8_t wsConnect(WebSocketsServer& ws) {
+    auto&   cl = ws.hostClients();
+    uint8_t id = 0;
+    while (cl.count(id)) id++;
+    cl[id].toServer.emplace_back(WStype_CONNECTED, std::string("/"));
+    return id;
+}
+
+void wsSend(WebSocketsServer& ws, uint8_t id, const std::string& text) { ws.hostClients()[id].toServer.emplace_back(WStype_TEXT, text); }
+
+void wsClose(WebSocketsServer& ws, uint8_t id) {
+    auto& c     = ws.hostClients()[id];
+    c.connected = false;
+    c.toServer.emplace_back(WStype_DISCONNECTED, std::string());
+}
+
+std::vector<std::string> wsTake(WebSocketsServer& ws, uint8_t id) {
+    std::vector<std::string> r;
+    r.swap(ws.hostClients()[id].received);
+    return r;
+}
+
+} // namespace tkwmHost
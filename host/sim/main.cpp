@@ -0,0 +1,94 @@
+// tkwm_sim — драйвер хост-сборки: одно устройство с TKWifiManager, эфир по сценарию из командной строки,
+// serviceTick() через loop() с шагом TKWM_TASK_TICK_MS. С --listen веб-интерфейс доступен браузеру ПК.
+//   tkwm_sim --ap home:secret12[:ch[:rssi]] ... [--fs <каталог>] [--listen <порт>] [--seconds N] [--down i@s] [--up i@s]
+#include <TKWifiManager.h>
+#include "host_sim.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Toggle {
+    int      ap;
+    uint32_t atMs;
+    bool     up;
+};
+
+void usage() {
+    fprintf(stderr,
+            "tkwm_sim --ap ssid:pass[:ch[:rssi]] ... [--fs dir] [--listen port] [--seconds N]\n"
+            "         [--down i@sec] [--up i@sec]   точка i пропадает/появляется на секунде sec\n");
+}
+
+bool parseToggle(const char* s, bool up, std::vector<Toggle>& out) {
+    int i, sec;
+    if (sscanf(s, "%d@%d", &i, &sec) != 2) return false;
+    out.push_back({i, (uint32_t)sec * 1000, up});
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    using namespace tkwmHost;
+    std::vector<Toggle> toggles;
+    std::string fsDir;
+    int      listenPort = -1;
+    uint32_t seconds    = 60;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        const char*       v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (a == "--ap" && v) {
+            char ssid[33] = {}, pass[65] = {};
+            int  ch = 6, rssi = -55;
+            if (sscanf(v, "%32[^:]:%64[^:]:%d:%d", ssid, pass, &ch, &rssi) < 1) return usage(), 2;
+            Ap ap;
+            ap.ssid = ssid;
+            ap.pass = pass;
+            ap.ch   = (uint8_t)ch;
+            ap.rssi = (int8_t)rssi;
+            const uint8_t b[6] = {0x02, 0x11, 0x22, 0x33, 0x44, (uint8_t)(air().aps.size() + 1)};
+            memcpy(ap.bssid, b, 6);
+            addAp(ap);
+            ++i;
+        } else if (a == "--fs" && v) fsDir = argv[++i];
+        else if (a == "--listen" && v) listenPort = atoi(argv[++i]);
+        else if (a == "--seconds" && v) seconds = (uint32_t)atoi(argv[++i]);
+        else if (a == "--down" && v) { if (!parseToggle(argv[++i], false, toggles)) return usage(), 2; }
+        else if (a == "--up" && v) { if (!parseToggle(argv[++i], true, toggles)) return usage(), 2; }
+        else return usage(), 2;
+    }
+
+    serialEcho(true);
+    if (!fsDir.empty()) device().fsRoot = fsDir;
+    if (listenPort >= 0) {
+        WebServer::hostListen(true); // браузер и curl идут через настоящий сокет — время тоже настоящее
+        realTime(true);
+    }
+
+    TKWifiManager mgr(listenPort >= 0 ? (uint16_t)listenPort : 80); // 0 — свободный порт ПК
+    mgr.begin();
+    if (listenPort >= 0) fprintf(stderr, "[sim] http://127.0.0.1:%u/\n", (unsigned)mgr.web().hostPort());
+
+    const uint32_t t0 = millis();
+    uint32_t lastReport = 0;
+    while (millis() - t0 < seconds * 1000UL) {
+        const uint32_t now = millis() - t0;
+        for (auto it = toggles.begin(); it != toggles.end();) {
+            if (now < it->atMs) { ++it; continue; }
+            if (it->ap >= 0 && it->ap < (int)air().aps.size()) apSet(it->ap, it->up);
+            it = toggles.erase(it);
+        }
+        mgr.loop();
+        advance(TKWM_TASK_TICK_MS);
+        if (now - lastReport >= 5000) {
+            lastReport = now;
+            fprintf(stderr, "[sim] t=%lus %s ip=%s\n", (unsigned long)(now / 1000), mgr.inCaptive() ? "AP" : "STA",
+                    mgr.ip().toString().c_str());
+        }
+    }
+    return 0;
+}
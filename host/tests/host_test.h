@@ -0,0 +1,96 @@
+#pragma once
+// Общие помощники хост-тестов: проверки без фреймворка, точки доступа, шаг менеджера в виртуальном времени.
+#include <TKWifiManager.h>
+#include "host_sim.h"
+#include <cstdio>
+#include <functional>
+#include <sstream>
+#include <string>
+
+namespace tkwmTest {
+inline int& failures() { static int n = 0; return n; }
+template <typename T> std::string show(const T& v) {
+    std::ostringstream o;
+    o << v;
+    return o.str();
+}
+inline std::string show(const String& v) { return v.str(); }
+inline void fail(const char* file, int line, const std::string& what) {
+    fprintf(stderr, "%s:%d: FAILED: %s\n", file, line, what.c_str());
+    failures()++;
+}
+}
+
+#define CHECK(c) do { if (!(c)) tkwmTest::fail(__FILE__, __LINE__, #c); } while (0)
+#define CHECK_EQ(a, b) do { const auto a_ = (a); const auto b_ = (b); \
+    if (!(a_ == b_)) tkwmTest::fail(__FILE__, __LINE__, std::string(#a " == " #b " (") + tkwmTest::show(a_) + " vs " + tkwmTest::show(b_) + ")"); } while (0)
+#define CHECK_LE(a, b) do { const auto a_ = (a); const auto b_ = (b); \
+    if (!(a_ <= b_)) tkwmTest::fail(__FILE__, __LINE__, std::string(#a " <= " #b " (") + tkwmTest::show(a_) + " vs " + tkwmTest::show(b_) + ")"); } while (0)
+
+/** Итог теста: код возврата для ctest. */
+inline int report(const char* name) {
+    if (tkwmTest::failures()) fprintf(stderr, "%s: %d check(s) failed\n", name, tkwmTest::failures());
+    else printf("%s: OK\n", name);
+    return tkwmTest::failures() ? 1 : 0;
+}
+
+/** Строка результата замера: ctest -V и журналы CI показывают их как есть. */
+inline void metric(const char* name, double value, const char* unit) { printf("METRIC %s=%.3f %s\n", name, value, unit); }
+
+/** Точка доступа с уникальным BSSID. */
+inline tkwmHost::Ap hostAp(const char* ssid, const char* pass, uint8_t ch = 6, int8_t rssi = -55) {
+    static uint8_t n = 0;
+    tkwmHost::Ap a;
+    a.ssid = ssid;
+    a.pass = pass;
+    a.ch   = ch;
+    a.rssi = rssi;
+    const uint8_t b[6] = {0x02, 0x11, 0x22, 0x33, 0x44, ++n};
+    memcpy(a.bssid, b, 6);
+    return a;
+}
+
+/** Один шаг владельца: loop() и TKWM_TASK_TICK_MS виртуального времени (как задача tkwm_task). */
+inline std::function<void()> tickOf(TKWifiManager& m) {
+    return [&m] {
+        m.loop();
+        tkwmHost::advance(TKWM_TASK_TICK_MS);
+    };
+}
+
+/** Шагать менеджером, пока не выполнится pred или не пройдёт ms виртуального времени. */
+inline bool runUntil(TKWifiManager& m, const std::function<bool()>& pred, uint32_t ms) {
+    const uint32_t t0 = millis();
+    while (!pred()) {
+        if (millis() - t0 >= ms) return false;
+        m.loop();
+        tkwmHost::advance(TKWM_TASK_TICK_MS);
+    }
+    return true;
+}
+
+inline void runFor(TKWifiManager& m, uint32_t ms) { runUntil(m, [] { return false; }, ms); }
+
+/** Длительность loop(): виртуальное время, которое он сдвинул (delay(), ожидание NVS/flash) — столько тик занял бы задачу. */
+struct TickStats {
+    uint64_t maxUs = 0, sumUs = 0, n = 0;
+    void step(TKWifiManager& m) {
+        const uint64_t t0 = tkwmHost::nowUs();
+        m.loop();
+        const uint64_t dt = tkwmHost::nowUs() - t0;
+        maxUs = dt > maxUs ? dt : maxUs;
+        sumUs += dt;
+        n++;
+        tkwmHost::advance(TKWM_TASK_TICK_MS);
+    }
+    bool runUntil(TKWifiManager& m, const std::function<bool()>& pred, uint32_t ms) {
+        const uint32_t t0 = millis();
+        while (!pred()) {
+            if (millis() - t0 >= ms) return false;
+            step(m);
+        }
+        return true;
+    }
+    void runFor(TKWifiManager& m, uint32_t ms) { runUntil(m, [] { return false; }, ms); }
+    std::function<void()> tick(TKWifiManager& m) { return [this, &m] { step(m); }; }
+};
@@ -0,0 +1,110 @@
+// user-003: встроенные страницы уходят заранее сжатыми (gzip) со строгим ETag, повторный запрос с
+// If-None-Match получает 304 без тела. Тело каждого ответа распаковывается и сверяется с исходником в src/.
+#include "host_test.h"
+#include <fstream>
+#include <sstream>
+#include <zlib.h>
+
+namespace {
+
+std::string readSource(const char* rel) {
+    std::ifstream f(std::string(TKWM_SRC_DIR) + "/" + rel, std::ios::binary);
+    std::stringstream ss;
+    ss << f.rdbuf();
+    std::string s = ss.str();
+    const std::string mark = "%TKWM_WS_PORT%";
+    for (size_t p; (p = s.find(mark)) != std::string::npos;) s.replace(p, mark.size(), std::to_string(TKWM_WS_PORT));
+    return s;
+}
+
+std::string gunzip(const std::string& gz) {
+    z_stream z{};
+    if (inflateInit2(&z, 16 + MAX_WBITS) != Z_OK) return std::string();
+    std::string out;
+    char        buf[16384];
+    z.next_in  = (Bytef*)gz.data();
+    z.avail_in = (uInt)gz.size();
+    int rc;
+    do {
+        z.next_out  = (Bytef*)buf;
+        z.avail_out = sizeof(buf);
+        rc          = inflate(&z, Z_NO_FLUSH);
+        out.append(buf, sizeof(buf) - z.avail_out);
+    } while (rc == Z_OK);
+    inflateEnd(&z);
+    return rc == Z_STREAM_END ? out : std::string();
+}
+
+// Ответ целиком (заголовки + тело) — байты в эфире.
+std::string exchange(TKWifiManager& m, const std::string& raw) {
+    auto c = m.web().hostQueue(raw);
+    for (int i = 0; i < 100 && !c->done; i++) tickOf(m)();
+    return c->out;
+}
+
+} // namespace
+
+int main() {
+    using namespace tkwmHost;
+    Device dev(1);
+    use(dev);
+    TKWifiManager mgr;
+    CHECK(mgr.begin());
+
+    struct Page { const char* uri; const char* src; const char* mime; } pages[] = {
+        {"/", "embed/index.html", "text/html"},
+        {"/wifi", "embed/wifi.html", "text/html"},
+        {"/fs", "embed/fs.html", "text/html"},
+        {"/ota", "ota.html", "text/html"},
+        {"/theme.css", "theme.css", "text/css"},
+        {"/theme.js", "theme.js", "application/javascript"},
+    };
+    const std::string gzHdr = "Accept-Encoding: gzip, deflate\r\n";
+    size_t rawTotal = 0, wireTotal = 0, reloadTotal = 0;
+    for (const Page& p : pages) {
+        const std::string wire = exchange(mgr, rawRequest("GET", p.uri, "", gzHdr));
+        Response r;
+        CHECK(parseResponse(wire, r));
+        CHECK_EQ(r.code, 200);
+        CHECK(r.header("content-type").find(p.mime) == 0);
+        CHECK_EQ(r.header("content-encoding"), std::string("gzip"));
+        CHECK(r.header("cache-control").size() > 0);
+        const std::string etag = r.header("etag");
+        CHECK(etag.size() > 2 && etag.front() == '"' && etag.back() == '"');  // строгий, не W/
+        const std::string src = readSource(p.src);
+        CHECK(!src.empty());
+        CHECK(gunzip(r.body) == src);
+        rawTotal += src.size();
+        wireTotal += wire.size();
+
+        // повторная загрузка: тег совпал — 304 без тела, тот же ETag
+        const std::string again = exchange(mgr, rawRequest("GET", p.uri, "", gzHdr + "If-None-Match: " + etag + "\r\n"));
+        Response r304;
+        CHECK(parseResponse(again, r304));
+        CHECK_EQ(r304.code, 304);
+        CHECK(r304.body.empty());
+        CHECK_EQ(r304.header("etag"), etag);
+        reloadTotal += again.size();
+
+        // список тегов и слабое сравнение (W/) для GET тоже совпадают; чужой тег — полный ответ
+        CHECK_EQ(request(mgr.web(), rawRequest("GET", p.uri, "", "If-None-Match: \"0000\", " + etag + "\r\n"), tickOf(mgr)).code, 304);
+        CHECK_EQ(request(mgr.web(), rawRequest("GET", p.uri, "", "If-None-Match: W/" + etag + "\r\n"), tickOf(mgr)).code, 304);
+        CHECK_EQ(request(mgr.web(), rawRequest("GET", p.uri, "", "If-None-Match: *\r\n"), tickOf(mgr)).code, 304);
+        CHECK_EQ(request(mgr.web(), rawRequest("GET", p.uri, "", "If-None-Match: \"0000000000000000\"\r\n"), tickOf(mgr)).code, 200);
+    }
+    metric("assets_raw_bytes", (double)rawTotal, "B");
+    metric("assets_wire_bytes", (double)wireTotal, "B");
+    metric("assets_saving_pct", 100.0 * (1.0 - (double)wireTotal / rawTotal), "%");
+    metric("assets_reload_bytes", (double)reloadTotal, "B");
+    CHECK_LE(wireTotal * 100, rawTotal * 45);     // сжатие экономит больше 55% трафика страниц
+    CHECK_LE(reloadTotal * 100, wireTotal * 6);   // повторная загрузка с 304 — не больше 6% первой
+
+    // файл в FS подменяет встроенную страницу (без ETag встроенной)
+    fs::File f = LittleFS.open("/theme.css", "w", true);
+    f.print("body{color:red}");
+    f.close();
+    const Response own = request(mgr.web(), rawRequest("GET", "/theme.css", "", gzHdr), tickOf(mgr));
+    CHECK_EQ(own.code, 200);
+    CHECK_EQ(own.body, std::string("body{color:red}"));
+    return report("builtin_assets");
+}
@@ -0,0 +1,160 @@
+// user-014: ранжирование кандидатов по RSSI и сохранённой истории. Сценарии с точками, которые падают
+// с заданной вероятностью (DHCP не отвечает, отказ ассоциации, сменённый пароль), прогоняются серией
+// загрузок на двух устройствах: одно помнит статистику сетей в блобе NVS, у другого она стирается перед
+// каждой загрузкой (выбор только по RSSI, как до user-014). Подсказка быстрого подключения стирается у
+// обоих, чтобы каждая загрузка шла через скан и ранжирование. Итог — среднее время до IP.
+#include "host_test.h"
+#include <algorithm>
+#include <random>
+#include <zlib.h>
+
+namespace {
+
+struct ApSpec {
+    const char* ssid;
+    int8_t      rssi;
+    int         failPct;  // вероятность провала на загрузку
+    char        kind;     // 'd' — DHCP молчит, 'r' — отказ ассоциации, 'p' — пароль на точке сменили
+};
+
+struct Scenario {
+    const char* name;
+    ApSpec      aps[3];
+};
+
+const Scenario kScenarios[] = {
+    {"strong_dhcp_flaky", {{"strong", -45, 80, 'd'}, {"mid", -62, 0, 'd'}, {"weak", -74, 0, 'd'}}},
+    {"strong_wrong_pass", {{"strong", -40, 100, 'p'}, {"mid", -64, 10, 'd'}, {"weak", -72, 0, 'd'}}},
+    {"two_flaky", {{"a", -48, 60, 'r'}, {"b", -55, 50, 'd'}, {"c", -70, 0, 'd'}}},
+};
+const int kBoots = 24;
+
+std::string passFor(const char* ssid) { return std::string("pw-") + ssid + "-12345"; }
+
+void seed(tkwmHost::Nvs& nvs, const Scenario& s) {
+    auto& m = nvs.ns["tkw_net"];
+    m.clear();
+    int32_t n = 3;
+    m["count"] = {'i', std::string((const char*)&n, 4)};
+    for (int i = 0; i < 3; i++) {
+        m["s" + std::to_string(i)] = {'s', s.aps[i].ssid};
+        m["p" + std::to_string(i)] = {'s', passFor(s.aps[i].ssid)};
+    }
+}
+
+// Блоб tkw_net/creds (формат — TKWifiManager.cpp, «Creds»): снять флаг «подключались последней»,
+// для памяти без истории — обнулить статистику ext[24..35]; CRC пересчитать.
+void prepBlob(tkwmHost::Nvs& nvs, bool wipeStats) {
+    auto it = nvs.ns["tkw_net"].find("creds");
+    if (it == nvs.ns["tkw_net"].end()) return;
+    std::string& b = it->second.data;
+    size_t       i = 8;
+    for (int r = 0; r < (uint8_t)b[3]; r++) {
+        i += 1 + (uint8_t)b[i];
+        i += 1 + (uint8_t)b[i];
+        const uint8_t l = (uint8_t)b[i++];
+        if (l >= 24) b[i] &= ~1;
+        if (wipeStats && l >= 36) std::fill(b.begin() + i + 24, b.begin() + i + 36, 0);
+        i += l;
+    }
+    const uint32_t crc = (uint32_t)crc32(0, (const Bytef*)b.data() + 8, (uInt)(b.size() - 8));
+    for (int k = 0; k < 4; k++) b[4 + k] = (char)(crc >> (8 * k));
+}
+
+// Состояние точек на эту загрузку.
+void configure(const Scenario& s, const int* aps, const bool* failing) {
+    for (int i = 0; i < 3; i++) {
+        tkwmHost::Ap& a = tkwmHost::ap(aps[i]);
+        const ApSpec& p = s.aps[i];
+        a.failReason    = 0;
+        a.dhcpMs        = 250;
+        a.pass          = passFor(p.ssid).c_str();
+        if (!failing[i]) continue;
+        if (p.kind == 'd') a.dhcpMs = 60000;
+        else if (p.kind == 'r') a.failReason = WIFI_REASON_ASSOC_FAIL;
+        else a.pass = "changed-by-admin";
+    }
+}
+
+// Одна загрузка: время от begin() до IP (0 — не подключились за 120 с).
+uint32_t boot(tkwmHost::Device& d, bool wipeStats) {
+    tkwmHost::use(d);
+    prepBlob(d.nvs, wipeStats);
+    d.reboot();
+    const uint32_t t0 = tkwmHost::nowMs();
+    TKWifiManager  mgr;
+    CHECK(mgr.begin());
+    const bool ok = runUntil(mgr, [&] { return d.staConnected() && !mgr.inCaptive(); }, 120000);
+    const uint32_t ms = tkwmHost::nowMs() - t0;
+    runFor(mgr, 500);
+    return ok ? ms : 0;
+}
+
+struct Series {
+    std::vector<uint32_t> ms;
+    int                   fails = 0;
+    double mean() const {
+        double s = 0;
+        for (uint32_t v : ms) s += v;
+        return ms.empty() ? 0 : s / ms.size();
+    }
+    double p90() const {
+        if (ms.empty()) return 0;
+        std::vector<uint32_t> v = ms;
+        std::sort(v.begin(), v.end());
+        return v[(v.size() * 9) / 10 < v.size() ? (v.size() * 9) / 10 : v.size() - 1];
+    }
+};
+
+} // namespace
+
+int main() {
+    using namespace tkwmHost;
+    double sumAdaptive = 0, sumRssi = 0;
+    int    sc = 0;
+    for (const Scenario& s : kScenarios) {
+        clearAir();
+        int aps[3];
+        for (int i = 0; i < 3; i++) aps[i] = addAp(hostAp(s.aps[i].ssid, passFor(s.aps[i].ssid).c_str(), (uint8_t)(1 + 5 * i), s.aps[i].rssi));
+
+        Device adaptive(10 + sc * 2), rssiOnly(11 + sc * 2);
+        seed(adaptive.nvs, s);
+        seed(rssiOnly.nvs, s);
+        std::mt19937 rng(1400 + sc);
+        Series       a, r;
+        for (int b = 0; b < kBoots; b++) {
+            bool failing[3];
+            for (int i = 0; i < 3; i++) failing[i] = (int)(rng() % 100) < s.aps[i].failPct;
+            configure(s, aps, failing);
+            const uint32_t ta = boot(adaptive, false);
+            configure(s, aps, failing);
+            const uint32_t tr = boot(rssiOnly, true);
+            if (ta) a.ms.push_back(ta);
+            else a.fails++;
+            if (tr) r.ms.push_back(tr);
+            else r.fails++;
+        }
+        CHECK_EQ(a.fails, 0);
+        CHECK_EQ(r.fails, 0);
+
+        char name[96];
+        snprintf(name, sizeof(name), "%s_history_mean_ttc", s.name);
+        metric(name, a.mean(), "ms");
+        snprintf(name, sizeof(name), "%s_rssi_only_mean_ttc", s.name);
+        metric(name, r.mean(), "ms");
+        snprintf(name, sizeof(name), "%s_history_p90_ttc", s.name);
+        metric(name, a.p90(), "ms");
+        snprintf(name, sizeof(name), "%s_rssi_only_p90_ttc", s.name);
+        metric(name, r.p90(), "ms");
+        // История не должна делать хуже ни в одном сценарии
+        CHECK_LE(a.mean(), r.mean());
+        sumAdaptive += a.mean();
+        sumRssi += r.mean();
+        sc++;
+    }
+    metric("all_history_mean_ttc", sumAdaptive / sc, "ms");
+    metric("all_rssi_only_mean_ttc", sumRssi / sc, "ms");
+    // Стабильно падающая сильная точка уходит вниз списка после пары провалов.
+    CHECK_LE(sumAdaptive * 3, sumRssi * 2);
+    return report("test_connect_rank");
+}
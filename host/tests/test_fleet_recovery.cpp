@@ -0,0 +1,162 @@
+// user-016: восстановление парка устройств после перезагрузки точки. N устройств на одной точке (очередь
+// ассоциаций, повторы занимают эфир), точка пропадает на время outage и после включения ещё bootMs не
+// отвечает. Короткий сбой (8 с) — устройства переподключаются в STA; длинный (90 с) — уходят в AP (каждое в свой срок
+// по политике) и из портала продолжают пробовать STA. Для политик reconnectBackoff и reconnectFixed:
+// время до IP у всех (от готовности точки), среднее и p90, разброс ухода в AP, отказы точки и сканы.
+#include "host_test.h"
+#include <algorithm>
+#include <memory>
+
+namespace {
+
+const int      kDevices = 40;
+const uint32_t kTick    = TKWM_TASK_TICK_MS;
+
+struct Outcome {
+    std::vector<uint32_t> ms;        // от готовности точки до IP, по устройствам
+    uint32_t              apSpreadMs = 0, apN = 0;
+    uint32_t              assocFail = 0, assocOk = 0, scans = 0;
+    bool                  all = false;
+    double mean() const {
+        double s = 0;
+        for (uint32_t v : ms) s += v;
+        return ms.empty() ? 0 : s / ms.size();
+    }
+    uint32_t pct(int p) const {
+        if (ms.empty()) return 0;
+        std::vector<uint32_t> v = ms;
+        std::sort(v.begin(), v.end());
+        return v[std::min(v.size() - 1, v.size() * p / 100)];
+    }
+};
+
+Outcome run(bool backoff, uint32_t outageMs, uint32_t bootMs) {
+    using namespace tkwmHost;
+    clearAir();
+    Ap a0          = hostAp("floor", "floor-pass", 6, -50);
+    a0.bootMs      = bootMs;
+    const int ap   = addAp(a0);
+
+    std::vector<std::unique_ptr<Device>>        devs;
+    std::vector<std::unique_ptr<TKWifiManager>> mgrs;
+    std::vector<uint32_t>                       apAt(kDevices, 0);
+    for (int i = 0; i < kDevices; i++) {
+        devs.emplace_back(new Device(1600 + i));
+        Device& d = *devs.back();
+        use(d);
+        auto& m = d.nvs.ns["tkw_net"];
+        int32_t n = 1;
+        m["count"] = {'i', std::string((const char*)&n, 4)};
+        m["s0"]    = {'s', "floor"};
+        m["p0"]    = {'s', "floor-pass"};
+        mgrs.emplace_back(new TKWifiManager);
+        TKWifiManager& mgr = *mgrs.back();
+        if (!backoff) mgr.setReconnectPolicy(TKWifiManager::reconnectFixed);
+        mgr.setEventHook([&apAt, i](TKWifiManager::Event e) {
+            if (e == TKWifiManager::Event::ApStarted && !apAt[i]) apAt[i] = nowMs();
+        });
+        CHECK(mgr.begin());
+    }
+    auto step = [&] {
+        for (int i = 0; i < kDevices; i++) {
+            use(*devs[i]);
+            mgrs[i]->loop();
+        }
+        advance(kTick);
+    };
+    auto online = [&](int i) { return devs[i]->staConnected() && !mgrs[i]->inCaptive(); };
+    // старт парка: очередь ассоциаций разбирается не сразу
+    auto allOnline = [&] {
+        for (int i = 0; i < kDevices; i++)
+            if (!online(i)) return false;
+        return true;
+    };
+    for (uint32_t t0 = nowMs(); !allOnline() && nowMs() - t0 < 60000;) step();
+    CHECK(allOnline());
+    std::fill(apAt.begin(), apAt.end(), 0);
+
+    apSet(ap, false);
+    for (uint32_t t0 = nowMs(); nowMs() - t0 < outageMs;) step();
+    apSet(ap, true);
+    const uint32_t ready = nowMs() + bootMs;
+    const uint32_t fail0 = tkwmHost::ap(ap).assocFail, ok0 = tkwmHost::ap(ap).assocOk;
+    uint32_t       scans0 = 0;
+    for (auto& d : devs) scans0 += d->scanN();
+
+    Outcome             o;
+    std::vector<uint32_t> doneAt(kDevices, 0);
+    int                 done = 0;
+    while (done < kDevices && (int32_t)(nowMs() - ready) < 600000) {
+        step();
+        for (int i = 0; i < kDevices; i++)
+            if (!doneAt[i] && (int32_t)(nowMs() - ready) >= 0 && online(i)) {
+                doneAt[i] = nowMs();
+                done++;
+            }
+    }
+    o.all = done == kDevices;
+    for (uint32_t t : doneAt)
+        if (t) o.ms.push_back(t - ready);
+    uint32_t lo = UINT32_MAX, hi = 0;
+    for (uint32_t t : apAt)
+        if (t) {
+            o.apN++;
+            lo = std::min(lo, t);
+            hi = std::max(hi, t);
+        }
+    o.apSpreadMs = o.apN ? hi - lo : 0;
+    o.assocFail  = tkwmHost::ap(ap).assocFail - fail0;
+    o.assocOk    = tkwmHost::ap(ap).assocOk - ok0;
+    for (auto& d : devs) o.scans += d->scanN();
+    o.scans -= scans0;
+    mgrs.clear();
+    devs.clear();
+    return o;
+}
+
+void emit(const char* name, const Outcome& o) {
+    char m[96];
+    snprintf(m, sizeof(m), "%s_all_recovered_ms", name);
+    metric(m, o.ms.empty() ? 0 : o.pct(100), "ms");
+    snprintf(m, sizeof(m), "%s_mean_recovery_ms", name);
+    metric(m, o.mean(), "ms");
+    snprintf(m, sizeof(m), "%s_p90_recovery_ms", name);
+    metric(m, o.pct(90), "ms");
+    snprintf(m, sizeof(m), "%s_ap_fallbacks", name);
+    metric(m, o.apN, "devices");
+    snprintf(m, sizeof(m), "%s_ap_fallback_spread_ms", name);
+    metric(m, o.apSpreadMs, "ms");
+    snprintf(m, sizeof(m), "%s_assoc_fail", name);
+    metric(m, o.assocFail, "assoc");
+    snprintf(m, sizeof(m), "%s_scans", name);
+    metric(m, o.scans, "scans");
+}
+
+} // namespace
+
+int main() {
+    // короткий сбой: в AP никто не уходит
+    const Outcome sb = run(true, 8000, 2000);
+    const Outcome sf = run(false, 8000, 2000);
+    // перезагрузка точки на полторы минуты: весь парк в портале, возврат в STA — из портала
+    const Outcome lb = run(true, 90000, 20000);
+    const Outcome lf = run(false, 90000, 20000);
+    emit("short_backoff", sb);
+    emit("short_fixed", sf);
+    emit("long_backoff", lb);
+    emit("long_fixed", lf);
+
+    for (const Outcome* o : {&sb, &sf, &lb, &lf}) CHECK_EQ(o->ms.size(), (size_t)kDevices);
+    CHECK_EQ(sb.apN, 0u);
+    CHECK_EQ(sf.apN, 0u);
+    CHECK_EQ(lb.apN, (uint32_t)kDevices);
+    CHECK_EQ(lf.apN, (uint32_t)kDevices);
+    // Срок ухода в AP у экспоненциальной политики свой у каждого устройства (×1…1.5), у фиксированной — общий.
+    CHECK(lb.apSpreadMs >= TKWM_STA_FAIL_TO_AP_MS / 4);
+    CHECK_LE(lf.apSpreadMs * 2, lb.apSpreadMs);
+    // Из портала — по паузам политики, не дольше её потолка с джиттером и одного подбора сети.
+    CHECK_LE(lb.pct(100), (uint32_t)(TKWM_RECONNECT_MAX_MS * 3 / 2 + TKWM_CONNECT_BUDGET_MS));
+    // Разведённые попытки не забивают очередь точки так, как синхронные.
+    CHECK_LE(lb.assocFail, lf.assocFail);
+    return report("test_fleet_recovery");
+}
@@ -0,0 +1,590 @@
+// user-010: HTTP под нагрузкой 8 параллельных клиентов (как браузер: keep-alive HTTP/1.1, на «Connection:
+// close» — новое соединение). Собирается дважды: test_http_load_sync (WebServer ядра) и test_http_load_async
+// (TKWM_HTTP_ASYNC=1, TkwmAsyncServer; TKWM_HTTP_MAX_CONN=8 — по соединению на клиента, с 4 местами восемь
+// клиентов вытесняли бы друг друга). Оба гоняют маршруты самого TKWifiManager и печатают req/s и p99.
+// Асинхронная сборка дополнительно сравнивает оба сервера на одинаковых обработчиках в одном процессе —
+// восемь быстрых клиентов и семь быстрых плюс один медленный (заголовки запроса двумя кусками с паузой или
+// крупный ответ, который он читает понемногу) — и проверяет сервер через web()/addRoute(): keep-alive,
+// конвейер, HTTP/1.0, HEAD, формы, multipart-загрузку в FS и медленное скачивание файла параллельно
+// с запросами, вытеснение простаивающих соединений.
+#include "host_test.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <random>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double msSince(Clock::time_point t0) { return std::chrono::duration<double, std::milli>(Clock::now() - t0).count(); }
+
+// lwIP держит неотправленным не больше TCP_SND_BUF (5744 байт в ядре 2.x), loopback ПК — мегабайты: без
+// предела медленный читатель не задержал бы ни один сервер. Только для проверок с медленным читателем: с
+// маленьким буфером отложенный ACK клиента добавляет хвосту задержек шум. Принятые сокеты наследуют
+// SO_SNDBUF слушающего, а сам сокет сервер не отдаёт — ищем его среди открытых по порту.
+void lwipSndBuf(uint16_t port) {
+    for (int fd = 0; fd < 1024; fd++) {
+        sockaddr_in a{};
+        socklen_t   len = sizeof(a);
+        int         acc = 0;
+        socklen_t   al  = sizeof(acc);
+        if (getsockname(fd, (sockaddr*)&a, &len) != 0 || a.sin_family != AF_INET || ntohs(a.sin_port) != port) continue;
+        if (getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &acc, &al) != 0 || !acc) continue;
+        const int half = 5744 / 2; // Linux удваивает заданное значение
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &half, sizeof(half));
+    }
+}
+
+// Длина первого полного ответа в b (0 — ещё не весь). eof — соединение закрыто: тело без длины кончилось.
+size_t responseLen(const std::string& b, bool head, bool eof) {
+    const size_t he = b.find("\r\n\r\n");
+    if (he == std::string::npos) return 0;
+    tkwmHost::Response h;
+    tkwmHost::parseResponse(b.substr(0, he + 4), h);
+    const size_t body = he + 4;
+    if (head || h.code == 100 || h.code == 304 || h.code == 204) return body;
+    if (h.header("transfer-encoding") == "chunked") {
+        for (size_t q = body;;) {
+            const size_t e = b.find("\r\n", q);
+            if (e == std::string::npos) return 0;
+            const size_t n = strtoul(b.substr(q, e - q).c_str(), nullptr, 16);
+            if (b.size() < e + 2 + n + 2) return 0;
+            if (!n) return e + 4;
+            q = e + 2 + n + 2;
+        }
+    }
+    const std::string cl = h.header("content-length");
+    if (!cl.empty()) {
+        const size_t n = body + strtoul(cl.c_str(), nullptr, 10);
+        return b.size() >= n ? n : 0;
+    }
+    return eof ? b.size() : 0;
+}
+
+// Клиент как браузер: одно соединение, пока сервер его не закроет.
+class Client {
+public:
+    explicit Client(uint16_t port) : _port(port) {}
+    ~Client() { reset(); }
+
+    bool open() {
+        reset();
+        _fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (rcvBuf) setsockopt(_fd, SOL_SOCKET, SO_RCVBUF, &rcvBuf, sizeof(rcvBuf)); // до connect: окно TCP
+        sockaddr_in a{};
+        a.sin_family      = AF_INET;
+        a.sin_port        = htons(_port);
+        a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        const int one     = 1;
+        setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        timeval tv{10, 0};
+        setsockopt(_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        connects++;
+        return connect(_fd, (sockaddr*)&a, sizeof(a)) == 0;
+    }
+    void reset() {
+        if (_fd >= 0) ::close(_fd);
+        _fd = -1;
+        _buf.clear();
+    }
+    bool sendRaw(const std::string& s, size_t splitAt = 0, int pauseMs = 0) {
+        size_t p = 0;
+        if (splitAt && splitAt < s.size()) {
+            if (!sendAll(s.data(), splitAt)) return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(pauseMs));
+            p = splitAt;
+        }
+        return sendAll(s.data() + p, s.size() - p);
+    }
+    bool sendAll(const char* p, size_t n) {
+        while (n) {
+            const ssize_t k = send(_fd, p, n, MSG_NOSIGNAL);
+            if (k <= 0) return false;
+            p += k;
+            n -= (size_t)k;
+        }
+        return true;
+    }
+    // Следующий ответ из потока; false — соединение закрылось раньше.
+    bool read(tkwmHost::Response& r, bool head = false, std::string* raw = nullptr) {
+        for (bool eof = false;;) {
+            const size_t n = responseLen(_buf, head, eof);
+            if (n) {
+                tkwmHost::parseResponse(_buf.substr(0, n), r);
+                if (head) r.body.clear();
+                if (raw) *raw = _buf.substr(0, n);
+                _buf.erase(0, n);
+                if (r.header("connection") == "close") reset();
+                return true;
+            }
+            if (eof) return false;
+            char          b[8192];
+            const ssize_t k = recv(_fd, b, std::min(sizeof(b), readChunk), 0);
+            if (k <= 0) eof = true;
+            else _buf.append(b, (size_t)k);
+            if (readPauseMs) std::this_thread::sleep_for(std::chrono::milliseconds(readPauseMs));
+        }
+    }
+    // Запрос с повтором: простаивающее keep-alive соединение сервер мог закрыть (браузер делает так же).
+    bool request(const std::string& raw, tkwmHost::Response& r, size_t splitAt = 0, int pauseMs = 0) {
+        for (int attempt = 0; attempt < 3; attempt++) {
+            if (_fd < 0 && !open()) continue;
+            if (sendRaw(raw, splitAt, pauseMs) && read(r, raw.compare(0, 5, "HEAD ") == 0)) return true;
+            reset();
+            retries++;
+        }
+        return false;
+    }
+    // Сервер закрыл соединение (ждём FIN не дольше waitMs).
+    bool closedByPeer(int waitMs = 200) {
+        if (_fd < 0) return true;
+        pollfd p{_fd, POLLIN, 0};
+        char   b;
+        return poll(&p, 1, waitMs) == 1 && recv(_fd, &b, 1, MSG_DONTWAIT) == 0;
+    }
+    int connects = 0, retries = 0;
+    // медленный читатель: маленькое окно приёма, ответ понемногу с паузами
+    int    rcvBuf = 0, readPauseMs = 0;
+    size_t readChunk = 8192;
+
+private:
+    uint16_t    _port;
+    int         _fd = -1;
+    std::string _buf;
+};
+
+std::string get(const std::string& uri, const char* extra = "") {
+    return "GET " + uri + " HTTP/1.1\r\nHost: 127.0.0.1\r\nAccept-Encoding: gzip\r\n" + extra + "\r\n";
+}
+
+struct Load {
+    std::vector<double> ms;
+    double              wallMs = 0;
+    int                 fails = 0, connects = 0, retries = 0;
+    double rps() const { return wallMs > 0 ? ms.size() * 1000.0 / wallMs : 0; }
+    double pct(int p) const {
+        if (ms.empty()) return 0;
+        std::vector<double> v = ms;
+        std::sort(v.begin(), v.end());
+        return v[std::min(v.size() - 1, v.size() * p / 100)];
+    }
+};
+
+// Медленный клиент: заголовки запроса приходят двумя кусками с паузой или он читает крупный ответ (slowUri)
+// по 1 КБ раз в 5 мс через окно 2 КБ.
+enum class Slow { None, Headers, Reader };
+
+// 8 клиентов по кругу запрашивают uris. slow — последний клиент медленный, и так всё время, пока работают
+// остальные семь; req/s и задержки — по быстрым.
+Load runLoad(uint16_t port, const std::vector<std::string>& uris, int rounds, const std::function<void()>& pump,
+             Slow slow = Slow::None, const std::string& slowUri = std::string()) {
+    const int                kClients = 8, kFast = slow != Slow::None ? kClients - 1 : kClients;
+    std::vector<Load>        per(kClients);
+    std::atomic<int>         fastLeft{kFast}, left{kClients};
+    std::vector<std::thread> th;
+    const auto               t0 = Clock::now();
+    for (int c = 0; c < kClients; c++)
+        th.emplace_back([&, c] {
+            Client     cl(port);
+            const bool isSlow = c >= kFast, slowHead = isSlow && slow == Slow::Headers;
+            if (isSlow && slow == Slow::Reader) {
+                cl.rcvBuf      = 2048;
+                cl.readChunk   = 1024;
+                cl.readPauseMs = 5;
+            }
+            const std::vector<std::string> mine = isSlow && slow == Slow::Reader ? std::vector<std::string>{slowUri} : uris;
+            for (int r = 0; isSlow ? fastLeft > 0 : r < rounds; r++)
+                for (const std::string& u : mine) {
+                    const std::string  raw = get(u);
+                    tkwmHost::Response rsp;
+                    const auto         q0 = Clock::now();
+                    const bool         ok = cl.request(raw, rsp, slowHead ? raw.size() / 2 : 0, slowHead ? 40 : 0);
+                    if (!ok || rsp.code != 200) per[c].fails++;
+                    else if (!isSlow) per[c].ms.push_back(msSince(q0));
+                }
+            per[c].connects = cl.connects;
+            per[c].retries  = cl.retries;
+            if (!isSlow) fastLeft--;
+            left--;
+        });
+    while (fastLeft) pump();
+    Load all;
+    all.wallMs = msSince(t0);
+    while (left) pump();
+    for (auto& t : th) t.join();
+    for (const Load& l : per) {
+        all.ms.insert(all.ms.end(), l.ms.begin(), l.ms.end());
+        all.fails += l.fails;
+        all.connects += l.connects;
+        all.retries += l.retries;
+    }
+    return all;
+}
+
+void emit(const std::string& name, const Load& l) {
+    metric((name + "_rps").c_str(), l.rps(), "req/s");
+    metric((name + "_p50").c_str(), l.pct(50), "ms");
+    metric((name + "_p99").c_str(), l.pct(99), "ms");
+    metric((name + "_connects").c_str(), l.connects, "conn");
+    CHECK_EQ(l.fails, 0);
+}
+
+// Тик владельца сервера, как задача tkwm_task при активном HTTP: до TKWM_HTTP_BURST handleClient(), пока
+// они что-то обслуживают, затем системный тик (1 мс).
+template <typename S> std::function<void()> serverTick(S& s, const uint32_t& served) {
+    return [&s, &served] {
+        for (int i = 0; i < TKWM_HTTP_BURST; i++) {
+            const uint32_t before = served;
+            s.handleClient();
+            if (served == before) break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    };
+}
+
+std::function<void()> managerTick(TKWifiManager& m) {
+    return [&m] {
+        m.loop();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    };
+}
+
+// Тело /ram: 30 КБ — больше буфера и очереди ответа TkwmAsyncServer; период 23 не кратен буферу.
+const std::string& ramBody() {
+    static std::string b;
+    for (size_t i = b.size(); i < 30000; i++) b += (char)('a' + i % 23);
+    return b;
+}
+
+const std::vector<std::string> kLibUris = {"/", "/api/wifi/saved", "/api/ota/info", "/api/fs/list"};
+
+#if TKWM_HTTP_ASYNC
+
+// Одинаковые обработчики на обоих серверах: страница, css, js и JSON кусками, как у маршрутов библиотеки;
+// /big — крупный ресурс из ROM (send_P), как встроенная страница.
+const std::string kBig(64 * 1024, 'b');
+template <typename S> void bench(S& s, uint32_t& served) {
+    static const std::string page(4096, 'p'), css(2600, 'c'), js(2900, 'j');
+    s.on("/big", HTTP_GET, [&s, &served] {
+        served++;
+        s.send_P(200, "application/octet-stream", kBig.data(), kBig.size());
+    });
+    s.on("/", HTTP_GET, [&s, &served] {
+        served++;
+        s.send(200, "text/html", page.data(), page.size());
+    });
+    s.on("/theme.css", HTTP_GET, [&s, &served] {
+        served++;
+        s.send(200, "text/css", css.data(), css.size());
+    });
+    s.on("/theme.js", HTTP_GET, [&s, &served] {
+        served++;
+        s.send(200, "application/javascript", js.data(), js.size());
+    });
+    s.on("/api/state", HTTP_GET, [&s, &served] {
+        served++;
+        s.setContentLength(CONTENT_LENGTH_UNKNOWN);
+        s.send(200, "application/json", "");
+        for (int i = 0; i < 6; i++) s.sendContent(std::string(200, '0' + i).c_str());
+        s.sendContent("");
+    });
+}
+const std::vector<std::string> kBenchUris = {"/", "/theme.css", "/theme.js", "/api/state"};
+
+void compareServers() {
+    for (Slow slow : {Slow::None, Slow::Headers, Slow::Reader}) {
+        // WebServer при медленном читателе обслуживает ~20 запросов/с — хватит и меньшего прогона
+        const int rounds = slow == Slow::Reader ? 4 : 25;
+        Load      sync, async;
+        {
+            WebServer::hostListen(true);
+            WebServer s(0);
+            uint32_t  served = 0;
+            bench(s, served);
+            s.begin();
+            if (slow == Slow::Reader) lwipSndBuf(s.hostPort());
+            sync = runLoad(s.hostPort(), kBenchUris, rounds, serverTick(s, served), slow, "/big");
+            WebServer::hostListen(false);
+        }
+        {
+            TkwmAsyncServer s(0);
+            uint32_t        served = 0;
+            bench(s, served);
+            s.begin();
+            if (slow == Slow::Reader) lwipSndBuf(s.port());
+            async = runLoad(s.port(), kBenchUris, rounds, serverTick(s, served), slow, "/big");
+        }
+        const std::string sc = slow == Slow::Headers ? "slow_client" : slow == Slow::Reader ? "slow_reader" : "fast";
+        emit("bench_" + sc + "_sync", sync);
+        emit("bench_" + sc + "_async", async);
+        metric(("bench_" + sc + "_rps_ratio").c_str(), sync.rps() > 0 ? async.rps() / sync.rps() : 0, "x");
+        // Keep-alive и обход всех сокетов за тик: больше запросов в секунду и короче хвост задержек.
+        CHECK_LE(sync.rps() * 1.5, async.rps());
+        CHECK_LE(async.pct(99) * 2, sync.pct(99));
+        CHECK_LE(async.connects, sync.connects / 4);
+        // Медленный клиент WebServer держит всех (ждёт его заголовки или пока он дочитает ответ);
+        // асинхронный — никого.
+        if (slow != Slow::None) CHECK_LE(async.pct(99), 40.0);
+    }
+}
+
+// Загрузка multipart, которая приходит кусками: тем временем другие запросы обслуживаются.
+void uploadDuringRequests(TKWifiManager& mgr, uint16_t port, const std::string& file) {
+    const std::string bd   = "----tkwmBoundary7MA4YWxk";
+    const std::string body = "--" + bd + "\r\nContent-Disposition: form-data; name=\"note\"\r\n\r\nhello\r\n--" + bd +
+                             "\r\nContent-Disposition: form-data; name=\"file\"; filename=\"a.bin\"\r\nContent-Type: application/octet-stream\r\n\r\n" +
+                             file + "\r\n--" + bd + "--\r\n";
+    const std::string head = "POST /upload?to=/up/a.bin HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Type: multipart/form-data; boundary=" + bd +
+                             "\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+    std::atomic<bool>   done{false};
+    std::atomic<int>    left{2};
+    std::vector<double> other;
+    int                 upCode = 0, otherFails = 0;
+    std::thread         up([&] {
+        Client c(port);
+        c.open();
+        c.sendAll(head.data(), head.size());
+        // 1 КБ каждые 5 мс: граница частей может разрезаться между пакетами
+        for (size_t p = 0; p < body.size(); p += 1000) {
+            c.sendAll(body.data() + p, std::min<size_t>(1000, body.size() - p));
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        tkwmHost::Response r;
+        if (c.read(r)) upCode = r.code;
+        done = true;
+        left--;
+    });
+    std::thread q([&] {
+        Client c(port);
+        while (!done) {
+            tkwmHost::Response r;
+            const auto         t0 = Clock::now();
+            if (!c.request(get("/api/ota/info"), r) || r.code != 200) otherFails++;
+            else other.push_back(msSince(t0));
+        }
+        left--;
+    });
+    while (left) managerTick(mgr)();
+    up.join();
+    q.join();
+    CHECK_EQ(upCode, 200);
+    CHECK_EQ(otherFails, 0);
+    CHECK(other.size() >= 10);
+    double worst = 0;
+    for (double v : other) worst = std::max(worst, v);
+    metric("upload_concurrent_requests", other.size(), "req");
+    metric("upload_concurrent_max_ms", worst, "ms");
+    CHECK_LE(worst, 50.0);
+
+    // файл в FS совпадает байт в байт
+    std::atomic<bool>  got{false};
+    tkwmHost::Response r;
+    std::thread        t([&] {
+        Client c(port);
+        c.request(get("/api/fs/download?path=/up/a.bin"), r);
+        got = true;
+    });
+    while (!got) managerTick(mgr)();
+    t.join();
+    CHECK_EQ(r.code, 200);
+    CHECK(r.body == file);
+
+    // тот же файл медленному читателю: его отдача не держит остальные запросы
+    lwipSndBuf(port);
+    std::atomic<bool>   slowDone{false};
+    std::atomic<int>    slowLeft{2};
+    std::vector<double> during;
+    tkwmHost::Response  sr;
+    std::thread         slow([&] {
+        Client c(port);
+        c.rcvBuf      = 2048;
+        c.readChunk   = 1024;
+        c.readPauseMs = 5;
+        c.request(get("/api/fs/download?path=/up/a.bin"), sr);
+        slowDone = true;
+        slowLeft--;
+    });
+    std::thread fast([&] {
+        Client c(port);
+        while (!slowDone) {
+            tkwmHost::Response r2;
+            const auto         t0 = Clock::now();
+            if (c.request(get("/api/boot"), r2) && r2.code == 200) during.push_back(msSince(t0));
+        }
+        slowLeft--;
+    });
+    while (slowLeft) managerTick(mgr)();
+    slow.join();
+    fast.join();
+    CHECK_EQ(sr.code, 200);
+    CHECK(sr.body == file);
+    CHECK(during.size() >= 10);
+    double slowWorst = 0;
+    for (double v : during) slowWorst = std::max(slowWorst, v);
+    metric("slow_download_concurrent_requests", during.size(), "req");
+    metric("slow_download_concurrent_max_ms", slowWorst, "ms");
+    CHECK_LE(slowWorst, 50.0);
+}
+
+void functional(TKWifiManager& mgr, uint16_t port) {
+    std::atomic<bool> done{false};
+    std::thread       t([&] {
+        // keep-alive: несколько запросов по одному соединению, chunked JSON
+        {
+            Client             c(port);
+            tkwmHost::Response r;
+            CHECK(c.request(get("/"), r));
+            CHECK_EQ(r.code, 200);
+            CHECK(r.body.size() > 200);
+            CHECK_EQ(r.header("connection"), std::string("keep-alive"));
+            CHECK(c.request(get("/api/wifi/saved"), r));
+            CHECK_EQ(r.code, 200);
+            CHECK(r.chunked);
+            CHECK(!r.body.empty() && (r.body[0] == '{' || r.body[0] == '['));
+            CHECK(c.request("HEAD /echo?x=h HTTP/1.1\r\nHost: x\r\n\r\n", r));
+            CHECK_EQ(r.code, 200);
+            CHECK_EQ(r.header("content-length"), std::string("6"));
+            CHECK(r.body.empty());
+            CHECK(c.request(get("/echo?x=a%20b&y=%D0%AF"), r));
+            CHECK_EQ(r.body, std::string("a b|Я|GET"));
+            CHECK_EQ(c.connects, 1);
+            CHECK_EQ(c.retries, 0);
+        }
+        // конвейер: два запроса одним пакетом — два ответа по порядку
+        {
+            Client c(port);
+            c.open();
+            c.sendRaw(get("/echo?x=1") + get("/echo?x=2"));
+            tkwmHost::Response a, b;
+            CHECK(c.read(a) && c.read(b));
+            CHECK_EQ(a.body, std::string("1||GET"));
+            CHECK_EQ(b.body, std::string("2||GET"));
+        }
+        // POST: форма и JSON (arg("plain")), Expect: 100-continue
+        {
+            Client             c(port);
+            tkwmHost::Response r;
+            const std::string  form = "x=%2Fa+b&y=2";
+            CHECK(c.request("POST /echo HTTP/1.1\r\nHost: x\r\nContent-Type: application/x-www-form-urlencoded\r\nContent-Length: " +
+                                std::to_string(form.size()) + "\r\n\r\n" + form,
+                            r));
+            CHECK_EQ(r.body, std::string("/a b|2|POST"));
+            const std::string json = "{\"k\":1}";
+            c.open();
+            c.sendRaw("POST /echo HTTP/1.1\r\nHost: x\r\nContent-Type: application/json\r\nExpect: 100-continue\r\nContent-Length: " +
+                      std::to_string(json.size()) + "\r\n\r\n");
+            tkwmHost::Response cont;
+            CHECK(c.read(cont));
+            CHECK_EQ(cont.code, 100);
+            c.sendRaw(json);
+            CHECK(c.read(r));
+            CHECK_EQ(r.body, std::string("plain=" + json + "||POST"));
+        }
+        // ответ из ОЗУ больше TKWM_HTTP_TX_BUF + TKWM_HTTP_TX_QUEUE: очередь, затем ожидание сокета — байт в байт
+        {
+            Client             c(port);
+            tkwmHost::Response r;
+            CHECK(c.request(get("/ram"), r));
+            CHECK_EQ(r.code, 200);
+            CHECK(r.body == ramBody());
+            CHECK(c.request(get("/echo?x=after"), r));
+            CHECK_EQ(r.body, std::string("after||GET"));
+        }
+        // HTTP/1.0 без keep-alive — сервер закрывает после ответа
+        {
+            Client             c(port);
+            tkwmHost::Response r;
+            c.open();
+            c.sendRaw("GET /echo?x=z HTTP/1.0\r\n\r\n");
+            CHECK(c.read(r));
+            CHECK_EQ(r.header("connection"), std::string("close"));
+            CHECK(c.closedByPeer());
+        }
+        // заголовки не помещаются в буфер соединения — 431 и закрытие
+        {
+            Client             c(port);
+            tkwmHost::Response r;
+            c.open();
+            c.sendRaw("GET / HTTP/1.1\r\nX-Big: " + std::string(TKWM_HTTP_RX_BUF, 'a') + "\r\n\r\n");
+            CHECK(c.read(r));
+            CHECK_EQ(r.code, 431);
+        }
+        // соединений больше TKWM_HTTP_MAX_CONN: простаивающие keep-alive уступают новым
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50)); // сервер закрыл соединения прошлых проверок
+            std::vector<std::unique_ptr<Client>> idle;
+            for (int i = 0; i < TKWM_HTTP_MAX_CONN; i++) {
+                idle.emplace_back(new Client(port));
+                tkwmHost::Response r;
+                CHECK(idle.back()->request(get("/echo?x=i"), r));
+            }
+            Client             fresh(port);
+            tkwmHost::Response r;
+            const auto         t0 = Clock::now();
+            CHECK(fresh.request(get("/echo?x=new"), r));
+            CHECK_EQ(r.body, std::string("new||GET"));
+            CHECK_LE(msSince(t0), 100.0);
+            int evicted = 0;
+            for (auto& c : idle) evicted += c->closedByPeer();
+            CHECK_EQ(evicted, 1);
+        }
+        done = true;
+    });
+    while (!done) managerTick(mgr)();
+    t.join();
+    CHECK_LE((int)mgr.web().clients(), TKWM_HTTP_MAX_CONN);
+
+    std::string  file(48 * 1024, '\0');
+    std::mt19937 rng(1010);
+    for (char& ch : file) ch = (char)rng();
+    // граница внутри данных файла — почти, но не совсем
+    file.replace(20000, 26, "\r\n----tkwmBoundary7MA4YWx");
+    uploadDuringRequests(mgr, port, file);
+}
+
+#endif
+
+} // namespace
+
+int main() {
+    using namespace tkwmHost;
+    Device dev(1);
+    use(dev);
+#if !TKWM_HTTP_ASYNC
+    WebServer::hostListen(true);
+#endif
+    TKWifiManager mgr;
+    mgr.addRoute("/echo", HTTP_ANY, [&mgr] {
+        TkwmWebServer& w = mgr.web();
+        const String   x = w.hasArg("x") ? w.arg("x") : w.hasArg("plain") ? "plain=" + w.arg("plain") : String();
+        w.send(200, "text/plain", x + "|" + w.arg("y") + "|" + (w.method() == HTTP_POST ? "POST" : "GET"));
+    });
+    mgr.addRoute("/ram", HTTP_GET, [&mgr] { mgr.web().send(200, "text/plain", ramBody().data(), ramBody().size()); });
+    CHECK(mgr.begin());
+    realTime(true);
+#if TKWM_HTTP_ASYNC
+    mgr.web().begin(0); // порт 80 на ПК — не наш; любой свободный
+    const uint16_t port = mgr.web().port();
+    const char*    mode = "lib_async";
+#else
+    const uint16_t port = mgr.web().hostPort();
+    const char*    mode = "lib_sync";
+#endif
+    CHECK(port != 0);
+
+    const Load lib = runLoad(port, kLibUris, 25, managerTick(mgr));
+    emit(mode, lib);
+#if TKWM_HTTP_ASYNC
+    functional(mgr, port);
+    compareServers();
+#endif
+    return report(TKWM_HTTP_ASYNC ? "test_http_load_async" : "test_http_load_sync");
+}
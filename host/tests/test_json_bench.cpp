@@ -0,0 +1,246 @@
+// user-006: потоковый TkwmJson против прежней сборки ответа в String. Скан на 16 сетей и список FS на
+// 500 файлов отдаются обоими способами; меряются пик кучи на запрос, запросы/с и байты ответа.
+// Прежние обработчики повторены дословно (rev. до user-006) и подключены через addRoute().
+#include "host_test.h"
+#include <LittleFS.h>
+#include <algorithm>
+#include <chrono>
+#include <set>
+
+namespace {
+
+const int kNets  = 16;
+const int kDirs  = 10;
+const int kFiles = 500;
+
+// ===== прежние обработчики: JSON целиком в String, затем send() с Content-Length =====
+void legacyJsonVal(String& o, const String& s) {
+    for (uint32_t i = 0; i < s.length(); ++i) {
+        unsigned char c = (unsigned char)s[i];
+        if (c == '"' || c == '\\') {
+            o += '\\';
+            o += (char)c;
+        } else if (c < 0x20) {
+            char esc[8];
+            snprintf(esc, sizeof(esc), "\\u%04X", (unsigned)c);
+            o += esc;
+        } else
+            o += (char)c;
+    }
+}
+
+void legacyListDir(File dir, String& out, bool& first) {
+    for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+        if (f.isDirectory()) {
+            legacyListDir(f, out, first);
+        } else {
+            const char* name = f.path();
+            if (!first) out += ",";
+            first = false;
+            out += F("{\"path\":\"");
+            for (; *name; ++name) {
+                if (*name == '\"' || *name == '\\') { out += '\\'; out += *name; }
+                else out += *name;
+            }
+            out += F("\",\"size\":"); out += String((uint32_t)f.size()); out += '}';
+        }
+        f.close();
+    }
+}
+
+// Кэш скана прежнего кода — те же поля ScanNet, по убыванию RSSI.
+struct LegacyNet {
+    String  ssid;
+    int8_t  rssi;
+    uint8_t ch;
+    bool    open;
+};
+std::vector<LegacyNet> g_nets;
+
+void legacyScan(WebServer& srv) {
+    const int n = (int)g_nets.size();
+    String out;
+    out.reserve(64 * max(n, 1) + 96);
+    out += F("{\"connected\":false,\"ip\":\"0.0.0.0\",\"scanning\":false,\"age\":0,\"nets\":[");
+    for (int i = 0; i < n; ++i) {
+        const LegacyNet& e = g_nets[i];
+        if (i) out += ',';
+        out += F("{\"ssid\":\"");
+        legacyJsonVal(out, e.ssid);
+        out += F("\",\"rssi\":"); out += String((int)e.rssi);
+        out += F(",\"ch\":");     out += String((int)e.ch);
+        out += F(",\"enc\":");    out += e.open ? '0' : '1';
+        out += '}';
+    }
+    out += F("]}");
+    srv.send(200, "application/json", out);
+}
+
+// Только обход FS без ответа: его куча (каталоги, FILE ПК) общая для обоих способов и вычитается.
+void walkDir(File dir, size_t& n) {
+    for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+        if (f.isDirectory()) walkDir(f, n);
+        else n += f.size() ? 1 : 0;
+        f.close();
+    }
+}
+
+void legacyFsList(WebServer& srv) {
+    String out = "{\"files\":[";
+    File root = LittleFS.open("/");
+    bool first = true;
+    legacyListDir(root, out, first);
+    out += "]}";
+    srv.send(200, "application/json", out);
+}
+
+// ===== замеры =====
+std::string fetch(TKWifiManager& m, const std::string& uri) {
+    tkwmHost::Response r;
+    const std::string raw = tkwmHost::rawRequest("GET", uri);
+    r = tkwmHost::request(m.web(), raw, tickOf(m));
+    CHECK_EQ(r.code, 200);
+    return r.body;
+}
+
+struct Cost {
+    size_t peak  = 0;  // пик кучи сверх занятого до запроса, байт
+    size_t bytes = 0;  // ответ в сокет (заголовки + тело)
+    double rps   = 0;
+};
+
+// Запрос целиком в handleClient(): ответ не копится (discard), куча — только обработчика и разбора.
+size_t serveOnce(TKWifiManager& m, const std::string& raw) {
+    auto c     = m.web().hostQueue(raw);
+    c->discard = true;
+    for (int i = 0; i < 100 && !c->done; i++) m.web().handleClient();
+    CHECK(c->done);
+    return c->outBytes;
+}
+
+Cost measure(TKWifiManager& m, const std::string& uri, int iters) {
+    const std::string raw = tkwmHost::rawRequest("GET", uri);
+    Cost c;
+    serveOnce(m, raw);  // прогрев: ленивые аллокации сервера не в счёт
+    const size_t before = tkwmHost::heapUsed();
+    tkwmHost::heapPeakReset();
+    c.bytes = serveOnce(m, raw);
+    c.peak  = tkwmHost::heapPeak() - before;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; i++) serveOnce(m, raw);
+    const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    c.rps = s > 0 ? iters / s : 0;
+    return c;
+}
+
+void emit(const char* what, const Cost& c) {
+    char name[64];
+    snprintf(name, sizeof(name), "%s_peak_heap", what);
+    metric(name, (double)c.peak, "B");
+    snprintf(name, sizeof(name), "%s_rps", what);
+    metric(name, c.rps, "req/s");
+    snprintf(name, sizeof(name), "%s_bytes", what);
+    metric(name, (double)c.bytes, "B");
+}
+
+std::string between(const std::string& s, const std::string& from, const std::string& to) {
+    const size_t a = s.find(from);
+    const size_t b = s.rfind(to);
+    return a == std::string::npos || b == std::string::npos || b < a ? std::string() : s.substr(a, b - a);
+}
+
+} // namespace
+
+int main() {
+    using namespace tkwmHost;
+    Device dev(1);
+    use(dev);
+
+    // эфир: разные RSSI (порядок кэша однозначен), в именах — кавычки, обратная косая и управляющий байт
+    for (int i = 0; i < kNets; i++) {
+        char ssid[33];
+        switch (i % 4) {
+        case 0: snprintf(ssid, sizeof(ssid), "Office-%02d", i); break;
+        case 1: snprintf(ssid, sizeof(ssid), "Cafe \"Wi-Fi\" %d", i); break;
+        case 2: snprintf(ssid, sizeof(ssid), "lab\\net\\%d", i); break;
+        default: snprintf(ssid, sizeof(ssid), "iot\x01node-%d", i); break;
+        }
+        const int8_t rssi = (int8_t)(-40 - i * 3);
+        addAp(hostAp(ssid, i % 5 ? "password" : "", (uint8_t)(1 + i % 13), rssi));
+        g_nets.push_back({String(ssid), rssi, (uint8_t)(1 + i % 13), i % 5 == 0});
+    }
+
+    TKWifiManager mgr;
+    CHECK(mgr.begin());
+    mgr.addRoute("/bench/scan", HTTP_GET, [&mgr] { legacyScan(mgr.web()); });
+    mgr.addRoute("/bench/fs", HTTP_GET, [&mgr] { legacyFsList(mgr.web()); });
+    mgr.addRoute("/bench/walk", HTTP_GET, [&mgr] {
+        size_t n = 0;
+        walkDir(LittleFS.open("/"), n);
+        mgr.web().send(204);
+    });
+
+    // 500 файлов в 10 каталогах (и пара в корне) — через FS устройства
+    std::set<std::string> made;
+    for (int i = 0; i < kFiles; i++) {
+        char path[48];
+        if (i < 2) snprintf(path, sizeof(path), "/root-%d.txt", i);
+        else snprintf(path, sizeof(path), "/data/d%02d/log-%03d.csv", i % kDirs, i);
+        File f = LittleFS.open(path, "w", true);
+        CHECK(f);
+        const std::string body(16 + i % 200, 'x');
+        f.write((const uint8_t*)body.data(), body.size());
+        f.close();
+        made.insert(path);
+    }
+
+    // свежий скан в кэше
+    fetch(mgr, "/api/wifi/scan?maxAge=0");
+    runFor(mgr, 3000);
+
+    // одинаковое содержимое: массив сетей байт в байт, список файлов — байт в байт
+    const std::string scanNew = fetch(mgr, "/api/wifi/scan");
+    const std::string scanOld = fetch(mgr, "/bench/scan");
+    CHECK(scanNew.find("\"scanning\":false") != std::string::npos);
+    CHECK_EQ(between(scanNew, "\"nets\":[", "]}"), between(scanOld, "\"nets\":[", "]}"));
+    CHECK(scanNew.find("Cafe \\\"Wi-Fi\\\" 1") != std::string::npos);
+    CHECK(scanNew.find("iot\\u0001node-3") != std::string::npos);
+
+    const std::string fsNew = fetch(mgr, "/api/fs/list");
+    const std::string fsOld = fetch(mgr, "/bench/fs");
+    CHECK_EQ(fsNew, fsOld);
+    size_t listed = 0;
+    for (size_t p = 0; (p = fsNew.find("\"path\":\"", p)) != std::string::npos; p++) {
+        const size_t q = fsNew.find('"', p + 8);
+        CHECK(made.count(fsNew.substr(p + 8, q - p - 8)));
+        listed++;
+    }
+    CHECK_EQ(listed, (size_t)kFiles);
+
+    const Cost scanS = measure(mgr, "/api/wifi/scan", 2000);
+    const Cost scanL = measure(mgr, "/bench/scan", 2000);
+    const Cost fsS   = measure(mgr, "/api/fs/list", 60);
+    const Cost fsL   = measure(mgr, "/bench/fs", 60);
+    const Cost walk  = measure(mgr, "/bench/walk", 60);
+    emit("scan16_stream", scanS);
+    emit("scan16_string", scanL);
+    emit("fs500_stream", fsS);
+    emit("fs500_string", fsL);
+    metric("fs500_walk_peak_heap", (double)walk.peak, "B");
+    // сверх самого обхода FS — то, что стоит построение ответа
+    const size_t fsNetS = fsS.peak > walk.peak ? fsS.peak - walk.peak : 0;
+    const size_t fsNetL = fsL.peak > walk.peak ? fsL.peak - walk.peak : 0;
+    metric("fs500_stream_response_heap", (double)fsNetS, "B");
+    metric("fs500_string_response_heap", (double)fsNetL, "B");
+    metric("fs500_peak_heap_ratio", fsL.peak ? (double)fsS.peak / fsL.peak : 0, "x");
+    metric("fs500_rps_ratio", fsL.rps ? fsS.rps / fsL.rps : 0, "x");
+    metric("scan16_rps_ratio", scanL.rps ? scanS.rps / scanL.rps : 0, "x");
+
+    // Строка ответа растёт вместе с данными, буфер писателя — нет: на 500 файлах пик кучи
+    // потокового ответа — малая доля прежнего и не зависит от размера списка.
+    CHECK(fsNetL >= fsNew.size());
+    CHECK_LE(fsNetS * 8, fsNetL);
+    CHECK_LE(fsS.peak, fsL.peak);
+    CHECK_LE(scanS.peak, scanL.peak);
+    return report("test_json_bench");
+}
@@ -0,0 +1,502 @@
+// user-007: TkwmJsonPick. Сгенерированные объекты с известным ответом (ключи на глубине 1 и во вложенных
+// значениях, \-escape, суррогатные пары, дубли), мутации корректных документов (String, поток с рваными
+// чтениями и chunked через TkwmHttpBody должны давать один и тот же результат), замер против прежнего
+// indexOf-разбора: время и пик кучи, в том числе когда тело ответа сначала читалось в String целиком.
+#include "host_test.h"
+#include "TKWifiManager.cpp"
+#include <chrono>
+#include <random>
+
+namespace {
+
+std::mt19937 rng(7007);
+int  rnd(int n) { return (int)(rng() % (uint32_t)n); }
+bool coin(int pct) { return rnd(100) < pct; }
+
+// ===== поток из памяти: available() и readBytes() отдают случайные куски =====
+class ChunkStream : public Stream {
+public:
+    ChunkStream(const std::string& d, size_t maxChunk) : _d(d), _max(maxChunk) {}
+    int available() override {
+        const size_t left = _d.size() - _p;
+        return left ? (int)std::min(left, (size_t)rnd((int)_max + 1)) : 0;
+    }
+    int read() override { return _p < _d.size() ? (uint8_t)_d[_p++] : -1; }
+    int peek() override { return _p < _d.size() ? (uint8_t)_d[_p] : -1; }
+    size_t readBytes(char* buf, size_t n) override {
+        n = std::min(n, _d.size() - _p);
+        if (n > 1 && coin(30)) n = 1 + (size_t)rnd((int)n); // короче запрошенного, как сокет
+        memcpy(buf, _d.data() + _p, n);
+        _p += n;
+        return n;
+    }
+    size_t write(uint8_t) override { return 0; }
+    size_t consumed() const { return _p; }
+
+private:
+    std::string _d;
+    size_t      _p = 0;
+    size_t      _max;
+};
+
+std::string chunked(const std::string& body) {
+    std::string out;
+    for (size_t p = 0; p < body.size();) {
+        const size_t n = std::min(body.size() - p, (size_t)(1 + rnd(40)));
+        char h[32];
+        snprintf(h, sizeof(h), coin(20) ? "%zx;ext=1\r\n" : "%zX\r\n", n);
+        out += h;
+        out.append(body, p, n);
+        out += "\r\n";
+        p += n;
+    }
+    out += coin(30) ? "0\r\nX-Trailer: 1\r\n\r\n" : "0\r\n\r\n";
+    return out;
+}
+
+// ===== результат разбора: одинаковый набор полей для всех источников =====
+struct Picked {
+    bool   ok = false;
+    String ssid, pass;
+    long   n    = -7;
+    bool   flag = false;
+    bool   fSsid = false, fPass = false, fN = false, fFlag = false;
+    bool operator==(const Picked& o) const {
+        return ok == o.ok && fSsid == o.fSsid && fPass == o.fPass && fN == o.fN && fFlag == o.fFlag &&
+               (!fSsid || ssid == o.ssid) && (!fPass || pass == o.pass) && (!fN || n == o.n) && (!fFlag || flag == o.flag);
+    }
+};
+
+Picked pick(TkwmJsonPick& p) {
+    Picked r;
+    p.str("ssid", r.ssid).str("password", r.pass).num("n", r.n).boolean("flag", r.flag);
+    r.ok    = p.run();
+    r.fSsid = p.found("ssid");
+    r.fPass = p.found("password");
+    r.fN    = p.found("n");
+    r.fFlag = p.found("flag");
+    return r;
+}
+
+Picked pickString(const std::string& doc) {
+    const String s(doc);
+    TkwmJsonPick p(s);
+    return pick(p);
+}
+
+Picked pickStream(const std::string& doc) {
+    ChunkStream st(doc, 1 + (size_t)rnd(80));
+    TkwmJsonPick p(st, coin(50) ? (int)doc.size() : -1);
+    return pick(p);
+}
+
+Picked pickChunked(const std::string& doc) {
+    ChunkStream  st(chunked(doc), 1 + (size_t)rnd(80));
+    TkwmHttpBody body(st, -1, true);
+    TkwmJsonPick p(body, -1);
+    return pick(p);
+}
+
+// ===== генератор: JSON-текст и то, что из него обязан достать разборщик =====
+void utf8(std::string& o, uint32_t cp) {
+    char u[4];
+    const uint8_t n = tkwmUtf8Enc_(cp, u);
+    o.append(u, n);
+}
+
+void hex4(std::string& o, uint32_t v) {
+    char b[8];
+    snprintf(b, sizeof(b), coin(50) ? "\\u%04x" : "\\u%04X", v);
+    o += b;
+}
+
+// Строковый литерал (после открывающей кавычки) и его значение.
+void genString(std::string& json, std::string& val, int maxLen) {
+    const int len = rnd(maxLen + 1);
+    for (int i = 0; i < len; i++) {
+        switch (rnd(12)) {
+        case 0: json += "\\\""; val += '"'; break;
+        case 1: json += "\\\\"; val += '\\'; break;
+        case 2: {
+            static const char esc[] = "/bfnrt", dec[] = "/\b\f\n\r\t";
+            const int k = rnd(6);
+            json += '\\';
+            json += esc[k];
+            val += dec[k];
+        } break;
+        case 3: {                                    // BMP через \u (без суррогатов)
+            uint32_t cp = (uint32_t)rnd(0xD800);
+            if (coin(30)) cp = 0xE000 + (uint32_t)rnd(0x2000);
+            hex4(json, cp);
+            utf8(val, cp);
+        } break;
+        case 4: {                                    // суррогатная пара → 4 байта UTF-8
+            const uint32_t cp = 0x10000 + (uint32_t)rnd(0x100000);
+            hex4(json, 0xD800 + ((cp - 0x10000) >> 10));
+            hex4(json, 0xDC00 + ((cp - 0x10000) & 0x3FF));
+            utf8(val, cp);
+        } break;
+        case 5:                                      // одинокий суррогат → U+FFFD
+            if (coin(50)) {
+                hex4(json, 0xD800 + (uint32_t)rnd(0x400));
+                json += 'x';                         // иначе следующий \uDCxx составит с ним пару
+                utf8(val, 0xFFFD);
+                val += 'x';
+            } else {
+                hex4(json, 0xDC00 + (uint32_t)rnd(0x400));
+                utf8(val, 0xFFFD);
+            }
+            break;
+        case 6: json += "\xD0\x9F\xD1\x80"; val += "\xD0\x9F\xD1\x80"; break; // «Пр» как есть
+        default: {
+            static const char plain[] = "abcxyzABC0129 _-.:{}[],";
+            const char c = plain[rnd(sizeof(plain) - 1)];
+            json += c;
+            val += c;
+        }
+        }
+    }
+    json += '"';
+}
+
+void ws(std::string& o) {
+    static const char w[] = " \t\r\n";
+    for (int n = coin(40) ? rnd(3) + 1 : 0; n; n--) o += w[rnd(4)];
+}
+
+void genValue(std::string& o, int depth);
+
+void genComposite(std::string& o, int depth) {
+    const bool obj = coin(50);
+    o += obj ? '{' : '[';
+    const int n = depth > 3 ? 0 : rnd(4);
+    for (int i = 0; i < n; i++) {
+        if (i) o += ',';
+        ws(o);
+        if (obj) {
+            static const char* k[] = {"ssid", "password", "n", "flag", "meta"};
+            o += '"';
+            o += k[rnd(5)];
+            o += "\":";
+            ws(o);
+        }
+        genValue(o, depth + 1);
+        ws(o);
+    }
+    o += obj ? '}' : ']';
+}
+
+void genValue(std::string& o, int depth) {
+    std::string v;
+    switch (rnd(6)) {
+    case 0: o += '"'; genString(o, v, 12); break;
+    case 1: o += std::to_string(rnd(2000000) - 1000000); break;
+    case 2: o += coin(50) ? "true" : "false"; break;
+    case 3: o += "null"; break;
+    default: genComposite(o, depth); break;
+    }
+}
+
+struct Truth {
+    Picked      want;
+    std::string doc;
+};
+
+// Объект верхнего уровня: первое вхождение ключа с подходящим типом значения — ответ.
+Truth genDoc() {
+    Truth t;
+    Picked& w = t.want;
+    std::string& o = t.doc;
+    ws(o);
+    o += '{';
+    const int members = rnd(9);
+    for (int m = 0; m < members; m++) {
+        if (m) o += ',';
+        ws(o);
+        // ключ: целевой, целевой через \u, чужой, слишком длинный для буфера ключа
+        static const char* names[] = {"ssid", "password", "n", "flag"};
+        int         target = rnd(6);                 // 4, 5 — чужой ключ
+        std::string key;
+        if (target < 4) {
+            key = names[target];
+            if (coin(15)) {                          // "ss\u0069d" — тот же ключ
+                std::string k = "\"";
+                for (char c : key) {
+                    if (coin(40)) hex4(k, (uint8_t)c);
+                    else k += c;
+                }
+                o += k + "\"";
+            } else o += "\"" + key + "\"";
+        } else {
+            o += coin(20) ? "\"" + std::string(60, 's') + "\"" : (coin(50) ? "\"SSID\"" : "\"meta\"");
+            target = -1;
+        }
+        ws(o);
+        o += ':';
+        ws(o);
+        const int kind = rnd(6);
+        std::string sval;
+        if (kind == 0) {                             // строка
+            o += '"';
+            genString(o, sval, 24);
+            if (target == 0 && !w.fSsid) { w.ssid = sval.c_str(); w.fSsid = true; }
+            if (target == 1 && !w.fPass) { w.pass = String(sval); w.fPass = true; }
+        } else if (kind == 1) {                      // целое
+            const long v = (long)rnd(2000000) - 1000000;
+            o += std::to_string(v);
+            if (target == 0 && !w.fSsid) { w.ssid = std::to_string(v).c_str(); w.fSsid = true; }
+            if (target == 1 && !w.fPass) { w.pass = std::to_string(v).c_str(); w.fPass = true; }
+            if (target == 2 && !w.fN) { w.n = v; w.fN = true; }
+        } else if (kind == 2) {                      // true/false
+            const bool b = coin(50);
+            o += b ? "true" : "false";
+            if (target == 0 && !w.fSsid) { w.ssid = b ? "true" : "false"; w.fSsid = true; }
+            if (target == 1 && !w.fPass) { w.pass = b ? "true" : "false"; w.fPass = true; }
+            if (target == 3 && !w.fFlag) { w.flag = b; w.fFlag = true; }
+        } else if (kind == 3) {
+            o += "null";
+        } else {
+            genComposite(o, 1);                      // вложенные "ssid" не должны совпасть
+        }
+        ws(o);
+    }
+    o += '}';
+    ws(o);
+    w.ok = true;
+    return t;
+}
+
+// ===== прежний разбор (до user-007): indexOf по всему тексту =====
+void legacyUtf8(String& s, uint32_t cp) {
+    if (cp < 0x80) s += (char)cp;
+    else if (cp < 0x800) {
+        s += (char)(0xC0 | (cp >> 6));
+        s += (char)(0x80 | (cp & 0x3F));
+    } else {
+        s += (char)(0xE0 | (cp >> 12));
+        s += (char)(0x80 | ((cp >> 6) & 0x3F));
+        s += (char)(0x80 | (cp & 0x3F));
+    }
+}
+
+bool legacyGetString(const String& j, const char* key, String& out) {
+    const String keyPat = String("\"") + key + String("\"");
+    int k = j.indexOf(keyPat);
+    if (k < 0) return false;
+    k = j.indexOf(':', k);
+    if (k < 0) return false;
+    int n = (int)j.length();
+    int i = k + 1;
+    while (i < n && (j[i] == ' ' || j[i] == '\t' || j[i] == '\r' || j[i] == '\n')) i++;
+    if (i >= n || j[i] != '\"') return false;
+    i++;
+    out = "";
+    while (i < n) {
+        char c = (char)j[i];
+        if (c == '\"') return true;
+        if (c == '\\' && i + 1 < n) {
+            char t = (char)j[i + 1];
+            if (t == '\"' || t == '\\' || t == '/') { out += t; i += 2; continue; }
+            if (t == 'b') { out += '\b'; i += 2; continue; }
+            if (t == 'f') { out += '\f'; i += 2; continue; }
+            if (t == 'n') { out += '\n'; i += 2; continue; }
+            if (t == 'r') { out += '\r'; i += 2; continue; }
+            if (t == 't') { out += '\t'; i += 2; continue; }
+            if (t == 'u' && i + 6 < n) {
+                int h = tkwmHex4_(j.c_str() + i + 2);
+                if (h >= 0) { legacyUtf8(out, (uint32_t)h); i += 6; continue; }
+            }
+        }
+        out += c;
+        i++;
+    }
+    return false;
+}
+
+// Ответ resolve-download: нужные ключи в конце, перед ними — длинные release notes и вложенные объекты.
+std::string resolveBody(size_t notes) {
+    std::string o = "{\"status\":\"ok\",\"meta\":{\"firmware_version\":\"0.0.0\",\"channels\":[1,2,3]},\"notes\":\"";
+    for (size_t i = 0; o.size() < notes; i++) o += i % 7 ? "Fixed \\\"edge\\\" cases. " : "\\u041F\\u0440. ";
+    o += "\",\"firmware_version\":\"1.4.2\",\"latest_firmware_version\":\"1.4.2\","
+         "\"download_url\":\"https://ota.example.com/fw/1.4.2/firmware.bin?sig=abcdef0123456789\"}";
+    return o;
+}
+
+struct Resolve {
+    String fw, dl, latest;
+    // fw не сравнивается: прежний разбор брал "firmware_version" из вложенного "meta"
+    bool operator==(const Resolve& o) const { return dl == o.dl && latest == o.latest; }
+};
+
+// Как tkwmResolveRead_ до и после user-007: шесть ключей (snake_case и camelCase).
+Resolve resolveLegacy(const String& r) {
+    Resolve out;
+    if (!legacyGetString(r, "download_url", out.dl)) legacyGetString(r, "downloadUrl", out.dl);
+    if (!legacyGetString(r, "firmware_version", out.fw)) legacyGetString(r, "firmwareVersion", out.fw);
+    if (!legacyGetString(r, "latest_firmware_version", out.latest)) legacyGetString(r, "latestFirmwareVersion", out.latest);
+    return out;
+}
+
+Resolve resolvePick(TkwmJsonPick& p, String& cap) {
+    Resolve out;
+    String  dl2, fw2, latest2;
+    p.capture(cap, 200)
+        .str("download_url", out.dl)
+        .str("downloadUrl", dl2)
+        .str("firmware_version", out.fw)
+        .str("firmwareVersion", fw2)
+        .str("latest_firmware_version", out.latest)
+        .str("latestFirmwareVersion", latest2)
+        .run();
+    return out;
+}
+
+struct BenchCost {
+    double ns   = 0;
+    size_t peak = 0;
+};
+
+template <typename F> BenchCost bench(int iters, F&& f) {
+    BenchCost c;
+    f();
+    const size_t before = tkwmHost::heapUsed();
+    tkwmHost::heapPeakReset();
+    f();
+    c.peak        = tkwmHost::heapPeak() - before;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; i++) f();
+    c.ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / iters;
+    return c;
+}
+
+} // namespace
+
+int main() {
+    // ===== известные случаи =====
+    {
+        Picked p = pickString("{\"meta\":{\"ssid\":\"inner\",\"flag\":true},\"list\":[\"ssid\",{\"n\":1}],"
+                              "\"ssid\":\"outer\",\"note\":\"\\\"ssid\\\":\\\"fake\\\"\"}");
+        CHECK(p.ok);
+        CHECK_EQ(p.ssid, String("outer"));
+        CHECK(!p.fN && !p.fFlag);
+        p = pickString("{\"ssid\":\"\\ud83d\\ude00 \\ud800x \\udc00\"}");
+        CHECK_EQ(p.ssid, String("\xF0\x9F\x98\x80 \xEF\xBF\xBDx \xEF\xBF\xBD"));
+        p = pickString("{\"ss\\u0069d\":\"k\",\"n\":-42,\"flag\":false,\"password\":null}");
+        CHECK(p.ok && p.fSsid && p.fN && p.fFlag && !p.fPass);
+        CHECK_EQ(p.n, -42L);
+        // все поля найдены — остаток не читается
+        p = pickString("{\"ssid\":\"a\",\"password\":\"b\",\"n\":1,\"flag\":true,garbage");
+        CHECK(p.ok);
+        const char* bad[] = {"", "[]", "{", "{\"ssid\"}", "{\"ssid\":}", "{\"a\":[}", "{\"a\":{]}",
+                             "{\"ssid\":\"x", "{\"ssid\":\"\\q\"}", "{\"ssid\":\"\\u12\"}", "{'ssid':1}",
+                             "{\"a\":1 \"b\":2}"};
+        for (const char* b : bad) CHECK(!pickString(b).ok);
+        std::string deep = "{\"a\":";
+        for (int i = 0; i < 40; i++) deep += '[';
+        CHECK(!pickString(deep).ok);                 // глубже 32 уровней — отказ, не переполнение
+    }
+
+    // ===== сгенерированные документы: ответ известен заранее, три источника согласны =====
+    const int kDocs = 20000;
+    int       agree = 0;
+    for (int i = 0; i < kDocs; i++) {
+        const Truth t  = genDoc();
+        const Picked a = pickString(t.doc);
+        if (!(a == t.want)) {
+            tkwmTest::fail(__FILE__, __LINE__, "generated: " + t.doc);
+            if (tkwmTest::failures() > 5) break;
+            continue;
+        }
+        CHECK(pickStream(t.doc) == a);
+        CHECK(pickChunked(t.doc) == a);
+        agree++;
+    }
+    CHECK_EQ(agree, kDocs);
+    metric("json_pick_generated_docs", agree, "docs");
+
+    // ===== мутации: любой ввод — без падений, источники дают одно и то же =====
+    const int kMut = 50000;
+    int       rejected = 0;
+    for (int i = 0; i < kMut; i++) {
+        std::string d = genDoc().doc;
+        for (int m = 1 + rnd(3); m && !d.empty(); m--) {
+            const size_t at = (size_t)rnd((int)d.size());
+            switch (rnd(5)) {
+            case 0: d[at] = (char)rnd(256); break;
+            case 1: d.erase(at, 1 + (size_t)rnd(4)); break;
+            case 2: d.insert(at, 1, "{}[]\",:\\u"[rnd(9)]); break;
+            case 3: d.resize(at); break;
+            default: d.insert(at, d.substr(at, (size_t)rnd(16))); break;
+            }
+        }
+        const Picked a = pickString(d);
+        rejected += a.ok ? 0 : 1;
+        if (!(pickStream(d) == a) || !(pickChunked(d) == a)) {
+            tkwmTest::fail(__FILE__, __LINE__, "sources disagree: " + d);
+            if (tkwmTest::failures() > 5) break;
+        }
+    }
+    metric("json_pick_mutations", kMut, "docs");
+    metric("json_pick_mutations_rejected", 100.0 * rejected / kMut, "%");
+
+    // capture() — первые байты исходного текста, сколько бы их ни было прочитано
+    {
+        const std::string body = resolveBody(1200);
+        ChunkStream       st(body, 64);
+        String            cap;
+        TkwmJsonPick      p(st, -1);
+        const Resolve     r = resolvePick(p, cap);
+        CHECK_EQ(cap, String(body.substr(0, 200)));
+        CHECK_EQ(r.fw, String("1.4.2"));
+    }
+
+    // ===== замер: String-источник, поток вместо getString() =====
+    const size_t sizes[] = {512, 4096};
+    for (size_t sz : sizes) {
+        const std::string body = resolveBody(sz);
+        const String      s(body);
+        Resolve           a, b;
+        String            cap;
+        const BenchCost old = bench(3000, [&] { a = resolveLegacy(s); });
+        const BenchCost now = bench(3000, [&] {
+            TkwmJsonPick p(s);
+            b = resolvePick(p, cap);
+        });
+        CHECK(a == b);
+        CHECK_EQ(a.fw, String("0.0.0"));
+        CHECK_EQ(b.fw, String("1.4.2"));
+        CHECK_EQ(b.dl, String("https://ota.example.com/fw/1.4.2/firmware.bin?sig=abcdef0123456789"));
+        // прежний путь: getString() всего тела, затем indexOf; новый — разбор прямо из потока
+        const BenchCost oldStream = bench(3000, [&] {
+            ChunkStream st(body, 1436);
+            const String all = st.readString();
+            a                = resolveLegacy(all);
+        });
+        const BenchCost nowStream = bench(3000, [&] {
+            ChunkStream  st(body, 1436);
+            TkwmJsonPick p(st, (int)body.size());
+            b = resolvePick(p, cap);
+        });
+        CHECK(a == b);
+
+        char name[64];
+        snprintf(name, sizeof(name), "resolve%zu_indexof_ns", sz);
+        metric(name, old.ns, "ns");
+        snprintf(name, sizeof(name), "resolve%zu_pick_ns", sz);
+        metric(name, now.ns, "ns");
+        snprintf(name, sizeof(name), "resolve%zu_indexof_peak_heap", sz);
+        metric(name, (double)old.peak, "B");
+        snprintf(name, sizeof(name), "resolve%zu_pick_peak_heap", sz);
+        metric(name, (double)now.peak, "B");
+        snprintf(name, sizeof(name), "resolve%zu_getstring_indexof_peak_heap", sz);
+        metric(name, (double)oldStream.peak, "B");
+        snprintf(name, sizeof(name), "resolve%zu_stream_pick_peak_heap", sz);
+        metric(name, (double)nowStream.peak, "B");
+        snprintf(name, sizeof(name), "resolve%zu_stream_pick_ns", sz);
+        metric(name, nowStream.ns, "ns");
+
+        // из потока — без копии тела: пик кучи меньше прежнего как минимум на размер тела
+        CHECK_LE(nowStream.peak + sz, oldStream.peak);
+    }
+    return report("test_json_pick");
+}
@@ -0,0 +1,231 @@
+// user-011: сети в NVS одним блобом. 16 сетей: число операций NVS и их время на загрузку, сохранение
+// и удаление против прежней схемы count + s<i>/p<i> (повторена здесь поверх того же Preferences),
+// однократный перенос из старых ключей, битый блоб.
+#include "host_test.h"
+#include <Preferences.h>
+
+namespace {
+
+const int kNets = TKWM_MAX_CRED;
+
+std::string ssidOf(int i) { return "net-" + std::to_string(i); }
+std::string passOf(int i, int gen = 0) { return "pass-" + std::to_string(i) + "-" + std::to_string(gen) + "-xxxxxxxx"; }
+
+// Старые ключи так, как их оставила прежняя версия.
+void seedLegacy(tkwmHost::Nvs& nvs, int n) {
+    auto& m = nvs.ns["tkw_net"];
+    int32_t cnt = n;
+    m["count"] = {'i', std::string((const char*)&cnt, 4)};
+    for (int i = 0; i < n; i++) {
+        m["s" + std::to_string(i)] = {'s', ssidOf(i)};
+        m["p" + std::to_string(i)] = {'s', passOf(i)};
+    }
+}
+
+// ===== прежняя схема (до user-011) =====
+int legacyLoad(Preferences& p, String* ssid, String* pass) {
+    p.begin("tkw_net", true);
+    int n = p.getInt("count", 0);
+    if (n < 0 || n > TKWM_MAX_CRED) n = 0;
+    for (int i = 0; i < n; i++) {
+        ssid[i] = p.getString((String("s") + i).c_str(), "");
+        pass[i] = p.getString((String("p") + i).c_str(), "");
+    }
+    p.end();
+    return n;
+}
+
+void legacySaveAt(Preferences& p, int idx, const String& ssid, const String& pass) {
+    p.begin("tkw_net", false);
+    p.putString((String("s") + idx).c_str(), ssid);
+    p.putString((String("p") + idx).c_str(), pass);
+    p.end();
+}
+
+int legacyDelete(Preferences& p, String* ssid, String* pass, int n, int idx) {
+    for (int i = idx; i < n - 1; ++i) {
+        ssid[i] = ssid[i + 1];
+        pass[i] = pass[i + 1];
+    }
+    n--;
+    p.begin("tkw_net", false);
+    p.putInt("count", n);
+    for (int i = 0; i < n; ++i) {
+        p.putString((String("s") + i).c_str(), ssid[i]);
+        p.putString((String("p") + i).c_str(), pass[i]);
+    }
+    for (int i = n; i < TKWM_MAX_CRED; ++i) {
+        p.remove((String("s") + i).c_str());
+        p.remove((String("p") + i).c_str());
+    }
+    p.end();
+    return n;
+}
+
+tkwmHost::Nvs::Stats netStats() {
+    tkwmHost::Nvs& nvs = tkwmHost::device().nvs;
+    const auto     it  = nvs.perNs.find("tkw_net");
+    return it == nvs.perNs.end() ? tkwmHost::Nvs::Stats() : it->second;
+}
+
+void reset() { tkwmHost::device().nvs.resetStats(); }
+
+void emit(const char* what, const tkwmHost::Nvs::Stats& s) {
+    char name[64];
+    snprintf(name, sizeof(name), "%s_nvs_reads", what);
+    metric(name, s.reads, "ops");
+    snprintf(name, sizeof(name), "%s_nvs_writes", what);
+    metric(name, s.writes, "ops");
+    snprintf(name, sizeof(name), "%s_nvs_erases", what);
+    metric(name, s.erases, "ops");
+    snprintf(name, sizeof(name), "%s_nvs_ms", what);
+    metric(name, s.us / 1000.0, "ms");
+}
+
+std::vector<std::string> savedList(TKWifiManager& m) {
+    const tkwmHost::Response r = tkwmHost::request(m.web(), tkwmHost::rawRequest("GET", "/api/wifi/saved"), tickOf(m));
+    CHECK_EQ(r.code, 200);
+    std::vector<std::string> out;
+    const size_t a = r.body.find("\"nets\":[");
+    const size_t b = r.body.find(']', a);
+    for (size_t p = a + 8; p < b;) {
+        const size_t q = r.body.find('"', p + 1);
+        out.push_back(r.body.substr(p + 1, q - p - 1));
+        p = q + 2;
+    }
+    return out;
+}
+
+tkwmHost::Response post(TKWifiManager& m, const char* uri, const std::string& body, const char* type) {
+    return tkwmHost::request(m.web(), tkwmHost::rawRequest("POST", uri, body, "", type), tickOf(m));
+}
+
+bool hasLegacyKeys(tkwmHost::Nvs& nvs) {
+    for (auto& kv : nvs.ns["tkw_net"])
+        if (kv.first != "creds") return true;
+    return false;
+}
+
+} // namespace
+
+int main() {
+    using namespace tkwmHost;
+
+    // ===== прежняя схема: загрузка, смена пароля, удаление =====
+    Nvs::Stats oldLoad, oldSave, oldDelete;
+    {
+        Device dev(2);
+        use(dev);
+        seedLegacy(dev.nvs, kNets);
+        Preferences p;
+        String      ssid[TKWM_MAX_CRED], pass[TKWM_MAX_CRED];
+        reset();
+        const int n = legacyLoad(p, ssid, pass);
+        oldLoad     = netStats();
+        CHECK_EQ(n, kNets);
+        reset();
+        legacySaveAt(p, 5, ssid[5], String(passOf(5, 1)));
+        oldSave = netStats();
+        reset();
+        legacyDelete(p, ssid, pass, n, 0);
+        oldDelete = netStats();
+    }
+
+    Device dev(1);
+    use(dev);
+    seedLegacy(dev.nvs, kNets);
+
+    // ===== первый запуск новой версии: перенос в блоб один раз =====
+    Nvs::Stats migrate, load, save, same, del;
+    {
+        TKWifiManager mgr;
+        reset();
+        CHECK(mgr.begin());
+        migrate = netStats();
+        CHECK(dev.nvs.ns["tkw_net"].count("creds"));
+        CHECK(!hasLegacyKeys(dev.nvs));
+        CHECK_EQ(migrate.writes, 1u);
+        const std::vector<std::string> l = savedList(mgr);
+        CHECK_EQ(l.size(), (size_t)kNets);
+        for (int i = 0; i < (int)l.size() && i < kNets; i++) CHECK_EQ(l[i], ssidOf(i));
+    }
+
+    // ===== перезагрузка: загрузка 16 сетей из блоба =====
+    {
+        TKWifiManager mgr;
+        reset();
+        CHECK(mgr.begin());
+        load = netStats();
+        CHECK_EQ(load.writes, 0u);
+        CHECK_EQ(savedList(mgr).size(), (size_t)kNets);
+
+        // смена пароля: одна запись; тот же пароль ещё раз — ни одной
+        const std::string body = "{\"ssid\":\"" + ssidOf(5) + "\",\"password\":\"" + passOf(5, 1) + "\"}";
+        reset();
+        CHECK_EQ(post(mgr, "/api/wifi/save", body, "application/json").code, 200);
+        save = netStats();
+        reset();
+        CHECK_EQ(post(mgr, "/api/wifi/save", body, "application/json").code, 200);
+        same = netStats();
+        CHECK_EQ(same.writes, 0u);
+
+        // удаление первой сети: одна запись, без удаления ключей
+        reset();
+        const Response r = post(mgr, "/api/wifi/delete", "ssid=" + ssidOf(0), "application/x-www-form-urlencoded");
+        CHECK(r.body.find("\"removed\":true") != std::string::npos);
+        del = netStats();
+        const std::vector<std::string> l = savedList(mgr);
+        CHECK_EQ(l.size(), (size_t)kNets - 1);
+        CHECK(!l.empty() && l[0] == ssidOf(1));
+    }
+    {
+        TKWifiManager mgr;
+        CHECK(mgr.begin());
+        CHECK_EQ(savedList(mgr).size(), (size_t)kNets - 1);
+    }
+
+    emit("legacy_load16", oldLoad);
+    emit("blob_load16", load);
+    emit("legacy_save", oldSave);
+    emit("blob_save", save);
+    emit("blob_save_same", same);
+    emit("legacy_delete", oldDelete);
+    emit("blob_delete", del);
+    emit("migrate16", migrate);
+
+    CHECK_EQ(save.writes, 1u);
+    CHECK_EQ(del.writes, 1u);
+    CHECK_EQ(del.erases, 0u);
+    CHECK_LE(load.reads * 4, oldLoad.reads);         // 2N+2 чтений против константы
+    CHECK_LE(load.us * 4, oldLoad.us);
+    CHECK_LE(del.us * 10, oldDelete.us);
+    CHECK_LE(save.writes, oldSave.writes);
+
+    // ===== битый блоб: при живых старых ключах — повторный перенос, без них — пустой список =====
+    {
+        Device d3(3);
+        use(d3);
+        seedLegacy(d3.nvs, 3);
+        {
+            TKWifiManager mgr;
+            CHECK(mgr.begin());
+        }
+        std::string& blob = d3.nvs.ns["tkw_net"]["creds"].data;
+        CHECK(blob.size() > 8);
+        blob[blob.size() - 1] ^= 0x5A;
+        seedLegacy(d3.nvs, 2);
+        {
+            TKWifiManager mgr;
+            CHECK(mgr.begin());
+            CHECK_EQ(savedList(mgr).size(), (size_t)2);
+            CHECK(!hasLegacyKeys(d3.nvs));
+        }
+        d3.nvs.ns["tkw_net"]["creds"].data[9] ^= 0x01;
+        {
+            TKWifiManager mgr;
+            CHECK(mgr.begin());
+            CHECK_EQ(savedList(mgr).size(), (size_t)0);
+        }
+    }
+    return report("test_nvs_creds");
+}
@@ -0,0 +1,207 @@
+// user-018: конвейер OTA (сокет → кольцо блоков → задача записи → Update) против синхронной записи через
+// один блок. Образ отдаёт локальный HTTP-сервер (поток теста); приём WiFiClient ограничен скоростью канала и
+// TCP-окном lwIP (air().linkBps / tcpWnd), flash пишет сектор за заданное время. Синхронный путь — тот же
+// tkwmEsptoolsBinFetch_, которому не хватило памяти под кольцо (heapFailSize). Часы — реальные: писатель
+// живёт в своём потоке.
+#include "host_test.h"
+#include "TKWifiManager.cpp"
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <netinet/in.h>
+#include <random>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+const size_t kImage = 512 * 1024;
+
+// ===== HTTP-сервер образа: 200 + Content-Length + ETag, тело без пауз (темп задаёт канал клиента) =====
+// chunked — как сервер за прокси с HTTP/1.1: тело кадрами, соединение остаётся открытым для следующего запроса.
+class BinServer {
+public:
+    explicit BinServer(const std::string& body) : _body(body) {
+        _fd = socket(AF_INET, SOCK_STREAM, 0);
+        const int one = 1;
+        setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in a{};
+        a.sin_family      = AF_INET;
+        a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len     = sizeof(a);
+        CHECK(bind(_fd, (sockaddr*)&a, sizeof(a)) == 0 && listen(_fd, 4) == 0);
+        getsockname(_fd, (sockaddr*)&a, &len);
+        port = ntohs(a.sin_port);
+        _th  = std::thread([this] { run(); });
+    }
+    ~BinServer() {
+        shutdown(_fd, SHUT_RDWR);
+        close(_fd);
+        _th.join();
+    }
+    std::string url() const { return "http://127.0.0.1:" + std::to_string(port) + "/fw.bin"; }
+    uint16_t          port = 0;
+    std::atomic<bool> chunked{false};
+
+private:
+    void run() {
+        for (int c; (c = accept(_fd, nullptr, nullptr)) >= 0; close(c)) {
+            for (std::string req;; req.clear()) {
+                char b[512];
+                while (req.find("\r\n\r\n") == std::string::npos) {
+                    const ssize_t n = recv(c, b, sizeof(b), 0);
+                    if (n <= 0) break;
+                    req.append(b, (size_t)n);
+                }
+                if (req.find("\r\n\r\n") == std::string::npos) break;
+                if (!chunked) {
+                    const std::string head = "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: " +
+                                             std::to_string(_body.size()) + "\r\nETag: \"fw-1\"\r\nConnection: close\r\n\r\n";
+                    sendAll(c, head);
+                    sendAll(c, _body);
+                    break;
+                }
+                sendAll(c, "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nTransfer-Encoding: chunked\r\n"
+                           "Connection: keep-alive\r\n\r\n");
+                // кадры разной длины, с расширением у одного — граница кадра не совпадает с блоком OTA
+                for (size_t p = 0, k = 0; p < _body.size(); k++) {
+                    const size_t n = std::min<size_t>(_body.size() - p, 1000 + (k % 7) * 733);
+                    char         hex[32];
+                    snprintf(hex, sizeof(hex), k == 3 ? "%zx;ext=1\r\n" : "%zx\r\n", n);
+                    sendAll(c, hex + _body.substr(p, n) + "\r\n");
+                    p += n;
+                }
+                sendAll(c, "0\r\n\r\n");
+            }
+        }
+    }
+    static void sendAll(int c, const std::string& s) {
+        for (size_t p = 0; p < s.size();) {
+            const ssize_t n = send(c, s.data() + p, s.size() - p, MSG_NOSIGNAL);
+            if (n <= 0) return;
+            p += (size_t)n;
+        }
+    }
+    std::string _body;
+    int         _fd = -1;
+    std::thread _th;
+};
+
+struct Link {
+    const char* name;
+    uint32_t    bps;       // канал
+    uint32_t    us, slowEvery, slowUs; // flash: сектор, каждый slowEvery-й — медленное стирание
+};
+
+const Link kLinks[] = {
+    {"jitter", 400000, 4000, 8, 60000},  // в среднем flash ≈ сети, но медленное стирание раз в 8 секторов
+    {"steady", 400000, 8000, 0, 0},      // ровные сеть и flash
+};
+
+struct Run {
+    TkwmOtaStats st;
+    bool         ok = false;
+};
+
+Run fetch(const std::string& url, const std::string& body, bool ring) {
+    tkwmHost::Flash& f = tkwmHost::device().flash;
+    f.image.clear();
+    f.writes    = 0;
+    f.committed = false;
+    Run r;
+    tkwmHost::heapFailSize(ring ? 0 : (size_t)TKWM_OTA_RING_BLOCKS * TKWM_OTA_BLOCK);
+    {
+        HTTPClient    http;
+        WiFiClient    cli;
+        TkwmOtaResume rs;
+        String        err;
+        const int     code = tkwmEsptoolsBinFetch_(http, cli, String(url.c_str()), String(), 0, err, rs, r.st);
+        if (code != TKWM_BIN_FETCH_OK) fprintf(stderr, "fetch: %d %s\n", code, err.c_str());
+        r.ok = code == TKWM_BIN_FETCH_OK && Update.end(true); // как установка: размер может быть неизвестен (chunked)
+    }
+    tkwmHost::heapFailSize(0);
+    CHECK(r.ok);
+    CHECK(f.committed);
+    CHECK(f.image.size() == body.size() && memcmp(f.image.data(), body.data(), body.size()) == 0);
+    CHECK_EQ((int)r.st.ring, ring ? (int)TKWM_OTA_RING_BLOCKS : 0);
+    return r;
+}
+
+void emit(const char* link, const char* mode, const Run& r) {
+    char name[96];
+    snprintf(name, sizeof(name), "%s_%s_ms", link, mode);
+    metric(name, r.st.ms, "ms");
+    snprintf(name, sizeof(name), "%s_%s_kbps", link, mode);
+    metric(name, r.st.ms ? r.st.bytes / 1.024 / r.st.ms : 0, "KB/s");
+    snprintf(name, sizeof(name), "%s_%s_net_wait", link, mode);
+    metric(name, r.st.netWaitMs, "ms");
+    snprintf(name, sizeof(name), "%s_%s_flash_wait", link, mode);
+    metric(name, r.st.flashWaitMs, "ms");
+    snprintf(name, sizeof(name), "%s_%s_ring_max", link, mode);
+    metric(name, r.st.ringMax, "blocks");
+}
+
+} // namespace
+
+int main() {
+    using namespace tkwmHost;
+    Device dev(1);
+    use(dev);
+    realTime(true);
+
+    // несжимаемый образ приложения: приёмник пишет его как есть
+    std::string  body(kImage, '\0');
+    std::mt19937 rng(1018);
+    for (char& c : body) c = (char)rng();
+    body[0] = (char)0xE9;
+    BinServer srv(body);
+
+    const uint32_t blocks = (uint32_t)(kImage / TKWM_OTA_BLOCK);
+    for (const Link& l : kLinks) {
+        air().linkBps     = l.bps;
+        dev.flash.writeUsPer4k = l.us;
+        dev.flash.slowEvery    = l.slowEvery;
+        dev.flash.slowUsPer4k  = l.slowUs;
+        const Run ring = fetch(srv.url(), body, true);
+        const Run sync = fetch(srv.url(), body, false);
+        emit(l.name, "ring", ring);
+        emit(l.name, "sync", sync);
+
+        // нижние границы модели: ни один путь не быстрее канала и суммарного времени flash
+        const uint32_t netMs   = (uint32_t)((uint64_t)kImage * 1000 / l.bps);
+        const uint32_t slow    = l.slowEvery ? blocks / l.slowEvery : 0;
+        const uint32_t flashMs = (uint32_t)(((uint64_t)(blocks - slow) * l.us + (uint64_t)slow * l.slowUs) / 1000);
+        char name[64];
+        snprintf(name, sizeof(name), "%s_net_only_ms", l.name);
+        metric(name, netMs, "ms");
+        snprintf(name, sizeof(name), "%s_flash_only_ms", l.name);
+        metric(name, flashMs, "ms");
+        snprintf(name, sizeof(name), "%s_ring_speedup", l.name);
+        metric(name, ring.st.ms ? (double)sync.st.ms / ring.st.ms : 0, "x");
+        CHECK_LE(netMs * 95 / 100, sync.st.ms);
+        CHECK_LE(netMs * 95 / 100, ring.st.ms);
+        CHECK_LE(flashMs * 95 / 100, ring.st.ms);
+        if (l.slowEvery) {
+            // Синхронно канал стоит, пока стирается медленный сектор (окно 5,7 КБ заполняется за 14 мс);
+            // кольцо дочитывает сокет в свободные блоки — время близко к max(сеть, flash).
+            CHECK(ring.st.ringMax >= 2);
+            CHECK_LE(ring.st.ms * 100, sync.st.ms * 85);
+            CHECK_LE(ring.st.ms * 100, std::max(netMs, flashMs) * 125);
+        }
+    }
+    air().linkBps = 0;
+
+    // HTTP/1.1 keep-alive, тело chunked без длины: в образ — только данные кадров, конец тела — нулевой кадр,
+    // а не TKWM_OTA_STALL_MS тишины в открытом соединении.
+    dev.flash.writeUsPer4k = 0;
+    dev.flash.slowEvery    = 0;
+    srv.chunked            = true;
+    const auto t0          = std::chrono::steady_clock::now();
+    const Run  ch          = fetch(srv.url(), body, true);
+    const auto chMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+    metric("chunked_keepalive_ms", (double)chMs, "ms");
+    CHECK_EQ(ch.st.total, 0u);
+    CHECK_LE((uint32_t)chMs, (uint32_t)TKWM_OTA_STALL_MS / 2);
+    return report("test_ota_pipe");
+}
@@ -0,0 +1,304 @@
+// user-019: приёмник OTA TkwmOtaSink — распаковка gzip и TKLZ прямо в Update. Образ «как прошивка» (код,
+// строки, таблицы, заполнение) пакуется zlib (gzip с разными полями заголовка) и TKLZ (кодер повторяет
+// extras/tkwm_pack_fw.py) и подаётся кусками случайной длины; во flash должен оказаться исходный образ.
+// Порча (CRC, длина, обрыв, битые данные, неверный заголовок) — отказ. Замер: пик кучи приёмника и
+// скорость распаковки на ПК (МБ/с на выходе) для raw, gzip и TKLZ с разными окнами.
+#include "host_test.h"
+#include "TKWifiManager.cpp"
+#include <chrono>
+#include <random>
+#include <unordered_map>
+#include <zlib.h>
+
+namespace {
+
+std::mt19937 rng(1019);
+
+// ===== образ: E9-заголовок, «инструкции» из малого словаря, строки, таблицы, 0xFF-заполнение =====
+std::string makeImage(size_t size) {
+    static const char* const words[] = {"wifi", "esp_err", "nvs_open", "TKWM", "http://", "/api/", "timeout", "connect"};
+    std::string out;
+    out.reserve(size);
+    out += (char)0xE9;
+    while (out.size() < size) {
+        const int kind = (int)(rng() % 10);
+        if (kind < 6) {
+            for (int i = 0; i < 32; i++) {
+                const uint32_t op = 0x00C12000u | (rng() % 16) << 4 | (rng() % 4);
+                out.append((const char*)&op, 3);
+            }
+        } else if (kind < 8) {
+            for (int i = 0; i < 8; i++) {
+                out += words[rng() % 8];
+                out += (char)(i % 3 ? ' ' : '\0');
+            }
+        } else if (kind < 9) {
+            for (int i = 0; i < 64; i++) out += (char)rng();
+        } else {
+            out.append(64 + rng() % 256, (char)0xFF);
+        }
+    }
+    out.resize(size);
+    return out;
+}
+
+// ===== gzip: заголовок собирается вручную (FEXTRA/FNAME/FCOMMENT/FHCRC), тело — raw deflate zlib =====
+std::string gzipOf(const std::string& raw, uint8_t flags) {
+    std::string out = {'\x1f', '\x8b', 8, (char)flags, 0, 0, 0, 0, 2, 3};
+    if (flags & 4) out += std::string("\x06\x00" "AB\x02\x00xy", 8);
+    if (flags & 8) out += std::string("firmware.bin", 13);
+    if (flags & 16) out += std::string("build 42", 9);
+    if (flags & 2) {
+        const uint32_t c = (uint32_t)crc32(0, (const Bytef*)out.data(), (uInt)out.size());
+        out += (char)c;
+        out += (char)(c >> 8);
+    }
+    z_stream z{};
+    deflateInit2(&z, 9, Z_DEFLATED, -15, 9, Z_DEFAULT_STRATEGY);
+    std::string body(deflateBound(&z, (uLong)raw.size()), '\0');
+    z.next_in   = (Bytef*)raw.data();
+    z.avail_in  = (uInt)raw.size();
+    z.next_out  = (Bytef*)&body[0];
+    z.avail_out = (uInt)body.size();
+    deflate(&z, Z_FINISH);
+    body.resize(z.total_out);
+    deflateEnd(&z);
+    out += body;
+    const uint32_t crc = (uint32_t)crc32(0, (const Bytef*)raw.data(), (uInt)raw.size());
+    const uint32_t len = (uint32_t)raw.size();
+    out.append((const char*)&crc, 4);
+    out.append((const char*)&len, 4);
+    return out;
+}
+
+// ===== TKLZ: как lz_pack() в extras/tkwm_pack_fw.py =====
+std::string lzOf(const std::string& raw, int w, int l) {
+    const size_t win = (size_t)1 << w, maxlen = (size_t)1 << l;
+    const size_t minlen = (size_t)(1 + w + l) / 9 + 1;
+    std::string  body;
+    uint32_t     acc = 0;
+    int          nbits = 0;
+    auto put = [&](uint32_t v, int n) {
+        acc = (acc << n) | v;
+        nbits += n;
+        while (nbits >= 8) {
+            nbits -= 8;
+            body += (char)((acc >> nbits) & 0xFF);
+        }
+        acc &= (1u << nbits) - 1;
+    };
+    std::unordered_map<uint32_t, std::vector<uint32_t>> heads;
+    auto key = [&](size_t i) { return (uint32_t)(uint8_t)raw[i] | (uint32_t)(uint8_t)raw[i + 1] << 8 | (uint32_t)(uint8_t)raw[i + 2] << 16; };
+    const size_t n = raw.size();
+    for (size_t i = 0; i < n;) {
+        size_t bestLen = 0, bestDist = 0;
+        if (i + 3 <= n) {
+            auto it = heads.find(key(i));
+            if (it != heads.end()) {
+                const std::vector<uint32_t>& chain = it->second;
+                const size_t from = chain.size() > 64 ? chain.size() - 64 : 0;
+                for (size_t c = chain.size(); c-- > from;) {
+                    const size_t j = chain[c];
+                    if (i - j > win) break;
+                    size_t m = 0;
+                    while (m < maxlen && i + m < n && raw[j + m] == raw[i + m]) m++;
+                    if (m > bestLen) {
+                        bestLen  = m;
+                        bestDist = i - j;
+                        if (m == maxlen) break;
+                    }
+                }
+            }
+        }
+        const size_t step = bestLen >= minlen ? bestLen : 1;
+        if (step > 1) {
+            put(0, 1);
+            put((uint32_t)(bestDist - 1), w);
+            put((uint32_t)(step - 1), l);
+        } else {
+            put(1, 1);
+            put((uint8_t)raw[i], 8);
+        }
+        for (size_t k = i; k < i + step; k++) {
+            if (k + 3 > n) continue;
+            std::vector<uint32_t>& chain = heads[key(k)];
+            chain.push_back((uint32_t)k);
+            if (chain.size() > 128) chain.erase(chain.begin(), chain.begin() + 64);
+        }
+        i += step;
+    }
+    if (nbits) body += (char)((acc << (8 - nbits)) & 0xFF);
+    std::string out = "TKLZ";
+    out += (char)w;
+    out += (char)l;
+    out.append(2, '\0');
+    const uint32_t len = (uint32_t)raw.size();
+    const uint32_t crc = (uint32_t)crc32(0, (const Bytef*)raw.data(), (uInt)raw.size());
+    out.append((const char*)&len, 4);
+    out.append((const char*)&crc, 4);
+    return out + body;
+}
+
+// ===== приём: как tkwmEsptoolsBinFetch_ / handleOtaUpload — куски в sink, затем end() и Update.end() =====
+struct Unpacked {
+    bool     ok = false;
+    String   err;
+    size_t   peak = 0;    // пик кучи приёмника сверх занятого до begin()
+    double   us   = 0;
+    uint32_t out  = 0;
+    TkwmOtaSink::Kind kind = TkwmOtaSink::K_NONE;
+};
+
+Unpacked unpack(const std::string& packed, bool gzHint, size_t maxChunk) {
+    tkwmHost::Flash& f = tkwmHost::device().flash;
+    f.image.clear();
+    f.committed = false;
+    Unpacked       r;
+    const size_t   before = tkwmHost::heapUsed();
+    tkwmHost::heapPeakReset();
+    const auto     t0 = std::chrono::steady_clock::now();
+    {
+        TkwmOtaSink sink;
+        sink.begin(packed.size(), gzHint);
+        bool ok = true;
+        for (size_t p = 0; ok && p < packed.size();) {
+            const size_t k = std::min(packed.size() - p, maxChunk > 1 ? 1 + rng() % maxChunk : 1);
+            ok = sink.write((const uint8_t*)packed.data() + p, k);
+            p += k;
+        }
+        r.ok = ok && sink.end() && Update.end(true); // сжатый образ: Update.begin() без размера
+        if (!r.ok) {
+            r.err = sink.err();
+            sink.abort();
+        }
+        r.out  = sink.outBytes();
+        r.kind = sink.kind();
+    }
+    r.us   = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+    r.peak = tkwmHost::heapPeak() - before;
+    return r;
+}
+
+bool flashIs(const std::string& raw) {
+    const tkwmHost::Flash& f = tkwmHost::device().flash;
+    return f.committed && f.image.size() == raw.size() && memcmp(f.image.data(), raw.data(), raw.size()) == 0;
+}
+
+std::string corrupt(std::string s, size_t at) {
+    s[at] ^= 0x5A;
+    return s;
+}
+
+void bench(const char* name, const std::string& packed, size_t rawSize, bool gzHint) {
+    Unpacked best;
+    best.us = 1e18;
+    for (int i = 0; i < 5; i++) {
+        const Unpacked r = unpack(packed, gzHint, 4096);
+        CHECK(r.ok);
+        if (r.us < best.us) best = r;
+    }
+    char m[64];
+    snprintf(m, sizeof(m), "%s_packed", name);
+    metric(m, (double)packed.size(), "B");
+    snprintf(m, sizeof(m), "%s_ratio", name);
+    metric(m, (double)packed.size() / rawSize, "x");
+    snprintf(m, sizeof(m), "%s_peak_heap", name);
+    metric(m, (double)best.peak, "B");
+    snprintf(m, sizeof(m), "%s_unpack_speed", name);
+    metric(m, best.us > 0 ? rawSize / best.us : 0, "MB/s");
+}
+
+} // namespace
+
+int main() {
+    using namespace tkwmHost;
+    Device dev(1);
+    use(dev);
+
+    const std::string raw = makeImage(640 * 1024);
+
+    // ===== gzip: все сочетания полей заголовка, куски от 1 байта до 8 КБ =====
+    for (uint8_t flags : {0, 2, 4, 8, 16, 2 | 4 | 8 | 16}) {
+        const std::string gz = gzipOf(raw, flags);
+        for (size_t chunk : {(size_t)1, (size_t)7, (size_t)1460, (size_t)8192}) {
+            if (chunk == 1 && flags && flags != 30) continue; // побайтно — только крайние случаи, это долго
+            const Unpacked r = unpack(gz, chunk % 2 == 0, chunk);
+            CHECK(r.ok);
+            CHECK_EQ((int)r.kind, (int)TkwmOtaSink::K_GZIP);
+            CHECK_EQ(r.out, (uint32_t)raw.size());
+            CHECK(flashIs(raw));
+        }
+    }
+
+    // ===== TKLZ: окна от 2^8 до 2^12, длина ссылки 2^4..2^6 =====
+    const int lzWl[][2] = {{8, 4}, {10, 5}, {12, 6}};
+    std::string lz10;
+    for (const auto& wl : lzWl) {
+        const std::string lz = lzOf(raw, wl[0], wl[1]);
+        if (wl[0] == 10) lz10 = lz;
+        for (size_t chunk : {(size_t)1, (size_t)3, (size_t)1460, (size_t)8192}) {
+            const Unpacked r = unpack(lz, false, chunk);
+            CHECK(r.ok);
+            CHECK_EQ((int)r.kind, (int)TkwmOtaSink::K_LZ);
+            CHECK_EQ(r.out, (uint32_t)raw.size());
+            CHECK(flashIs(raw));
+        }
+    }
+
+    // ===== порча =====
+    const std::string gz = gzipOf(raw, 8);
+    {
+        const Unpacked r = unpack(corrupt(gz, gz.size() - 6), false, 1460); // CRC в трейлере
+        CHECK(!r.ok);
+        CHECK(r.err.indexOf("crc") >= 0);
+        CHECK(!dev.flash.committed);
+    }
+    CHECK(!unpack(corrupt(gz, gz.size() - 2), false, 1460).ok);              // длина в трейлере
+    CHECK(unpack(gz.substr(0, gz.size() - 4), false, 1460).err.indexOf("truncated") >= 0);
+    CHECK(unpack(gz.substr(0, gz.size() / 2), false, 1460).err.indexOf("truncated") >= 0);
+    {
+        std::string bad = gz;
+        for (size_t i = 100; i < 140; i++) bad[i] = (char)0xFF;               // битые данные deflate
+        CHECK(!unpack(bad, false, 1460).ok);
+    }
+    {
+        std::string m = gz;
+        m[2] = 7;                                                             // метод не deflate
+        CHECK(unpack(m, false, 1460).err.indexOf("not deflate") >= 0);
+    }
+    CHECK(unpack(raw, true, 1460).err.indexOf("Content-Encoding") >= 0);      // gzip по заголовку, а данные нет
+    CHECK(!unpack(corrupt(lz10, 12), false, 1460).ok);                         // CRC в заголовке TKLZ
+    CHECK(!unpack(corrupt(lz10, lz10.size() / 2), false, 1460).ok);            // битый поток
+    CHECK(unpack(lz10.substr(0, lz10.size() / 2), false, 1460).err.indexOf("expected") >= 0);
+    {
+        std::string h = lz10;
+        h[4] = 15;                                                            // окно больше 2^14
+        CHECK(unpack(h, false, 1460).err.indexOf("bad header") >= 0);
+        h[4] = 10;
+        h[5] = 10;                                                            // L >= W
+        CHECK(unpack(h, false, 1460).err.indexOf("bad header") >= 0);
+    }
+    {
+        std::string notApp = raw;
+        notApp[0] = 0x00;                                                     // и не сжатый, и не образ приложения
+        CHECK(!unpack(notApp, false, 1460).ok);
+    }
+    CHECK(unpack(raw, false, 1460).ok);                                       // после отказов Update снова принимает
+    CHECK(flashIs(raw));
+
+    // ===== замер: куча и скорость =====
+    bench("raw", raw, raw.size(), false);
+    bench("gzip9", gz, raw.size(), true);
+    for (const auto& wl : lzWl) {
+        char name[32];
+        snprintf(name, sizeof(name), "lz_w%d_l%d", wl[0], wl[1]);
+        bench(name, lzOf(raw, wl[0], wl[1]), raw.size(), false);
+    }
+
+    // RAM приёмника: gzip — tinfl_decompressor и словарь 32 КБ (README: +43 КБ), TKLZ — окно 2^W, raw — ничего.
+    CHECK_LE(unpack(raw, false, 4096).peak, (size_t)512);
+    CHECK_LE(unpack(gz, true, 4096).peak, sizeof(tinfl_decompressor) + TINFL_LZ_DICT_SIZE + 512);
+    CHECK_LE(unpack(lz10, false, 4096).peak, (size_t)(1 << 10) + 512);
+    CHECK(gz.size() < raw.size() && lz10.size() < raw.size());
+    return report("test_ota_unpack");
+}
@@ -0,0 +1,39 @@
+// Дымовой тест хост-сборки: пустое устройство уходит в точку настройки, сохранение сети через
+// /api/wifi/save подключает STA, страницы и JSON отдаются, сеть переживает перезагрузку (NVS).
+#include "host_test.h"
+
+int main() {
+    using namespace tkwmHost;
+    const int home = addAp(hostAp("home", "secret12"));
+    (void)home;
+
+    Device dev(1);
+    use(dev);
+    {
+        TKWifiManager mgr;
+        CHECK(mgr.begin());
+        CHECK(mgr.inCaptive());
+        CHECK(dev.softAp());
+
+        Response r = request(mgr.web(), rawRequest("GET", "/wifi"), tickOf(mgr));
+        CHECK_EQ(r.code, 200);
+        CHECK(r.body.size() > 100);
+
+        r = request(mgr.web(), rawRequest("POST", "/api/wifi/save", "{\"ssid\":\"home\",\"password\":\"secret12\"}", "",
+                                          "application/json"), tickOf(mgr));
+        CHECK_EQ(r.code, 200);
+        CHECK(runUntil(mgr, [&] { return dev.staConnected(); }, 30000));
+
+        r = request(mgr.web(), rawRequest("GET", "/api/wifi/saved"), tickOf(mgr));
+        CHECK_EQ(r.code, 200);
+        CHECK(r.body.find("\"home\"") != std::string::npos);
+    }
+
+    // «перезагрузка»: новый менеджер на тех же NVS и FS
+    {
+        TKWifiManager mgr;
+        CHECK(mgr.begin());
+        CHECK(runUntil(mgr, [&] { return dev.staConnected() && !mgr.inCaptive(); }, 30000));
+    }
+    return report("smoke");
+}
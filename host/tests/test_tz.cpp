@@ -0,0 +1,182 @@
+// user-025: таблица часовых поясов TKWifiManager_tz.inc против системной tzdata. Для каждой зоны смещение
+// по POSIX-правилу из таблицы (TZ=<правило>) сверяется со смещением по файлу зоны (TZ=:<имя>) каждые 6 часов
+// 2026–2035 годов и каждые 15 минут вокруг каждого перехода tzdata. Марокко (летнее время на Рамадан POSIX
+// не описывает) — только основное смещение. Затем путь устройства: timezone из /api/ota/save и ota.conf
+// после перезагрузки, фиксированное tz= для имени не из таблицы, /api/ota/timezones.
+#include "host_test.h"
+#include "TKWifiManager.cpp"
+#include <chrono>
+#include <sys/stat.h>
+
+namespace {
+
+const time_t kFrom = 1767225600; // 2026-01-01 00:00 UTC
+const time_t kTo   = 2082758400; // 2036-01-01 00:00 UTC
+const time_t kStep = 6 * 3600;
+
+const char* zoneName(int i) { return TKWM_TZ_NAMES + TKWM_TZ_NAME_OFF[i]; }
+
+bool isMorocco(const std::string& z) { return z == "Africa/Casablanca" || z == "Africa/El_Aaiun"; }
+
+void setTz(const std::string& tz) {
+    setenv("TZ", tz.c_str(), 1);
+    tzset();
+}
+
+std::vector<long> offsets(const std::vector<time_t>& at) {
+    std::vector<long> out(at.size());
+    for (size_t i = 0; i < at.size(); i++) {
+        struct tm lt;
+        localtime_r(&at[i], &lt);
+        out[i] = lt.tm_gmtoff;
+    }
+    return out;
+}
+
+std::string fmtUtc(time_t t) {
+    struct tm g;
+    gmtime_r(&t, &g);
+    char b[32];
+    strftime(b, sizeof(b), "%Y-%m-%d %H:%M", &g);
+    return b;
+}
+
+// Смещение зоны из tzdata сейчас, в минутах.
+int ianaNowMin(const char* zone) {
+    const char* saved = getenv("TZ");
+    const std::string keep = saved ? saved : "";
+    setTz(std::string(":") + zone);
+    const time_t t = time(nullptr);
+    struct tm    lt;
+    localtime_r(&t, &lt);
+    setTz(keep);
+    return (int)(lt.tm_gmtoff / 60);
+}
+
+tkwmHost::Response call(TKWifiManager& m, const char* method, const char* uri, const std::string& body = std::string()) {
+    return tkwmHost::request(m.web(), tkwmHost::rawRequest(method, uri, body, "", body.empty() ? nullptr : "application/json"), tickOf(m));
+}
+
+int jsonInt(const std::string& body, const std::string& key) {
+    const size_t p = body.find("\"" + key + "\":");
+    return p == std::string::npos ? -99999 : atoi(body.c_str() + p + key.size() + 3);
+}
+
+} // namespace
+
+int main() {
+    using namespace tkwmHost;
+    const char* zi = getenv("TZDIR") ? getenv("TZDIR") : "/usr/share/zoneinfo";
+
+    // ===== таблица: по возрастанию, каждое имя находится и есть в системной tzdata =====
+    int missing = 0;
+    for (int i = 0; i < TKWM_TZ_COUNT; i++) {
+        if (i) CHECK(strcmp(zoneName(i - 1), zoneName(i)) < 0);
+        CHECK(tkwmTzRule_(zoneName(i)) == TKWM_TZ_RULES + TKWM_TZ_RULE_OFF[TKWM_TZ_RULE_OF[i]]);
+        struct stat st;
+        if (stat((std::string(zi) + "/" + zoneName(i)).c_str(), &st) != 0) {
+            fprintf(stderr, "no tzdata file for %s\n", zoneName(i));
+            missing++;
+        }
+    }
+    CHECK_EQ(missing, 0);
+    CHECK(tkwmTzRule_("Europe/Berlin") && !strcmp(tkwmTzRule_("Europe/Berlin"), "CET-1CEST,M3.5.0,M10.5.0/3"));
+    CHECK(!tkwmTzRule_("Europe/Ber"));
+    CHECK(!tkwmTzRule_("Europe/Berlinx"));
+    CHECK(!tkwmTzRule_(""));
+    CHECK(!tkwmTzRule_("Mars/Olympus_Mons"));
+
+    // ===== смещения: правило таблицы против файла зоны =====
+    std::vector<time_t> coarse;
+    for (time_t t = kFrom; t < kTo; t += kStep) coarse.push_back(t);
+    uint64_t compared = 0;
+    int      badZones = 0, dstZones = 0, transitions = 0;
+    for (int z = 0; z < TKWM_TZ_COUNT; z++) {
+        const std::string name = zoneName(z);
+        const std::string rule = TKWM_TZ_RULES + TKWM_TZ_RULE_OFF[TKWM_TZ_RULE_OF[z]];
+        setTz(":" + name);
+        const std::vector<long> ic = offsets(coarse);
+        // окрестности переходов: шаг 15 минут внутри интервала, где смещение сменилось
+        std::vector<time_t> fine;
+        for (size_t i = 1; i < ic.size(); i++) {
+            if (ic[i] == ic[i - 1]) continue;
+            transitions++;
+            for (time_t t = coarse[i - 1]; t <= coarse[i]; t += 900) fine.push_back(t);
+        }
+        const std::vector<long> ifn = offsets(fine);
+        setTz(rule);
+        const std::vector<long> rc = offsets(coarse);
+        const std::vector<long> rf = offsets(fine);
+        if (rule.find(',') != std::string::npos) dstZones++;
+
+        size_t bad = 0, firstBad = SIZE_MAX;
+        for (size_t i = 0; i < ic.size(); i++)
+            if (ic[i] != rc[i] && bad++ == 0) firstBad = i;
+        size_t badFine = 0;
+        for (size_t i = 0; i < ifn.size(); i++) badFine += ifn[i] != rf[i];
+        compared += ic.size() + ifn.size();
+        if (isMorocco(name)) {
+            // вне Рамадана совпадает; сам Рамадан — около месяца в году
+            CHECK_LE(bad * 100, ic.size() * 15);
+            continue;
+        }
+        if (bad || badFine) {
+            badZones++;
+            fprintf(stderr, "%s (%s): %zu/%zu samples differ, first at %s UTC: tzdata %+ld s, rule %+ld s; near transitions %zu\n",
+                    name.c_str(), rule.c_str(), bad, ic.size(), firstBad == SIZE_MAX ? "-" : fmtUtc(coarse[firstBad]).c_str(),
+                    firstBad == SIZE_MAX ? 0L : ic[firstBad], firstBad == SIZE_MAX ? 0L : rc[firstBad], badFine);
+        }
+    }
+    CHECK_EQ(badZones, 0);
+    metric("tz_zones", TKWM_TZ_COUNT, "zones");
+    metric("tz_zones_with_dst", dstZones, "zones");
+    metric("tz_transitions_checked", transitions, "transitions");
+    metric("tz_samples_compared", (double)compared, "samples");
+    metric("tz_table_bytes", (double)(sizeof(TKWM_TZ_NAMES) + sizeof(TKWM_TZ_NAME_OFF) + sizeof(TKWM_TZ_RULE_OF) + sizeof(TKWM_TZ_RULES) + sizeof(TKWM_TZ_RULE_OFF)), "B");
+
+    // поиск: все имена таблицы подряд
+    const auto t0    = std::chrono::steady_clock::now();
+    size_t     found = 0;
+    for (int rep = 0; rep < 200; rep++)
+        for (int i = 0; i < TKWM_TZ_COUNT; i++) found += tkwmTzRule_(zoneName(i)) != nullptr;
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+    CHECK_EQ(found, (size_t)200 * TKWM_TZ_COUNT);
+    metric("tz_lookup", ns / found, "ns");
+
+    // ===== устройство: зона из /api/ota/save, из ota.conf после перезагрузки, фиксированное tz= =====
+    Device dev(1);
+    use(dev);
+    {
+        TKWifiManager mgr;
+        CHECK(mgr.begin());
+        CHECK_EQ(tkwmTzOffsetNowMin_(), 0); // без ota.conf — UTC
+        CHECK_EQ(call(mgr, "POST", "/api/ota/save", "{\"auto\":false,\"timezone\":\"Europe/Berlin\"}").code, 200);
+        CHECK_EQ((int)tkwmTzOffsetNowMin_(), ianaNowMin("Europe/Berlin"));
+        CHECK_EQ(jsonInt(call(mgr, "GET", "/api/ota/config").body, "tzOffsetMin"), ianaNowMin("Europe/Berlin"));
+
+        const Response tl = call(mgr, "GET", "/api/ota/timezones");
+        CHECK_EQ(tl.code, 200);
+        CHECK(tl.body.find("\"selected\":\"Europe/Berlin\"") != std::string::npos);
+        size_t pos = tl.body.find("\"timezones\":[");
+        int    listed = 0;
+        for (int i = 0; i < TKWM_TZ_COUNT && pos != std::string::npos; i++) {
+            pos = tl.body.find(std::string("\"") + zoneName(i) + "\"", pos);
+            listed += pos != std::string::npos;
+        }
+        CHECK_EQ(listed, TKWM_TZ_COUNT);
+        CHECK_EQ(call(mgr, "POST", "/api/ota/save", "{\"auto\":false,\"timezone\":\"America/New_York\"}").code, 200);
+    }
+    dev.reboot();
+    setTz("UTC0");
+    {
+        TKWifiManager mgr;
+        CHECK(mgr.begin());
+        CHECK_EQ((int)tkwmTzOffsetNowMin_(), ianaNowMin("America/New_York"));
+        // имени нет в таблице — действует фиксированное смещение
+        CHECK_EQ(call(mgr, "POST", "/api/ota/save", "{\"auto\":false,\"timezone\":\"Mars/Olympus_Mons\",\"tzOffsetMin\":\"+05:30\"}").code, 200);
+        CHECK_EQ((int)tkwmTzOffsetNowMin_(), 330);
+        CHECK_EQ(call(mgr, "POST", "/api/ota/save", "{\"auto\":false,\"timezone\":\"Mars/Olympus_Mons\",\"tzOffsetMin\":\"-03:45\"}").code, 200);
+        CHECK_EQ((int)tkwmTzOffsetNowMin_(), -225);
+    }
+    return report("test_tz");
+}
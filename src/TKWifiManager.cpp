@@ -4,87 +4,63 @@
 #include <WiFiClient.h>
 #include <WiFiClientSecure.h>
 #include <time.h>
+#include "esp_sntp.h"
 #include <cstdio>
 #include <cstring>
+#include <new>
+#if TKWM_LINK_PING
+#include "ping/ping_sock.h"
+#endif
+#if TKWM_OTA_GZIP
+#include "rom/miniz.h"
+#endif
+
+#if TKWM_METRICS
+/** Шаг serviceTick() с замером длительности в гистограмму стадии. */
+#define TKWM_STAGE(st, ...) do { const uint32_t t0_ = micros(); __VA_ARGS__; _mStage[st].add(micros() - t0_); } while (0)
+#define TKWM_METRIC(...) __VA_ARGS__
+#else
+#define TKWM_STAGE(st, ...) do { __VA_ARGS__; } while (0)
+#define TKWM_METRIC(...)
+#endif
 
-static const char* TKWM_TZ_CACHE_PATH = "/timezones.json";
 static const uint32_t TKWM_AUTO_TIME_SYNC_INTERVAL_MS = 24UL * 60UL * 60UL * 1000UL;
-static const uint32_t TKWM_SYNC_TIME_MANUAL_TIMEOUT_MS = 5000UL;
-static const char* TKWM_LOCAL_TZ_FALLBACK_JSON =
-    "[\"UTC\",\"Europe/Moscow\",\"Europe/Kaliningrad\",\"Europe/Samara\",\"Europe/Volgograd\","
-    "\"Europe/London\",\"Europe/Berlin\",\"Europe/Paris\",\"Europe/Madrid\",\"Europe/Rome\","
-    "\"Europe/Amsterdam\",\"Europe/Prague\",\"Europe/Warsaw\",\"Europe/Kyiv\",\"Europe/Istanbul\","
-    "\"Asia/Yekaterinburg\",\"Asia/Omsk\",\"Asia/Novosibirsk\",\"Asia/Krasnoyarsk\",\"Asia/Irkutsk\","
-    "\"Asia/Yakutsk\",\"Asia/Vladivostok\",\"Asia/Magadan\",\"Asia/Kamchatka\",\"Asia/Sakhalin\","
-    "\"Asia/Almaty\",\"Asia/Bishkek\",\"Asia/Tashkent\",\"Asia/Dushanbe\",\"Asia/Ashgabat\","
-    "\"Asia/Baku\",\"Asia/Tbilisi\",\"Asia/Yerevan\",\"Asia/Tehran\",\"Asia/Dubai\","
-    "\"Asia/Karachi\",\"Asia/Kolkata\",\"Asia/Kathmandu\",\"Asia/Dhaka\",\"Asia/Bangkok\","
-    "\"Asia/Jakarta\",\"Asia/Singapore\",\"Asia/Shanghai\",\"Asia/Hong_Kong\",\"Asia/Tokyo\","
-    "\"Asia/Seoul\",\"Asia/Manila\",\"Asia/Taipei\",\"Asia/Kuala_Lumpur\",\"Asia/Ho_Chi_Minh\","
-    "\"Australia/Perth\",\"Australia/Adelaide\",\"Australia/Darwin\",\"Australia/Brisbane\","
-    "\"Australia/Sydney\",\"Australia/Melbourne\",\"Pacific/Auckland\",\"Pacific/Fiji\","
-    "\"Pacific/Honolulu\",\"Pacific/Guam\",\"America/Anchorage\",\"America/Los_Angeles\","
-    "\"America/Denver\",\"America/Phoenix\",\"America/Chicago\",\"America/New_York\","
-    "\"America/Toronto\",\"America/Halifax\",\"America/St_Johns\",\"America/Mexico_City\","
-    "\"America/Bogota\",\"America/Lima\",\"America/Santiago\",\"America/La_Paz\","
-    "\"America/Caracas\",\"America/Sao_Paulo\",\"America/Montevideo\",\"America/Buenos_Aires\","
-    "\"America/Godthab\",\"Africa/Cairo\",\"Africa/Johannesburg\",\"Africa/Nairobi\","
-    "\"Africa/Lagos\",\"Africa/Casablanca\",\"Africa/Algiers\"]";
-
-static bool tkwmLookupFixedTzOffsetMin_(String tz, int16_t& outMin) {
-    tz.trim();
-    if (!tz.length()) tz = "UTC";
-    if (tz == "UTC" || tz == "Etc/UTC" || tz == "GMT") { outMin = 0; return true; }
-    if (tz == "Europe/Moscow") { outMin = 180; return true; }
-    if (tz == "Europe/Kaliningrad") { outMin = 120; return true; }
-    if (tz == "Europe/Samara") { outMin = 240; return true; }
-    if (tz == "Europe/Volgograd") { outMin = 180; return true; }
-    if (tz == "Europe/London") { outMin = 0; return true; }
-    if (tz == "Europe/Berlin" || tz == "Europe/Paris" || tz == "Europe/Madrid" || tz == "Europe/Rome" || tz == "Europe/Amsterdam" || tz == "Europe/Prague" || tz == "Europe/Warsaw") { outMin = 60; return true; }
-    if (tz == "Europe/Kyiv" || tz == "Europe/Istanbul") { outMin = 180; return true; }
-    if (tz == "Asia/Yekaterinburg") { outMin = 300; return true; }
-    if (tz == "Asia/Omsk") { outMin = 360; return true; }
-    if (tz == "Asia/Novosibirsk" || tz == "Asia/Krasnoyarsk" || tz == "Asia/Bangkok" || tz == "Asia/Jakarta" || tz == "Asia/Ho_Chi_Minh") { outMin = 420; return true; }
-    if (tz == "Asia/Irkutsk" || tz == "Asia/Singapore" || tz == "Asia/Shanghai" || tz == "Asia/Hong_Kong" || tz == "Asia/Manila" || tz == "Asia/Taipei" || tz == "Asia/Kuala_Lumpur") { outMin = 480; return true; }
-    if (tz == "Asia/Yakutsk" || tz == "Asia/Tokyo" || tz == "Asia/Seoul") { outMin = 540; return true; }
-    if (tz == "Asia/Vladivostok") { outMin = 600; return true; }
-    if (tz == "Asia/Magadan") { outMin = 660; return true; }
-    if (tz == "Asia/Kamchatka") { outMin = 720; return true; }
-    if (tz == "Asia/Sakhalin") { outMin = 660; return true; }
-    if (tz == "Asia/Almaty" || tz == "Asia/Bishkek" || tz == "Asia/Dushanbe" || tz == "Asia/Tashkent" || tz == "Asia/Karachi") { outMin = 300; return true; }
-    if (tz == "Asia/Ashgabat" || tz == "Asia/Dubai" || tz == "Asia/Baku") { outMin = 240; return true; }
-    if (tz == "Asia/Tbilisi" || tz == "Asia/Yerevan" || tz == "Asia/Tehran") { outMin = 210; return true; }
-    if (tz == "Asia/Kolkata") { outMin = 330; return true; }
-    if (tz == "Asia/Kathmandu") { outMin = 345; return true; }
-    if (tz == "Asia/Dhaka") { outMin = 360; return true; }
-    if (tz == "Australia/Perth") { outMin = 480; return true; }
-    if (tz == "Australia/Adelaide" || tz == "Australia/Darwin") { outMin = 570; return true; }
-    if (tz == "Australia/Brisbane" || tz == "Australia/Sydney" || tz == "Australia/Melbourne" || tz == "Pacific/Guam") { outMin = 600; return true; }
-    if (tz == "Pacific/Auckland" || tz == "Pacific/Fiji") { outMin = 720; return true; }
-    if (tz == "Pacific/Honolulu") { outMin = -600; return true; }
-    if (tz == "America/Anchorage") { outMin = -540; return true; }
-    if (tz == "America/Los_Angeles") { outMin = -480; return true; }
-    if (tz == "America/Denver" || tz == "America/Phoenix") { outMin = -420; return true; }
-    if (tz == "America/Chicago" || tz == "America/Mexico_City") { outMin = -360; return true; }
-    if (tz == "America/New_York" || tz == "America/Toronto" || tz == "America/Bogota" || tz == "America/Lima") { outMin = -300; return true; }
-    if (tz == "America/Halifax" || tz == "America/La_Paz" || tz == "America/Caracas" || tz == "America/Santiago") { outMin = -240; return true; }
-    if (tz == "America/St_Johns") { outMin = -210; return true; }
-    if (tz == "America/Sao_Paulo" || tz == "America/Montevideo" || tz == "America/Buenos_Aires" || tz == "America/Godthab") { outMin = -180; return true; }
-    if (tz == "Africa/Cairo") { outMin = 120; return true; }
-    if (tz == "Africa/Johannesburg") { outMin = 120; return true; }
-    if (tz == "Africa/Nairobi") { outMin = 180; return true; }
-    if (tz == "Africa/Lagos" || tz == "Africa/Casablanca" || tz == "Africa/Algiers") { outMin = 60; return true; }
-
-    // Etc/GMT+3 means UTC-3 in IANA notation.
-    if (tz.startsWith("Etc/GMT") && tz.length() > 7) {
-        String tail = tz.substring(7);
-        int sign = 1;
-        if (tail.startsWith("+")) { sign = -1; tail.remove(0, 1); }
-        else if (tail.startsWith("-")) { sign = 1; tail.remove(0, 1); }
-        int h = tail.toInt();
-        if (h >= 0 && h <= 14) { outMin = (int16_t)(sign * h * 60); return true; }
+
+// ===================== ЧАСОВЫЕ ПОЯСА =====================
+// IANA-имя → POSIX TZ из системной tzdata, с правилами летнего времени. После обновления tzdata:
+// py src/_gen_tz_inc.py → TKWifiManager_tz.inc (имена по возрастанию + общие правила, PROGMEM).
+#include "TKWifiManager_tz.inc"
+
+/** POSIX TZ для IANA-имени — двоичный поиск по таблице (на ESP32 PROGMEM читается напрямую); nullptr — нет. */
+static const char* tkwmTzRule_(const char* name) {
+    int lo = 0, hi = TKWM_TZ_COUNT - 1;
+    while (lo <= hi) {
+        const int mid = (lo + hi) / 2;
+        const int c   = strcmp(name, TKWM_TZ_NAMES + TKWM_TZ_NAME_OFF[mid]);
+        if (!c) return TKWM_TZ_RULES + TKWM_TZ_RULE_OFF[TKWM_TZ_RULE_OF[mid]];
+        if (c < 0) hi = mid - 1;
+        else lo = mid + 1;
     }
-    return false;
+    return nullptr;
+}
+
+/** Фиксированное смещение (tz= в ota.conf) как POSIX TZ: +05:30 → "<+0530>-5:30" (в POSIX знак обратный). */
+static String tkwmTzFixedRule_(int16_t offMin) {
+    const int a = offMin < 0 ? -offMin : offMin;
+    char      buf[24];
+    snprintf(buf, sizeof(buf), "<%c%02d%02d>%c%d:%02d", offMin < 0 ? '-' : '+', a / 60, a % 60, offMin < 0 ? '+' : '-', a / 60, a % 60);
+    return String(buf);
+}
+
+/** Текущее смещение местного времени от UTC в минутах — по применённому TZ, с учётом летнего времени. */
+static int16_t tkwmTzOffsetNowMin_() {
+    const time_t t = time(nullptr);
+    struct tm    lt, gt;
+    localtime_r(&t, &lt);
+    gmtime_r(&t, &gt);
+    int d = lt.tm_yday - gt.tm_yday;
+    if (lt.tm_year != gt.tm_year) d = lt.tm_year > gt.tm_year ? 1 : -1;
+    return (int16_t)(d * 1440 + (lt.tm_hour - gt.tm_hour) * 60 + lt.tm_min - gt.tm_min);
 }
 
 // Токен порта встроен в JS как число, чтобы встроенные HTML совпадали с макросом TKWM_WS_PORT
@@ -95,334 +71,164 @@ static bool tkwmLookupFixedTzOffsetMin_(String tz, int16_t& outMin) {
 
 // forward declaration (определение — ниже, перед wsRunScanAndPublish)
 static void ensureWifiForScan_();
-static String tkwmWebServerPostBody_(WebServer& s);
+static String tkwmWebServerPostBody_(TkwmWebServer& s);
 
 // ===================== ВСТРОЕННЫЕ СТРАНИЦЫ =====================
-static const char WIFI_HTML[] PROGMEM = R"HTML(<!doctype html>
-<html lang="ru"><head><meta charset="utf-8">
-<meta name="viewport" content="width=device-width,initial-scale=1">
-<title>Wi-Fi настройка</title>
-<script>(function(){try{var t=localStorage.getItem('tkwm-theme');if(t&&t!=='system')document.documentElement.dataset.theme=t;}catch(_){}})()</script>
-<style>
-:root{--bg:#0b1220;--card:#0d1728;--surface:#0f1a2c;--ink:#e8eef7;--mut:#9fb3d1;--br:#1b2a44;--btn:#143057;--link:#9fd0ff;--ok:#95ffa1;--err:#ff9a9a}
-:root[data-theme="light"]{--bg:#f0f4f8;--card:#fff;--surface:#e4eaf2;--ink:#1a2236;--mut:#5a7090;--br:#c5d0e0;--btn:#2563eb;--link:#1d4ed8;--ok:#16a34a;--err:#dc2626}
-@media(prefers-color-scheme:light){:root:not([data-theme]){--bg:#f0f4f8;--card:#fff;--surface:#e4eaf2;--ink:#1a2236;--mut:#5a7090;--br:#c5d0e0;--btn:#2563eb;--link:#1d4ed8;--ok:#16a34a;--err:#dc2626}}
-body{margin:0;background:var(--bg);color:var(--ink);font:15px system-ui,-apple-system,Segoe UI,Roboto}
-.wrap{max-width:860px;margin:auto;padding:20px}
-.card{background:var(--card);border:1px solid var(--br);border-radius:14px;padding:16px}
-h1{font-size:18px;margin:0 0 12px}
-h2{font-size:16px;margin:14px 0 8px}
-.row{display:flex;gap:12px;flex-wrap:wrap;align-items:center}
-input,button{padding:10px 12px;border-radius:10px;border:1px solid var(--br);background:var(--surface);color:var(--ink)}
-button{background:var(--btn);cursor:pointer}
-a{color:var(--link);text-decoration:none}
-.list{margin-top:12px}
-.net{display:flex;justify-content:space-between;align-items:center;padding:10px;border:1px solid var(--br);border-radius:10px;margin:8px 0;background:var(--surface);cursor:pointer}
-.net small{color:var(--mut)}
-.badge{color:var(--mut);font-size:12px}
-.ok{color:var(--ok)}.err{color:var(--err)}.mut{color:var(--mut)}
-</style><link rel="stylesheet" href="/theme.css"><script src="/theme.js"></script></head><body><div class="wrap"><div class="card">
-<h1>Настройка Wi-Fi</h1>
-
-<div class="row">
-  <button id="scan">🔄 Обновить список</button>
-  <button id="ap">📶 Перейти в AP-режим</button>
-  <span id="st" class="mut">WS…</span>
-</div>
-
-<h2>Доступные сети</h2>
-<div id="list" class="list"></div>
-
-<hr style="border:0;border-top:1px solid var(--br);margin:14px 0">
-
-<h2>Подключиться вручную</h2>
-<form id="f" class="row">
-  <input id="ssid" placeholder="SSID" required style="flex:1;min-width:180px">
-  <input id="pass" placeholder="Пароль" type="password" style="flex:1;min-width:180px">
-  <button type="submit">💾 Сохранить</button>
-</form>
-<div id="msg" class="mut" style="margin-top:8px"></div>
-
-<hr style="border:0;border-top:1px solid var(--br);margin:14px 0">
-
-<h2>Сохранённые сети</h2>
-<div id="saved" class="list"></div>
-
-<div class="row" style="margin-top:10px">
-  <a class="mut" href="/">Главная</a>
-  <a class="mut" href="/fs">Файлы</a>
-  <a class="mut" href="/ota">OTA</a>
-</div>
-</div></div>
-
-<script>
-const $=s=>document.querySelector(s);
-const list=$("#list"), st=$("#st"), ssid=$("#ssid"), pass=$("#pass"), msg=$("#msg"),
-      scanB=$("#scan"), saved=$("#saved"), apBtn=$("#ap");
-let ws;
-
-function connectWS(){
-  ws = new WebSocket('ws://'+location.hostname+':'+)HTML" TKWM_XSTR(TKWM_WS_PORT) R"HTML(+'/');
-  ws.onopen = ()=>{ st.textContent='WS ok'; ws.send('status'); ws.send('scan'); loadSaved(); };
-  ws.onclose = ()=>{ st.textContent='WS close'; setTimeout(connectWS,800); };
-  ws.onmessage = e=>{
-    let j; try{ j=JSON.parse(e.data);}catch(_){return;}
-    if (j.type==='status'){
-      st.innerHTML = (j.mode==='AP'?'AP (каптив)':'STA') + ' • IP: <b>'+ (j.ip||'-') + '</b>';
-    } else if (j.type==='scan'){
-      renderScan(j.nets||[]);
-    }
-  };
-}
-function esc(s){return String(s).replace(/[&<>"'`=\/]/g,m=>({"&":"&amp;","<":"&lt;",">":"&gt;","\"":"&quot;","'":"&#39;","`":"&#x60;","=":"&#x3D;","/":"&#x2F;"}[m]))}
-
-function renderScan(nets){
-  nets.sort((a,b)=>b.rssi-a.rssi);
-  list.innerHTML='';
-  if(!nets.length){ list.innerHTML='<i class="mut">ничего не найдено</i>'; return; }
-  nets.forEach(n=>{
-    const el=document.createElement('div'); el.className='net';
-    const enc=(n.enc===0)?'open':'🔒';
-    el.innerHTML=`<div><b>${esc(n.ssid||'(скрытая)')}</b><br><small>${enc}, ch ${n.ch}</small></div><small>${n.rssi} dBm</small>`;
-    el.onclick=()=>{ if(n.ssid){ ssid.value=n.ssid; pass.focus(); } else ssid.focus(); };
-    list.appendChild(el);
-  });
-}
-
-async function loadSaved(){
-  try{
-    const r = await fetch('/api/wifi/saved');
-    const j = await r.json();
-    saved.innerHTML = '';
-    (j.nets||[]).forEach(s=>{
-      const row=document.createElement('div'); row.className='net'; row.style.cursor='default';
-      row.innerHTML = `<div><b>${esc(s)}</b><br><small class="mut">сохранено</small></div>
-                       <button data-del style="cursor:pointer">🗑️</button>`;
-      row.querySelector('[data-del]').onclick = async ()=>{
-        if(!confirm('Удалить «'+s+'» ?')) return;
-        const r = await fetch('/api/wifi/delete', { method:'POST', headers:{'Content-Type':'application/x-www-form-urlencoded'}, body:'ssid='+encodeURIComponent(s) });
-        const jj = await r.json();
-        if (jj.ok) loadSaved();
-      };
-      saved.appendChild(row);
-    });
-    if(!(j.nets||[]).length){
-      saved.innerHTML = '<i class="mut">нет сохранённых сетей</i>';
-    }
-  } catch(_){
-    saved.innerHTML = '<span class="err">ошибка загрузки списка</span>';
-  }
-}
-
-scanB.onclick = ()=>{ if(ws && ws.readyState===1) ws.send('scan'); };
-apBtn.onclick  = async ()=>{
-  apBtn.disabled = true;
-  try{
-    const r = await fetch('/api/start_ap', {method:'POST'});
-    const j = await r.json();
-    if (j.ok && ws && ws.readyState===1) ws.send('status');
-  }catch(_){}
-  apBtn.disabled = false;
+// Исходники: src/embed/*.html, src/ota.html, src/theme.css, src/theme.js. После правки:
+// py src/_gen_assets_inc.py → TKWifiManager_assets.inc (gzip-массивы PROGMEM + ETag по содержимому).
+struct TkwmAsset {
+    const char*    path;
+    const char*    mime;
+    const uint8_t* gz;
+    uint32_t       gzLen;
+    uint32_t       rawLen;
+    const char*    etag;  // строгий, в кавычках
+};
+#include "TKWifiManager_assets.inc"
+
+static const TkwmAsset* tkwmFindAsset_(const char* path) {
+    for (const TkwmAsset& a : TKWM_ASSETS)
+        if (strcmp(a.path, path) == 0) return &a;
+    return nullptr;
+}
+
+/** If-None-Match: "*" или список тегов (в т.ч. W/"..." — для GET сравнение слабое). */
+static bool tkwmEtagMatches_(String inm, const char* etag) {
+    inm.trim();
+    if (!inm.length()) return false;
+    if (inm == "*") return true;
+    return inm.indexOf(etag) >= 0;
+}
+
+// ===================== Потоковый JSON-писатель =====================
+// Ответ собирается в буфере TKWM_JSON_CHUNK байт на стеке и уходит chunked-кусками через
+// WebServer::sendContent — без роста String и без построения всего ответа в RAM.
+// Второй режим (String&) — для WS-сообщений, которые нужно отправить одним кадром.
+class TkwmJson {
+public:
+    explicit TkwmJson(TkwmWebServer& srv) : _srv(&srv) {}
+    explicit TkwmJson(String& out) : _out(&out) {}
+    ~TkwmJson() { flush(); }
+    TkwmJson(const TkwmJson&) = delete;
+    TkwmJson& operator=(const TkwmJson&) = delete;
+
+    /** Заголовки ответа без Content-Length → Transfer-Encoding: chunked. */
+    void begin(int code = 200) {
+        _srv->setContentLength(CONTENT_LENGTH_UNKNOWN);
+        _srv->send(code, "application/json", "");
+    }
+    /** Остаток буфера + завершающий пустой chunk. */
+    void end() {
+        flush();
+        if (_srv) _srv->sendContent("");
+    }
+
+    TkwmJson& objOpen()  { sep(); put('{'); push(); return *this; }
+    TkwmJson& objClose() { _depth--; put('}'); return *this; }
+    TkwmJson& arrOpen()  { sep(); put('['); push(); return *this; }
+    TkwmJson& arrClose() { _depth--; put(']'); return *this; }
+    TkwmJson& key(const char* k) {
+        sep();
+        put('"');
+        while (*k) put(*k++);
+        put('"');
+        put(':');
+        _afterKey = true;
+        return *this;
+    }
+
+    TkwmJson& str(const char* p, size_t n) { strOpen(); strPart(p, n); return strClose(); }
+    TkwmJson& str(const char* p) { return str(p, strlen(p)); }
+    TkwmJson& str(const String& v) { return str(v.c_str(), v.length()); }
+    /** Строковое значение по частям (например, содержимое файла). */
+    TkwmJson& strOpen() { sep(); put('"'); return *this; }
+    TkwmJson& strClose() { put('"'); return *this; }
+    TkwmJson& strPart(const char* p, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            const char c = p[i];
+            switch (c) {
+            case '"':  put('\\'); put('"');  break;
+            case '\\': put('\\'); put('\\'); break;
+            case '\b': put('\\'); put('b');  break;
+            case '\f': put('\\'); put('f');  break;
+            case '\n': put('\\'); put('n');  break;
+            case '\r': put('\\'); put('r');  break;
+            case '\t': put('\\'); put('t');  break;
+            default:
+                // JSON требует экранировать все управляющие < 0x20
+                if ((uint8_t)c < 0x20) {
+                    static const char hex[] = "0123456789ABCDEF";
+                    put('\\'); put('u'); put('0'); put('0');
+                    put(hex[(uint8_t)c >> 4]);
+                    put(hex[c & 0xF]);
+                } else {
+                    put(c);
+                }
+            }
+        }
+        return *this;
+    }
+    TkwmJson& num(long v) {
+        char b[24];
+        int  n = snprintf(b, sizeof(b), "%ld", v);
+        return raw(b, (size_t)n);
+    }
+    TkwmJson& unum(unsigned long v) {
+        char b[24];
+        int  n = snprintf(b, sizeof(b), "%lu", v);
+        return raw(b, (size_t)n);
+    }
+    TkwmJson& boolean(bool v) { return v ? raw("true", 4) : raw("false", 5); }
+    /** Уже сериализованный JSON (массив/объект/число) как значение. */
+    TkwmJson& raw(const char* p, size_t n) {
+        sep();
+        for (size_t i = 0; i < n; ++i) put(p[i]);
+        return *this;
+    }
+    TkwmJson& raw(const String& v) { return raw(v.c_str(), v.length()); }
+
+    TkwmJson& kv(const char* k, const String& v) { return key(k).str(v); }
+    TkwmJson& kv(const char* k, const char* v)   { return key(k).str(v); }
+    TkwmJson& kvi(const char* k, long v)         { return key(k).num(v); }
+    TkwmJson& kvu(const char* k, unsigned long v) { return key(k).unum(v); }
+    TkwmJson& kvb(const char* k, bool v)         { return key(k).boolean(v); }
+
+private:
+    void put(char c) {
+        if (_n == sizeof(_buf)) flush();
+        _buf[_n++] = c;
+    }
+    void flush() {
+        if (!_n) return;
+        if (_srv) _srv->sendContent(_buf, _n);
+        else _out->concat(_buf, _n);
+        _n = 0;
+    }
+    // Запятая перед вторым и следующими элементами; после ключа — значение без запятой.
+    void sep() {
+        if (_afterKey) {
+            _afterKey = false;
+            return;
+        }
+        const uint32_t bit = 1UL << (_depth & 31);
+        if (_used & bit) put(',');
+        _used |= bit;
+    }
+    void push() {
+        _depth++;
+        _used &= ~(1UL << (_depth & 31));
+    }
+
+    TkwmWebServer* _srv = nullptr;
+    String*        _out = nullptr;
+    char           _buf[TKWM_JSON_CHUNK];
+    size_t         _n = 0;
+    uint32_t       _used = 0;  // бит на уровень вложенности: уже был элемент
+    uint8_t        _depth = 0;
+    bool           _afterKey = false;
 };
 
-document.getElementById('f').addEventListener('submit', async ev=>{
-  ev.preventDefault(); msg.textContent='Сохраняю и подключаюсь...';
-  const body = JSON.stringify({ssid:ssid.value.trim(), password:pass.value});
-  try{
-    const r = await fetch('/api/wifi/save', {method:'POST', headers:{'Content-Type':'application/json'}, body});
-    const j = await r.json();
-    if(!j.ok){ msg.innerHTML='<span class="err">'+(j.msg||'Ошибка')+'</span>'; return; }
-    if(j.connected){ msg.innerHTML='<span class="ok">Подключено! IP: <b>'+ (j.ip||'-') +'</b></span>'; }
-    else{ msg.innerHTML='<span class="err">Не удалось подключиться. Проверьте пароль.</span>'; }
-    loadSaved();
-    if(ws && ws.readyState===1){ ws.send('status'); ws.send('scan'); }
-  }catch(_){ msg.innerHTML='<span class="err">Ошибка запроса</span>'; }
-});
-
-connectWS();
-</script></body></html>)HTML";
-
-static const char FS_HTML[] PROGMEM = R"HTML(<!doctype html>
-<html lang="ru"><head><meta charset="utf-8">
-<meta name="viewport" content="width=device-width,initial-scale=1">
-<title>Файлы</title>
-<script>(function(){try{var t=localStorage.getItem('tkwm-theme');if(t&&t!=='system')document.documentElement.dataset.theme=t;}catch(_){}})()</script>
-<style>
-:root{--bg:#0b1220;--card:#0d1728;--surface:#0f1a2c;--ink:#e8eef7;--mut:#9fb3d1;--br:#1b2a44;--btn:#143057;--link:#9fd0ff;--ok:#95ffa1;--err:#ff9a9a}
-:root[data-theme="light"]{--bg:#f0f4f8;--card:#fff;--surface:#e4eaf2;--ink:#1a2236;--mut:#5a7090;--br:#c5d0e0;--btn:#2563eb;--link:#1d4ed8;--ok:#16a34a;--err:#dc2626}
-@media(prefers-color-scheme:light){:root:not([data-theme]){--bg:#f0f4f8;--card:#fff;--surface:#e4eaf2;--ink:#1a2236;--mut:#5a7090;--br:#c5d0e0;--btn:#2563eb;--link:#1d4ed8;--ok:#16a34a;--err:#dc2626}}
-*{box-sizing:border-box}body{margin:0;background:var(--bg);color:var(--ink);font:14px system-ui,-apple-system,Segoe UI,Roboto}
-.wrap{display:grid;grid-template-columns:340px 1fr;min-height:100vh}
-.side{border-right:1px solid var(--br);padding:14px}.main{padding:14px}
-h1{font-size:18px;margin:0 0 10px}
-input,button{padding:8px 10px;border-radius:10px;border:1px solid var(--br);background:var(--surface);color:var(--ink)}
-button{background:var(--btn);cursor:pointer}
-a{color:var(--link);text-decoration:none}
-.list{margin-top:10px;display:flex;flex-direction:column;gap:6px}
-.item{display:flex;gap:8px;align-items:center;justify-content:space-between;border:1px solid var(--br);border-radius:10px;padding:8px;background:var(--surface)}
-.item .path{white-space:nowrap;overflow:hidden;text-overflow:ellipsis;max-width:190px}
-.badge{color:var(--mut);font-size:12px}.row{display:flex;gap:8px;flex-wrap:wrap;align-items:center}
-.tools{display:flex;gap:8px;align-items:center;margin:8px 0}
-#editor{position:relative;height:64vh;width:100%;border:1px solid var(--br);border-radius:12px}
-.mut{color:var(--mut)}hr{border:0;border-top:1px solid var(--br);margin:12px 0}
-.drop{border:2px dashed var(--br);border-radius:12px;padding:16px;text-align:center;margin-top:8px}
-.drop.drag{background:var(--surface)}
-@media (max-width:900px){.wrap{grid-template-columns:1fr}.side{border-right:0;border-bottom:1px solid var(--br)}}
-</style><link rel="stylesheet" href="/theme.css"><script src="/theme.js"></script></head><body>
-<div class="wrap">
-  <div class="side">
-    <h1>Файлы</h1>
-    <div class="tools">
-      <button id="refresh">🔄 Обновить</button>
-      <a class="mut" href="/wifi">Wi-Fi</a>
-      <a class="mut" href="/ota">OTA</a>
-      <a class="mut" href="/">Главная</a>
-    </div>
-    <div class="row">
-      <input id="newPath" placeholder="/новый_файл.txt" style="flex:1;min-width:180px">
-      <button id="create">➕ Создать</button>
-    </div>
-    <div class="drop" id="drop">Перетащите файлы сюда или открой<input id="up" type="file" multiple></div>
-    <div class="list" id="list"></div>
-  </div>
-  <div class="main">
-    <div class="row">
-      <div>Открыт: <b id="curPath">—</b></div>
-      <div class="badge" id="curInfo"></div>
-      <span style="flex:1"></span>
-      <button id="save" disabled>💾 Сохранить</button>
-      <a id="download" class="mut" href="#" download>⬇️ Скачать</a>
-    </div>
-    <div id="editor"></div>
-    <div class="mut" style="margin-top:6px">Подсветка Ace (CDN). Для бинарных/больших файлов редактирование отключено.</div>
-  </div>
-</div>
-<script src="https://cdn.jsdelivr.net/npm/ace-builds@1.32.9/src-min/ace.js"></script>
-<script>
-const $=s=>document.querySelector(s); const listEl=$("#list"), drop=$("#drop"), up=$("#up"),
-      refreshBtn=$("#refresh"), createBtn=$("#create"), newPath=$("#newPath"),
-      curPathEl=$("#curPath"), curInfoEl=$("#curInfo"), saveBtn=$("#save"), downloadA=$("#download");
-let editor=null, currentPath="", currentBinary=false;
-function aceReady(){return window.ace&&ace.edit}
-function initEditor(){ if(!aceReady())return; editor=ace.edit("editor"); editor.session.setUseWorker(false); editor.setOption("wrap",true); editor.setTheme("ace/theme/one_dark"); editor.session.setMode("ace/mode/text"); editor.on('change',()=>{ if(currentPath && !currentBinary) saveBtn.disabled=false; }); }
-function modeByExt(p){ p=(p||"").toLowerCase();
- if(p.endsWith(".html")||p.endsWith(".htm"))return"ace/mode/html";
- if(p.endsWith(".css"))return"ace/mode/css";
- if(p.endsWith(".js")||p.endsWith(".mjs"))return"ace/mode/javascript";
- if(p.endsWith(".json"))return"ace/mode/json";
- if(p.endsWith(".md"))return"ace/mode/markdown";
- if(p.endsWith(".ini")||p.endsWith(".conf"))return"ace/mode/ini";
- if(p.endsWith(".svg")||p.endsWith(".xml"))return"ace/mode/xml";
- if(p.endsWith(".yaml")||p.endsWith(".yml"))return"ace/mode/yaml";
- if(p.endsWith(".c")||p.endsWith(".h")||p.endsWith(".cpp")||p.endsWith(".hpp")||p.endsWith(".ino"))return"ace/mode/c_cpp";
- return"ace/mode/text";
-}
-async function api(p,o){const r=await fetch(p,o);return r.json();}
-function fmtSize(b){return b>1048576?(b/1048576).toFixed(2)+" MB":b>1024?(b/1024).toFixed(1)+" KB":b+" B";}
-async function refreshList(){
-  listEl.innerHTML=""; const j=await api("/api/fs/list");
-  (j.files||[]).sort((a,b)=>a.path.localeCompare(b.path)).forEach(f=>{
-    const row=document.createElement("div"); row.className="item";
-    row.innerHTML=`<div class="path" title="${f.path}">${f.path}</div>
-      <div class="row"><span class="badge">${fmtSize(f.size)}</span>
-      <button data-open>✏️</button><a class="mut" href="${encodeURI(f.path)}" download>⬇️</a>
-      <button data-del>🗑️</button></div>`;
-    row.querySelector("[data-open]").onclick=()=>openFile(f.path,f.size);
-    row.querySelector("[data-del]").onclick=()=>delFile(f.path);
-    listEl.appendChild(row);
-  });
-}
-async function openFile(path,size){
-  currentPath=path; curPathEl.textContent=path;
-  downloadA.href=encodeURI(path); downloadA.download=path.split("/").pop();
-  const j=await api("/api/fs/get?path="+encodeURIComponent(path));
-  if(!j.ok){ currentBinary=true; if(editor)editor.setValue("",-1);
-    curInfoEl.textContent=j.binary?`Бинарный/большой (${fmtSize(j.size||0)}) — редактирование отключено.`:"Невозможно открыть";
-    saveBtn.disabled=true; return; }
-  currentBinary=false;
-  if(editor){ editor.session.setMode(modeByExt(path)); editor.setValue(j.text||"", -1); }
-  curInfoEl.textContent="Открыт для редактирования"; saveBtn.disabled=true;
-}
-async function save(){
-  if(!currentPath||currentBinary)return;
-  const text = editor?editor.getValue():"";
-  const r=await fetch("/api/fs/put?path="+encodeURIComponent(currentPath),{method:"POST",body:text});
-  const j=await r.json(); if(j.ok){ saveBtn.disabled=true; await refreshList(); curInfoEl.textContent="Сохранено"; }
-}
-async function delFile(path){
-  if(!confirm("Удалить "+path+" ?"))return;
-  const j=await api("/api/fs/delete",{method:"POST",headers:{"Content-Type":"application/x-www-form-urlencoded"},body:"path="+encodeURIComponent(path)});
-  if(j.ok){ if(path===currentPath){currentPath="";curPathEl.textContent="—";if(editor)editor.setValue("",-1);} refreshList(); }
-}
-async function createFile(){
-  let p=newPath.value.trim(); if(!p)return; if(!p.startsWith("/"))p="/"+p;
-  const j=await fetch("/api/fs/put?path="+encodeURIComponent(p),{method:"POST",body:""}); const jj=await j.json();
-  if(jj.ok){ newPath.value=""; await refreshList(); openFile(p,0); }
-}
-async function uploadFiles(files){
-  for(const f of files){ const fd=new FormData(); fd.append("file",f,f.name); const to="/"+f.name;
-    await fetch("/upload?to="+encodeURIComponent(to),{method:"POST",body:fd}); }
-  await refreshList();
-}
-refreshBtn.onclick=refreshList; createBtn.onclick=createFile; saveBtn.onclick=save;
-up.addEventListener("change",async e=>{ await uploadFiles(e.target.files); up.value=""; });
-["dragenter","dragover"].forEach(t=>drop.addEventListener(t,e=>{e.preventDefault();drop.classList.add("drag");}));
-["dragleave","drop"].forEach(t=>drop.addEventListener(t,e=>{e.preventDefault();drop.classList.remove("drag");}));
-drop.addEventListener("drop",e=>uploadFiles(e.dataTransfer.files));
-window.addEventListener("load",()=>{initEditor();refreshList();});
-</script></body></html>)HTML";
-
-// Встроенный /ota: правьте src/ota.html, затем py src/_gen_ota_inc.py → TKWifiManager_ota.inc
-#include "TKWifiManager_ota.inc"
-
-static const char INDEX_HTML[] PROGMEM = R"HTML(<!doctype html>
-<html lang="ru"><head><meta charset="utf-8">
-<meta name="viewport" content="width=device-width,initial-scale=1">
-<title>TK Wi-Fi Manager</title>
-<script>(function(){try{var t=localStorage.getItem('tkwm-theme');if(t&&t!=='system')document.documentElement.dataset.theme=t;}catch(_){}})()</script>
-<style>
-:root{--bg:#0b1220;--card:#0d1728;--surface:#0f1a2c;--ink:#e8eef7;--mut:#9fb3d1;--br:#1b2a44;--btn:#143057;--link:#9fd0ff;--ok:#95ffa1;--err:#ff9a9a}
-:root[data-theme="light"]{--bg:#f0f4f8;--card:#fff;--surface:#e4eaf2;--ink:#1a2236;--mut:#5a7090;--br:#c5d0e0;--btn:#2563eb;--link:#1d4ed8;--ok:#16a34a;--err:#dc2626}
-@media(prefers-color-scheme:light){:root:not([data-theme]){--bg:#f0f4f8;--card:#fff;--surface:#e4eaf2;--ink:#1a2236;--mut:#5a7090;--br:#c5d0e0;--btn:#2563eb;--link:#1d4ed8;--ok:#16a34a;--err:#dc2626}}
-body{margin:0;background:var(--bg);color:var(--ink);font:15px system-ui,-apple-system,Segoe UI,Roboto}
-.wrap{max-width:860px;margin:auto;padding:20px}.card{background:var(--card);border:1px solid var(--br);border-radius:14px;padding:16px}
-h1{font-size:18px;margin:0 0 12px}button{padding:10px 12px;border-radius:10px;border:1px solid var(--br);background:var(--surface);color:var(--ink);cursor:pointer}
-a{color:var(--link);text-decoration:none}
-.row{display:flex;gap:10px;flex-wrap:wrap;align-items:center}
-</style><link rel="stylesheet" href="/theme.css"><script src="/theme.js"></script></head><body><div class="wrap"><div class="card">
-<h1>TK Wi-Fi Manager</h1>
-<div id="st" class="mut">...</div>
-<div id="otah" class="mut" style="display:none;margin-top:8px"><a href="/ota">Доступно обновление прошивки (ESPConnect)</a></div>
-<div class="row" style="margin-top:10px">
-<a href="/wifi"><button>Wi-Fi</button></a>
-<a href="/fs"><button>Файлы</button></a>
-<a href="/ota"><button>OTA</button></a>
-</div>
-<script>
-const st=document.getElementById('st'),otah=document.getElementById('otah');
-const ws=new WebSocket('ws://'+location.hostname+':'+)HTML" TKWM_XSTR(TKWM_WS_PORT) R"HTML(+'/');
-ws.onopen=()=>ws.send('status');
-ws.onmessage=e=>{ try{const j=JSON.parse(e.data); if(j.type==='status') st.innerHTML=(j.mode==='AP'?'AP (каптив)':'STA')+' • IP: <b>'+ (j.ip||'-') +'</b>'; }catch(_){ } };
-setTimeout(function(){
- try{
-  var sk=localStorage.getItem('tkwm_ota_skip')||'';
-  fetch('/api/ota/config').then(function(r){ return r.json(); }).then(function(c){
-   if(!c||!c.ok||!c.hasCreds||!c.auto) return;
-   return fetch('/api/ota/check',{method:'POST',headers:{'Content-Type':'application/json'},body:JSON.stringify({host:c.host,token:c.token,skipVersion:sk.trim()})});
-  }).then(function(x){ if(!x) return; return x.json?x.json():null; }).then(function(j){
-   if(j&&j.ok&&j.updateAvailable&&otah) otah.style.display='block';
-  });
- }catch(_){ }
-},900);
-</script>
-</div></div></body></html>)HTML";
-
-const char* TKWifiManager::builtinIndex() { return INDEX_HTML; }
-const char* TKWifiManager::builtinWifi() { return WIFI_HTML; }
-const char* TKWifiManager::builtinFs() { return FS_HTML; }
-const char* TKWifiManager::builtinOta() { return OTA_HTML; }
-
-// ===== Устойчивый разбор "ssid" / "password" из тела JSON (без внешних библиотек) =====
+// ===== Потоковый разбор JSON (без внешних библиотек) =====
 static int tkwmHex4_(const char* p) {
     int v = 0;
     for (int i = 0; i < 4; i++) {
@@ -437,85 +243,292 @@ static int tkwmHex4_(const char* p) {
     }
     return v;
 }
-static void tkwmUtf8AppendCp_(String& s, uint32_t cp) {
-    if (cp < 0x80)
-        s += (char)cp;
-    else if (cp < 0x800) {
-        s += (char)(0xC0 | (cp >> 6));
-        s += (char)(0x80 | (cp & 0x3F));
-    } else {
-        s += (char)(0xE0 | (cp >> 12));
-        s += (char)(0x80 | ((cp >> 6) & 0x3F));
-        s += (char)(0x80 | (cp & 0x3F));
-    }
-}
-/** true если ключ найден; out — разобранное (пустая строка допустима) */
-static bool tkwmJsonGetString(const String& j, const char* key, String& out) {
-    const String keyPat = String("\"") + key + String("\"");
-    int k = j.indexOf(keyPat);
-    if (k < 0) return false;
-    k = j.indexOf(':', k);
-    if (k < 0) return false;
-    int n = (int)j.length();
-    int i = k + 1;
-    while (i < n && (j[i] == ' ' || j[i] == '\t' || j[i] == '\r' || j[i] == '\n')) i++;
-    if (i >= n || j[i] != '\"') return false;
-    i++;
-    out = "";
-    while (i < n) {
-        char c = (char)j[i];
-        if (c == '\"') return true;
-        if (c == '\\' && i + 1 < n) {
-            char t = (char)j[i + 1];
-            if (t == '\"' || t == '\\' || t == '/') {
-                out += t;
-                i += 2;
-                continue;
+/** Кодовая точка → UTF-8 (1..4 байта); возвращает длину. */
+static uint8_t tkwmUtf8Enc_(uint32_t cp, char* o) {
+    if (cp < 0x80) {
+        o[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        o[0] = (char)(0xC0 | (cp >> 6));
+        o[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        o[0] = (char)(0xE0 | (cp >> 12));
+        o[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        o[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    o[0] = (char)(0xF0 | (cp >> 18));
+    o[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    o[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    o[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+/**
+ * Однопроходный pull-разбор JSON-объекта: за один проход достаёт значения нужных
+ * ключей верхнего уровня, вложенные объекты/массивы пропускает с проверкой парности
+ * скобок. Память выделяется только под найденные строки. Источник — String или
+ * Stream (тело HTTPClient читается прямо из сокета через TkwmHttpBody, без getString()).
+ *
+ *   TkwmJsonPick p(body);
+ *   p.str("ssid", ssid).str("password", pass);
+ *   if (!p.run() || !p.found("ssid")) ...
+ */
+class TkwmJsonPick {
+public:
+    explicit TkwmJsonPick(const String& s) : _p(s.c_str()), _n(s.length()) {}
+    /** len — Content-Length (<0: до закрытия соединения/конца корня). */
+    TkwmJsonPick(Stream& st, int len) : _st(&st), _left(len) {}
+
+    /** Строка; число/true/false отдаются текстом литерала, null — «не найдено». */
+    TkwmJsonPick& str(const char* key, String& out) { return add(key, 's', &out); }
+    TkwmJsonPick& num(const char* key, long& out) { return add(key, 'n', &out); }
+    TkwmJsonPick& boolean(const char* key, bool& out) { return add(key, 'b', &out); }
+    /** Копить первые max байт исходного текста (для сообщений об ошибке). */
+    TkwmJsonPick& capture(String& out, size_t max) {
+        _cap    = &out;
+        _capMax = max;
+        out     = "";
+        return *this;
+    }
+
+    /** true — корень является корректным объектом (либо все ключи найдены раньше его конца). */
+    bool run() {
+        if (nextNonWs() != '{') return false;
+        int c = nextNonWs();
+        if (c == '}') return true;
+        const uint8_t all = (uint8_t)((1u << _fn) - 1);
+        for (;;) {
+            if (c != '"') return false;
+            char   key[40];
+            size_t kl = 0;
+            if (!readString(nullptr, key, sizeof(key), &kl)) return false;
+            if (nextNonWs() != ':') return false;
+            int fi = -1;
+            if (kl < sizeof(key)) {
+                key[kl] = 0;
+                for (uint8_t i = 0; i < _fn; i++)
+                    if (!(_found & (1u << i)) && !strcmp(_f[i].key, key)) {
+                        fi = i;
+                        break;
+                    }
+            }
+            if (!value(fi)) return false;
+            if (_fn && _found == all) return true; // дальше читать незачем
+            c = nextNonWs();
+            if (c == '}') return true;
+            if (c != ',') return false;
+            c = nextNonWs();
+        }
+    }
+
+    bool found(const char* key) const {
+        for (uint8_t i = 0; i < _fn; i++)
+            if (!strcmp(_f[i].key, key)) return (_found & (1u << i)) != 0;
+        return false;
+    }
+
+private:
+    static const uint8_t MAX_FIELDS = 8;
+    struct Field {
+        const char* key;
+        char        kind;
+        void*       out;
+    };
+
+    TkwmJsonPick& add(const char* key, char kind, void* out) {
+        if (_fn < MAX_FIELDS) _f[_fn++] = { key, kind, out };
+        return *this;
+    }
+
+    int next() {
+        if (_back >= 0) {
+            const int c = _back;
+            _back       = -1;
+            return c;
+        }
+        int c;
+        if (_st) {
+            if (_bp == _bl) {
+                if (_left == 0) return -1;
+                int want = _st->available();
+                if (want <= 0) want = 1; // ждём хотя бы байт (таймаут потока)
+                if (want > (int)sizeof(_buf)) want = sizeof(_buf);
+                if (_left > 0 && want > _left) want = _left;
+                const size_t got = _st->readBytes(_buf, (size_t)want);
+                if (!got) return -1;
+                if (_left > 0) _left -= (int)got;
+                _bl = (uint8_t)got;
+                _bp = 0;
+            }
+            c = (uint8_t)_buf[_bp++];
+        } else {
+            if (_i >= _n) return -1;
+            c = (uint8_t)_p[_i++];
+        }
+        if (_cap && _cap->length() < _capMax) *_cap += (char)c;
+        return c;
+    }
+    int nextNonWs() {
+        int c;
+        do c = next();
+        while (c == ' ' || c == '\t' || c == '\r' || c == '\n');
+        return c;
+    }
+
+    /** После открывающей кавычки; пишет в out, в буфер ключа kb или никуда. */
+    bool readString(String* out, char* kb, size_t kcap, size_t* klen) {
+        uint32_t hi = 0; // старший суррогат, ждущий пары
+        for (;;) {
+            int c = next();
+            if (c < 0) return false;
+            if (c == '"') break;
+            uint32_t cp;
+            bool     raw = true;
+            if (c == '\\') {
+                raw = false;
+                c   = next();
+                switch (c) {
+                case '"':
+                case '\\':
+                case '/': cp = (uint32_t)c; break;
+                case 'b': cp = '\b'; break;
+                case 'f': cp = '\f'; break;
+                case 'n': cp = '\n'; break;
+                case 'r': cp = '\r'; break;
+                case 't': cp = '\t'; break;
+                case 'u': {
+                    char h[4];
+                    for (int k = 0; k < 4; k++) {
+                        const int d = next();
+                        if (d < 0) return false;
+                        h[k] = (char)d;
+                    }
+                    const int v = tkwmHex4_(h);
+                    if (v < 0) return false;
+                    cp = (uint32_t)v;
+                    break;
+                }
+                default: return false;
+                }
+            } else {
+                cp = (uint32_t)c;
             }
-            if (t == 'b') { out += '\b'; i += 2; continue; }
-            if (t == 'f') { out += '\f'; i += 2; continue; }
-            if (t == 'n') { out += '\n'; i += 2; continue; }
-            if (t == 'r') { out += '\r'; i += 2; continue; }
-            if (t == 't') { out += '\t'; i += 2; continue; }
-            if (t == 'u' && i + 6 < n) {
-                int h = tkwmHex4_(j.c_str() + i + 2);
-                if (h >= 0) {
-                    tkwmUtf8AppendCp_(out, (uint32_t)h);
-                    i += 6;
+            if (!raw && cp >= 0xDC00 && cp <= 0xDFFF && hi) {
+                cp = 0x10000 + ((hi - 0xD800) << 10) + (cp - 0xDC00);
+                hi = 0;
+            } else {
+                if (hi) emit(out, kb, kcap, klen, 0xFFFD, false); // одинокий старший суррогат
+                hi = 0;
+                if (!raw && cp >= 0xD800 && cp <= 0xDBFF) {
+                    hi = cp;
                     continue;
                 }
+                if (!raw && cp >= 0xDC00 && cp <= 0xDFFF) cp = 0xFFFD;
+            }
+            emit(out, kb, kcap, klen, cp, raw);
+        }
+        if (hi) emit(out, kb, kcap, klen, 0xFFFD, false);
+        return true;
+    }
+    /** raw — байт как есть (UTF-8 из источника), иначе кодовая точка из \-escape. */
+    static void emit(String* out, char* kb, size_t kcap, size_t* klen, uint32_t cp, bool raw) {
+        char          u[4];
+        const uint8_t n = raw ? 1 : tkwmUtf8Enc_(cp, u);
+        if (raw) u[0] = (char)cp;
+        for (uint8_t k = 0; k < n; k++) {
+            if (out)
+                *out += u[k];
+            else if (kb) {
+                if (*klen + 1 < kcap) kb[(*klen)++] = u[k];
+                else *klen = kcap; // ключ длиннее буфера — ни с чем не совпадёт
             }
         }
-        out += c;
-        i++;
     }
-    return false;
-}
 
-/** Целое после "\"key\": 123" (без кавычек у числа). */
-static bool tkwmJsonGetInt(const String& j, const char* key, int& out) {
-    const String keyPat = String("\"") + key + String("\"");
-    int k = j.indexOf(keyPat);
-    if (k < 0) return false;
-    k = j.indexOf(':', k);
-    if (k < 0) return false;
-    int n = (int)j.length();
-    int i = k + 1;
-    while (i < n && (j[i] == ' ' || j[i] == '\t' || j[i] == '\r' || j[i] == '\n')) i++;
-    if (i >= n || j[i] == '\"') return false;
-    long v = 0;
-    bool neg = false;
-    if (j[i] == '-') {
-        neg = true;
-        i++;
+    /** Пропуск объекта/массива; c — открывающая скобка. */
+    bool skipComposite(int c) {
+        uint32_t stack = 0; // бит на уровень: 1 — объект
+        uint8_t  depth = 0;
+        for (;;) {
+            if (c == '{' || c == '[') {
+                if (depth == 32) return false;
+                stack = (stack << 1) | (c == '{' ? 1u : 0u);
+                depth++;
+            } else if (c == '}' || c == ']') {
+                if (!depth || (stack & 1u) != (c == '}' ? 1u : 0u)) return false;
+                stack >>= 1;
+                if (--depth == 0) return true;
+            } else if (c == '"') {
+                if (!readString(nullptr, nullptr, 0, nullptr)) return false;
+            } else if (c < 0) {
+                return false;
+            }
+            c = next();
+        }
     }
-    if (i >= n || j[i] < '0' || j[i] > '9') return false;
-    while (i < n && j[i] >= '0' && j[i] <= '9') {
-        v = v * 10 + (j[i] - '0');
-        i++;
+
+    bool value(int fi) {
+        int c = nextNonWs();
+        if (c == '"') {
+            String* out = (fi >= 0 && _f[fi].kind == 's') ? (String*)_f[fi].out : nullptr;
+            if (out) *out = "";
+            if (!readString(out, nullptr, 0, nullptr)) return false;
+            if (out) _found |= (uint8_t)(1u << fi);
+            return true;
+        }
+        if (c == '{' || c == '[') return skipComposite(c);
+        char   t[24];
+        size_t n = 0;
+        while (c >= 0 && c != ',' && c != '}' && c != ']' && c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+            if (n + 1 < sizeof(t)) t[n++] = (char)c;
+            c = next();
+        }
+        _back = c;
+        t[n]  = 0;
+        if (!n || !strchr("-0123456789tfn", t[0])) return false;
+        if (fi < 0 || !strcmp(t, "null")) return true;
+        const Field& f = _f[fi];
+        if (f.kind == 's') {
+            *(String*)f.out = t;
+        } else if (f.kind == 'n') {
+            char*      e;
+            const long v = strtol(t, &e, 10);
+            if (e == t) return true;
+            *(long*)f.out = v;
+        } else {
+            if (strcmp(t, "true") && strcmp(t, "false")) return true;
+            *(bool*)f.out = t[0] == 't';
+        }
+        _found |= (uint8_t)(1u << fi);
+        return true;
     }
-    out = (int)(neg ? -v : v);
-    return true;
+
+    const char* _p = nullptr;
+    size_t      _n = 0;
+    size_t      _i = 0;
+    Stream*     _st = nullptr;
+    int         _left = -1;
+    char        _buf[64];
+    uint8_t     _bl = 0, _bp = 0;
+    int         _back = -1;
+    String*     _cap = nullptr;
+    size_t      _capMax = 0;
+    Field       _f[MAX_FIELDS];
+    uint8_t     _fn = 0;
+    uint8_t     _found = 0;
+};
+
+/** detail/message из JSON-ответа ошибки ESPConnect (message приоритетнее). */
+static void tkwmErrFromBody_(const String& r, String& err) {
+    String d, m;
+    TkwmJsonPick p(r);
+    p.str("detail", d).str("message", m).run();
+    if (m.length()) err = m;
+    else if (d.length()) err = d;
 }
 
 /** Запрет просмотра/редактирования ota.conf через /api/fs и /upload. */
@@ -532,7 +545,17 @@ TKWifiManager::TKWifiManager(uint16_t httpPort)
     : _httpPort(httpPort), _server(httpPort), _ws(TKWM_WS_PORT) {
 }
 
+TKWifiManager::~TKWifiManager() {
+    // Колбэк событий Wi-Fi и фоновая задача держат this: снимаем их до освобождения объекта.
+    if (_wifiEventId) WiFi.removeEvent(_wifiEventId);
+#if TKWM_USE_BACKGROUND_TASK
+    _bgTaskRunning = false;
+    while (_bgTaskHandle) delay(1); // задача доделывает тик и выходит сама
+#endif
+}
+
 bool TKWifiManager::begin(const String& apSsidPrefix, bool formatFSIfNeeded, int8_t taskCore) {
+    bootMark("begin");
     _apSsidPrefix = apSsidPrefix;
 #if TKWM_USE_LITTLEFS
     Serial.println(F("[TKWM] FS = LittleFS"));
@@ -548,20 +571,29 @@ bool TKWifiManager::begin(const String& apSsidPrefix, bool formatFSIfNeeded, int
     }
     Serial.printf("[TKWM] FS mount: %s\n", _fsOk ? "OK" : "FAIL");
     loadOtaConf_();
+    tzApply_();
+    if (TKWM_OTA_AUTO_MS) otaAutoSchedule(TKWM_OTA_AUTO_FIRST_MS, TKWM_OTA_AUTO_FIRST_MS);
+    bootMark("fs");
 
     // Wi-Fi creds
     loadCreds();
+    hookWifiEvents();
+    bootMark("creds");
 
+#if !TKWM_ASYNC_BEGIN
     // Попробуем подключиться к лучшей из известных
-    bool staOk = tryConnectBestKnown();
+    bool staOk = tryConnectFast();
+    if (!staOk) staOk = tryConnectBestKnown();
     if (!staOk) staOk = tryConnectBySavedOrder();
-    if (!staOk) startAPCaptive();
+    if (!staOk) startAPCaptive(_credN > 0);
+#endif
 
     // Маршруты и WS
     setupRoutes();
     _server.begin();
     setupWebSocket();
     _ws.begin();
+    bootMark("http");
 
     // Power-save OFF — стабильнее скан
     WiFi.setSleep(false);
@@ -570,6 +602,17 @@ bool TKWifiManager::begin(const String& apSsidPrefix, bool formatFSIfNeeded, int
     // UDP discovery
     _udp.begin(TKWM_DISCOVERY_PORT);
 
+#if TKWM_ASYNC_BEGIN
+    // Сервер уже отвечает; подбор сети — в фоне, провал сразу уводит в AP (не ждём TKWM_STA_FAIL_TO_AP_MS).
+    if (_credN == 0) {
+        startAPCaptive();
+    } else {
+        WiFi.mode(WIFI_STA);
+        _connFallbackAp = true;
+        connStart();
+    }
+#endif
+
 #if TKWM_USE_BACKGROUND_TASK
     if (!_bgTaskHandle) {
         _bgTaskRunning = true;
@@ -615,6 +658,7 @@ bool TKWifiManager::begin(const String& apSsidPrefix, bool formatFSIfNeeded, int
 #endif
     }
 #endif
+    bootMark("ready");
     return true; // HTTP/WS готовы; состояние ФС — isFilesystemOk()
 }
 
@@ -629,14 +673,50 @@ void TKWifiManager::loop() {
 }
 
 void TKWifiManager::serviceTick() {
+    TKWM_METRIC(const uint32_t tickAt = micros());
     if (_otaRestartPending && millis() >= _otaRestartAt) {
         ESP.restart();
     }
-    if (_captiveMode) _dns.processNextRequest();
-    _server.handleClient();
-    _ws.loop();
-    udpTick();
+    if (_captiveMode) TKWM_STAGE(MS_DNS, _dns.processNextRequest());
+    TKWM_STAGE(MS_HTTP, httpTick());
+    TKWM_STAGE(MS_WS, _ws.loop());
+    TKWM_STAGE(MS_UDP, udpTick());
+    TKWM_STAGE(MS_SCAN, scanTick());
+    TKWM_STAGE(MS_LINK, linkTick());
+    TKWM_STAGE(MS_CONN, connTick());
+    if (_otaJob) otaJobTick();
+    if (_otaAutoAt && (int32_t)(millis() - _otaAutoAt) >= 0) otaAutoTick();
+    if (_otaPoolCloseAt && (int32_t)(millis() - _otaPoolCloseAt) >= 0 && !otaJobRunning()) otaPoolClose();
+    TKWM_METRIC(_mStage[MS_TICK].add(micros() - tickAt));
+}
+
+// WebServer обслуживает одно соединение за handleClient(). Браузер открывает страницу
+// и сразу css/js/api — пока запросы идут, разбираем очередь подряд, а не по одному за тик.
+// TkwmAsyncServer за вызов обходит все сокеты; повтор дочитывает запросы, пришедшие по keep-alive.
+void TKWifiManager::httpTick() {
+    for (uint8_t i = 0; i < TKWM_HTTP_BURST; i++) {
+        const uint32_t before = _httpReqN;
+        _server.handleClient();
+        if (_httpReqN == before) break; // очередь пуста
+        _httpActiveAt = millis();
+    }
+#if TKWM_HTTP_ASYNC
+    // Открытое соединение (загрузка, keep-alive) — тоже активность: частый тик, пока оно живо.
+    if (_server.clients()) _httpActiveAt = millis();
+#endif
+}
+
+bool TKWifiManager::httpActive() const {
+    return _httpActiveAt && (uint32_t)(millis() - _httpActiveAt) < TKWM_HTTP_ACTIVE_MS;
+}
 
+void TKWifiManager::linkTick() {
+    if (_apDropAt && (int32_t)(millis() - _apDropAt) >= 0) {
+        _apDropAt = 0;
+        if (!_captiveMode) WiFi.softAPdisconnect(true);
+    }
+    // Провалы подключений не пишем в flash на каждой попытке — пачкой, раз в TKWM_STATS_SAVE_MS.
+    if (_credDirtyAt && (uint32_t)(millis() - _credDirtyAt) >= TKWM_STATS_SAVE_MS) saveCreds();
     // Если в STA сеть пропала — сначала пытаемся восстановиться, потом только AP fallback.
     if (!_captiveMode) {
         const uint32_t now = millis();
@@ -645,121 +725,506 @@ void TKWifiManager::serviceTick() {
             const bool justConnected = !_wasStaConnected;
             _wasStaConnected = true;
             _staLostSinceMs = 0;
-            _lastFullScanReconnectMs = 0;
+            if (justConnected) {
+                _linkSince = now;
+                _linkRssi4 = 0;
+                _linkRttMs = 0;
+                _linkLoss = 0;
+            }
+            if (TKWM_LINK_SAMPLE_MS && (uint32_t)(now - _linkSampleAt) >= TKWM_LINK_SAMPLE_MS) {
+                _linkSampleAt = now;
+                linkSample();
+            }
+            if (_roamScanWait && !_scanRunning) roamEval();
             const bool syncDue = (_lastAutoTimeSyncMs == 0) || ((uint32_t)(now - _lastAutoTimeSyncMs) >= TKWM_AUTO_TIME_SYNC_INTERVAL_MS);
             if (syncDue && (justConnected || _lastAutoTimeSyncMs == 0 || (uint32_t)(now - _lastAutoTimeSyncMs) >= TKWM_AUTO_TIME_SYNC_INTERVAL_MS)) {
-                (void)syncTimeWithNtp_(otaConfigNtp_(), 12000);
-                int16_t offMin = 0;
-                if (fetchTimezoneOffsetMin_(otaConfigTimezone_(), offMin)) _otaFileTzOffsetMin = offMin;
+                (void)timeSyncStart_(otaConfigNtp_()); // ответ придёт колбэком; свежую синхронизацию не повторяет
                 _lastAutoTimeSyncMs = now;
             }
         } else {
             _wasStaConnected = false;
-            if (_staLostSinceMs == 0) _staLostSinceMs = now;
-            if (now - _lastReconnectAttemptMs >= TKWM_RECONNECT_INTERVAL_MS) {
-                _lastReconnectAttemptMs = now;
-                // Сначала мягкая попытка восстановить уже известное STA-соединение.
-                WiFi.reconnect();
-
-                // Тяжёлый scan+switch делаем реже, чтобы не дестабилизировать линк.
-                if (_lastFullScanReconnectMs == 0 || (now - _lastFullScanReconnectMs) >= TKWM_FULL_SCAN_RECONNECT_MS) {
-                    _lastFullScanReconnectMs = now;
-                    if (tryConnectBestKnown(12000) || tryConnectBySavedOrder(8000)) {
-                        _staLostSinceMs = 0;
-                        return;
-                    }
-                }
+            if (_staLostSinceMs == 0) {
+                _staLostSinceMs = now;
+                _reconnectN = 0;
+                reconnectSchedule(now);
             }
-            if (_staLostSinceMs > 0 && (now - _staLostSinceMs) >= TKWM_STA_FAIL_TO_AP_MS) {
-                startAPCaptive();
+            // Пока движок подключения работает, мягкие reconnect и уход в AP не трогаем — он сам
+            // сообщит результат; тик при этом не блокируется.
+            if (!connBusy() && (int32_t)(now - _reconnectAt) >= 0) {
+                // Тяжёлый scan+switch политика назначает реже, чтобы не дестабилизировать линк.
+                if (_reconnectFull) connStart();
+                else WiFi.reconnect(); // мягкая попытка восстановить уже известное STA-соединение
+                _reconnectN++;
+                reconnectSchedule(now);
+            }
+            const uint32_t apAfter = _reconnectApAfter ? _reconnectApAfter : TKWM_STA_FAIL_TO_AP_MS;
+            if (!connBusy() && _staLostSinceMs > 0 && (uint32_t)(now - _staLostSinceMs) >= apAfter) {
+                startAPCaptive(true);
                 _staLostSinceMs = 0;
             }
         }
+    } else if (_apRetrySta && !connBusy()) {
+        // AP поднят из-за потери сети: STA пробуем дальше по той же политике, иначе после перезагрузки
+        // точки устройство так и осталось бы в портале. Только полный подбор — он же и гасит AP.
+        // Пока к порталу кто-то подключён, попытку откладываем: скан и смена канала рвут ему связь.
+        const uint32_t now = millis();
+        const int      cur = (WiFi.status() == WL_CONNECTED) ? findBySsid(WiFi.SSID()) : -1;
+        if (cur >= 0) {
+            // Драйвер сам восстановил STA (переподключение SDK при поднятом AP) — выходим из портала.
+            _connStartedAt = now;
+            connDone(cur, "auto");
+            connPublish("ok", cur);
+        } else if ((int32_t)(now - _reconnectAt) >= 0) {
+            if (WiFi.softAPgetStationNum() == 0) {
+                connStart();
+                _reconnectN++;
+            }
+            reconnectSchedule(now);
+        }
+    }
+}
+
+// Провал, похожий на неверный пароль (с такой точкой повторять без смены пароля бессмысленно).
+static bool tkwmAuthFail_(uint8_t r) {
+    return r == WIFI_REASON_AUTH_FAIL || r == WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT || r == WIFI_REASON_HANDSHAKE_TIMEOUT;
+}
+
+static void tkwmMacStr_(const uint8_t* m, char* out) {
+    snprintf(out, 18, "%02X:%02X:%02X:%02X:%02X:%02X", m[0], m[1], m[2], m[3], m[4], m[5]);
+}
+
+// ============ Политика переподключения ============
+// Фиксированные интервалы после перезагрузки точки синхронизируют весь парк устройств: все сканируют и
+// ассоциируются разом. Экспонента разводит попытки во времени, а постоянный для устройства джиттер
+// (от MAC) не даёт им снова сойтись. Счётчик попыток сбрасывается при каждом подключении.
+static uint32_t tkwmMix32_(uint32_t h) { // финализатор murmur3
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h;
+}
+
+TKWifiManager::ReconnectStep TKWifiManager::reconnectBackoff(uint16_t attempt, uint32_t seed) {
+    uint32_t d = TKWM_RECONNECT_INTERVAL_MS;
+    for (uint16_t k = 0; k < attempt && d < TKWM_RECONNECT_MAX_MS; k++) d *= 2;
+    d = min<uint32_t>(d, TKWM_RECONNECT_MAX_MS);
+    const uint32_t r = tkwmMix32_(seed ^ (attempt * 0x9E3779B9u)) & 0xFFFF;
+    d = d / 2 + (uint32_t)(((uint64_t)d * r) >> 16); // ×0.5 … ×1.5
+    // Уход в AP тоже разведён по устройствам: ×1 … ×1.5 от TKWM_STA_FAIL_TO_AP_MS, но не позже потолка.
+    const uint32_t ap = TKWM_STA_FAIL_TO_AP_MS + (uint32_t)(((uint64_t)TKWM_STA_FAIL_TO_AP_MS * (tkwmMix32_(seed) & 0xFFFF)) >> 17);
+    // Первая попытка — мягкая (короткие провалы SDK переживает сам), дальше скан через раз.
+    return { d, (attempt & 1) != 0, min<uint32_t>(ap, TKWM_STA_FAIL_TO_AP_MAX_MS) };
+}
+
+TKWifiManager::ReconnectStep TKWifiManager::reconnectFixed(uint16_t attempt, uint32_t seed) {
+    (void)seed;
+    const uint16_t every = max<uint16_t>(1, TKWM_FULL_SCAN_RECONNECT_MS / TKWM_RECONNECT_INTERVAL_MS);
+    return { TKWM_RECONNECT_INTERVAL_MS, attempt % every == 0, TKWM_STA_FAIL_TO_AP_MS };
+}
+
+void TKWifiManager::reconnectSchedule(uint32_t now) {
+    if (!_reconnectSeed) _reconnectSeed = tkwmMix32_((uint32_t)ESP.getEfuseMac() ^ (uint32_t)(ESP.getEfuseMac() >> 32)) | 1;
+    const ReconnectStep st = _reconnectPolicy(_reconnectN, _reconnectSeed);
+    _reconnectAt      = now + st.delayMs;
+    _reconnectFull    = st.fullScan;
+    _reconnectApAfter = st.apAfterMs;
+}
+
+// ============ Монитор линка и роуминг ============
+// Раз в TKWM_LINK_SAMPLE_MS: RSSI (EMA 1/4) и ping шлюза (EMA задержки, потери подряд). Плохой линк
+// держится дольше TKWM_ROAM_HOLD_MS → фоновый скан не чаще TKWM_ROAM_SCAN_MS; переход, только если
+// другая точка той же сети сильнее на TKWM_ROAM_DELTA_DB (другая сохранённая сеть — на вдвое больше).
+#if TKWM_LINK_PING
+void TKWifiManager::pingOk_(void* hdl, void* arg) {
+    TKWifiManager* self = (TKWifiManager*)arg;
+    uint32_t       ms   = 0;
+    esp_ping_get_profile(hdl, ESP_PING_PROF_TIMEGAP, &ms, sizeof(ms));
+    self->_pingRtt = (uint16_t)min<uint32_t>(ms, 65535);
+    self->_pingRes = 1;
+}
+
+void TKWifiManager::pingLost_(void* hdl, void* arg) {
+    (void)hdl;
+    ((TKWifiManager*)arg)->_pingRes = 2;
+}
+#endif
+
+void TKWifiManager::linkSample() {
+    const uint32_t now  = millis();
+    const int      rssi = WiFi.RSSI();
+    if (rssi < 0) _linkRssi4 = _linkRssi4 ? (int16_t)(_linkRssi4 + (rssi * 4 - _linkRssi4) / 4) : (int16_t)(rssi * 4);
+#if TKWM_LINK_PING
+    const uint8_t res = _pingRes;
+    if (res == 1) {
+        const uint16_t rtt = max<uint16_t>((uint16_t)_pingRtt, 1);
+        _linkRttMs = _linkRttMs ? (uint16_t)((_linkRttMs * 3 + rtt) / 4) : rtt;
+        _linkLoss  = 0;
+    } else if (res == 2 && _linkLoss < 255) {
+        _linkLoss++;
+    }
+    const uint32_t gw = (uint32_t)WiFi.gatewayIP();
+    if (_ping && gw != _pingGw) {
+        esp_ping_stop(_ping);
+        esp_ping_delete_session(_ping);
+        _ping = nullptr;
+    }
+    if (!_ping && gw) {
+        esp_ping_config_t cfg = ESP_PING_DEFAULT_CONFIG();
+        cfg.count           = 1;
+        cfg.timeout_ms      = 1000;
+        cfg.data_size       = 8;
+        cfg.task_stack_size = 2560;
+        cfg.target_addr.u_addr.ip4.addr = gw;
+        cfg.target_addr.type            = IPADDR_TYPE_V4;
+        esp_ping_callbacks_t cb = {};
+        cb.cb_args         = this;
+        cb.on_ping_success = pingOk_;
+        cb.on_ping_timeout = pingLost_;
+        esp_ping_handle_t h = nullptr;
+        if (esp_ping_new_session(&cfg, &cb, &h) == ESP_OK) {
+            _ping   = h;
+            _pingGw = gw;
+        }
+    }
+    // Прошлый ping ещё в полёте (таймаут 1 с) — новый не запускаем.
+    if (_ping && res != 3) {
+        _pingRes = 3;
+        esp_ping_start(_ping);
+    }
+#endif
+    if (linkDegraded() && !connBusy() && !_scanRunning && (uint32_t)(now - _linkSince) >= TKWM_ROAM_HOLD_MS &&
+        (!_roamScanAt || (uint32_t)(now - _roamScanAt) >= TKWM_ROAM_SCAN_MS) && scanRequest()) {
+        _roamScanAt   = now;
+        _roamScanWait = true;
+    }
+}
+
+bool TKWifiManager::linkDegraded() const {
+    return (_linkRssi4 && _linkRssi4 < TKWM_ROAM_RSSI * 4) || _linkLoss >= 3 || _linkRttMs > TKWM_ROAM_RTT_MS;
+}
+
+void TKWifiManager::roamEval() {
+    _roamScanWait = false;
+    if (connBusy() || WiFi.status() != WL_CONNECTED || _scanAt == 0 || (int32_t)(_scanAt - _roamScanAt) < 0) return;
+    const String   cur     = WiFi.SSID();
+    const uint8_t* curB    = WiFi.BSSID();
+    const int      curRssi = WiFi.RSSI();
+    int best = -1, bestIdx = -1, bestMargin = -1;
+    for (int i = 0; i < _scanN; ++i) {
+        const ScanNet& n = _scanNets[i];
+        if (curB && !memcmp(n.bssid, curB, 6)) continue;
+        const int idx = findBySsid(n.ssid);
+        if (idx < 0 || bssidBanned(n.bssid) || tkwmAuthFail_(_creds[idx].lastFail)) continue;
+        const int margin = n.rssi - curRssi - (n.ssid == cur ? TKWM_ROAM_DELTA_DB : 2 * TKWM_ROAM_DELTA_DB);
+        if (margin > bestMargin) {
+            bestMargin = margin;
+            best       = i;
+            bestIdx    = idx;
+        }
+    }
+    if (best < 0) return;
+    const ScanNet& n = _scanNets[best];
+    char from[18] = "", to[18];
+    if (curB) tkwmMacStr_(curB, from);
+    tkwmMacStr_(n.bssid, to);
+    Serial.printf("[TKWM] roam %s %s %d dBm -> %s %s %d dBm\n", cur.c_str(), from, curRssi, n.ssid.c_str(), to, n.rssi);
+    String out;
+    TkwmJson j(out);
+    j.objOpen().kv("type", "roam").kv("from", from).kv("to", to).kv("ssid", n.ssid).kvi("rssi", curRssi).kvi("target", n.rssi);
+    j.objClose().end();
+    _ws.broadcastTXT(out);
+    TKWM_METRIC(_mWsTx++);
+    _roamN++;
+    if (_eventHook) _eventHook(Event::Roam);
+    // Один кандидат — выбранная точка; дальше обычные фазы движка (Settle → Attempt).
+    _connRoam      = true;
+    _connStartedAt = millis();
+    _connOrder[0]  = (int8_t)bestIdx;
+    memcpy(_connBssid[0], n.bssid, 6);
+    _connCh[0]     = n.ch;
+    _connOrderN    = 1;
+    _connVisibleN  = 0;
+    _connPos       = 0;
+    _connTry       = 0;
+    connBeginCandidate();
+}
+
+void TKWifiManager::handleWifiLink() {
+    const bool sta = !_captiveMode && WiFi.status() == WL_CONNECTED;
+    TkwmJson   j(_server);
+    j.begin();
+    j.objOpen().kvb("ok", true).kvb("connected", sta);
+    if (sta) {
+        const uint8_t* b = WiFi.BSSID();
+        char           bs[18] = "";
+        if (b) tkwmMacStr_(b, bs);
+        j.kv("ssid", WiFi.SSID()).kv("bssid", bs).kvi("ch", WiFi.channel()).kvi("rssi", WiFi.RSSI());
+        j.kvi("rssiAvg", _linkRssi4 / 4).kvu("rttMs", _linkRttMs).kvi("loss", _linkLoss);
+        j.kvb("degraded", linkDegraded()).kvu("sinceMs", millis() - _linkSince);
     }
+    j.kvu("roams", _roamN).objClose().end();
 }
 
 // ======================= Creds ========================
+// Все сети — один бинарный блоб tkw_net/"creds": читается одним getBytes, пишется одним
+// putBytes (NVS атомарно заменяет запись целиком), без записи, если содержимое не изменилось.
+//   [0..1] 'T','N'  [2] версия  [3] число записей  [4..7] CRC32 записей (LE)
+//   запись: u8 len + ssid, u8 len + pass, u8 len + ext (незнакомый хвост ext читатель пропускает)
+//   ext: [0] флаги (бит 0 — подключались последней), [1..6] BSSID, [7] канал, [8..23] ip/gw/mask/dns (LE),
+//        [24] hist [25] histN [26] lastFail [27] ttiPos [28..35] tti[4] (LE16) — статистика подключений
+static const uint8_t TKWM_CRED_BLOB_VER = 1;
+static const size_t  TKWM_CRED_HDR      = 8;
+static const uint8_t TKWM_CRED_EXT_HINT = 24; // подсказка без статистики (записи первых версий)
+static const uint8_t TKWM_CRED_EXT_LEN  = 36;
+
+/** CRC32 (как zlib); crc — результат для предыдущих байтов, чтобы считать потоком. */
+static uint32_t tkwmCrc32_(const uint8_t* p, size_t n, uint32_t crc = 0) {
+    static const uint32_t t[16] = { 0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+                                    0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+                                    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C };
+    uint32_t c = ~crc;
+    while (n--) {
+        c ^= *p++;
+        c = (c >> 4) ^ t[c & 15];
+        c = (c >> 4) ^ t[c & 15];
+    }
+    return ~c;
+}
+static uint32_t tkwmRd32_(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+static void tkwmWr32_(uint8_t* p, uint32_t v) {
+    for (uint8_t k = 0; k < 4; k++) p[k] = (uint8_t)(v >> (8 * k));
+}
+
+/** Разбор блоба; ext[r] указывает внутрь b. false — не наш формат/версия/CRC. */
+static bool tkwmCredBlobParse_(const uint8_t* b, size_t len, String* ssid, String* pass, const uint8_t** ext, uint8_t* extLen, int& n) {
+    if (len < TKWM_CRED_HDR || b[0] != 'T' || b[1] != 'N' || b[2] != TKWM_CRED_BLOB_VER) return false;
+    if (tkwmCrc32_(b + TKWM_CRED_HDR, len - TKWM_CRED_HDR) != tkwmRd32_(b + 4)) return false;
+    const int cnt = b[3];
+    if (cnt > TKWM_MAX_CRED) return false;
+    size_t i = TKWM_CRED_HDR;
+    for (int r = 0; r < cnt; r++) {
+        String* dst[3] = { &ssid[r], &pass[r], nullptr };
+        for (uint8_t f = 0; f < 3; f++) {
+            if (i >= len) return false;
+            const uint8_t l = b[i++];
+            if (i + l > len) return false;
+            if (dst[f]) {
+                dst[f]->reserve(l);
+                *dst[f] = "";
+                for (uint8_t k = 0; k < l; k++) *dst[f] += (char)b[i + k];
+            } else {
+                ext[r]    = b + i;
+                extLen[r] = l;
+            }
+            i += l;
+        }
+    }
+    n = cnt;
+    return true;
+}
+
 void TKWifiManager::loadCreds() {
+    String         ssid[TKWM_MAX_CRED], pass[TKWM_MAX_CRED];
+    const uint8_t* ext[TKWM_MAX_CRED];
+    uint8_t        extLen[TKWM_MAX_CRED] = {};
+    int            n = 0;
+    _credN = 0;
     _prefs.begin("tkw_net", true);
-    _credN = _prefs.getInt("count", 0);
-    if (_credN < 0 || _credN > TKWM_MAX_CRED) _credN = 0;
-    for (int i = 0; i < _credN; i++) {
-        _creds[i].ssid = _prefs.getString((String("s") + i).c_str(), "");
-        _creds[i].pass = _prefs.getString((String("p") + i).c_str(), "");
+    const size_t len = _prefs.isKey("creds") ? _prefs.getBytesLength("creds") : 0;
+    uint8_t*     b   = len ? (uint8_t*)malloc(len) : nullptr;
+    bool         ok  = false;
+    if (b) {
+        ok = _prefs.getBytes("creds", b, len) == len && tkwmCredBlobParse_(b, len, ssid, pass, ext, extLen, n);
+        if (ok) _credBlobCrc = tkwmCrc32_(b, len);
+        else n = 0;
+    }
+    if (len && !ok) Serial.println(F("[TKWM] creds blob damaged, trying legacy keys"));
+    bool legacy = false;
+    if (!ok && _prefs.isKey("count")) {
+        // Старый формат: count + s<i>/p<i> — переносим в блоб один раз.
+        n = _prefs.getInt("count", 0);
+        if (n < 0 || n > TKWM_MAX_CRED) n = 0;
+        for (int i = 0; i < n; i++) {
+            ssid[i] = _prefs.getString((String("s") + i).c_str(), "");
+            pass[i] = _prefs.getString((String("p") + i).c_str(), "");
+        }
+        legacy = true;
     }
     _prefs.end();
+    for (int i = 0; i < n; i++) {
+        Cred& c = _creds[i];
+        c       = { ssid[i], pass[i] };
+        const uint8_t* e = ext[i];
+        if (extLen[i] >= TKWM_CRED_EXT_HINT) {
+            c.last = (e[0] & 1) != 0;
+            memcpy(c.bssid, e + 1, 6);
+            c.ch   = e[7];
+            c.ip   = tkwmRd32_(e + 8);
+            c.gw   = tkwmRd32_(e + 12);
+            c.mask = tkwmRd32_(e + 16);
+            c.dns  = tkwmRd32_(e + 20);
+        }
+        if (extLen[i] >= TKWM_CRED_EXT_LEN) {
+            c.hist     = e[24];
+            c.histN    = min(e[25], (uint8_t)8);
+            c.lastFail = e[26];
+            c.ttiPos   = e[27] & 3;
+            for (uint8_t k = 0; k < 4; k++) c.tti[k] = (uint16_t)(e[28 + 2 * k] | (e[29 + 2 * k] << 8));
+        }
+    }
+    _credN = n;
+    free(b);
+
+    if (legacy && saveCreds()) {
+        _prefs.begin("tkw_net", false);
+        _prefs.remove("count");
+        for (int i = 0; i < TKWM_MAX_CRED; i++) {
+            _prefs.remove((String("s") + i).c_str());
+            _prefs.remove((String("p") + i).c_str());
+        }
+        _prefs.end();
+        Serial.printf("[TKWM] creds migrated to blob (%d)\n", _credN);
+    }
 }
-void TKWifiManager::saveCount() {
-    _prefs.begin("tkw_net", false);
-    _prefs.putInt("count", _credN);
-    _prefs.end();
-}
-void TKWifiManager::saveAt(int idx, const String& ssid, const String& pass) {
-    if (idx < 0 || idx >= TKWM_MAX_CRED) return;
-    _prefs.begin("tkw_net", false);
-    _prefs.putString((String("s") + idx).c_str(), ssid);
-    _prefs.putString((String("p") + idx).c_str(), pass);
-    _prefs.end();
+
+bool TKWifiManager::saveCreds() {
+    size_t len = TKWM_CRED_HDR;
+    for (int i = 0; i < _credN; i++)
+        len += 3 + min(_creds[i].ssid.length(), 255u) + min(_creds[i].pass.length(), 255u) + (_creds[i].ch || _creds[i].histN ? TKWM_CRED_EXT_LEN : 0);
+    uint8_t* b = (uint8_t*)malloc(len);
+    if (!b) return false;
+    size_t o = TKWM_CRED_HDR;
+    for (int i = 0; i < _credN; i++) {
+        const Cred&   c    = _creds[i];
+        const String* f[2] = { &c.ssid, &c.pass };
+        for (const String* v : f) {
+            const uint8_t l = (uint8_t)min(v->length(), 255u);
+            b[o++]          = l;
+            memcpy(b + o, v->c_str(), l);
+            o += l;
+        }
+        if (!c.ch && !c.histN) {
+            b[o++] = 0;
+            continue;
+        }
+        b[o++] = TKWM_CRED_EXT_LEN;
+        b[o]   = c.last ? 1 : 0;
+        memcpy(b + o + 1, c.bssid, 6);
+        b[o + 7] = c.ch;
+        tkwmWr32_(b + o + 8, c.ip);
+        tkwmWr32_(b + o + 12, c.gw);
+        tkwmWr32_(b + o + 16, c.mask);
+        tkwmWr32_(b + o + 20, c.dns);
+        b[o + 24] = c.hist;
+        b[o + 25] = c.histN;
+        b[o + 26] = c.lastFail;
+        b[o + 27] = c.ttiPos;
+        for (uint8_t k = 0; k < 4; k++) {
+            b[o + 28 + 2 * k] = (uint8_t)c.tti[k];
+            b[o + 29 + 2 * k] = (uint8_t)(c.tti[k] >> 8);
+        }
+        o += TKWM_CRED_EXT_LEN;
+    }
+    b[0] = 'T';
+    b[1] = 'N';
+    b[2] = TKWM_CRED_BLOB_VER;
+    b[3] = (uint8_t)_credN;
+    tkwmWr32_(b + 4, tkwmCrc32_(b + TKWM_CRED_HDR, len - TKWM_CRED_HDR));
+
+    const uint32_t all = tkwmCrc32_(b, len);
+    bool           ok  = true;
+    if (all != _credBlobCrc) { // то же содержимое — flash не трогаем
+        _prefs.begin("tkw_net", false);
+        ok = _prefs.putBytes("creds", b, len) == len;
+        _prefs.end();
+        if (ok) _credBlobCrc = all;
+    }
+    if (ok) _credDirtyAt = 0;
+    free(b);
+    return ok;
 }
+
 int TKWifiManager::findBySsid(const String& ssid) const {
     for (int i = 0; i < _credN; i++) if (_creds[i].ssid == ssid) return i;
     return -1;
 }
 
 // ======================= Wi-Fi ========================
+// Явный отказ точки (нет AP / неверный пароль / handshake) — ждать таймаут попытки незачем.
+static bool tkwmConnHardFail_(uint8_t r) {
+    return r == WIFI_REASON_NO_AP_FOUND || r == WIFI_REASON_AUTH_FAIL ||
+        r == WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT || r == WIFI_REASON_HANDSHAKE_TIMEOUT;
+}
+
+// Режим для STA-попытки: поднятый AP (портал) не роняем — клиент настройки остаётся на связи.
+static void tkwmStaMode_() {
+    WiFi.mode((WiFi.getMode() & WIFI_AP) ? WIFI_AP_STA : WIFI_STA);
+}
+
+static void tkwmStaDhcp_() {
+#if TKWM_FAST_CONNECT_STATIC_IP
+    WiFi.config(IPAddress(), IPAddress(), IPAddress()); // 0.0.0.0 — снова DHCP (после прямой попытки со статикой)
+#endif
+}
+
 bool TKWifiManager::tryConnectBestKnown(uint32_t timeoutMs) {
+    connAbort();
     if (_credN == 0) return false;
-    // sync scan (AP не выключаем)
-    int n = WiFi.scanNetworks(/*async*/false, /*hidden*/true);
-    int bestRssi = -9999, bestIdx = -1;
-    for (int i = 0; i < n; i++) {
-        String s = WiFi.SSID(i);
-        int idx = findBySsid(s);
-        if (idx >= 0) {
-            int rssi = WiFi.RSSI(i);
-            if (rssi > bestRssi) { bestRssi = rssi; bestIdx = idx; }
-        }
-    }
-    if (bestIdx < 0) return false;
-
-    if (connectWithCred(_creds[bestIdx].ssid, _creds[bestIdx].pass, timeoutMs, 2)) {
-        _captiveMode = false;
-        _dns.stop();
-        Serial.print(F("[TKWM] Wi-Fi STA: SSID="));
-        Serial.print(_creds[bestIdx].ssid);
-        Serial.print(F(" IP="));
-        Serial.println(WiFi.localIP().toString());
-        return true;
+    _connStartedAt = millis();
+    // sync scan (AP не выключаем); результат заодно обновляет общий кэш скана. Вызывается только из begin()
+    // до маршрутов и планировщика сканов — делить в этот момент не с кем.
+    const int16_t n = WiFi.scanNetworks(/*async*/false, /*hidden*/true);
+    scanCollect(n);
+    WiFi.scanDelete();
+    connRank(n >= 0);
+    // Только видимые, лучшие по оценке первыми; лучшему — 2 попытки.
+    for (uint8_t p = 0; p < _connVisibleN && !connOverBudget(); p++) {
+        const int idx = _connOrder[p];
+        if (connectWithCred(_creds[idx].ssid, _creds[idx].pass, timeoutMs, p == 0 ? 2 : 1, _connCh[p], _connBssid[p])) {
+            connDone(idx, "scan");
+            return true;
+        }
+        connFail(p);
     }
     return false;
 }
 
 bool TKWifiManager::tryConnectBySavedOrder(uint32_t timeoutMs) {
+    connAbort();
     if (_credN == 0) return false;
-    for (int i = 0; i < _credN; ++i) {
-        if (connectWithCred(_creds[i].ssid, _creds[i].pass, timeoutMs, 1)) {
-            _captiveMode = false;
-            _dns.stop();
-            Serial.print(F("[TKWM] Wi-Fi STA fallback: SSID="));
-            Serial.print(_creds[i].ssid);
-            Serial.print(F(" IP="));
-            Serial.println(WiFi.localIP().toString());
+    _connStartedAt = millis();
+    // Без скана: сохранённые сети по оценке истории (успешные и быстрые — раньше).
+    connRank(false);
+    for (uint8_t p = 0; p < _connOrderN && !connOverBudget(); ++p) {
+        const int idx = _connOrder[p];
+        if (connectWithCred(_creds[idx].ssid, _creds[idx].pass, timeoutMs, 1)) {
+            connDone(idx, "saved");
             return true;
         }
+        connFail(p);
     }
     return false;
 }
 
-bool TKWifiManager::connectWithCred(const String& ssid, const String& pass, uint32_t timeoutMs, uint8_t attempts) {
+bool TKWifiManager::connectWithCred(const String& ssid, const String& pass, uint32_t timeoutMs, uint8_t attempts,
+                                    uint8_t ch, const uint8_t* bssid) {
     if (ssid.isEmpty()) return false;
+    tkwmStaDhcp_();
     for (uint8_t attempt = 0; attempt < attempts; ++attempt) {
-        WiFi.mode(WIFI_STA);
+        tkwmStaMode_();
         // Не стираем сохранённые настройки SDK, просто разрываем текущую сессию.
         WiFi.disconnect(false, true);
         delay(80);
-        WiFi.begin(ssid.c_str(), pass.c_str());
+        _connDiscReason = 0;
+        _connAttemptAt  = millis();
+        if (ch && bssid) WiFi.begin(ssid.c_str(), pass.c_str(), ch, bssid);
+        else WiFi.begin(ssid.c_str(), pass.c_str());
         const uint32_t t0 = millis();
-        while (WiFi.status() != WL_CONNECTED && millis() - t0 < timeoutMs) {
+        while (WiFi.status() != WL_CONNECTED && millis() - t0 < timeoutMs && !tkwmConnHardFail_(_connDiscReason)) {
             delay(120);
         }
         if (WiFi.status() == WL_CONNECTED) return true;
@@ -768,8 +1233,368 @@ bool TKWifiManager::connectWithCred(const String& ssid, const String& pass, uint
     return false;
 }
 
-void TKWifiManager::startAPCaptive() {
+// ============ Ранжирование кандидатов ============
+// Оценка сети = RSSI (дБм) + доля успехов последних 8 попыток (−20…+20) − медиана времени до IP
+// (−1 за 0.5 с, до −20) − 30 за «похоже на неверный пароль» − 100 за недавно провалившийся BSSID.
+// Сильная точка, которая стабильно не пускает, через пару провалов уступает место соседям.
+int TKWifiManager::credScore(int idx, int rssi, bool banned) const {
+    const Cred& c = _creds[idx];
+    int s = rssi;
+    if (c.histN) {
+        int ok = 0;
+        for (uint8_t k = 0; k < c.histN; k++) ok += (c.hist >> k) & 1;
+        s += ok * 40 / c.histN - 20;
+    }
+    uint16_t v[4];
+    uint8_t  m = 0;
+    for (uint8_t k = 0; k < 4; k++) {
+        if (!c.tti[k]) continue;
+        uint8_t j = m++;
+        while (j > 0 && v[j - 1] > c.tti[k]) { v[j] = v[j - 1]; j--; }
+        v[j] = c.tti[k];
+    }
+    if (m) s -= min(v[m / 2] / 500, 20);
+    if (tkwmAuthFail_(c.lastFail)) s -= 30;
+    if (banned) s -= 100;
+    return s;
+}
+
+void TKWifiManager::credRecord(int idx, bool ok, uint8_t reason) {
+    Cred& c = _creds[idx];
+    c.hist  = (uint8_t)((c.hist << 1) | (ok ? 1 : 0));
+    if (c.histN < 8) c.histN++;
+    if (ok) {
+        c.lastFail     = 0;
+        c.tti[c.ttiPos] = (uint16_t)max<uint32_t>(1, min<uint32_t>(millis() - _connAttemptAt, 65535));
+        c.ttiPos       = (c.ttiPos + 1) & 3;
+    } else {
+        c.lastFail = reason ? reason : (uint8_t)WIFI_REASON_UNSPECIFIED; // 0 — таймаут без причины
+        if (!_credDirtyAt) _credDirtyAt = millis() | 1;
+    }
+}
+
+void TKWifiManager::connRank(bool useScan) {
+    int    score[TKWM_MAX_CRED];
+    int8_t net[TKWM_MAX_CRED]; // индекс точки в _scanNets, -1 — сеть не видна
+    for (int i = 0; i < _credN; ++i) {
+        // Кэш отсортирован по RSSI: берём сильнейший не забаненный BSSID сети, иначе сильнейший вообще.
+        net[i] = -1;
+        for (int j = 0; useScan && j < _scanN; ++j) {
+            if (_scanNets[j].ssid != _creds[i].ssid) continue;
+            if (net[i] < 0) net[i] = (int8_t)j;
+            if (!bssidBanned(_scanNets[j].bssid)) {
+                net[i] = (int8_t)j;
+                break;
+            }
+        }
+        const bool vis = net[i] >= 0;
+        score[i] = credScore(i, vis ? _scanNets[net[i]].rssi : -100, vis && bssidBanned(_scanNets[net[i]].bssid));
+    }
+    // Вставками: видимые раньше невидимых, внутри — по убыванию оценки, при равенстве — сохранённый порядок.
+    _connOrderN = 0;
+    _connVisibleN = 0;
+    for (int i = 0; i < _credN; ++i) {
+        const bool vis = net[i] >= 0;
+        int k = _connOrderN++;
+        while (k > 0) {
+            const int  o    = _connOrder[k - 1];
+            const bool oVis = net[o] >= 0;
+            if (oVis > vis || (oVis == vis && score[o] >= score[i])) break;
+            _connOrder[k] = _connOrder[k - 1];
+            k--;
+        }
+        _connOrder[k] = (int8_t)i;
+        if (vis) _connVisibleN++;
+    }
+    for (uint8_t p = 0; p < _connOrderN; ++p) {
+        const int j = net[_connOrder[p]];
+        _connCh[p] = j >= 0 ? _scanNets[j].ch : 0;
+        if (j >= 0) memcpy(_connBssid[p], _scanNets[j].bssid, 6);
+    }
+}
+
+void TKWifiManager::connFail(uint8_t pos) {
+    credRecord(_connOrder[pos], false, _connDiscReason);
+    if (_connCh[pos]) bssidBan(_connBssid[pos]);
+}
+
+bool TKWifiManager::connOverBudget() const {
+    return TKWM_CONNECT_BUDGET_MS && (uint32_t)(millis() - _connStartedAt) >= TKWM_CONNECT_BUDGET_MS;
+}
+
+void TKWifiManager::bssidBan(const uint8_t* bssid) {
+    BadBssid& b = _badBssid[_badBssidPos];
+    _badBssidPos = (_badBssidPos + 1) % (sizeof(_badBssid) / sizeof(_badBssid[0]));
+    memcpy(b.bssid, bssid, 6);
+    b.until = (millis() + TKWM_BSSID_BAN_MS) | 1;
+}
+
+bool TKWifiManager::bssidBanned(const uint8_t* bssid) const {
+    const uint32_t now = millis();
+    for (const BadBssid& b : _badBssid)
+        if (b.until && (int32_t)(b.until - now) > 0 && !memcmp(b.bssid, bssid, 6)) return true;
+    return false;
+}
+
+// ============ Быстрое подключение по подсказке (BSSID/канал/аренда) ============
+// После успешного подключения запоминаем BSSID, канал и аренду DHCP сети. При загрузке и
+// переподключении сначала идёт прямой WiFi.begin(ssid, pass, ch, bssid) — без скана 2–5 с;
+// не вышло за TKWM_FAST_CONNECT_MS — обычный путь со сканом.
+int TKWifiManager::fastCandidate() const {
+    for (int i = 0; i < _credN; i++)
+        if (_creds[i].last && _creds[i].ch) return i;
+    return -1;
+}
+
+void TKWifiManager::fastBegin(int idx) {
+    const Cred& c = _creds[idx];
+#if TKWM_FAST_CONNECT_STATIC_IP
+    if (c.ip && c.mask) WiFi.config(IPAddress(c.ip), IPAddress(c.gw), IPAddress(c.mask), IPAddress(c.dns));
+#endif
+    _connAttemptAt = millis();
+    WiFi.begin(c.ssid.c_str(), c.pass.c_str(), c.ch, c.bssid);
+}
+
+void TKWifiManager::fastDrop() {
+    WiFi.disconnect(false, true);
+    tkwmStaDhcp_();
+}
+
+bool TKWifiManager::tryConnectFast(uint32_t timeoutMs) {
+    connAbort();
+    const int idx = fastCandidate();
+    if (idx < 0) return false;
+    _connStartedAt = millis();
+    tkwmStaMode_();
+    WiFi.disconnect(false, true);
+    delay(80);
+    _connDiscReason = 0;
+    fastBegin(idx);
+    const uint32_t t0 = millis();
+    while (WiFi.status() != WL_CONNECTED && millis() - t0 < timeoutMs && !tkwmConnHardFail_(_connDiscReason)) delay(50);
+    if (WiFi.status() == WL_CONNECTED) {
+        connDone(idx, "fast");
+        return true;
+    }
+    Serial.println(F("[TKWM] fast connect failed"));
+    if (tkwmConnHardFail_(_connDiscReason)) bssidBan(_creds[idx].bssid);
+    fastDrop();
+    return false;
+}
+
+void TKWifiManager::connDone(int idx, const char* path) {
+    _connMs   = millis() - _connStartedAt;
+    _connPath = path;
+    // Из портала: AP ещё TKWM_AP_LINGER_MS держим — страница получит "ok" с новым IP.
+    if (_captiveMode) _apDropAt = (millis() + TKWM_AP_LINGER_MS) | 1;
+    _captiveMode = false;
+    _apRetrySta  = false;
+    _dns.stop();
+    Serial.printf("[TKWM] Wi-Fi STA: SSID=%s IP=%s (%s, %lu ms)\n", _creds[idx].ssid.c_str(), WiFi.localIP().toString().c_str(), path,
+                  (unsigned long)_connMs);
+    // Подсказка на следующий раз; saveCreds() не трогает flash, если ничего не изменилось.
+    for (int i = 0; i < _credN; i++) _creds[i].last = (i == idx);
+    Cred&          c = _creds[idx];
+    const uint8_t* b = WiFi.BSSID();
+    if (b) memcpy(c.bssid, b, 6);
+    c.ch   = b ? (uint8_t)WiFi.channel() : 0;
+    c.ip   = (uint32_t)WiFi.localIP();
+    c.gw   = (uint32_t)WiFi.gatewayIP();
+    c.mask = (uint32_t)WiFi.subnetMask();
+    c.dns  = (uint32_t)WiFi.dnsIP(0);
+    credRecord(idx, true, 0);
+    saveCreds();
+    _connFallbackAp = false;
+    if (!_bootLinked) {
+        _bootLinked = true;
+        bootMark("sta");
+    }
+    if (_eventHook) _eventHook(Event::StaConnected);
+}
+
+// ============ Неблокирующий движок подключения ============
+// Та же стратегия, что tryConnectBestKnown() + tryConnectBySavedOrder(), но разложенная на шаги:
+// асинхронный скан → видимые по убыванию оценки (лучшему 2 попытки) → невидимые по оценке истории,
+// всё в пределах TKWM_CONNECT_BUDGET_MS.
+// Каждый вызов connTick() выполняет не больше одного короткого действия и сразу возвращается.
+void TKWifiManager::hookWifiEvents() {
+    if (_wifiEventId) return;
+    // Колбэк выполняется в задаче событий Wi-Fi — только выставляем флаги, остальное делает connTick().
+    _wifiEventId = WiFi.onEvent([this](arduino_event_id_t e, arduino_event_info_t info) {
+        if (e == ARDUINO_EVENT_WIFI_STA_GOT_IP) _connGotIp = true;
+        else if (e == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) _connDiscReason = info.wifi_sta_disconnected.reason;
+    });
+}
+
+void TKWifiManager::connStart() {
+    if (_credN == 0 || connBusy()) return;
+    _connRoam = false;
+    _connStartedAt = millis();
+    _connOrderN = 0;
+    const int f = fastCandidate();
+    // Из портала прямую попытку не делаем: запомненный канал может увести AP; скан AP не трогает.
+    if (f < 0 || _captiveMode) {
+        connScanStart();
+        return;
+    }
+    _connFastIdx = (int8_t)f;
+    tkwmStaMode_();
+    WiFi.disconnect(false, true);
+    _connPhase = ConnPhase::FastSettle;
+    _connPhaseAt = _connStartedAt;
+    connPublish("fast", f);
+}
+
+void TKWifiManager::connScanStart() {
+    _connOrderN = 0;
+    _connVisibleN = 0;
+    _connPos = 0;
+    _connTry = 0;
+    _connPhaseAt = millis();
+    if (!scanRequest()) {
+        // Без скана — сохранённые сети по оценке истории.
+        connRank(false);
+        connBeginCandidate();
+        return;
+    }
+    _connPhase = ConnPhase::Scan;
+    connPublish("scan", -1);
+}
+
+void TKWifiManager::connAbort() {
+    // Скан (если идёт) не прерываем — он общий, его результат попадёт в кэш.
+    _connPhase = ConnPhase::Idle;
+}
+
+void TKWifiManager::connBeginCandidate() {
+    if (_connPos >= _connOrderN || connOverBudget()) {
+        _connPhase = ConnPhase::Idle;
+        Serial.println(_connPos >= _connOrderN ? F("[TKWM] Wi-Fi STA: no saved network reachable")
+                                               : F("[TKWM] Wi-Fi STA: connect budget exhausted"));
+        connPublish("fail", -1);
+        if (_connFallbackAp) startAPCaptive(true);
+        // Неудачный роуминг — сразу обратно через обычный подбор (прямая попытка на прежнюю точку).
+        if (_connRoam) connStart();
+        return;
+    }
+    tkwmStaMode_();
+    // Не стираем сохранённые настройки SDK, просто разрываем текущую сессию.
+    WiFi.disconnect(false, true);
+    tkwmStaDhcp_();
+    _connGotIp = false;
+    _connPhase = ConnPhase::Settle;
+    _connPhaseAt = millis();
+    connPublish("try", _connOrder[_connPos]);
+    // Одно радио: STA на другом канале утащит за собой AP. Переносим AP заранее и предупреждаем
+    // страницу (HTTP-ответ уже ушёл) — телефон переподключится к той же открытой сети.
+    const uint8_t ch = _connCh[_connPos];
+    if (_captiveMode && ch && ch != WiFi.channel()) {
+        Serial.printf("[TKWM] AP -> ch %u for STA probe\n", ch);
+        String out;
+        TkwmJson j(out);
+        j.objOpen().kv("type", "conn").kv("phase", "switch").kvi("ch", ch).objClose().end();
+        _ws.broadcastTXT(out);
+        TKWM_METRIC(_mWsTx++);
+        WiFi.softAP(_apSsid.c_str(), nullptr, ch);
+    }
+}
+
+void TKWifiManager::connNextCandidate() {
+    const uint8_t maxTry = (_connPos == 0 && _connVisibleN > 0) ? 2 : 1;
+    if (++_connTry >= maxTry) {
+        _connTry = 0;
+        _connPos++;
+    }
+    connBeginCandidate();
+}
+
+void TKWifiManager::connTick() {
+    if (_connPhase == ConnPhase::Idle) return;
+    const uint32_t now = millis();
+    switch (_connPhase) {
+    case ConnPhase::FastSettle: {
+        if ((now - _connPhaseAt) < 80) return;
+        _connGotIp = false;
+        _connDiscReason = 0;
+        fastBegin(_connFastIdx);
+        _connPhase = ConnPhase::Fast;
+        _connPhaseAt = now;
+    } break;
+    case ConnPhase::Fast: {
+        if (_connGotIp || WiFi.status() == WL_CONNECTED) {
+            _connPhase = ConnPhase::Idle;
+            connDone(_connFastIdx, "fast");
+            connPublish("ok", _connFastIdx);
+            return;
+        }
+        if (tkwmConnHardFail_(_connDiscReason) || (now - _connPhaseAt) >= TKWM_FAST_CONNECT_MS) {
+            Serial.println(F("[TKWM] fast connect failed, scanning"));
+            // Явный отказ запомненной точки — в скане предпочтём другую точку той же сети.
+            if (tkwmConnHardFail_(_connDiscReason)) bssidBan(_creds[_connFastIdx].bssid);
+            fastDrop();
+            connScanStart();
+        }
+    } break;
+    case ConnPhase::Scan: {
+        if (WiFi.status() == WL_CONNECTED) {
+            // Пока шёл скан, мягкий reconnect уже поднял линк — дальше идти незачем.
+            connAbort();
+            return;
+        }
+        if (_scanRunning) return; // таймаут скана отслеживает scanTick()
+        // Кэш старше старта попытки — скан не удался; ранжируем только по истории.
+        connRank(_scanAt != 0 && (int32_t)(_scanAt - _connPhaseAt) >= 0);
+        connBeginCandidate();
+    } break;
+    case ConnPhase::Settle: {
+        // Пауза после disconnect, как раньше delay(80), только без остановки тика.
+        if ((now - _connPhaseAt) < 80) return;
+        const Cred& c = _creds[_connOrder[_connPos]];
+        _connGotIp = false;
+        _connDiscReason = 0;
+        _connAttemptAt = now;
+        // Видимая сеть — сразу на выбранную точку (BSSID + канал), без внутреннего скана драйвера.
+        if (_connCh[_connPos]) WiFi.begin(c.ssid.c_str(), c.pass.c_str(), _connCh[_connPos], _connBssid[_connPos]);
+        else WiFi.begin(c.ssid.c_str(), c.pass.c_str());
+        _connPhase = ConnPhase::Attempt;
+        _connPhaseAt = now;
+    } break;
+    case ConnPhase::Attempt: {
+        if (_connGotIp || WiFi.status() == WL_CONNECTED) {
+            const int idx = _connOrder[_connPos];
+            _connPhase = ConnPhase::Idle;
+            connDone(idx, _connRoam ? "roam" : "scan");
+            connPublish("ok", idx);
+            return;
+        }
+        if (tkwmConnHardFail_(_connDiscReason) || (now - _connPhaseAt) >= TKWM_CONNECT_ATTEMPT_MS || connOverBudget()) {
+            connFail(_connPos);
+            connNextCandidate();
+        }
+    } break;
+    default:
+        break;
+    }
+}
+
+void TKWifiManager::connPublish(const char* phase, int credIdx) {
+    String out;
+    TkwmJson j(out);
+    j.objOpen().kv("type", "conn").kv("phase", phase);
+    if (credIdx >= 0) j.kv("ssid", _creds[credIdx].ssid);
+    if (credIdx >= 0 && _connOrderN) j.kvi("n", _connPos + 1).kvi("of", _connOrderN);
+    if (!strcmp(phase, "ok")) j.kv("path", _connPath).kvu("ms", _connMs).kv("ip", WiFi.localIP().toString());
+    j.objClose().end();
+    _ws.broadcastTXT(out);
+    TKWM_METRIC(_mWsTx++);
+}
+
+void TKWifiManager::startAPCaptive(bool retrySta) {
+    connAbort();
     _captiveMode = true;
+    _apDropAt = 0;
+    _apRetrySta = retrySta && _credN > 0;
+    if (_apRetrySta) reconnectSchedule(millis()); // счётчик попыток продолжается — пауза растёт дальше
 
     // уникальный SSID: <prefix>-XXXXXX
     if (!_apSsid.length()) {
@@ -787,6 +1612,12 @@ void TKWifiManager::startAPCaptive() {
     Serial.print(_apSsid);
     Serial.print(F(" IP="));
     Serial.println(WiFi.softAPIP().toString());
+    _connFallbackAp = false;
+    if (!_bootLinked) {
+        _bootLinked = true;
+        bootMark("ap");
+    }
+    if (_eventHook) _eventHook(Event::ApStarted);
 }
 
 void TKWifiManager::bgTaskEntry(void* arg) {
@@ -795,9 +1626,12 @@ void TKWifiManager::bgTaskEntry(void* arg) {
         vTaskDelete(nullptr);
         return;
     }
+    // Паузу между тиками даёт vTaskDelay ниже; delay(1) внутри пустого handleClient() лишний.
+    self->_server.enableDelay(false);
     while (self->_bgTaskRunning) {
         self->serviceTick();
-        vTaskDelay(pdMS_TO_TICKS(TKWM_TASK_TICK_MS));
+        // Во время активного HTTP-обмена — минимальная пауза, иначе каждый запрос ждёт тик.
+        vTaskDelay(self->httpActive() ? 1 : pdMS_TO_TICKS(TKWM_TASK_TICK_MS));
     }
     self->_bgTaskHandle = nullptr;
     vTaskDelete(nullptr);
@@ -806,61 +1640,97 @@ void TKWifiManager::bgTaskEntry(void* arg) {
 // ===================== Web/Routes =====================
 void TKWifiManager::setupRoutes() {
     // главная
-    _server.on("/", HTTP_GET, [this] { handleRoot(); });
+    route("/", HTTP_GET, [this] { handleRoot(); });
 
     // captive детекторы
-    _server.on("/generate_204", HTTP_ANY, [this] { handleCaptiveProbe(); });
-    _server.on("/hotspot-detect.html", HTTP_ANY, [this] { handleCaptiveProbe(); });
-    _server.on("/ncsi.txt", HTTP_ANY, [this] { handleCaptiveProbe(); });
+    route("/generate_204", HTTP_ANY, [this] { handleCaptiveProbe(); });
+    route("/hotspot-detect.html", HTTP_ANY, [this] { handleCaptiveProbe(); });
+    route("/ncsi.txt", HTTP_ANY, [this] { handleCaptiveProbe(); });
 
     // Wi-Fi
-    _server.on("/wifi", HTTP_GET, [this] { handleWifiPage(); });
-    _server.on("/api/wifi/save", HTTP_POST, [this] { handleWifiSave(); });
-    _server.on("/api/reconnect", HTTP_POST, [this] { handleReconnect(); });
-    _server.on("/api/start_ap", HTTP_POST, [this] { handleStartAP(); });
-    _server.on("/api/wifi/saved", HTTP_GET, [this] { handleWifiListSaved(); });
-    _server.on("/api/wifi/delete", HTTP_POST, [this] { handleWifiDelete();    });
-    _server.on("/api/wifi/scan",  HTTP_GET,  [this] { handleWifiScan();      });
+    route("/wifi", HTTP_GET, [this] { handleWifiPage(); });
+    route("/api/wifi/save", HTTP_POST, [this] { handleWifiSave(); });
+    route("/api/reconnect", HTTP_POST, [this] { handleReconnect(); });
+    route("/api/start_ap", HTTP_POST, [this] { handleStartAP(); });
+    route("/api/wifi/saved", HTTP_GET, [this] { handleWifiListSaved(); });
+    route("/api/wifi/link", HTTP_GET, [this] { handleWifiLink(); });
+    route("/api/wifi/delete", HTTP_POST, [this] { handleWifiDelete();    });
+    route("/api/wifi/scan",  HTTP_GET,  [this] { handleWifiScan();      });
 
     // FS API
-    _server.on("/api/fs/list", HTTP_GET, [this] { handleFsList();   });
-    _server.on("/api/fs/get", HTTP_GET, [this] { handleFsGet();    });
-    _server.on("/api/fs/put", HTTP_POST, [this] { handleFsPut();    });
-    _server.on("/api/fs/delete", HTTP_POST, [this] { handleFsDelete(); });
-    _server.on("/api/fs/mkdir", HTTP_POST, [this] { handleFsMkdir();  });
+    route("/api/fs/list", HTTP_GET, [this] { handleFsList();   });
+    route("/api/fs/get", HTTP_GET, [this] { handleFsGet();    });
+    route("/api/fs/download", HTTP_GET, [this] { handleFsDownload(); });
+    route("/api/fs/put", HTTP_POST, [this] { handleFsPut();    });
+    route("/api/fs/delete", HTTP_POST, [this] { handleFsDelete(); });
+    route("/api/fs/mkdir", HTTP_POST, [this] { handleFsMkdir();  });
 
     // FS страница
-    _server.on("/fs", HTTP_GET, [this]() {
+    route("/fs", HTTP_GET, [this]() {
         if (_fsOk && streamIfExists("/fs.html")) return;
-        _server.send(200, "text/html; charset=utf-8", builtinFs());
+        sendBuiltin("/fs.html");
         });
 
     // Загрузка (multipart). Путь обязателен через ?to=/полный/путь/имя
-    _server.on("/upload", HTTP_POST, [this] { handleUploadDone(); }, [this] { handleUpload(); });
+    route("/upload", HTTP_POST, [this] { handleUploadDone(); }, [this] { handleUpload(); });
 
     // OTA
-    _server.on("/ota", HTTP_GET, [this] { handleOtaPage(); });
-    _server.on("/ota", HTTP_POST, [this] { handleOtaFinish(); }, [this] { handleOtaUpload(); });
-    _server.on("/api/ota/info", HTTP_GET, [this] { handleOtaInfo(); });
-    _server.on("/api/ota/config", HTTP_GET, [this] { handleOtaConfig(); });
-    _server.on("/api/ota/check", HTTP_POST, [this] { handleOtaCheck(); });
-    _server.on("/api/ota/install", HTTP_POST, [this] { handleOtaInstall(); });
-    _server.on("/api/ota/save", HTTP_POST, [this] { handleOtaSaveSettings(); });
-    _server.on("/api/ota/sync-time", HTTP_POST, [this] { handleOtaSyncTime(); });
-    _server.on("/api/ota/timezones", HTTP_GET, [this] { handleOtaTimezones(); });
+    route("/ota", HTTP_GET, [this] { handleOtaPage(); });
+    route("/ota", HTTP_POST, [this] { handleOtaFinish(); }, [this] { handleOtaUpload(); });
+    route("/api/ota/info", HTTP_GET, [this] { handleOtaInfo(); });
+    route("/api/ota/config", HTTP_GET, [this] { handleOtaConfig(); });
+    route("/api/ota/check", HTTP_POST, [this] { handleOtaCheck(); });
+    route("/api/ota/install", HTTP_POST, [this] { handleOtaInstall(); });
+    route("/api/ota/progress", HTTP_GET, [this] { handleOtaProgress(); });
+    route("/api/ota/cancel", HTTP_POST, [this] { handleOtaCancel(); });
+    route("/api/ota/save", HTTP_POST, [this] { handleOtaSaveSettings(); });
+    route("/api/ota/sync-time", HTTP_POST, [this] { handleOtaSyncTime(); });
+    route("/api/ota/sync-time", HTTP_GET, [this] { handleOtaSyncTime(); });
+    route("/api/ota/timezones", HTTP_GET, [this] { handleOtaTimezones(); });
+
+    route("/api/boot", HTTP_GET, [this] { handleBoot(); });
+
+#if TKWM_METRICS
+    route("/api/metrics", HTTP_GET, [this] { handleMetrics(); });
+#endif
 
     // 404
-    _server.onNotFound([this] { handleNotFound(); });
+    Route notFound = [this] { handleNotFound(); };
+#if TKWM_METRICS
+    notFound = metricWrap("*", HTTP_ANY, std::move(notFound));
+#endif
+    _server.onNotFound([this, notFound] {
+        _httpReqN++;
+        notFound();
+    });
+
+    // WebServer хранит только перечисленные заголовки запроса
+    static const char* collect[] = { "If-None-Match", "If-Modified-Since", "Accept-Encoding", "Range", "If-Range" };
+    _server.collectHeaders(collect, sizeof(collect) / sizeof(collect[0]));
+}
+
+void TKWifiManager::route(const char* uri, HTTPMethod method, Route h, Route upload) {
+#if TKWM_METRICS
+    h = metricWrap(uri, method, std::move(h));
+#endif
+    h = [this, h] {
+        _httpReqN++;
+        h();
+    };
+    if (upload) _server.on(uri, method, h, upload);
+    else _server.on(uri, method, h);
 }
 
+
 void TKWifiManager::setupWebSocket() {
     _ws.onEvent([this](uint8_t id, WStype_t t, uint8_t* p, size_t l) {
         switch (t) {
         case WStype_CONNECTED: wsSendStatus(id); break;
         case WStype_TEXT: {
+            TKWM_METRIC(_mWsRx++; _mWsRxBytes += l);
             String s; s.reserve(l);
             for (size_t i = 0; i < l; i++) s += (char)p[i];
-            if (s == "scan")       wsRunScanAndPublish();
+            if (s == "scan")       wsRunScanAndPublish(id);
             else if (s == "status") wsSendStatus(id);
             else if (_userWsHook)   _userWsHook(id, t, p, l);
         } break;
@@ -873,7 +1743,7 @@ void TKWifiManager::setupWebSocket() {
 // ===================== HTTP handlers ===================
 void TKWifiManager::handleRoot() {
     if (_fsOk && streamIfExists("/index.html")) return;
-    _server.send(200, "text/html; charset=utf-8", builtinIndex());
+    sendBuiltin("/index.html");
 }
 
 void TKWifiManager::handleCaptiveProbe() {
@@ -888,7 +1758,7 @@ void TKWifiManager::handleCaptiveProbe() {
 
 void TKWifiManager::handleWifiPage() {
     if (_fsOk && streamIfExists("/wifi.html")) return;
-    _server.send(200, "text/html; charset=utf-8", builtinWifi());
+    sendBuiltin("/wifi.html");
 }
 
 void TKWifiManager::handleWifiSave() {
@@ -898,76 +1768,69 @@ void TKWifiManager::handleWifiSave() {
         return;
     }
     String          ssid, pass;
-
-    if (!tkwmJsonGetString(body, "ssid", ssid)) {
+    TkwmJsonPick    pk(body);
+    pk.str("ssid", ssid).str("password", pass).run();
+    if (!pk.found("ssid")) {
         _server.send(200, "application/json", "{\"ok\":false,\"msg\":\"ssid required\"}");
         return;
     }
-    if (!tkwmJsonGetString(body, "password", pass)) pass = "";
 
     if (ssid.isEmpty()) { _server.send(200, "application/json", "{\"ok\":false,\"msg\":\"ssid empty\"}"); return; }
 
     int idx = findBySsid(ssid);
     if (idx < 0) {
         if (_credN >= TKWM_MAX_CRED) { _server.send(200, "application/json", "{\"ok\":false,\"msg\":\"full\"}"); return; }
-        _creds[_credN] = { ssid, pass }; saveAt(_credN, ssid, pass); _credN++; saveCount();
+        _creds[_credN++] = { ssid, pass };
     }
     else {
-        _creds[idx].pass = pass; saveAt(idx, ssid, pass);
+        Cred& c = _creds[idx];
+        if (c.pass != pass) {
+            // Новый пароль — старая история провалов к нему не относится.
+            c.pass = pass;
+            c.hist = c.histN = c.lastFail = 0;
+        }
     }
+    saveCreds();
 
-    bool ok = tryConnectBestKnown();
-    if (ok) {
-        String out = String("{\"ok\":true,\"connected\":true,\"ip\":\"") + WiFi.localIP().toString() + "\"}";
-        _server.send(200, "application/json", out);
-    }
-    else {
-        _server.send(200, "application/json", "{\"ok\":true,\"connected\":false}");
-    }
+    // И в портале, и в STA ответ сразу: подбор идёт движком в фоне, итог — WS {"type":"conn"}.
+    // Синхронный tryConnectBestKnown() держал бы задачу tkwm десятки секунд (скан + попытки).
+    connAbort();
+    connStart();
+    _server.send(200, "application/json", "{\"ok\":true,\"connected\":false,\"pending\":true}");
 }
 
 void TKWifiManager::handleReconnect() {
-    bool ok = tryConnectBestKnown();
-    if (ok) {
-        String out = String("{\"ok\":true,\"ip\":\"") + WiFi.localIP().toString() + "\"}";
-        _server.send(200, "application/json", out);
-    }
-    else {
-        _server.send(200, "application/json", "{\"ok\":false}");
+    if (_credN == 0) {
+        _server.send(200, "application/json", "{\"ok\":false,\"msg\":\"no saved networks\"}");
+        return;
     }
+    connAbort();
+    connStart();
+    _server.send(200, "application/json", "{\"ok\":true,\"pending\":true}");
 }
 
 void TKWifiManager::handleStartAP() {
     startAPCaptive();
     _server.send(200, "application/json", "{\"ok\":true}");
-    String mode = "AP";
-    String ipS = WiFi.softAPIP().toString();
-    String j = String("{\"type\":\"status\",\"mode\":\"") + mode + "\",\"ip\":\"" + ipS + "\"}";
-    _ws.broadcastTXT(j);
+    _ws.broadcastTXT(wsStatusMessage());
+    TKWM_METRIC(_mWsTx++);
 }
 
 void TKWifiManager::handleWifiListSaved() {
-    // Ответ: { "ok": true, "nets": [ "ssid1", "ssid2", ... ] }
-    String out;
-    out.reserve(_credN * 24 + 32);
-    out += F("{\"ok\":true,\"nets\":[");
+    // Ответ: { "ok": true, "nets": [ "ssid1", ... ], "stats": [ {"ssid","tries","ok","ttiMs","fail"}, ... ] }
+    TkwmJson j(_server);
+    j.begin();
+    j.objOpen().kvb("ok", true).key("nets").arrOpen();
+    for (int i = 0; i < _credN; ++i) j.str(_creds[i].ssid);
+    j.arrClose().key("stats").arrOpen();
     for (int i = 0; i < _credN; ++i) {
-        if (i) out += ',';
-        out += '\"';
-        const String& s = _creds[i].ssid;
-        for (size_t k = 0; k < s.length(); ++k) {
-            char c = s[k];
-            if (c == '\"' || c == '\\') { out += '\\'; out += c; }
-            else if ((uint8_t)c < 0x20) {
-                char esc[7]; snprintf(esc, sizeof(esc), "\\u%04X", (unsigned char)c);
-                out += esc;
-            }
-            else out += c;
-        }
-        out += '\"';
+        const Cred& c  = _creds[i];
+        int         ok = 0;
+        for (uint8_t k = 0; k < c.histN; k++) ok += (c.hist >> k) & 1;
+        const uint16_t last = c.tti[(c.ttiPos + 3) & 3];
+        j.objOpen().kv("ssid", c.ssid).kvi("tries", c.histN).kvi("ok", ok).kvu("ttiMs", last).kvi("fail", c.lastFail).objClose();
     }
-    out += "]}";
-    _server.send(200, "application/json", out);
+    j.arrClose().objClose().end();
 }
 
 void TKWifiManager::handleWifiDelete() {
@@ -978,23 +1841,16 @@ void TKWifiManager::handleWifiDelete() {
     int idx = findBySsid(ssid);
     if (idx < 0) { _server.send(200, "application/json", "{\"ok\":true,\"removed\":false}"); return; }
 
-    // сдвигаем массив
+    // Движок держит индексы _creds (_connOrder, _connFastIdx, _connCh/_connBssid по позициям) — после сдвига
+    // он попробовал бы соседнюю сеть или устаревший _creds[_credN]. Останавливаем и перезапускаем с новым списком.
+    const bool wasBusy = connBusy();
+    connAbort();
+    // сдвигаем массив и пишем блоб одной операцией
     for (int i = idx; i < _credN - 1; ++i) _creds[i] = _creds[i + 1];
     _credN--;
-
-    // перезапишем хранилище заново (простая и надёжная тактика)
-    _prefs.begin("tkw_net", false);
-    _prefs.putInt("count", _credN);
-    for (int i = 0; i < _credN; ++i) {
-        _prefs.putString((String("s") + i).c_str(), _creds[i].ssid);
-        _prefs.putString((String("p") + i).c_str(), _creds[i].pass);
-    }
-    // подчистим «хвост» старых ключей (не обязательно, но приятно)
-    for (int i = _credN; i < TKWM_MAX_CRED; ++i) {
-        _prefs.remove((String("s") + i).c_str());
-        _prefs.remove((String("p") + i).c_str());
-    }
-    _prefs.end();
+    _creds[_credN] = Cred();
+    saveCreds();
+    if (wasBusy) connStart();
 
     _server.send(200, "application/json", "{\"ok\":true,\"removed\":true}");
 
@@ -1005,25 +1861,18 @@ void TKWifiManager::handleWifiDelete() {
 // ===== FS API =====
 
 // Рекурсивный обход директорий для handleFsList
-static void fsListDir_(File dir, String& out, bool& first) {
+static void fsListDir_(File dir, TkwmJson& j) {
     for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
         if (f.isDirectory()) {
-            fsListDir_(f, out, first);
+            fsListDir_(f, j);
         } else {
-            const char* name = f.name();
-            if (tkwmFsPathIsOtaConf_(String(name))) {
+            // ядро 2.x: name() — только имя файла, полный путь /dir/file.txt — path()
+            const char* path = f.path();
+            if (tkwmFsPathIsOtaConf_(String(path))) {
                 f.close();
                 continue;
             }
-            if (!first) out += ",";
-            first = false;
-            out += F("{\"path\":\"");
-            // f.name() в LittleFS возвращает полный путь вида /dir/file.txt
-            for (; *name; ++name) {
-                if (*name == '\"' || *name == '\\') { out += '\\'; out += *name; }
-                else out += *name;
-            }
-            out += F("\",\"size\":"); out += String((uint32_t)f.size()); out += '}';
+            j.objOpen().kv("path", path).kvu("size", (unsigned long)f.size()).objClose();
         }
         f.close();
     }
@@ -1031,12 +1880,12 @@ static void fsListDir_(File dir, String& out, bool& first) {
 
 void TKWifiManager::handleFsList() {
     if (!_fsOk) { _server.send(500, "application/json", "{\"files\":[]}"); return; }
-    String out = "{\"files\":[";
+    TkwmJson j(_server);
+    j.begin();
+    j.objOpen().key("files").arrOpen();
     File root = TKWM_FS.open("/");
-    bool first = true;
-    fsListDir_(root, out, first);
-    out += "]}";
-    _server.send(200, "application/json", out);
+    fsListDir_(root, j);
+    j.arrClose().objClose().end();
 }
 
 void TKWifiManager::handleFsGet() {
@@ -1053,54 +1902,46 @@ void TKWifiManager::handleFsGet() {
 
     File f = TKWM_FS.open(path, "r");
     size_t sz = f.size();
+    TkwmJson j(_server);
+    j.begin();
     if (sz > 256 * 1024 || !looksText(f)) {
         f.close();
-        String resp = String("{\"ok\":false,\"binary\":true,\"size\":") + sz + "}";
-        _server.send(200, "application/json", resp);
+        j.objOpen().kvb("ok", false).kvb("binary", true).kvu("size", (unsigned long)sz).objClose().end();
         return;
     }
 
-    // ——— Стримовый ответ (chunked) с корректным JSON-экранированием текста ———
-    _server.setContentLength(CONTENT_LENGTH_UNKNOWN);
-    _server.send(200, "application/json", ""); // заголовки
-
-    auto sendChunk = [this](const String& s) { _server.sendContent(s); };
-
-    sendChunk(F("{\"ok\":true,\"text\":\""));
-
-    // читаем по кускам и экранируем спецсимволы
-    const size_t BUFSZ = 1024;
-    uint8_t buf[BUFSZ];
+    // ——— Стримовый ответ (chunked): текст файла экранируется по кускам прямо в буфер писателя ———
+    j.objOpen().kvb("ok", true).key("text").strOpen();
+    const size_t BUFSZ = 512;
+    char buf[BUFSZ];
     while (f.available()) {
-        size_t n = f.read(buf, BUFSZ);
-        String out; out.reserve(n * 2); // с запасом под экранирование
-        for (size_t i = 0; i < n; ++i) {
-            char c = (char)buf[i];
-            switch (c) {
-            case '\"': out += "\\\""; break;
-            case '\\': out += "\\\\"; break;
-            case '\b': out += "\\b";  break;
-            case '\f': out += "\\f";  break;
-            case '\n': out += "\\n";  break;
-            case '\r': out += "\\r";  break;
-            case '\t': out += "\\t";  break;
-            default:
-                // JSON требует экранировать все управляющие < 0x20
-                if ((uint8_t)c < 0x20) {
-                    char esc[7];
-                    snprintf(esc, sizeof(esc), "\\u%04X", (unsigned char)c);
-                    out += esc;
-                }
-                else {
-                    out += c;
-                }
-            }
-        }
-        sendChunk(out);
+        size_t n = f.read((uint8_t*)buf, BUFSZ);
+        if (!n) break;
+        j.strPart(buf, n);
     }
     f.close();
+    j.strClose().objClose().end();
+}
 
-    sendChunk(F("\"}"));
+// Сырой файл любого размера/типа (в отличие от /api/fs/get), с Range для докачки.
+void TKWifiManager::handleFsDownload() {
+    String path = _server.arg("path");
+    if (!path.startsWith("/")) path = "/" + path;
+    if (tkwmFsPathIsOtaConf_(path)) {
+        _server.send(403, "application/json", "{\"ok\":false,\"msg\":\"forbidden\"}");
+        return;
+    }
+    File f;
+    if (_fsOk && TKWM_FS.exists(path)) f = TKWM_FS.open(path, "r");
+    if (!f || f.isDirectory()) {
+        if (f) f.close();
+        _server.send(404, "application/json", "{\"ok\":false,\"msg\":\"not found\"}");
+        return;
+    }
+    String name = path.substring(path.lastIndexOf('/') + 1);
+    name.replace("\"", "");
+    _server.sendHeader(F("Content-Disposition"), String(F("attachment; filename=\"")) + name + "\"");
+    sendFile(f, F("application/octet-stream"), F("no-cache"), false);
 }
 
 void TKWifiManager::handleFsPut() {
@@ -1117,8 +1958,9 @@ void TKWifiManager::handleFsPut() {
     if (!f) { _server.send(500, "application/json", "{\"ok\":false,\"msg\":\"open failed\"}"); return; }
     size_t w = f.print(body);
     f.close();
-    String out = String("{\"ok\":true,\"wrote\":") + w + "}";
-    _server.send(200, "application/json", out);
+    TkwmJson j(_server);
+    j.begin();
+    j.objOpen().kvb("ok", true).kvu("wrote", (unsigned long)w).objClose().end();
 }
 
 void TKWifiManager::handleFsDelete() {
@@ -1234,9 +2076,326 @@ void TKWifiManager::handleUploadDone() {
 }
 
 // ===== OTA =====
+// ---------- Приёмник OTA: формат по первым байтам → Update ----------
+//   E9 …             — обычный образ приложения, пишется как есть;
+//   1F 8B …          — gzip: inflate из ROM (tinfl), окно 32 КБ; CRC32 и длина сверяются с трейлером;
+//   'T','K','L','Z'  — LZ (heatshrink) с окном 2^W байт для малой RAM; заголовок 16 байт:
+//                      [4] W, [5] L, [6..7] 0, [8..11] длина образа, [12..15] CRC32 образа (LE).
+// Упакованный образ готовит extras/tkwm_pack_fw.py.
+class TkwmOtaSink {
+public:
+    enum Kind : uint8_t { K_NONE, K_RAW, K_GZIP, K_LZ };
+    ~TkwmOtaSink() { release(); }
+    void     begin(size_t rawLen, bool gzip);  // rawLen — Content-Length (для Update.begin обычного образа), 0 — нет
+    bool     write(const uint8_t* p, size_t n); // false — см. err()
+    bool     end();                             // хвост + проверка длины/CRC; Update.end() — за вызывающим
+    void     abort();                           // Update.abort()
+    uint32_t outBytes() const { return _out; }
+    Kind     kind() const { return _kind; }
+    const String& err() const { return _err; }
+    static const char* kindName(Kind k) { return k == K_GZIP ? "gzip" : k == K_LZ ? "lz" : "raw"; }
+
+private:
+    bool fail(const String& e) {
+        if (!_failed) _err = e;
+        _failed = true;
+        return false;
+    }
+    void detect();
+    bool open();
+    bool feed(const uint8_t* p, size_t n);
+    bool emit(const uint8_t* p, size_t n); // распакованное → Update + CRC
+    bool gzip(const uint8_t* p, size_t n);
+    void gzNext();
+    bool lz(const uint8_t* p, size_t n);
+    bool lzPut(uint8_t c);
+    void release();
+
+    Kind     _kind = K_NONE;
+    bool     _gzHint = false, _failed = false;
+    String   _err;
+    size_t   _rawLen = 0;
+    uint8_t  _hdr[16];
+    uint8_t  _hdrN = 0;
+    uint32_t _out = 0, _crc = 0, _expLen = 0, _expCrc = 0;
+    // gzip
+    enum : uint8_t { GZ_HEAD, GZ_XLEN, GZ_SKIP, GZ_NAME, GZ_COMMENT, GZ_BODY, GZ_TAIL, GZ_DONE };
+    uint8_t  _gzSt = GZ_HEAD, _gzFlg = 0;
+    uint16_t _skip = 0;
+#if TKWM_OTA_GZIP
+    tinfl_decompressor* _inf  = nullptr;
+    uint8_t*            _dict = nullptr;
+    size_t              _dictOfs = 0;
+#endif
+    // LZ
+    enum : uint8_t { LZ_TAG, LZ_LIT, LZ_IDX, LZ_CNT };
+    uint8_t* _win = nullptr;
+    uint16_t _winMask = 0, _winPos = 0, _lzIdx = 0;
+    uint8_t  _lzW = 0, _lzL = 0, _lzSt = LZ_TAG, _bitN = 0;
+    uint32_t _bits = 0, _lzOut = 0;
+    uint8_t  _stage[256];
+    uint16_t _stageN = 0;
+};
+
+void TkwmOtaSink::begin(size_t rawLen, bool gzip) {
+    release();
+    _kind = K_NONE;
+    _gzHint = gzip;
+    _failed = false;
+    _err = "";
+    _rawLen = rawLen;
+    _hdrN = 0;
+    _out = _crc = _expLen = _expCrc = 0;
+    _gzSt = GZ_HEAD;
+    _gzFlg = 0;
+    _skip = 0;
+    _lzSt = LZ_TAG;
+    _bitN = 0;
+    _bits = _lzOut = 0;
+    _stageN = 0;
+}
+
+void TkwmOtaSink::detect() {
+    const uint8_t* h = _hdr;
+    if (h[0] == 0x1F) {
+        if (_hdrN >= 2) _kind = (h[1] == 0x8B) ? K_GZIP : K_RAW;
+    } else if (h[0] == 'T') {
+        if (_hdrN >= 2 && h[1] != 'K') _kind = K_RAW;
+        else if (_hdrN >= 4 && memcmp(h, "TKLZ", 4)) _kind = K_RAW;
+        else if (_hdrN == 16) _kind = K_LZ;
+    } else {
+        _kind = K_RAW;
+    }
+}
+
+bool TkwmOtaSink::open() {
+    if (_gzHint && _kind != K_GZIP) return fail("Content-Encoding: gzip, но данные не gzip");
+    size_t img = UPDATE_SIZE_UNKNOWN;
+    if (_kind == K_RAW && _rawLen) img = _rawLen;
+    if (_kind == K_GZIP) {
+#if TKWM_OTA_GZIP
+        _inf  = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+        _dict = (uint8_t*)malloc(TINFL_LZ_DICT_SIZE);
+        if (!_inf || !_dict) return fail("gzip: no memory");
+        tinfl_init(_inf);
+        _dictOfs = 0;
+#else
+        return fail("gzip off (TKWM_OTA_GZIP=0)");
+#endif
+    }
+    if (_kind == K_LZ) {
+        _lzW = _hdr[4];
+        _lzL = _hdr[5];
+        if (_lzW < 4 || _lzW > 14 || _lzL < 3 || _lzL >= _lzW) return fail("lz: bad header");
+        _expLen = tkwmRd32_(_hdr + 8);
+        _expCrc = tkwmRd32_(_hdr + 12);
+        _win = (uint8_t*)calloc(1, (size_t)1 << _lzW);
+        if (!_win) return fail("lz: no memory");
+        _winMask = (uint16_t)((1u << _lzW) - 1);
+        _winPos = 0;
+        img = _expLen;
+    }
+    if (!Update.begin(img)) return fail(String("Update.begin: ") + Update.errorString());
+    return true;
+}
+
+bool TkwmOtaSink::write(const uint8_t* p, size_t n) {
+    if (_failed) return false;
+    if (_kind == K_NONE) {
+        // Копим начало, пока не ясен формат (LZ — весь заголовок), затем прогоняем его как данные.
+        while (_kind == K_NONE && n) {
+            _hdr[_hdrN++] = *p++;
+            n--;
+            detect();
+        }
+        if (_kind == K_NONE) return true;
+        if (!open()) return false;
+        if (_kind != K_LZ && !feed(_hdr, _hdrN)) return false;
+    }
+    return feed(p, n);
+}
+
+bool TkwmOtaSink::feed(const uint8_t* p, size_t n) {
+    if (!n) return true;
+    if (_kind == K_GZIP) return gzip(p, n);
+    if (_kind == K_LZ) return lz(p, n);
+    return emit(p, n);
+}
+
+bool TkwmOtaSink::emit(const uint8_t* p, size_t n) {
+    if (Update.write((uint8_t*)p, n) != n) return fail(String("write: ") + Update.errorString());
+    _crc = tkwmCrc32_(p, n, _crc);
+    _out += n;
+    return true;
+}
+
+// Заголовок gzip разбирается по байту: FEXTRA → FNAME → FCOMMENT → FHCRC, флаг снимается по готовности.
+void TkwmOtaSink::gzNext() {
+    if (_gzFlg & 4) {
+        _gzSt = GZ_XLEN;
+        _hdrN = 0;
+    } else if (_gzFlg & 8) {
+        _gzSt = GZ_NAME;
+    } else if (_gzFlg & 16) {
+        _gzSt = GZ_COMMENT;
+    } else if (_gzFlg & 2) {
+        _gzFlg &= ~2;
+        _gzSt = GZ_SKIP;
+        _skip = 2;
+    } else {
+        _gzSt = GZ_BODY;
+    }
+}
+
+bool TkwmOtaSink::gzip(const uint8_t* p, size_t n) {
+#if TKWM_OTA_GZIP
+    while (n) {
+        if (_gzSt == GZ_BODY) {
+            size_t inN = n, outN = TINFL_LZ_DICT_SIZE - _dictOfs;
+            const tinfl_status st = tinfl_decompress(_inf, p, &inN, _dict, _dict + _dictOfs, &outN, TINFL_FLAG_HAS_MORE_INPUT);
+            p += inN;
+            n -= inN;
+            if (outN && !emit(_dict + _dictOfs, outN)) return false;
+            _dictOfs = (_dictOfs + outN) & (TINFL_LZ_DICT_SIZE - 1);
+            if (st < 0) return fail("gzip: bad data");
+            if (st == TINFL_STATUS_DONE) {
+                _gzSt = GZ_TAIL;
+                _hdrN = 0;
+            }
+            continue; // NEEDS_MORE_INPUT съел весь вход; HAS_MORE_OUTPUT — ещё круг
+        }
+        const uint8_t b = *p++;
+        n--;
+        switch (_gzSt) {
+        case GZ_HEAD: // 10 байт: 1F 8B, метод (8 — deflate), флаги, время, xfl, os
+            if (_skip == 2 && b != 8) return fail("gzip: not deflate");
+            if (_skip == 3) _gzFlg = b & 0x1E;
+            if (++_skip == 10) gzNext();
+            break;
+        case GZ_XLEN:
+            _hdr[_hdrN++] = b;
+            if (_hdrN == 2) {
+                _gzFlg &= ~4;
+                _skip = (uint16_t)(_hdr[0] | (_hdr[1] << 8));
+                if (_skip) _gzSt = GZ_SKIP;
+                else gzNext();
+            }
+            break;
+        case GZ_SKIP:
+            if (--_skip == 0) gzNext();
+            break;
+        case GZ_NAME:
+        case GZ_COMMENT:
+            if (!b) {
+                _gzFlg &= (_gzSt == GZ_NAME) ? ~8 : ~16;
+                gzNext();
+            }
+            break;
+        case GZ_TAIL:
+            _hdr[_hdrN++] = b;
+            if (_hdrN == 8) {
+                _expCrc = tkwmRd32_(_hdr);
+                _expLen = tkwmRd32_(_hdr + 4);
+                _gzSt = GZ_DONE;
+            }
+            break;
+        default: // после трейлера — мусор/второй член gzip не поддерживаем
+            return true;
+        }
+    }
+    return true;
+#else
+    (void)p;
+    (void)n;
+    return false;
+#endif
+}
+
+bool TkwmOtaSink::lzPut(uint8_t c) {
+    _win[_winPos] = c;
+    _winPos = (_winPos + 1) & _winMask;
+    _stage[_stageN++] = c;
+    _lzOut++;
+    if (_stageN == sizeof(_stage)) {
+        _stageN = 0;
+        return emit(_stage, sizeof(_stage));
+    }
+    return true;
+}
+
+bool TkwmOtaSink::lz(const uint8_t* p, size_t n) {
+    // Поток heatshrink, биты от старшего: 1 + 8 бит — литерал; 0 + W бит (расстояние−1) + L бит (длина−1) — ссылка.
+    while (n && _lzOut < _expLen) {
+        _bits = (_bits << 8) | *p++;
+        _bitN += 8;
+        n--;
+        for (;;) {
+            const uint8_t need = _lzSt == LZ_TAG ? 1 : _lzSt == LZ_LIT ? 8 : _lzSt == LZ_IDX ? _lzW : _lzL;
+            if (_bitN < need || _lzOut >= _expLen) break;
+            _bitN -= need;
+            const uint16_t v = (uint16_t)((_bits >> _bitN) & ((1u << need) - 1));
+            switch (_lzSt) {
+            case LZ_TAG:
+                _lzSt = v ? LZ_LIT : LZ_IDX;
+                break;
+            case LZ_LIT:
+                if (!lzPut((uint8_t)v)) return false;
+                _lzSt = LZ_TAG;
+                break;
+            case LZ_IDX:
+                _lzIdx = v + 1;
+                _lzSt = LZ_CNT;
+                break;
+            default:
+                for (uint16_t k = 0; k <= v && _lzOut < _expLen; k++)
+                    if (!lzPut(_win[(_winPos - _lzIdx) & _winMask])) return false;
+                _lzSt = LZ_TAG;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+bool TkwmOtaSink::end() {
+    if (_failed) return false;
+    if (_kind == K_NONE) {
+        if (!_hdrN) return fail("empty image");
+        _kind = K_RAW; // образ короче заголовка — пусть решает Update
+        if (!open() || !feed(_hdr, _hdrN)) return false;
+    }
+    if (_kind == K_LZ && _stageN) {
+        const uint16_t k = _stageN;
+        _stageN = 0;
+        if (!emit(_stage, k)) return false;
+    }
+    if (_kind == K_GZIP && _gzSt != GZ_DONE) return fail("gzip: truncated");
+    if (_kind != K_RAW && (_out != _expLen || _crc != _expCrc)) {
+        return fail(String("unpacked ") + _out + " B, crc mismatch or length (expected " + _expLen + " B)");
+    }
+    release();
+    return true;
+}
+
+void TkwmOtaSink::abort() {
+    Update.abort(); // и до Update.begin(): ошибка формата должна быть видна через Update.hasError()
+    release();
+}
+
+void TkwmOtaSink::release() {
+#if TKWM_OTA_GZIP
+    free(_inf);
+    free(_dict);
+    _inf  = nullptr;
+    _dict = nullptr;
+#endif
+    free(_win);
+    _win = nullptr;
+}
+
 void TKWifiManager::handleOtaPage() {
     if (_fsOk && streamIfExists("/ota.html")) return;
-    _server.send(200, "text/html; charset=utf-8", builtinOta());
+    sendBuiltin("/ota.html");
 }
 
 void TKWifiManager::handleOtaUpload() {
@@ -1244,28 +2403,31 @@ void TKWifiManager::handleOtaUpload() {
     static size_t wrote = 0;
     static String err;
 
+    static TkwmOtaSink sink; // .bin / .bin.gz / TKLZ — формат по первым байтам
+    static bool   busy = false; // идёт фоновая установка — её Update не трогаем
+
     HTTPUpload& up = _server.upload();
     if (up.status == UPLOAD_FILE_START) {
         inProg = true; wrote = 0; err = "";
-        size_t sz = up.totalSize;
-        if (!Update.begin(sz ? sz : UPDATE_SIZE_UNKNOWN)) {
-            err = String("Update.begin failed: ") + Update.errorString();
-        }
+        busy = otaJobRunning();
+        if (busy) err = "OTA install job running";
+        else sink.begin(up.totalSize, false);
     }
     else if (up.status == UPLOAD_FILE_WRITE) {
         if (err.isEmpty()) {
-            size_t w = Update.write(up.buf, up.currentSize);
-            if (w != up.currentSize) err = String("Write failed: ") + Update.errorString();
-            else wrote += w;
+            if (!sink.write(up.buf, up.currentSize)) err = sink.err();
+            else wrote += up.currentSize;
         }
     }
     else if (up.status == UPLOAD_FILE_END) {
+        if (err.isEmpty() && !sink.end()) err = sink.err();
         if (err.isEmpty()) { if (!Update.end(true)) err = String("Update.end failed: ") + Update.errorString(); }
-        else Update.abort();
+        else if (!busy) sink.abort();
         inProg = false;
     }
     else if (up.status == UPLOAD_FILE_ABORTED) {
-        Update.abort(); inProg = false; err = "Aborted";
+        if (!busy) sink.abort();
+        inProg = false; err = "Aborted";
     }
 }
 
@@ -1273,6 +2435,11 @@ void TKWifiManager::handleOtaFinish() {
     // этот handler вызывается после handleOtaUpload()
     // отдадим html-результат и, если успех — перезагрузимся
     String html;
+    if (otaJobRunning()) {
+        _server.send(409, "text/html; charset=utf-8", "<!doctype html><meta charset='utf-8'><title>OTA</title>"
+            "<h3 style='color:#ff9a9a'>Ошибка OTA</h3><p>Идёт установка с сервера ESPConnect.</p>");
+        return;
+    }
     if (Update.hasError()) {
         html = String("<!doctype html><meta charset='utf-8'><title>OTA</title>"
             "<h3 style='color:#ff9a9a'>Ошибка OTA</h3><pre>") + Update.errorString() + "</pre>";
@@ -1364,22 +2531,6 @@ static String tkwmIsoTimeNowWithOffset_(int16_t offMin) {
         tmv.tm_hour, tmv.tm_min, tmv.tm_sec, tkwmFmtTzOffset_(offMin).c_str());
     return String(buf);
 }
-static void tkwmAppJsonVal_(String& o, const String& s) {
-    for (uint32_t i = 0; i < s.length(); ++i) {
-        unsigned char c = (unsigned char)s[i];
-        if (c == '"' || c == '\\') {
-            o += '\\';
-            o += (char)c;
-        }
-        else if (c < 0x20) {
-            char esc[8];
-            snprintf(esc, sizeof(esc), "\\u%04X", (unsigned)c);
-            o += esc;
-        }
-        else
-            o += (char)c;
-    }
-}
 /** Соединение с HTTP, ответ 400/… про HTTPS — чаще всего указан http://, а порт/виртуалхост ждут TLS. */
 static bool tkwmErrSuggestsHttps_(const String& r, const String& err) {
     String t = r + " " + err;
@@ -1405,8 +2556,156 @@ static void tkwmHttpErrNegative_(int code, bool httpsUrl, String& err) {
     if (httpsUrl && code < 0)
         err += F(" (TLS/сеть; по умолчанию TKWM_OTA_INSECURE=1 — см. TKWifiManager.h / README)");
 }
+
+// ---------- Пул соединений ESPConnect ----------
+// Один тёплый клиент (схема+хост+порт) и один HTTPClient на все запросы OTA: resolve, POST и скачивание
+// идут по одному keep-alive соединению, и TLS-рукопожатие (1–3 с CPU и RTT на ESP32) делается один раз.
+// Тикетов/возобновления TLS-сессий WiFiClientSecure не даёт, поэтому выигрыш живёт, пока живо соединение;
+// простаивающее дольше TKWM_OTA_KEEPALIVE_MS закрывается. IP хоста кэшируется (соединение открывается по
+// адресу, SNI — по имени), хост, ответивший «нужен HTTPS», дальше сразу идёт по https://.
+// Пользователи — check (тик) и задача OTA, одновременно не работают: check при живой задаче отклоняется.
+class TkwmHttpPool {
+public:
+    struct Stats {
+        uint16_t handshakes = 0; // новых соединений (DNS + TCP + TLS)
+        uint16_t reused     = 0; // запросов по уже открытому
+        uint16_t dnsHits    = 0, dnsMiss = 0;
+        uint32_t handshakeMs = 0, lastHandshakeMs = 0;
+    };
+    HTTPClient& http() { return _http; }
+    WiFiClient* acquire(const String& url); // затем http().begin(*cli, url); nullptr — не соединились
+    void        release(bool clean);        // после http().end(): ответ не дочитан — соединение закрыть
+    void        close();
+    String      upgrade(const String& url) const; // http:// → https:// для хоста, требовавшего HTTPS
+    void        markHttps(const String& url);
+    Stats       st;
+
+private:
+    static bool split(const String& url, bool& tls, String& host, uint16_t& port);
+    bool        lookup(const String& host, IPAddress& ip, bool& cached);
+
+    HTTPClient  _http;
+    WiFiClient* _cli = nullptr;
+    String      _key;
+    uint32_t    _usedAt = 0;
+    String      _dnsHost, _httpsHost;
+    IPAddress   _dnsIp;
+    uint32_t    _dnsAt = 0;
+};
+static TkwmHttpPool tkwmPool_;
+
+bool TkwmHttpPool::split(const String& url, bool& tls, String& host, uint16_t& port) {
+    const int s = url.indexOf("://");
+    if (s < 0) return false;
+    tls   = url.startsWith("https://");
+    int e = s + 3;
+    while (e < (int)url.length() && url[e] != '/' && url[e] != '?') e++;
+    const String hp = url.substring(s + 3, e);
+    const int    c  = hp.indexOf(':');
+    host = (c >= 0) ? hp.substring(0, c) : hp;
+    port = (c >= 0) ? (uint16_t)hp.substring(c + 1).toInt() : (tls ? 443 : 80);
+    return host.length() && port;
+}
+
+bool TkwmHttpPool::lookup(const String& host, IPAddress& ip, bool& cached) {
+    cached = false;
+    if (ip.fromString(host)) return true;
+    if (_dnsAt && _dnsHost == host && (uint32_t)(millis() - _dnsAt) < TKWM_OTA_DNS_TTL_MS) {
+        ip     = _dnsIp;
+        cached = true;
+        st.dnsHits++;
+        return true;
+    }
+    st.dnsMiss++;
+    _dnsAt = 0;
+    if (!WiFi.hostByName(host.c_str(), ip)) return false;
+    _dnsHost = host;
+    _dnsIp   = ip;
+    _dnsAt   = millis();
+    return true;
+}
+
+WiFiClient* TkwmHttpPool::acquire(const String& url) {
+    bool     tls;
+    String   host;
+    uint16_t port;
+    if (!split(url, tls, host, port)) return nullptr;
+    const String key = String(tls ? "s:" : "p:") + host + ':' + String((unsigned)port);
+    if (_cli && _key == key && _cli->connected() && (uint32_t)(millis() - _usedAt) < TKWM_OTA_KEEPALIVE_MS) {
+        st.reused++;
+        return _cli;
+    }
+    close();
+    for (uint8_t att = 0; att < 2; att++) {
+        IPAddress ip;
+        bool      cached;
+        if (!lookup(host, ip, cached)) return nullptr;
+        const uint32_t t0 = millis();
+        WiFiClient*    c  = nullptr;
+        bool           ok = false;
+        if (tls) {
+            WiFiClientSecure* sc = new (std::nothrow) WiFiClientSecure;
+            if (sc) {
+#if TKWM_OTA_INSECURE
+                sc->setInsecure();
+#endif
+                ok = sc->connect(ip, port, host.c_str(), nullptr, nullptr, nullptr) > 0;
+            }
+            c = sc;
+        } else {
+            c  = new (std::nothrow) WiFiClient;
+            ok = c && c->connect(ip, port, 15000) > 0;
+        }
+        if (ok) {
+            st.lastHandshakeMs = millis() - t0;
+            st.handshakeMs += st.lastHandshakeMs;
+            st.handshakes++;
+            Serial.printf("[TKWM] OTA connect %s in %lu ms%s\n", key.c_str(), (unsigned long)st.lastHandshakeMs, cached ? " (DNS cached)" : "");
+            _cli    = c;
+            _key    = key;
+            _usedAt = millis();
+            return c;
+        }
+        delete c;
+        if (!cached) break;
+        _dnsAt = 0; // адрес из кэша мог устареть — ещё круг со свежим DNS
+    }
+    return nullptr;
+}
+
+void TkwmHttpPool::release(bool clean) {
+    if (!clean || !_cli || !_cli->connected()) {
+        close();
+        return;
+    }
+    _usedAt = millis();
+}
+
+void TkwmHttpPool::close() {
+    if (!_cli) return;
+    _cli->stop();
+    delete _cli;
+    _cli = nullptr;
+    _key = "";
+}
+
+String TkwmHttpPool::upgrade(const String& url) const {
+    bool     tls;
+    String   host;
+    uint16_t port;
+    if (_httpsHost.length() && url.startsWith("http://") && split(url, tls, host, port) && host == _httpsHost)
+        return String("https://") + url.substring(7);
+    return url;
+}
+
+void TkwmHttpPool::markHttps(const String& url) {
+    bool     tls;
+    uint16_t port;
+    if (!split(url, tls, _httpsHost, port)) _httpsHost = "";
+}
+
 /** Тело JSON POST: в разных версиях/клиентах аргумент может называться иначе, чем "plain". */
-static String tkwmWebServerPostBody_(WebServer& s) {
+static String tkwmWebServerPostBody_(TkwmWebServer& s) {
     if (s.hasArg("plain")) return s.arg("plain");
     if (s.hasArg("body")) return s.arg("body");
     if (s.hasArg("json")) return s.arg("json");
@@ -1458,6 +2757,8 @@ void TKWifiManager::loadOtaConf_() {
     _otaFileTimezone     = "UTC";
     _otaFileTzOffsetMin  = 0;
     _otaFileAuto   = -1;
+    _otaFileWindow       = "";
+    _otaFileIntervalMin  = 0;
     if (!_fsOk || !TKWM_FS.exists("/ota.conf")) return;
     File f = TKWM_FS.open("/ota.conf", "r");
     if (!f) return;
@@ -1487,6 +2788,10 @@ void TKWifiManager::loadOtaConf_() {
                 _otaFileAuto = 1;
             else
                 _otaFileAuto = 0;
+        } else if (k == "window") {
+            _otaFileWindow = v;
+        } else if (k == "interval") {
+            _otaFileIntervalMin = (uint16_t)min<long>(max<long>(v.toInt(), 0), 65535);
         }
     }
     f.close();
@@ -1500,7 +2805,7 @@ String TKWifiManager::otaConfigNtp_() {
     if (!ntp.length()) ntp = "pool.ntp.org";
     return ntp;
 }
-int16_t TKWifiManager::otaConfigTzOffsetMin_() { return _otaFileTzOffsetMin; }
+int16_t TKWifiManager::otaConfigTzOffsetMin_() { return tkwmTzOffsetNowMin_(); }
 String TKWifiManager::otaConfigTimezone_() {
     String tz = _otaFileTimezone;
     tz.trim();
@@ -1515,64 +2820,113 @@ bool   TKWifiManager::otaConfigAuto_() {
     return a;
 }
 
-bool TKWifiManager::syncTimeWithNtp_(const String& ntpServer, uint32_t timeoutMs) {
+// ---------- Время (SNTP) ----------
+// configTime() перезапускает SNTP-клиент lwIP и сразу возвращается; о пришедшем времени сообщает колбэк
+// (он же срабатывает на периодических пересинхронизациях самого lwIP). Колбэк идёт в задаче tcpip и пишет
+// только скаляры; имя сервера меняется лишь из тика — lwIP хранит указатель на него, а не копию.
+struct TkwmTimeSync {
+    volatile uint32_t syncedAt   = 0; // millis() последней синхронизации; 0 — не было
+    volatile uint32_t requestAt  = 0; // millis() последнего configTime(); 0 — не запрашивали
+    int64_t           epochMs    = 0; // UTC, пришедшее с последней синхронизацией
+    volatile int32_t  driftMs    = 0; // поправка часов на последней синхронизации (+ — отставали)
+    volatile bool     driftKnown = false;
+    volatile uint16_t count      = 0;
+    uint16_t          skipped    = 0; // запросов, отброшенных как лишние (время свежее)
+    String            server;         // кому ушёл последний запрос
+};
+static TkwmTimeSync tkwmTime_;
+
+static bool tkwmTimeValid_() {
+    return time(nullptr) >= 1700000000;
+}
+
+/** Запрос ушёл, ответа ещё нет и срок TKWM_TIME_WAIT_MS не вышел. */
+static bool tkwmTimePending_() {
+    const uint32_t req = tkwmTime_.requestAt, syn = tkwmTime_.syncedAt;
+    if (!req || (syn && (int32_t)(syn - req) >= 0)) return false;
+    return (uint32_t)(millis() - req) < TKWM_TIME_WAIT_MS;
+}
+
+static void tkwmSntpSynced_(struct timeval* tv) {
+    const uint32_t now = millis();
+    const int64_t  ms  = (int64_t)tv->tv_sec * 1000 + tv->tv_usec / 1000;
+    if (tkwmTime_.syncedAt) {
+        // Ожидали: прошлое время + прошедшие millis(); разница — уход часов за интервал.
+        const int64_t d = ms - (tkwmTime_.epochMs + (uint32_t)(now - tkwmTime_.syncedAt));
+        tkwmTime_.driftMs    = (int32_t)max<int64_t>(-2000000000LL, min<int64_t>(2000000000LL, d));
+        tkwmTime_.driftKnown = true;
+    }
+    tkwmTime_.epochMs  = ms;
+    tkwmTime_.syncedAt = now ? now : 1;
+    tkwmTime_.count++;
+}
+
+bool TKWifiManager::timeSyncStart_(const String& ntpServer, bool force) {
     if (WiFi.status() != WL_CONNECTED) return false;
     String srv = ntpServer;
     srv.trim();
     if (!srv.length()) srv = "pool.ntp.org";
-    configTime(0, 0, srv.c_str());
-    const uint32_t t0 = millis();
-    while (millis() - t0 < timeoutMs) {
-        if (time(nullptr) > 1700000000) return true;
-        delay(100);
+    const bool same = (srv == tkwmTime_.server);
+    if (same && tkwmTimePending_()) return true; // уже ждём ответа — не перезапускаем клиент
+    if (!force && same && tkwmTime_.syncedAt && tkwmTimeValid_() && (uint32_t)(millis() - tkwmTime_.syncedAt) < TKWM_TIME_FRESH_MS) {
+        tkwmTime_.skipped++;
+        return false;
     }
-    return false;
-}
-
-bool TKWifiManager::ensureTimezoneListCache_() {
-    if (!_fsOk) return false;
-    if (TKWM_FS.exists(TKWM_TZ_CACHE_PATH)) return true;
-    // Локальная база: никаких сетевых запросов на список таймзон.
-    File f = TKWM_FS.open(TKWM_TZ_CACHE_PATH, "w");
-    if (!f) return false;
-    f.print(TKWM_LOCAL_TZ_FALLBACK_JSON);
-    f.close();
+    static bool cbSet = false;
+    if (!cbSet) {
+        sntp_set_time_sync_notification_cb(tkwmSntpSynced_);
+        cbSet = true;
+    }
+    tkwmTime_.server    = srv;
+    const uint32_t now  = millis();
+    tkwmTime_.requestAt = now ? now : 1;
+    configTime(0, 0, tkwmTime_.server.c_str());
+    tzApply_(); // configTime() сбрасывает TZ окружения в UTC
     return true;
 }
 
-String TKWifiManager::readTimezoneListJson_() {
-    if (!_fsOk) return "[]";
-    // Только локальный хардкод-список таймзон.
-    return String(TKWM_LOCAL_TZ_FALLBACK_JSON);
+// Зона из ota.conf → TZ окружения: дальше localtime() сам переходит на летнее время и обратно.
+// Имя не из таблицы — фиксированное смещение tz= из ota.conf.
+void TKWifiManager::tzApply_() {
+    const String tz   = otaConfigTimezone_();
+    const char*  rule = tkwmTzRule_(tz.c_str());
+    const String r    = rule ? String(rule) : tkwmTzFixedRule_(_otaFileTzOffsetMin);
+    setenv("TZ", r.c_str(), 1);
+    tzset();
 }
 
-bool TKWifiManager::fetchTimezoneOffsetMin_(const String& timezone, int16_t& outMin) {
-    return tkwmLookupFixedTzOffsetMin_(timezone, outMin);
+void TKWifiManager::otaPoolClose() {
+    tkwmPool_.close();
+    _otaPoolCloseAt = 0;
 }
 
 void TKWifiManager::handleOtaInfo() {
     if (!_otaConfLoaded) loadOtaConf_();
-    String ctrl = tkwmOtaController_();
-    String out  = F("{\"ok\":true,\"controller\":\"");
-    tkwmAppJsonVal_(out, ctrl);
-    out += F("\",\"currentVersion\":\"");
-    tkwmAppJsonVal_(out, String(TKWM_FW_VERSION));
-    out += F("\",\"timeSynced\":");
-    out += (time(nullptr) > 1700000000) ? "true" : "false";
-    out += F(",\"deviceTime\":\"");
-    tkwmAppJsonVal_(out, tkwmIsoTimeNowWithOffset_(otaConfigTzOffsetMin_()));
-    out += F("\",\"deviceTimeUtc\":\"");
-    tkwmAppJsonVal_(out, tkwmIsoTimeNowUtc_());
-    out += F("\",\"ntpServer\":\"");
-    tkwmAppJsonVal_(out, otaConfigNtp_());
-    out += F("\",\"timezone\":\"");
-    tkwmAppJsonVal_(out, otaConfigTimezone_());
-    out += F("\",\"tzOffsetMin\":");
-    out += String((int)otaConfigTzOffsetMin_());
-    out += F(",\"tzLabel\":\"");
-    tkwmAppJsonVal_(out, tkwmFmtTzOffset_(otaConfigTzOffsetMin_()));
-    out += F("\"}");
-    _server.send(200, "application/json", out);
+    const TkwmHttpPool::Stats& ps = tkwmPool_.st;
+    TkwmJson j(_server);
+    j.begin();
+    j.objOpen()
+        .kvb("ok", true)
+        .kv("controller", tkwmOtaController_())
+        .kv("currentVersion", TKWM_FW_VERSION)
+        .kvb("timeSynced", tkwmTimeValid_())
+        .kv("deviceTime", tkwmIsoTimeNowWithOffset_(otaConfigTzOffsetMin_()))
+        .kv("deviceTimeUtc", tkwmIsoTimeNowUtc_())
+        .kv("ntpServer", otaConfigNtp_())
+        .kv("timezone", otaConfigTimezone_())
+        .kvi("tzOffsetMin", otaConfigTzOffsetMin_())
+        .kv("tzLabel", tkwmFmtTzOffset_(otaConfigTzOffsetMin_()))
+        .key("net")
+        .objOpen()
+        .kvu("handshakes", ps.handshakes)
+        .kvu("handshakeMs", ps.handshakeMs)
+        .kvu("lastHandshakeMs", ps.lastHandshakeMs)
+        .kvu("reused", ps.reused)
+        .kvu("dnsHits", ps.dnsHits)
+        .kvu("dnsMiss", ps.dnsMiss)
+        .objClose()
+        .objClose()
+        .end();
 }
 
 void TKWifiManager::handleOtaConfig() {
@@ -1583,26 +2937,23 @@ void TKWifiManager::handleOtaConfig() {
     const String  tzName = otaConfigTimezone_();
     const int16_t tzOffMin = otaConfigTzOffsetMin_();
     const bool    au = otaConfigAuto_();
-    String        out;
-    out.reserve(120 + h.length() + tk.length());
-    out = F("{\"ok\":true,\"host\":\"");
-    tkwmAppJsonVal_(out, h);
-    out += F("\",\"token\":\"");
-    tkwmAppJsonVal_(out, tk);
-    out += F("\",\"ntp\":\"");
-    tkwmAppJsonVal_(out, ntp);
-    out += F("\",\"timezone\":\"");
-    tkwmAppJsonVal_(out, tzName);
-    out += F("\",\"tzOffsetMin\":");
-    out += String((int)tzOffMin);
-    out += F(",\"tzLabel\":\"");
-    tkwmAppJsonVal_(out, tkwmFmtTzOffset_(tzOffMin));
-    out += F("\",\"auto\":");
-    out += au ? "true" : "false";
-    out += F(",\"hasCreds\":");
-    out += (h.length() && tk.length()) ? "true" : "false";
-    out += "}";
-    _server.send(200, "application/json", out);
+    TkwmJson j(_server);
+    j.begin();
+    j.objOpen()
+        .kvb("ok", true)
+        .kv("host", h)
+        .kv("token", tk)
+        .kv("ntp", ntp)
+        .kv("timezone", tzName)
+        .kvi("tzOffsetMin", tzOffMin)
+        .kv("tzLabel", tkwmFmtTzOffset_(tzOffMin))
+        .kvb("auto", au)
+        .kv("window", _otaFileWindow)
+        .kvu("intervalMin", otaAutoIntervalMs() / 60000UL)
+        .kvi("nextCheckS", (au && _otaAutoAt) ? (long)((int32_t)(_otaAutoAt - millis()) / 1000) : -1)
+        .kvb("hasCreds", h.length() && tk.length())
+        .objClose()
+        .end();
 }
 
 void TKWifiManager::handleOtaSaveSettings() {
@@ -1612,39 +2963,35 @@ void TKWifiManager::handleOtaSaveSettings() {
         return;
     }
     bool         au  = false;
-    int           p  = b.indexOf(F("\"auto\""));
-    if (p >= 0) {
-        p = b.indexOf(':', p);
-        if (p > 0) {
-            p++;
-            const int n = (int)b.length();
-            while (p < n && (b[(unsigned)p] == ' ' || b[(unsigned)p] == '\t' || b[(unsigned)p] == '\r' || b[(unsigned)p] == '\n')) p++;
-            if (b.substring(p, p + 4) == "true")
-                au = true;
-        }
-    }
-    String hostIn, tokenIn;
-    if (tkwmJsonGetString(b, "host", hostIn))
+    long         intervalIn = 0;
+    String hostIn, tokenIn, ntpIn, tzNameIn, tzIn, windowIn;
+    TkwmJsonPick pk(b);
+    pk.boolean("auto", au).str("host", hostIn).str("token", tokenIn).str("ntp", ntpIn).str("timezone", tzNameIn).str("tzOffsetMin", tzIn);
+    pk.str("window", windowIn).num("intervalMin", intervalIn).run();
+    if (pk.found("window")) {
+        windowIn.trim();
+        _otaFileWindow = windowIn;
+    }
+    if (pk.found("intervalMin")) _otaFileIntervalMin = (uint16_t)min<long>(max<long>(intervalIn, 0), 65535);
+    if (pk.found("host"))
         _otaFileHost = hostIn;
-    if (tkwmJsonGetString(b, "token", tokenIn))
+    if (pk.found("token"))
         _otaFileToken = tokenIn;
-    String ntpIn;
-    if (tkwmJsonGetString(b, "ntp", ntpIn))
+    if (pk.found("ntp"))
         _otaFileNtp = ntpIn;
-    String tzNameIn;
-    if (tkwmJsonGetString(b, "timezone", tzNameIn)) {
-        tzNameIn.trim();
-        if (tzNameIn.length()) _otaFileTimezone = tzNameIn;
-    }
-    String tzIn;
-    if (tkwmJsonGetString(b, "tzOffsetMin", tzIn))
+    tzNameIn.trim();
+    if (tzNameIn.length()) _otaFileTimezone = tzNameIn;
+    if (pk.found("tzOffsetMin"))
         _otaFileTzOffsetMin = tkwmParseTzOffsetMin_(tzIn);
+    tzApply_();
 
     _prefs.begin("tkw_ota", false);
     _prefs.putBool("auto", au);
     _prefs.end();
 
     writeOtaConf_(au);
+    // Включили авто или сменили интервал — не ждём срока, назначенного по старым настройкам.
+    if (au && TKWM_OTA_AUTO_MS && !otaJobRunning()) otaAutoSchedule(TKWM_OTA_AUTO_FIRST_MS, TKWM_OTA_AUTO_FIRST_MS);
 
     _server.send(200, "application/json", "{\"ok\":true}");
 }
@@ -1666,66 +3013,234 @@ void TKWifiManager::writeOtaConf_(bool autoFlag) {
     f.print(F("timezone="));
     f.println(otaConfigTimezone_());
     f.print(F("tz="));
-    f.println(String((int)otaConfigTzOffsetMin_()));
+    f.println(String((int)_otaFileTzOffsetMin));
     f.print(F("auto="));
     f.println(autoFlag ? "1" : "0");
+    if (_otaFileWindow.length()) {
+        f.print(F("window="));
+        f.println(_otaFileWindow);
+    }
+    if (_otaFileIntervalMin) {
+        f.print(F("interval="));
+        f.println(String((unsigned)_otaFileIntervalMin));
+    }
     f.close();
     _otaFileAuto = autoFlag ? 1 : 0;
     _otaConfLoaded = true;
 }
 
+// POST — запросить синхронизацию (не ждёт ответа), GET — состояние; страница опрашивает GET, пока pending.
 void TKWifiManager::handleOtaSyncTime() {
-    const String body = tkwmWebServerPostBody_(_server);
-    String ntpIn;
-    if (body.length()) tkwmJsonGetString(body, "ntp", ntpIn);
-    if (ntpIn.length()) _otaFileNtp = ntpIn;
-    String timezoneIn;
-    if (body.length()) tkwmJsonGetString(body, "timezone", timezoneIn);
-    if (timezoneIn.length()) _otaFileTimezone = timezoneIn;
-    const String ntp = otaConfigNtp_();
-    const bool ok = syncTimeWithNtp_(ntp, TKWM_SYNC_TIME_MANUAL_TIMEOUT_MS);
-    int16_t offMin = otaConfigTzOffsetMin_();
-    (void)fetchTimezoneOffsetMin_(otaConfigTimezone_(), offMin);
-    _otaFileTzOffsetMin = offMin;
-    String out = F("{\"ok\":");
-    out += ok ? "true" : "false";
-    out += F(",\"ntp\":\"");
-    tkwmAppJsonVal_(out, ntp);
-    out += F("\",\"deviceTime\":\"");
-    tkwmAppJsonVal_(out, tkwmIsoTimeNowWithOffset_(otaConfigTzOffsetMin_()));
-    out += F("\",\"tzOffsetMin\":");
-    out += String((int)otaConfigTzOffsetMin_());
-    out += F(",\"tzLabel\":\"");
-    tkwmAppJsonVal_(out, tkwmFmtTzOffset_(otaConfigTzOffsetMin_()));
-    out += F("\",\"timezone\":\"");
-    tkwmAppJsonVal_(out, otaConfigTimezone_());
-    out += F("\"}");
-    _server.send(200, "application/json", out);
+    if (!_otaConfLoaded) loadOtaConf_();
+    bool started = false;
+    if (_server.method() == HTTP_POST) {
+        const String body = tkwmWebServerPostBody_(_server);
+        String ntpIn, timezoneIn;
+        if (body.length()) TkwmJsonPick(body).str("ntp", ntpIn).str("timezone", timezoneIn).run();
+        if (ntpIn.length()) _otaFileNtp = ntpIn;
+        if (timezoneIn.length()) _otaFileTimezone = timezoneIn;
+        tzApply_();
+        started = timeSyncStart_(otaConfigNtp_(), true);
+    }
+    const String   ntp     = otaConfigNtp_();
+    const bool     pending = tkwmTimePending_();
+    const uint32_t syn     = tkwmTime_.syncedAt;
+    // ok — время есть и этот запрос (если был) уже получил ответ; при сбое запроса — false с msg.
+    const bool ok = tkwmTimeValid_() && !pending;
+    TkwmJson   j(_server);
+    j.begin();
+    j.objOpen().kvb("ok", ok).kvb("pending", pending).kvb("synced", tkwmTimeValid_());
+    if (_server.method() == HTTP_POST && !started && !pending) j.kv("msg", "no Wi-Fi link");
+    else if (!ok && !pending && tkwmTime_.requestAt) j.kv("msg", "no NTP reply");
+    j.kvi("syncedAgoS", syn ? (int32_t)((uint32_t)(millis() - syn) / 1000) : -1)
+        .kv("source", tkwmTime_.server)
+        .kvu("syncs", tkwmTime_.count)
+        .kvu("skipped", tkwmTime_.skipped);
+    if (tkwmTime_.driftKnown) j.kvi("driftMs", tkwmTime_.driftMs);
+    j.kvu("waitMs", TKWM_TIME_WAIT_MS)
+        .kv("ntp", ntp)
+        .kv("deviceTime", tkwmIsoTimeNowWithOffset_(otaConfigTzOffsetMin_()))
+        .kvi("tzOffsetMin", otaConfigTzOffsetMin_())
+        .kv("tzLabel", tkwmFmtTzOffset_(otaConfigTzOffsetMin_()))
+        .kv("timezone", otaConfigTimezone_())
+        .objClose()
+        .end();
 }
 
 void TKWifiManager::handleOtaTimezones() {
     if (!_otaConfLoaded) loadOtaConf_();
-    const String listJson = readTimezoneListJson_();
-    String out = F("{\"ok\":true,\"selected\":\"");
-    tkwmAppJsonVal_(out, otaConfigTimezone_());
-    out += F("\",\"timezones\":");
-    out += listJson;
-    out += "}";
-    _server.send(200, "application/json", out);
+    TkwmJson j(_server);
+    j.begin();
+    j.objOpen()
+        .kvb("ok", true)
+        .kv("selected", otaConfigTimezone_())
+        .key("timezones")
+        .arrOpen();
+    for (int i = 0; i < TKWM_TZ_COUNT; i++) j.str(TKWM_TZ_NAMES + TKWM_TZ_NAME_OFF[i]); // прямо из таблицы, без копии в RAM
+    j.arrClose().objClose().end();
 }
 
+/**
+ * Тело ответа HTTPClient как Stream: getStream() отдаёт сырой сокет, поэтому границу тела
+ * (Content-Length или chunked-кадры HTTP/1.1) отслеживаем здесь. drain() дочитывает остаток —
+ * иначе keep-alive соединение из пула начнёт следующий ответ с хвоста этого.
+ */
+class TkwmHttpBody : public Stream {
+public:
+    /** len — Content-Length (<0: не указан — тело до закрытия соединения, если не chunked). */
+    TkwmHttpBody(Stream& s, int len, bool chunked) : _s(s), _left(chunked ? 0 : len), _chunked(chunked) {}
+
+    int available() override {
+        if (!more()) return 0;
+        const int a = _s.available();
+        return (_left >= 0 && a > _left) ? _left : a;
+    }
+    int read() override {
+        uint8_t b;
+        return readBytes(&b, 1) ? b : -1;
+    }
+    int peek() override { return more() ? _s.peek() : -1; }
+    size_t readBytes(char* buf, size_t n) {
+        if (!n || !more()) return 0;
+        if (_left >= 0 && n > (size_t)_left) n = (size_t)_left;
+        const size_t got = _s.readBytes(buf, n);
+        if (!got) _bad = true; // таймаут посреди тела
+        if (_left > 0) _left -= (int)got;
+        return got;
+    }
+    size_t readBytes(uint8_t* buf, size_t n) { return readBytes((char*)buf, n); }
+    size_t write(uint8_t) override { return 0; }
+
+    /** Дочитать тело до конца (не больше maxBytes); true — граница найдена, соединение можно вернуть в пул. */
+    bool drain(size_t maxBytes = 4096) {
+        char b[64];
+        while (more()) {
+            if (_left < 0 || !maxBytes) return false; // тело до закрытия — повторно не использовать
+            const size_t n = readBytes(b, min<size_t>(min<size_t>(sizeof(b), maxBytes), (size_t)_left));
+            if (!n) return false;
+            maxBytes -= n;
+        }
+        return !_bad;
+    }
+    /** Тело принято до границы (последний кадр chunked, Content-Length исчерпан). */
+    bool ended() const { return _end || (!_chunked && _left == 0); }
+    /** Таймаут или обрыв посреди тела (в том числе посреди заголовка кадра). */
+    bool failed() const { return _bad; }
+
+private:
+    /** Есть ли ещё байты тела; для chunked на границе кадра читает заголовок следующего. */
+    bool more() {
+        if (_bad || _end) return false;
+        if (!_chunked || _left > 0) return _left != 0;
+        if (_inChunk && !line(nullptr)) return false; // CRLF после данных кадра
+        char hex[12];
+        if (!line(hex)) return false;
+        const unsigned long n = strtoul(hex, nullptr, 16); // ";ext" после размера strtoul отбрасывает сам
+        if (!n) {
+            while (line(hex) && hex[0]) {} // трейлеры до пустой строки
+            _end = true;
+            return false;
+        }
+        _left    = (int)n;
+        _inChunk = true;
+        return true;
+    }
+    /** Строка до \n без \r (обрезается до 11 символов); false — таймаут. */
+    bool line(char* out) {
+        size_t k = 0;
+        for (;;) {
+            char c;
+            if (!_s.readBytes(&c, 1)) {
+                _bad = true;
+                return false;
+            }
+            if (c == '\n') break;
+            if (out && c != '\r' && k < 11) out[k++] = c;
+        }
+        if (out) out[k] = 0;
+        return true;
+    }
+
+    Stream& _s;
+    int     _left;
+    bool    _chunked;
+    bool    _inChunk = false, _end = false, _bad = false;
+};
+
 // POST resolve-download на ESPConnect; out: firmware_version, download_url, latest_firmware_version, err
+/**
+ * Ответ resolve-download: при 2xx нужные поля разбираются прямо из сокета за один
+ * проход (в r остаётся только начало тела для сообщения об ошибке), остаток тела
+ * дочитывается для keep-alive; иначе тело читается целиком — ответы с ошибкой короткие.
+ * false — граница тела не найдена, соединение в пул не возвращать.
+ */
+static bool tkwmResolveRead_(HTTPClient& http, int code, String& r, String& fw, String& dl, String& latest) {
+    fw = dl = latest = "";
+    if (code < 200 || code >= 300) {
+        r = (code > 0) ? http.getString() : String();
+        return code > 0;
+    }
+    String te = http.header("Transfer-Encoding");
+    te.toLowerCase();
+    TkwmHttpBody body(http.getStream(), http.getSize(), te.indexOf("chunked") >= 0);
+    String       dl2, fw2, latest2;
+    TkwmJsonPick p(body, -1);
+    p.capture(r, 200)
+        .str("download_url", dl)
+        .str("downloadUrl", dl2)
+        .str("firmware_version", fw)
+        .str("firmwareVersion", fw2)
+        .str("latest_firmware_version", latest)
+        .str("latestFirmwareVersion", latest2)
+        .run();
+    if (dl.isEmpty()) dl = dl2;
+    if (fw.isEmpty()) fw = fw2;
+    if (latest.isEmpty()) latest = latest2;
+    return body.drain();
+}
+
+// Условный resolve: ETag прошлого ответа уходит в If-None-Match; ETag и Cache-Control: max-age ответа — обратно.
+struct TkwmResolveCond {
+    String  etag;
+    int32_t maxAgeS = -1; // -1 — сервер срок не указал
+};
+
+/** false — соединение нельзя вернуть в пул (ошибка или недочитанное тело). */
+static bool tkwmResolveExchange_(HTTPClient& http, const String& token, const String& post, TkwmResolveCond* cond, int& code, String& r,
+                                 String& fw, String& dl, String& latest) {
+    tkwmHttpAddBearerJson_(http, token);
+    http.useHTTP10(false); // HTTP/1.1 — соединение остаётся в пуле
+    http.setReuse(true);
+    if (cond && cond->etag.length()) http.addHeader("If-None-Match", cond->etag);
+    const char* keys[] = { "Transfer-Encoding", "ETag", "Cache-Control" };
+    http.collectHeaders(keys, 3);
+    code = http.POST(post);
+    if (cond && code > 0) {
+        const String et = http.header("ETag");
+        if (et.length() || code != 304) cond->etag = et;
+        const String cc = http.header("Cache-Control");
+        const int    ma = cc.indexOf("max-age=");
+        cond->maxAgeS   = (ma >= 0) ? (int32_t)cc.substring(ma + 8).toInt() : (cc.indexOf("no-cache") >= 0 ? 0 : -1);
+    }
+    const bool clean = tkwmResolveRead_(http, code, r, fw, dl, latest);
+    http.end();
+    return clean;
+}
+
+/** cond != nullptr — условный запрос; 304 → true с пустыми fw/dl/latest (значения берутся из кэша). */
 static bool tkwmEsptoolsResolve_(const String& base, const String& token, const String& controller, String& fw, String& dl, String& latest, String& err,
-    String* outEffBase) {
+    String* outEffBase, TkwmResolveCond* cond = nullptr) {
     if (WiFi.status() != WL_CONNECTED) {
         err = "no internet (Wi-Fi not connected)";
         return false;
     }
-    String post = F("{\"controller\":\"");
-    tkwmAppJsonVal_(post, controller);
-    post += F("\",\"firmware_type\":\"firmware\",\"firmware_version\":\"latest\"}");
+    String post;
+    {
+        TkwmJson j(post);
+        j.objOpen().kv("controller", controller).kv("firmware_type", "firmware").kv("firmware_version", "latest").objClose().end();
+    }
     const String sufx = F("/api/firmware/resolve-download");
-    String         baseN = tkwmNormHost_(base);
+    String         baseN = tkwmPool_.upgrade(tkwmNormHost_(base));
     if (baseN.indexOf("://") < 0) {
         err = "bad host";
         return false;
@@ -1735,46 +3250,34 @@ static bool tkwmEsptoolsResolve_(const String& base, const String& token, const
     for (int att = 0; att < 2; att++) {
         if (att == 1) {
             if (!baseN.startsWith("http://")) break;
+            tkwmPool_.markHttps(baseN);
             baseN = String("https://") + baseN.substring(7);
         }
         url = baseN + sufx;
-        {
-            HTTPClient http;
+        WiFiClient* cli = tkwmPool_.acquire(url);
+        if (!cli) {
+            code = HTTPC_ERROR_CONNECTION_REFUSED;
+        } else {
+            HTTPClient& http = tkwmPool_.http();
             http.setConnectTimeout(15000);
             http.setTimeout(30000);
-            const bool httpsUrl = url.startsWith("https://");
-            if (httpsUrl) {
-                WiFiClientSecure tlsCl;
-#if TKWM_OTA_INSECURE
-                tlsCl.setInsecure();
-#endif
-                if (!http.begin(tlsCl, url)) {
-                    err = "http begin failed";
-                    return false;
-                }
-                tkwmHttpAddBearerJson_(http, token);
-                code = http.POST(post);
-                r    = http.getString();
-                http.end();
-            } else {
-                WiFiClient plainCl;
-                if (!http.begin(plainCl, url)) {
-                    err = "http begin failed";
-                    return false;
-                }
-                tkwmHttpAddBearerJson_(http, token);
-                code = http.POST(post);
-                r    = http.getString();
-                http.end();
+            if (!http.begin(*cli, url)) {
+                tkwmPool_.release(false);
+                err = "http begin failed";
+                return false;
             }
+            tkwmPool_.release(tkwmResolveExchange_(http, token, post, cond, code, r, fw, dl, latest));
         }
         if (code < 0) {
             tkwmHttpErrNegative_(code, url.startsWith("https://"), err);
             return false;
         }
+        if (code == 304 && cond && cond->etag.length()) {
+            if (outEffBase)
+                *outEffBase = baseN;
+            return true;
+        }
         if (code >= 200 && code < 300) {
-            dl = "";
-            if (!tkwmJsonGetString(r, "download_url", dl) || dl.isEmpty()) tkwmJsonGetString(r, "downloadUrl", dl);
             if (dl.isEmpty()) {
                 err = "no download_url in response";
                 if (r.length() && r.length() < 256) {
@@ -1783,11 +3286,6 @@ static bool tkwmEsptoolsResolve_(const String& base, const String& token, const
                 }
                 return false;
             }
-            fw = "";
-            if (!tkwmJsonGetString(r, "firmware_version", fw) || !fw.length()) tkwmJsonGetString(r, "firmwareVersion", fw);
-            latest = "";
-            if (!tkwmJsonGetString(r, "latest_firmware_version", latest) || !latest.length())
-                tkwmJsonGetString(r, "latestFirmwareVersion", latest);
             if (outEffBase)
                 *outEffBase = baseN;
             return true;
@@ -1796,17 +3294,60 @@ static bool tkwmEsptoolsResolve_(const String& base, const String& token, const
         if (r.length() && r.length() < 512) err += ": " + r;
         /* До подстановки detail/message: иначе err теряет текст про HTTPS и повтор не сработает. */
         const bool httpsHint = tkwmErrSuggestsHttps_(r, err);
-        {
-            String d;
-            if (tkwmJsonGetString(r, "detail", d) && d.length()) err = d;
-            if (tkwmJsonGetString(r, "message", d) && d.length()) err = d;
-        }
+        tkwmErrFromBody_(r, err);
         if (att == 0 && baseN.startsWith("http://") && (httpsHint || tkwmErrSuggestsHttps_(r, err))) continue;
         return false;
     }
     return false;
 }
 
+// Кэш resolve-download: check → install и автопроверки в пределах TTL не ходят на сервер; после TTL —
+// условный запрос, 304 продлевает кэш без тела. Срок — min(TKWM_OTA_RESOLVE_TTL_MS, max-age сервера).
+// Обращения — из тика (check) или из задачи OTA, но не одновременно: check при живой задаче отклоняется.
+struct TkwmResolveCache {
+    String   key; // host \n token \n controller
+    String   fw, dl, latest, effBase, etag;
+    uint32_t at = 0, ttl = 0;
+    bool     ok = false;
+};
+static TkwmResolveCache tkwmResolveCache_;
+
+static bool tkwmEsptoolsResolveCached_(const String& base, const String& token, const String& controller, String& fw, String& dl, String& latest,
+                                       String& err, String* outEffBase) {
+    TkwmResolveCache& c   = tkwmResolveCache_;
+    const String      key = tkwmNormHost_(base) + '\n' + token + '\n' + controller;
+    if (c.key != key) {
+        c     = TkwmResolveCache();
+        c.key = key;
+    }
+    if (!c.ok || (uint32_t)(millis() - c.at) >= c.ttl) {
+        TkwmResolveCond cond;
+        if (c.ok) cond.etag = c.etag;
+        String f2, d2, l2, eb;
+        if (!tkwmEsptoolsResolve_(base, token, controller, f2, d2, l2, err, &eb, &cond)) {
+            c.ok = false;
+            return false;
+        }
+        if (d2.length()) { // 200; при 304 остаются прежние значения
+            c.fw     = f2;
+            c.dl     = d2;
+            c.latest = l2;
+        }
+        c.effBase = eb;
+        c.etag    = cond.etag;
+        c.at      = millis();
+        c.ttl     = TKWM_OTA_RESOLVE_TTL_MS;
+        // max-age сравниваем в секундах: ×1000 в uint32_t переполняется уже на ~50 днях (год → ~17 дней).
+        if (cond.maxAgeS >= 0 && (uint32_t)cond.maxAgeS < c.ttl / 1000UL) c.ttl = (uint32_t)cond.maxAgeS * 1000UL;
+        c.ok = true;
+    }
+    fw     = c.fw;
+    dl     = c.dl;
+    latest = c.latest;
+    if (outEffBase) *outEffBase = c.effBase;
+    return true;
+}
+
 /** POST JSON на ESPConnect (Bearer), с тем же http→https повтором, что и resolve. */
 static bool tkwmEsptoolsPostJson_(const String& base, const String& token, const String& pathSuffix, const String& jsonBody, String& respOut, String& err) {
     if (WiFi.status() != WL_CONNECTED) {
@@ -1814,7 +3355,7 @@ static bool tkwmEsptoolsPostJson_(const String& base, const String& token, const
         return false;
     }
     const String sufx = pathSuffix.startsWith("/") ? pathSuffix : (String("/") + pathSuffix);
-    String         baseN = tkwmNormHost_(base);
+    String         baseN = tkwmPool_.upgrade(tkwmNormHost_(base));
     if (baseN.indexOf("://") < 0) {
         err = "bad host";
         return false;
@@ -1824,38 +3365,29 @@ static bool tkwmEsptoolsPostJson_(const String& base, const String& token, const
     for (int att = 0; att < 2; att++) {
         if (att == 1) {
             if (!baseN.startsWith("http://")) break;
+            tkwmPool_.markHttps(baseN);
             baseN = String("https://") + baseN.substring(7);
         }
         url = baseN + sufx;
-        {
-            HTTPClient http;
+        WiFiClient* cli = tkwmPool_.acquire(url);
+        if (!cli) {
+            code = HTTPC_ERROR_CONNECTION_REFUSED;
+        } else {
+            HTTPClient& http = tkwmPool_.http();
             http.setConnectTimeout(15000);
             http.setTimeout(30000);
-            const bool httpsUrl = url.startsWith("https://");
-            if (httpsUrl) {
-                WiFiClientSecure tlsCl;
-#if TKWM_OTA_INSECURE
-                tlsCl.setInsecure();
-#endif
-                if (!http.begin(tlsCl, url)) {
-                    err = "http begin failed";
-                    return false;
-                }
-                tkwmHttpAddBearerJson_(http, token);
-                code = http.POST(jsonBody.length() ? jsonBody : String(F("{}")));
-                r    = http.getString();
-                http.end();
-            } else {
-                WiFiClient plainCl;
-                if (!http.begin(plainCl, url)) {
-                    err = "http begin failed";
-                    return false;
-                }
-                tkwmHttpAddBearerJson_(http, token);
-                code = http.POST(jsonBody.length() ? jsonBody : String(F("{}")));
-                r    = http.getString();
-                http.end();
+            if (!http.begin(*cli, url)) {
+                tkwmPool_.release(false);
+                err = "http begin failed";
+                return false;
             }
+            tkwmHttpAddBearerJson_(http, token);
+            http.useHTTP10(false);
+            http.setReuse(true);
+            code = http.POST(jsonBody.length() ? jsonBody : String(F("{}")));
+            r    = (code > 0) ? http.getString() : String();
+            http.end();
+            tkwmPool_.release(code > 0);
         }
         if (code < 0) {
             tkwmHttpErrNegative_(code, url.startsWith("https://"), err);
@@ -1868,11 +3400,7 @@ static bool tkwmEsptoolsPostJson_(const String& base, const String& token, const
         err = "server HTTP " + String(code);
         if (r.length() && r.length() < 1024) err += ": " + r;
         const bool httpsHint = tkwmErrSuggestsHttps_(r, err);
-        {
-            String d;
-            if (tkwmJsonGetString(r, "detail", d) && d.length()) err = d;
-            if (tkwmJsonGetString(r, "message", d) && d.length()) err = d;
-        }
+        tkwmErrFromBody_(r, err);
         if (att == 0 && baseN.startsWith("http://") && (httpsHint || tkwmErrSuggestsHttps_(r, err))) continue;
         return false;
     }
@@ -1893,78 +3421,313 @@ static String tkwmJoinOtaDownloadUrl_(const String& effBase, const String& dlIn)
     return effBase + dl;
 }
 
-enum { TKWM_BIN_FETCH_FAIL = 0, TKWM_BIN_FETCH_OK = 1, TKWM_BIN_FETCH_RETRY = 2 };
+// ---------- Конвейер OTA: сокет → кольцо блоков → Update ----------
+// Приём и запись во flash идут в разных задачах: пока flash стирает/пишет сектор, сокет дочитывается
+// в свободные блоки и TCP-окно не схлопывается. Нет памяти под кольцо — тот же интерфейс пишет
+// синхронно через один блок.
+struct TkwmOtaStats {
+    uint32_t bytes       = 0; // принято из сети (до распаковки)
+    uint32_t outBytes    = 0; // записано в Update (после распаковки)
+    const char* enc      = "raw";
+    uint32_t ms          = 0; // от старта конвейера до записи последнего блока
+    uint32_t netWaitMs   = 0; // писатель ждал данных (упор в сеть)
+    uint32_t flashWaitMs = 0; // приём ждал свободный блок (упор во flash)
+    uint8_t  ringMax     = 0; // максимум заполненных блоков в очереди
+    uint8_t  ring        = 0; // размер кольца (0 — синхронная запись)
+    uint8_t  resumes     = 0; // докачек после обрыва
+    uint32_t pos         = 0; // позиция в потоке (с учётом докачки)
+    uint32_t total       = 0; // размер потока; 0 — неизвестен
+    // Прогресс: вызывается из цикла приёма не чаще раза в 250 мс.
+    void (*progress)(const TkwmOtaStats& st, void* ctx) = nullptr;
+    void* progressCtx = nullptr;
+    const volatile bool* cancel = nullptr; // true — бросить скачивание (Update откатывается)
+};
+
+class TkwmOtaPipe {
+public:
+    TkwmOtaPipe(TkwmOtaStats& st, TkwmOtaSink& sink) : _st(st), _sink(sink) {}
+    ~TkwmOtaPipe() {
+        String e;
+        finish(e);
+    }
+    bool     begin();                      // false — нет памяти даже под один блок
+    uint8_t* acquire();                    // свободный блок TKWM_OTA_BLOCK; nullptr — запись уже сломалась
+    bool     commit(uint8_t* b, size_t n); // отдать блок на запись; false — запись сломалась
+    bool     finish(String& err);          // дописать очередь и остановить писателя
+
+private:
+    struct Msg {
+        uint8_t* p;   // nullptr — конец потока
+        uint16_t n;
+    };
+    static void writerTask(void* arg);
+    void        release();
+
+    TkwmOtaStats&     _st;
+    TkwmOtaSink&      _sink;
+    uint8_t*          _mem  = nullptr;
+    QueueHandle_t     _free = nullptr, _full = nullptr;
+    SemaphoreHandle_t _done = nullptr;
+    TaskHandle_t      _task = nullptr;
+    volatile bool     _fail = false;
+    String            _err;
+    uint32_t          _t0 = 0;
+};
+
+bool TkwmOtaPipe::begin() {
+    _t0 = millis();
+    _st.ring = 0;
+    if (TKWM_OTA_RING_BLOCKS >= 2) _mem = (uint8_t*)malloc((size_t)TKWM_OTA_RING_BLOCKS * TKWM_OTA_BLOCK);
+    if (_mem) {
+        _free = xQueueCreate(TKWM_OTA_RING_BLOCKS, sizeof(uint8_t*));
+        _full = xQueueCreate(TKWM_OTA_RING_BLOCKS + 1, sizeof(Msg));
+        _done = xSemaphoreCreateBinary();
+        if (_free && _full && _done) {
+            for (uint8_t i = 0; i < TKWM_OTA_RING_BLOCKS; i++) {
+                uint8_t* b = _mem + (size_t)i * TKWM_OTA_BLOCK;
+                xQueueSend(_free, &b, 0);
+            }
+            if (xTaskCreate(writerTask, "tkwm_ota_wr", 4096, this, uxTaskPriorityGet(nullptr), &_task) == pdPASS) {
+                _st.ring = TKWM_OTA_RING_BLOCKS;
+                return true;
+            }
+            _task = nullptr;
+        }
+        release();
+    }
+    _mem = (uint8_t*)malloc(TKWM_OTA_BLOCK);
+    return _mem != nullptr;
+}
+
+void TkwmOtaPipe::writerTask(void* arg) {
+    TkwmOtaPipe* p = (TkwmOtaPipe*)arg;
+    Msg          m;
+    for (;;) {
+        const uint32_t w0 = millis();
+        xQueueReceive(p->_full, &m, portMAX_DELAY);
+        p->_st.netWaitMs += millis() - w0;
+        if (!m.p) break;
+        if (!p->_fail) {
+            if (p->_sink.write(m.p, m.n)) {
+                p->_st.bytes += m.n;
+            } else {
+                p->_err  = p->_sink.err();
+                p->_fail = true;
+            }
+        }
+        xQueueSend(p->_free, &m.p, portMAX_DELAY);
+    }
+    xSemaphoreGive(p->_done);
+    vTaskDelete(nullptr);
+}
+
+uint8_t* TkwmOtaPipe::acquire() {
+    if (!_task) return _fail ? nullptr : _mem;
+    uint8_t*       b  = nullptr;
+    const uint32_t w0 = millis();
+    xQueueReceive(_free, &b, portMAX_DELAY); // писатель всегда возвращает блоки — ожидание конечно
+    _st.flashWaitMs += millis() - w0;
+    if (!_fail) return b;
+    xQueueSend(_free, &b, 0);
+    return nullptr;
+}
+
+bool TkwmOtaPipe::commit(uint8_t* b, size_t n) {
+    if (!_task) {
+        if (!_sink.write(b, n)) {
+            _err  = _sink.err();
+            _fail = true;
+            return false;
+        }
+        _st.bytes += n;
+        return true;
+    }
+    Msg m = { b, (uint16_t)n };
+    xQueueSend(_full, &m, portMAX_DELAY);
+    const uint8_t q = (uint8_t)uxQueueMessagesWaiting(_full);
+    if (q > _st.ringMax) _st.ringMax = q;
+    return !_fail;
+}
+
+bool TkwmOtaPipe::finish(String& err) {
+    if (_task) {
+        Msg m = { nullptr, 0 };
+        xQueueSend(_full, &m, portMAX_DELAY);
+        xSemaphoreTake(_done, portMAX_DELAY);
+        _task = nullptr;
+    }
+    if (_mem) {
+        _st.ms += millis() - _t0; // по всем сессиям докачки
+        release();
+    }
+    err = _err;
+    return !_fail;
+}
+
+void TkwmOtaPipe::release() {
+    if (_free) vQueueDelete(_free);
+    if (_full) vQueueDelete(_full);
+    if (_done) vSemaphoreDelete(_done);
+    _free = _full = nullptr;
+    _done = nullptr;
+    free(_mem);
+    _mem = nullptr;
+}
+
+enum { TKWM_BIN_FETCH_FAIL = 0, TKWM_BIN_FETCH_OK = 1, TKWM_BIN_FETCH_RETRY = 2, TKWM_BIN_FETCH_STALL = 3 };
+
+// Докачка: приёмник (и начатый Update) переживает обрыв, следующая сессия просит Range: bytes=got-.
+// If-Range с ETag (или Last-Modified) первой сессии: если файл на сервере сменился, придёт 200 и весь
+// образ — тогда Update начинается заново. Без валидатора докачка небезопасна — только с нуля.
+struct TkwmOtaResume {
+    TkwmOtaSink sink;
+    uint32_t    got   = 0;  // байт потока уже отдано приёмнику
+    uint32_t    total = 0;  // полный размер потока; 0 — неизвестен (chunked), докачка невозможна
+    String      validator;  // ETag / Last-Modified
+    bool        started = false;
+};
 
-template <typename TClient>
-static int tkwmEsptoolsBinFetch_(HTTPClient& http, TClient& cli, const String& tryUrl, const String& token, int att, String& err) {
+static int tkwmEsptoolsBinFetch_(HTTPClient& http, WiFiClient& cli, const String& tryUrl, const String& token, int att, String& err,
+                                 TkwmOtaResume& rs, TkwmOtaStats& st) {
     if (!http.begin(cli, tryUrl)) {
         err = "http begin (bin) failed";
         return TKWM_BIN_FETCH_FAIL;
     }
     tkwmHttpAddBearer_(http, token);
+    http.useHTTP10(false);
+    http.setReuse(true);
+    const bool resume = rs.got && rs.total && rs.validator.length();
+    if (resume) {
+        http.addHeader("Range", "bytes=" + String((unsigned long)rs.got) + "-");
+        http.addHeader("If-Range", rs.validator);
+    }
+    const char* hdrKeys[] = { "Content-Encoding", "ETag", "Last-Modified", "Content-Range", "Transfer-Encoding" };
+    http.collectHeaders(hdrKeys, 5);
     int    code  = http.GET();
     int    len   = (int)http.getSize();
-    String rbody = (code == 200) ? String() : http.getString();
-    if (code != 200) {
+    // HTTP/1.1: тело может прийти кадрами chunked — размеры кадров в образ не попадают, конец тела — нулевой кадр.
+    const bool chunked = http.header("Transfer-Encoding").equalsIgnoreCase("chunked");
+    const bool okCode = code == 200 || (resume && code == 206);
+    String rbody = okCode ? String() : http.getString();
+    if (!okCode) {
         http.end();
         err = "GET " + String(code) + " " + rbody;
         if (code < 0 && tryUrl.startsWith("https://"))
             err += F(" (TLS/сеть; см. TKWM_OTA_INSECURE, время на ESP)");
         if (att == 0 && tryUrl.startsWith("http://") && tkwmErrSuggestsHttps_(rbody, err))
             return TKWM_BIN_FETCH_RETRY;
+        // Сеть/таймаут после того, как сервер уже отдавал образ, — тот же обрыв, пробуем снова.
+        if (rs.started && (code < 0 || code == 408 || code >= 500)) return TKWM_BIN_FETCH_STALL;
         return TKWM_BIN_FETCH_FAIL;
     }
-    if (!Update.begin((len > 0) ? (size_t)len : UPDATE_SIZE_UNKNOWN)) {
-        err = String("Update.begin: ") + Update.errorString();
-        http.end();
-        return TKWM_BIN_FETCH_FAIL;
+    if (code == 206) {
+        // Content-Range: bytes <from>-<to>/<size> — сервер обязан продолжить ровно с нашей позиции.
+        const String cr = http.header("Content-Range");
+        const int    sp = cr.indexOf(' '), dash = cr.indexOf('-');
+        if (sp < 0 || dash < 0 || (uint32_t)cr.substring(sp + 1, dash).toInt() != rs.got) {
+            http.end();
+            err = "bad Content-Range: " + cr;
+            return TKWM_BIN_FETCH_FAIL;
+        }
+        Serial.printf("[TKWM] OTA resume at %lu/%lu\n", (unsigned long)rs.got, (unsigned long)rs.total);
+    } else {
+        if (rs.got) Serial.println(F("[TKWM] OTA: файл на сервере сменился или Range не поддержан — заново"));
+        // Update.begin() — в приёмнике, когда по первым байтам ясен формат (сжатый образ длиннее Content-Length).
+        rs.sink.abort();
+        rs.sink.begin((len > 0) ? (size_t)len : 0, http.header("Content-Encoding").equalsIgnoreCase("gzip"));
+        rs.got       = 0;
+        rs.total     = (len > 0) ? (uint32_t)len : 0;
+        rs.validator = http.header("ETag");
+        if (rs.validator.isEmpty()) rs.validator = http.header("Last-Modified");
+        rs.started   = true;
     }
+    st.total = rs.total;
     WiFiClient* stream = http.getStreamPtr();
-    if (!stream) {
-        err = "no stream";
-        Update.abort();
+    TkwmOtaPipe pipe(st, rs.sink);
+    if (!stream || !pipe.begin()) {
+        err = stream ? "no memory" : "no stream";
         http.end();
         return TKWM_BIN_FETCH_FAIL;
     }
-    size_t   written = 0;
-    uint8_t buf[1024];
-    if (len > 0) {
-        size_t n = (size_t)len;
-        while (written < n) {
-            size_t want = n - written;
-            if (want > sizeof(buf)) want = sizeof(buf);
-            int nb = stream->readBytes((char*)buf, want);
-            if (nb <= 0) {
-                delay(2);
-                continue;
-            }
-            if (Update.write(buf, (size_t)nb) != (size_t)nb) {
-                err = String("write: ") + Update.errorString();
-                Update.abort();
-                http.end();
-                return TKWM_BIN_FETCH_FAIL;
-            }
-            written += (size_t)nb;
+    // Тело — через TkwmHttpBody: рамки chunked снимаются, граница тела видна и без закрытия соединения
+    // (keep-alive), иначе цикл дождался бы только TKWM_OTA_STALL_MS.
+    TkwmHttpBody body(*stream, chunked ? -1 : len, chunked);
+    // Блок наполняется из сокета целиком (сектор flash) и уходит писателю; хвост — неполным блоком.
+    // Тишина дольше TKWM_OTA_STALL_MS или закрытый сокет до конца файла — обрыв: принятое дописывается,
+    // позиция остаётся в rs.got.
+    size_t   fill   = 0;
+    uint8_t* blk    = pipe.acquire();
+    bool     ok     = blk != nullptr;
+    bool     stall  = false;
+    bool     cancelled = false;
+    uint32_t lastRx = millis(), lastCb = 0;
+    uint8_t  pct10  = 0;
+    while (ok && (!rs.total || rs.got < rs.total)) {
+        if (st.cancel && *st.cancel) {
+            cancelled = true;
+            break;
         }
-    } else {
-        while (http.connected() || stream->available()) {
-            size_t av = stream->available();
-            if (!av) {
-                delay(1);
-                continue;
+        size_t av = body.available();
+        if (!av) {
+            if (body.ended()) break;
+            // Обрыв посреди кадра или закрытие до нулевого кадра — chunked-тело не кончилось.
+            if (body.failed() || !http.connected()) {
+                stall = rs.total != 0 || chunked || body.failed();
+                break;
             }
-            if (av > sizeof(buf)) av = sizeof(buf);
-            int nb = stream->readBytes((char*)buf, av);
-            if (nb <= 0) continue;
-            if (Update.write(buf, (size_t)nb) != (size_t)nb) {
-                err = String("write: ") + Update.errorString();
-                Update.abort();
-                http.end();
-                return TKWM_BIN_FETCH_FAIL;
+            if (millis() - lastRx >= TKWM_OTA_STALL_MS) {
+                stall = true;
+                break;
             }
+            delay(1);
+            continue;
+        }
+        size_t want = TKWM_OTA_BLOCK - fill;
+        if (rs.total && want > rs.total - rs.got) want = rs.total - rs.got;
+        if (want > av) want = av;
+        const int nb = (int)body.readBytes(blk + fill, want);
+        if (nb <= 0) continue;
+        lastRx = millis();
+        fill += (size_t)nb;
+        rs.got += (uint32_t)nb;
+        if (fill == TKWM_OTA_BLOCK) {
+            ok   = pipe.commit(blk, fill);
+            fill = 0;
+            blk  = ok ? pipe.acquire() : nullptr;
+            ok   = blk != nullptr;
+        }
+        st.pos = rs.got;
+        if (st.progress && lastRx - lastCb >= 250) {
+            lastCb = lastRx;
+            st.progress(st, st.progressCtx);
+        }
+        if (rs.total && (uint8_t)((uint64_t)rs.got * 10 / rs.total) != pct10) {
+            pct10 = (uint8_t)((uint64_t)rs.got * 10 / rs.total);
+            Serial.printf("[TKWM] OTA %u%% (%lu/%lu)\n", pct10 * 10, (unsigned long)rs.got, (unsigned long)rs.total);
         }
     }
+    if (ok && fill) pipe.commit(blk, fill);
+    String werr;
+    ok = pipe.finish(werr);
     http.end();
+    if (!ok || cancelled) {
+        err = cancelled ? String("cancelled") : werr;
+        return TKWM_BIN_FETCH_FAIL;
+    }
+    if (stall) {
+        err = "stalled at " + String((unsigned long)rs.got) + "/" + String((unsigned long)rs.total);
+        return TKWM_BIN_FETCH_STALL;
+    }
+    if (!rs.sink.end()) {
+        err = rs.sink.err();
+        return TKWM_BIN_FETCH_FAIL;
+    }
+    st.outBytes = rs.sink.outBytes();
+    st.enc      = TkwmOtaSink::kindName(rs.sink.kind());
+    if (st.progress) st.progress(st, st.progressCtx);
+    Serial.printf("[TKWM] OTA %s %lu -> %lu B in %lu ms, net wait %lu ms, flash wait %lu ms, ring %u/%u, resumes %u\n", st.enc,
+                  (unsigned long)st.bytes, (unsigned long)st.outBytes, (unsigned long)st.ms, (unsigned long)st.netWaitMs,
+                  (unsigned long)st.flashWaitMs, st.ringMax, st.ring, st.resumes);
     return TKWM_BIN_FETCH_OK;
 }
 
@@ -1976,25 +3739,39 @@ void TKWifiManager::handleOtaCheck() {
     }
     if (!_otaConfLoaded) loadOtaConf_();
     String         hostI, tokenI, skipI;
-    tkwmJsonGetString(body, "host", hostI);
-    tkwmJsonGetString(body, "token", tokenI);
-    tkwmJsonGetString(body, "skipVersion", skipI);
+    TkwmJsonPick(body).str("host", hostI).str("token", tokenI).str("skipVersion", skipI).run();
     String h = tkwmNormHost_(hostI);
     if (h.isEmpty()) h = tkwmNormHost_(_otaFileHost);
     String tk = tokenI;
     if (tk.isEmpty()) tk = _otaFileToken;
-    (void)syncTimeWithNtp_(otaConfigNtp_(), 12000);
     if (h.isEmpty() || tk.isEmpty()) {
         _server.send(200, "application/json", "{\"ok\":false,\"msg\":\"host and token required\"}");
         return;
     }
+    if (otaJobRunning()) {
+        _server.send(200, "application/json", "{\"ok\":false,\"msg\":\"OTA job running\"}");
+        return;
+    }
+    if (!tkwmTimeValid_()) {
+        // TLS-сертификатам нужна дата: запрос SNTP уходит, а страница повторяет check через retryMs.
+        // Тик не ждёт; после TKWM_TIME_WAIT_MS без ответа — ошибка вместо бесконечного ожидания.
+        if (timeSyncStart_(otaConfigNtp_()) && tkwmTimePending_()) {
+            _server.send(200, "application/json", "{\"ok\":false,\"pending\":\"time\",\"retryMs\":1000,\"msg\":\"waiting for NTP time\"}");
+            return;
+        }
+        _server.send(200, "application/json", "{\"ok\":false,\"msg\":\"no NTP time (check Wi-Fi / NTP server)\"}");
+        return;
+    }
     String          ctrl   = tkwmOtaController_();
     String          fw, dl, latest, e;
-    if (!tkwmEsptoolsResolve_(h, tk, ctrl, fw, dl, latest, e, nullptr)) {
-        String o = F("{\"ok\":false,\"msg\":\"");
-        tkwmAppJsonVal_(o, e);
-        o += F("\"}");
-        _server.send(200, "application/json", o);
+    const bool resolved = tkwmEsptoolsResolveCached_(h, tk, ctrl, fw, dl, latest, e, nullptr);
+    // Соединение остаётся тёплым для «Обновить» сразу после проверки; закроет тик.
+    _otaPoolCloseAt = millis() + TKWM_OTA_KEEPALIVE_MS;
+    if (!_otaPoolCloseAt) _otaPoolCloseAt = 1;
+    if (!resolved) {
+        TkwmJson j(_server);
+        j.begin();
+        j.objOpen().kvb("ok", false).kv("msg", e).objClose().end();
         return;
     }
     if (!fw.length() && !latest.length()) {
@@ -2005,61 +3782,109 @@ void TKWifiManager::handleOtaCheck() {
     String       remoteV = fw.length() ? fw : latest;
     const bool   skipB   = (skipI.length() > 0) && (skipI == remoteV);
     const bool   upd     = (remoteV != cur) && !skipB;
-    String       out     = F("{\"ok\":true,\"updateAvailable\":");
-    out += upd ? "true" : "false";
-    out += F(",\"currentVersion\":\"");
-    tkwmAppJsonVal_(out, cur);
-    out += F("\",\"remoteVersion\":\"");
-    tkwmAppJsonVal_(out, remoteV);
-    out += F("\",\"controller\":\"");
-    tkwmAppJsonVal_(out, ctrl);
     (void)dl;
-    out += F("\"}");
-    _server.send(200, "application/json", out);
+    TkwmJson j(_server);
+    j.begin();
+    j.objOpen()
+        .kvb("ok", true)
+        .kvb("updateAvailable", upd)
+        .kv("currentVersion", cur)
+        .kv("remoteVersion", remoteV)
+        .kv("controller", ctrl)
+        .objClose()
+        .end();
 }
 
-static bool tkwmEsptoolsDownloadOta_(const String& base, const String& token, const String& controller, String& err) {
+// ---------- Фоновая установка ----------
+// POST /api/ota/install только ставит задачу tkwm_ota и сразу отвечает её id: время, resolve, скачивание
+// и Update.end() идут там, а сервисный тик (HTTP, WS, DNS, переподключение) не блокируется.
+// Поля пишет задача, тик только читает; err — после перехода в конечную фазу.
+struct TkwmOtaJob {
+    // P_CURRENT — автопроверка: на сервере та же версия, ставить нечего.
+    enum Phase : uint8_t { P_TIME, P_RESOLVE, P_DOWNLOAD, P_VERIFY, P_DONE, P_CURRENT, P_ERROR, P_CANCELLED };
+    static const char* phaseName(uint8_t p) {
+        static const char* const n[] = { "time", "resolve", "download", "verify", "done", "current", "error", "cancelled" };
+        return p <= P_CANCELLED ? n[p] : "?";
+    }
+    TKWifiManager*   owner = nullptr;
+    uint32_t         id    = 0;
+    String           host, token, ctrl;
+    bool             autoMode = false; // от планировщика: ставить, только если версия на сервере другая
+    bool             upToDate = false;
+    String           remote;           // версия на сервере
+    volatile uint8_t phase   = P_TIME;
+    volatile bool    cancel  = false;
+    volatile bool    running = true; // false — задача вышла, структуру можно удалять
+    String           err;
+    TkwmOtaStats     st;
+    uint32_t         startAt = 0, dlAt = 0, endAt = 0;
+    uint8_t          wsPhase = 0xFF; // последняя рассылка по WS (пишет только тик)
+    uint32_t         wsAt = 0, wsPos = 0;
+};
+
+static bool tkwmEsptoolsDownloadOta_(TkwmOtaJob& job) {
+    String&       err = job.err;
+    TkwmOtaStats& st  = job.st;
     if (WiFi.status() != WL_CONNECTED) {
         err = "no internet (Wi-Fi not connected)";
         return false;
     }
+    job.phase = TkwmOtaJob::P_RESOLVE;
     String fw, dl, latest, e2, effBase;
-    if (!tkwmEsptoolsResolve_(base, token, controller, fw, dl, latest, e2, &effBase)) {
+    if (!tkwmEsptoolsResolveCached_(job.host, job.token, job.ctrl, fw, dl, latest, e2, &effBase)) {
         err = e2;
         return false;
     }
-    String tryUrl = tkwmJoinOtaDownloadUrl_(effBase, dl);
+    job.remote = fw.length() ? fw : latest;
+    if (job.autoMode && (job.remote.isEmpty() || job.remote == F(TKWM_FW_VERSION))) {
+        job.upToDate = true;
+        return true;
+    }
+    if (job.cancel) {
+        err = "cancelled";
+        return false;
+    }
+    const String& token = job.token;
+    String tryUrl = tkwmPool_.upgrade(tkwmJoinOtaDownloadUrl_(effBase, dl));
     if (!tryUrl.startsWith("http")) {
         err = "bad download URL";
         return false;
     }
-    for (int att = 0; att < 2; att++) {
-        if (att == 1) {
-            if (!tryUrl.startsWith("http://")) break;
+    job.phase = TkwmOtaJob::P_DOWNLOAD;
+    job.dlAt  = millis();
+    TkwmOtaResume rs;
+    int           att = 0;
+    for (;;) {
+        int         r;
+        WiFiClient* cli = tkwmPool_.acquire(tryUrl); // тот же хост, что у resolve, — по тёплому соединению
+        if (!cli) {
+            tkwmHttpErrNegative_(HTTPC_ERROR_CONNECTION_REFUSED, tryUrl.startsWith("https://"), err);
+            r = rs.started ? TKWM_BIN_FETCH_STALL : TKWM_BIN_FETCH_FAIL;
+        } else {
+            HTTPClient& http = tkwmPool_.http();
+            http.setConnectTimeout(15000);
+            http.setTimeout(TKWM_OTA_STALL_MS);
+            r = tkwmEsptoolsBinFetch_(http, *cli, tryUrl, token, att, err, rs, st);
+            tkwmPool_.release(r == TKWM_BIN_FETCH_OK || r == TKWM_BIN_FETCH_RETRY);
+        }
+        if (r == TKWM_BIN_FETCH_OK) break;
+        if (r == TKWM_BIN_FETCH_RETRY && att == 0) {
+            tkwmPool_.markHttps(tryUrl);
+            att    = 1;
             tryUrl = String("https://") + tryUrl.substring(7);
+            continue;
         }
-        {
-            HTTPClient http;
-            http.setConnectTimeout(15000);
-            http.setTimeout(60000);
-            int st;
-            if (tryUrl.startsWith("https://")) {
-                WiFiClientSecure tlsCl;
-#if TKWM_OTA_INSECURE
-                tlsCl.setInsecure();
-#endif
-                st = tkwmEsptoolsBinFetch_(http, tlsCl, tryUrl, token, att, err);
-            } else {
-                WiFiClient plainCl;
-                st = tkwmEsptoolsBinFetch_(http, plainCl, tryUrl, token, att, err);
-            }
-            if (st == TKWM_BIN_FETCH_RETRY)
-                continue;
-            if (st == TKWM_BIN_FETCH_FAIL)
-                return false;
+        if (r == TKWM_BIN_FETCH_STALL && !job.cancel && st.resumes < TKWM_OTA_RESUME_TRIES && WiFi.status() == WL_CONNECTED) {
+            st.resumes++;
+            Serial.printf("[TKWM] OTA %s, retry %u/%u\n", err.c_str(), st.resumes, (unsigned)TKWM_OTA_RESUME_TRIES);
+            delay(500UL * st.resumes);
+            continue;
         }
-        break; // success
+        rs.sink.abort();
+        if (!job.cancel) tkwmResolveCache_.ok = false; // ссылка на образ могла истечь — следующий раз resolve заново
+        return false;
     }
+    job.phase = TkwmOtaJob::P_VERIFY;
     if (!Update.end(true)) {
         err = String("Update.end: ") + Update.errorString();
         return false;
@@ -2067,6 +3892,30 @@ static bool tkwmEsptoolsDownloadOta_(const String& base, const String& token, co
     return true;
 }
 
+bool TKWifiManager::otaJobRunning() const {
+    return _otaJob && _otaJob->running;
+}
+
+void TKWifiManager::otaJobTask_(void* arg) {
+    TkwmOtaJob* job = (TkwmOtaJob*)arg;
+    // Запрос SNTP отправил otaJobStart (тик); здесь только ждём колбэка — ограниченно и с отменой.
+    for (const uint32_t t0 = millis(); !tkwmTimeValid_() && !job->cancel && (uint32_t)(millis() - t0) < TKWM_TIME_WAIT_MS;)
+        vTaskDelay(pdMS_TO_TICKS(100));
+    const bool ok = !job->cancel && tkwmEsptoolsDownloadOta_(*job);
+    if (!ok && job->cancel) job->err = "cancelled";
+    job->endAt = millis();
+    Serial.printf("[TKWM] OTA job %lu%s: %s %s\n", (unsigned long)job->id, job->autoMode ? " (auto)" : "",
+                  !ok ? "failed" : job->upToDate ? "up to date" : "done", ok ? job->remote.c_str() : job->err.c_str());
+    const TkwmHttpPool::Stats& ps = tkwmPool_.st;
+    Serial.printf("[TKWM] OTA net: %u handshakes (%lu ms), %u reused, DNS %u/%u cached\n", ps.handshakes, (unsigned long)ps.handshakeMs,
+                  ps.reused, ps.dnsHits, ps.dnsHits + ps.dnsMiss);
+    tkwmPool_.close(); // задача — последний пользователь; ~40 КБ TLS-буферов назад в кучу
+    job->phase   = !ok ? (job->cancel ? TkwmOtaJob::P_CANCELLED : TkwmOtaJob::P_ERROR)
+                       : (job->upToDate ? TkwmOtaJob::P_CURRENT : TkwmOtaJob::P_DONE);
+    job->running = false;
+    vTaskDelete(nullptr);
+}
+
 void TKWifiManager::handleOtaInstall() {
     const String body = tkwmWebServerPostBody_(_server);
     if (!body.length()) {
@@ -2075,34 +3924,193 @@ void TKWifiManager::handleOtaInstall() {
     }
     if (!_otaConfLoaded) loadOtaConf_();
     String         hostI, tokenI;
-    tkwmJsonGetString(body, "host", hostI);
-    tkwmJsonGetString(body, "token", tokenI);
+    TkwmJsonPick(body).str("host", hostI).str("token", tokenI).run();
     String h  = tkwmNormHost_(hostI);
     if (h.isEmpty()) h = tkwmNormHost_(_otaFileHost);
     String tk = tokenI;
     if (tk.isEmpty()) tk = _otaFileToken;
-    (void)syncTimeWithNtp_(otaConfigNtp_(), 12000);
     if (h.isEmpty() || tk.isEmpty()) {
         _server.send(200, "application/json", "{\"ok\":false,\"msg\":\"host and token required\"}");
         return;
     }
-    String   errS;
-    String   ctrl = tkwmOtaController_();
-    if (!tkwmEsptoolsDownloadOta_(h, tk, ctrl, errS)) {
-        String o = F("{\"ok\":false,\"msg\":\"");
-        tkwmAppJsonVal_(o, errS);
-        o += F("\"}");
-        _server.send(200, "application/json", o);
+    String err;
+    if (!otaJobStart(h, tk, false, err)) {
+        TkwmJson j(_server);
+        j.begin();
+        j.objOpen().kvb("ok", false).kv("msg", err);
+        if (otaJobRunning()) j.kvu("job", _otaJob->id);
+        j.objClose().end();
+        return;
+    }
+    TkwmJson j(_server);
+    j.begin();
+    j.objOpen().kvb("ok", true).kvb("pending", true).kvu("job", _otaJob->id).objClose().end();
+}
+
+bool TKWifiManager::otaJobStart(const String& host, const String& token, bool autoMode, String& err) {
+    if (otaJobRunning() || Update.isRunning()) {
+        err = "OTA already running";
+        return false;
+    }
+    delete _otaJob;
+    _otaJob = new (std::nothrow) TkwmOtaJob;
+    if (!_otaJob) {
+        err = "no memory";
+        return false;
+    }
+    TkwmOtaJob& job = *_otaJob;
+    job.owner     = this;
+    job.id        = ++_otaJobSeq;
+    job.host      = host;
+    job.token     = token;
+    job.ctrl      = tkwmOtaController_();
+    job.autoMode  = autoMode;
+    job.startAt   = millis();
+    job.st.cancel = &job.cancel;
+    if (autoMode) _otaAutoAt = 0; // следующую проверку назначит итог задачи
+    if (!tkwmTimeValid_()) (void)timeSyncStart_(otaConfigNtp_()); // TLS-сертификатам нужна дата
+    if (xTaskCreate(otaJobTask_, "tkwm_ota", TKWM_OTA_JOB_STACK, _otaJob, uxTaskPriorityGet(nullptr), nullptr) != pdPASS) {
+        delete _otaJob;
+        _otaJob = nullptr;
+        err     = "task start failed";
+        return false;
+    }
+    return true;
+}
+
+void TKWifiManager::otaJobWrite(TkwmJson& j) const {
+    const TkwmOtaJob&   job = *_otaJob;
+    const TkwmOtaStats& st  = job.st;
+    const uint8_t       ph  = job.phase;
+    j.kvu("job", job.id).kv("phase", TkwmOtaJob::phaseName(ph)).kvb("auto", job.autoMode).kvu("pos", st.pos).kvu("total", st.total);
+    if (ph >= TkwmOtaJob::P_DONE && job.remote.length()) j.kv("remoteVersion", job.remote);
+    // Скорость — от начала скачивания (с докачками и паузами между ними), ETA — по ней же.
+    const uint32_t el  = job.dlAt ? ((ph >= TkwmOtaJob::P_DONE && job.endAt ? job.endAt : millis()) - job.dlAt) : 0;
+    const uint32_t bps = el ? (uint32_t)((uint64_t)st.pos * 1000 / el) : 0;
+    j.kvu("kbps", bps / 1024).kvi("resumes", st.resumes);
+    if (ph == TkwmOtaJob::P_DOWNLOAD && st.total && bps) j.kvu("etaS", (st.total - st.pos) / bps);
+    if (ph >= TkwmOtaJob::P_ERROR) j.kv("msg", job.err);
+    if (ph == TkwmOtaJob::P_DONE) {
+        j.key("stats").objOpen();
+        j.kv("enc", st.enc).kvu("bytes", st.bytes).kvu("image", st.outBytes).kvu("ms", st.ms).kvu("kbps", st.ms ? (uint32_t)((uint64_t)st.bytes * 1000 / 1024 / st.ms) : 0);
+        j.kvu("netWaitMs", st.netWaitMs).kvu("flashWaitMs", st.flashWaitMs).kvi("ringMax", st.ringMax).kvi("ring", st.ring);
+        j.kvi("resumes", st.resumes);
+        j.objClose();
+    }
+}
+
+// Тик: новая фаза — сразу, ход скачивания — не чаще двух раз в секунду. Без задачи — одно сравнение.
+void TKWifiManager::otaJobTick() {
+    TkwmOtaJob&   job = *_otaJob;
+    const uint8_t ph  = job.phase;
+    if (ph == job.wsPhase && (ph != TkwmOtaJob::P_DOWNLOAD || job.st.pos == job.wsPos || (uint32_t)(millis() - job.wsAt) < 500)) return;
+    job.wsPhase = ph;
+    job.wsAt    = millis();
+    job.wsPos   = job.st.pos;
+    String out;
+    TkwmJson j(out);
+    j.objOpen().kv("type", "ota");
+    otaJobWrite(j);
+    j.objClose().end();
+    _ws.broadcastTXT(out);
+    TKWM_METRIC(_mWsTx++);
+    if (ph == TkwmOtaJob::P_DONE) {
+        _otaRestartPending = true;
+        _otaRestartAt      = millis() + 1500; // страница успевает забрать итог
+    } else if (ph >= TkwmOtaJob::P_CURRENT && job.autoMode && TKWM_OTA_AUTO_MS) {
+        // Провал — пауза 2, 4, 8… мин (не дольше интервала), иначе — обычный интервал.
+        const uint32_t every = otaAutoIntervalMs();
+        uint32_t       wait  = every;
+        if (ph == TkwmOtaJob::P_ERROR) {
+            _otaAutoFails = (uint8_t)min<int>(_otaAutoFails + 1, 16);
+            wait          = min<uint32_t>(every, 60000UL << _otaAutoFails);
+        } else {
+            _otaAutoFails = 0;
+        }
+        otaAutoSchedule(wait, wait / 8);
+    }
+}
+
+// ---------- Планировщик автообновления ----------
+// Срок проверки — одна метка _otaAutoAt; тик сравнивает её с millis() и больше ничего не делает.
+// Разброс по MAC (не синхронизировать парк устройств на сервере) добавляется к каждому сроку.
+uint32_t TKWifiManager::otaAutoIntervalMs() const {
+    return _otaFileIntervalMin ? (uint32_t)_otaFileIntervalMin * 60000UL : (uint32_t)TKWM_OTA_AUTO_MS;
+}
+
+void TKWifiManager::otaAutoSchedule(uint32_t delayMs, uint32_t spreadMs) {
+    const uint32_t mac = (uint32_t)ESP.getEfuseMac() ^ (uint32_t)(ESP.getEfuseMac() >> 32);
+    const uint32_t r   = tkwmMix32_(mac ^ (++_otaAutoRound * 0x9E3779B9u));
+    _otaAutoAt = millis() + delayMs + (spreadMs ? r % spreadMs : 0);
+    if (!_otaAutoAt) _otaAutoAt = 1;
+}
+
+// Окна "HH:MM-HH:MM" через запятую по местному времени (смещение из ota.conf), окно может идти через
+// полночь. Ответ — сколько ждать до начала ближайшего; без даты на устройстве окно не определить.
+uint32_t TKWifiManager::otaAutoWindowWaitMs() {
+    if (_otaFileWindow.isEmpty()) return 0;
+    const time_t t = time(nullptr);
+    if (t < 1700000000) return 10UL * 60000UL;
+    const uint16_t now  = (uint16_t)((((long)(t / 60) + otaConfigTzOffsetMin_()) % 1440 + 1440) % 1440);
+    uint32_t       best = UINT32_MAX;
+    const char*    p    = _otaFileWindow.c_str();
+    while (*p) {
+        unsigned h1, m1, h2, m2;
+        int      n = 0;
+        if (sscanf(p, "%u:%u-%u:%u%n", &h1, &m1, &h2, &m2, &n) != 4) break;
+        p += n;
+        while (*p == ',' || *p == ' ') p++;
+        const uint16_t a = (uint16_t)((h1 * 60 + m1) % 1440), b = (uint16_t)((h2 * 60 + m2) % 1440);
+        if (a <= b ? (now >= a && now < b) : (now >= a || now < b)) return 0;
+        best = min<uint32_t>(best, (uint32_t)((a + 1440 - now) % 1440));
+    }
+    return best == UINT32_MAX ? 0 : best * 60000UL;
+}
+
+void TKWifiManager::otaAutoTick() {
+    const uint32_t every = otaAutoIntervalMs();
+    if (!otaConfigAuto_() || otaConfigHost_().isEmpty() || _otaFileToken.isEmpty()) {
+        otaAutoSchedule(every, 0); // авто выключено — флаг перечитаем через интервал (или при сохранении)
+        return;
+    }
+    if (_captiveMode || WiFi.status() != WL_CONNECTED || otaJobRunning() || Update.isRunning()) {
+        otaAutoSchedule(60000UL, 30000UL);
+        return;
+    }
+    const uint32_t wait = otaAutoWindowWaitMs();
+    if (wait) {
+        otaAutoSchedule(wait, min<uint32_t>(wait, 15UL * 60000UL));
+        return;
+    }
+    String err;
+    if (otaJobStart(otaConfigHost_(), _otaFileToken, true, err)) Serial.printf("[TKWM] OTA auto check, job %lu\n", (unsigned long)_otaJob->id);
+    else otaAutoSchedule(60000UL, 30000UL);
+}
+
+void TKWifiManager::handleOtaProgress() {
+    TkwmJson j(_server);
+    j.begin();
+    j.objOpen().kvb("ok", true);
+    if (_otaJob) otaJobWrite(j);
+    else j.kv("phase", "idle");
+    j.objClose().end();
+}
+
+void TKWifiManager::handleOtaCancel() {
+    if (!otaJobRunning()) {
+        _server.send(200, "application/json", "{\"ok\":false,\"msg\":\"no OTA job\"}");
         return;
     }
-    _server.send(200, "application/json", F("{\"ok\":true,\"msg\":\"reboot\"}"));
-    _otaRestartPending = true;
-    _otaRestartAt      = millis() + 500;
+    _otaJob->cancel = true; // задача увидит флаг в цикле приёма или между фазами
+    TkwmJson j(_server);
+    j.begin();
+    j.objOpen().kvb("ok", true).kvu("job", _otaJob->id).objClose().end();
 }
 
 void TKWifiManager::handleNotFound() {
     String uri = _server.uri();
     if (_fsOk && streamIfExists(uri)) return;
+    if (sendBuiltin(uri)) return; // /theme.css, /theme.js и т.п., если их нет в FS
     if (_captiveMode) {
         _server.sendHeader("Location", "/wifi", true);
         _server.send(302, "text/plain", "");
@@ -2112,42 +4120,43 @@ void TKWifiManager::handleNotFound() {
 }
 
 // =================== /api/wifi/scan (REST polling) =====
+// Ответ всегда сразу из кэша; если он старше maxAge (мс) — параллельно запускается скан,
+// а "scanning":true подсказывает клиенту повторить запрос чуть позже.
 void TKWifiManager::handleWifiScan() {
-    ensureWifiForScan_();
-    int n = WiFi.scanNetworks(false, true);
-    bool connected = (WiFi.status() == WL_CONNECTED);
-    String out;
-    out.reserve(64 * max(n, 1) + 64);
-    out += F("{\"connected\":");
-    out += connected ? F("true") : F("false");
-    out += F(",\"ip\":\"");
-    out += connected ? WiFi.localIP().toString() : String("0.0.0.0");
-    out += F("\",\"nets\":[");
-    for (int i = 0; i < n; ++i) {
-        if (i) out += ',';
-        out += F("{\"ssid\":\"");
-        String s = WiFi.SSID(i);
-        for (size_t k = 0; k < s.length(); k++) {
-            char c = s[k];
-            if (c == '\"' || c == '\\') { out += '\\'; out += c; }
-            else if ((uint8_t)c < 0x20) { char esc[7]; snprintf(esc, sizeof(esc), "\\u%04X", (unsigned char)c); out += esc; }
-            else out += c;
-        }
-        out += F("\",\"rssi\":"); out += String(WiFi.RSSI(i));
-        out += F(",\"ch\":");     out += String(WiFi.channel(i));
-        out += F(",\"enc\":");    out += (WiFi.encryptionType(i) == WIFI_AUTH_OPEN ? 0 : 1);
-        out += '}';
+    uint32_t maxAge = TKWM_SCAN_MAX_AGE_MS;
+    if (_server.hasArg("maxAge")) {
+        const long v = _server.arg("maxAge").toInt();
+        maxAge = v > 0 ? (uint32_t)v : 0;
     }
-    out += "]}";
-    _server.send(200, "application/json", out);
+    if (!_scanRunning && scanAgeMs() > maxAge) scanRequest();
+    bool connected = (WiFi.status() == WL_CONNECTED);
+    TkwmJson j(_server);
+    j.begin();
+    j.objOpen()
+        .kvb("connected", connected)
+        .kv("ip", connected ? WiFi.localIP().toString() : String("0.0.0.0"))
+        .kvb("scanning", _scanRunning)
+        .kvi("age", _scanAt ? (long)scanAgeMs() : -1L);
+    scanWriteNets(j);
+    j.objClose().end();
 }
 
 // =================== WebSocket helpers =================
+String TKWifiManager::wsStatusMessage() const {
+    String out;
+    TkwmJson j(out);
+    j.objOpen()
+        .kv("type", "status")
+        .kv("mode", _captiveMode ? "AP" : "STA")
+        .kv("ip", (_captiveMode ? WiFi.softAPIP() : WiFi.localIP()).toString());
+    if (!_captiveMode && _connPath[0]) j.kv("connPath", _connPath).kvu("connMs", _connMs);
+    j.objClose().end();
+    return out;
+}
+
 void TKWifiManager::wsSendStatus(uint8_t clientId) {
-    String mode = _captiveMode ? "AP" : "STA";
-    String ipS = (_captiveMode ? WiFi.softAPIP() : WiFi.localIP()).toString();
-    String j = String("{\"type\":\"status\",\"mode\":\"") + mode + "\",\"ip\":\"" + ipS + "\"}";
-    _ws.sendTXT(clientId, j);
+    _ws.sendTXT(clientId, wsStatusMessage());
+    TKWM_METRIC(_mWsTx++);
 }
 
 static void ensureWifiForScan_() {
@@ -2167,26 +4176,110 @@ static void ensureWifiForScan_() {
     esp_wifi_set_ps(WIFI_PS_NONE);
 }
 
-// --- основной сканер (три попытки) ---
-void TKWifiManager::wsRunScanAndPublish() {
-    ensureWifiForScan_();    
-    int n = WiFi.scanNetworks(false, true);
-    String out;
-    out.reserve(64 * max(n, 1) + 32);
-    out += F("{\"type\":\"scan\",\"nets\":[");
+// =================== Планировщик сканов =================
+bool TKWifiManager::scanRequest() {
+    if (_scanRunning) return true; // запрос сливается с уже идущим сканом
+    ensureWifiForScan_();
+    if (WiFi.scanNetworks(/*async*/true, /*hidden*/true) == WIFI_SCAN_FAILED) return false;
+    _scanRunning = true;
+    _scanStartedAt = millis();
+    return true;
+}
+
+void TKWifiManager::scanTick() {
+    if (!_scanRunning) return;
+    const int16_t n = WiFi.scanComplete();
+    if (n == WIFI_SCAN_RUNNING) {
+        if ((millis() - _scanStartedAt) < TKWM_SCAN_TIMEOUT_MS) return;
+        Serial.println(F("[TKWM] scan timeout"));
+    }
+    _scanRunning = false;
+    scanCollect(n);
+    WiFi.scanDelete();
+    if (_scanWsPending) {
+        _scanWsPending = false;
+        String out;
+        out.reserve(64 * max((int)_scanN, 1) + 32);
+        TkwmJson j(out);
+        j.objOpen().kv("type", "scan");
+        scanWriteNets(j);
+        j.objClose().end();
+        _ws.broadcastTXT(out);
+        TKWM_METRIC(_mWsTx++);
+    }
+}
+
+void TKWifiManager::scanCollect(int16_t n) {
+    if (n < 0) return;
+    // В кэш — сильнейшие TKWM_SCAN_CACHE_MAX сетей, по убыванию RSSI.
+    _scanN = 0;
     for (int i = 0; i < n; ++i) {
-        if (i) out += ',';
-        out += '{';
-        out += F("\"ssid\":\"");
-        String s = WiFi.SSID(i);
-        for (size_t k = 0; k < s.length(); k++) { char c = s[k]; if (c == '\"' || c == '\\') { out += '\\'; out += c; } else if ((uint8_t)c < 0x20) { char esc[7]; snprintf(esc, sizeof(esc), "\\u%04X", (unsigned char)c); out += esc; } else out += c; }
-        out += F("\",\"rssi\":"); out += String(WiFi.RSSI(i));
-        out += F(",\"ch\":");     out += String(WiFi.channel(i));
-        out += F(",\"enc\":");    out += (WiFi.encryptionType(i) == WIFI_AUTH_OPEN ? 0 : 1);
-        out += '}';
+        const int8_t rssi = (int8_t)WiFi.RSSI(i);
+        int k = _scanN;
+        if (k == TKWM_SCAN_CACHE_MAX) {
+            if (_scanNets[k - 1].rssi >= rssi) continue;
+            k--;
+        } else {
+            _scanN++;
+        }
+        while (k > 0 && _scanNets[k - 1].rssi < rssi) { _scanNets[k] = _scanNets[k - 1]; k--; }
+        _scanNets[k] = { WiFi.SSID(i), rssi, (uint8_t)WiFi.channel(i), WiFi.encryptionType(i) == WIFI_AUTH_OPEN };
+        const uint8_t* b = WiFi.BSSID(i);
+        if (b) memcpy(_scanNets[k].bssid, b, 6);
+        else memset(_scanNets[k].bssid, 0, 6);
+    }
+    _scanAt = millis();
+    if (_scanAt == 0) _scanAt = 1;
+}
+
+uint32_t TKWifiManager::scanAgeMs() const {
+    return _scanAt ? (uint32_t)(millis() - _scanAt) : UINT32_MAX;
+}
+
+void TKWifiManager::scanWriteNets(TkwmJson& j) const {
+    j.key("nets").arrOpen();
+    for (int i = 0; i < _scanN; ++i) {
+        const ScanNet& n = _scanNets[i];
+        j.objOpen().kv("ssid", n.ssid).kvi("rssi", n.rssi).kvi("ch", n.ch).kvi("enc", n.open ? 0 : 1).objClose();
     }
-    out += "]}";
-    _ws.broadcastTXT(out);    
+    j.arrClose();
+}
+
+// WS "scan": несколько вкладок подряд не порождают серию сканов — свежий кэш уходит сразу
+// запросившему клиенту, иначе результат общего скана получат все клиенты.
+void TKWifiManager::wsRunScanAndPublish(uint8_t clientId) {
+    if (!_scanRunning && scanAgeMs() < TKWM_SCAN_MIN_INTERVAL_MS) {
+        String out;
+        out.reserve(64 * max((int)_scanN, 1) + 32);
+        TkwmJson j(out);
+        j.objOpen().kv("type", "scan");
+        scanWriteNets(j);
+        j.objClose().end();
+        _ws.sendTXT(clientId, out);
+        TKWM_METRIC(_mWsTx++);
+        return;
+    }
+    _scanWsPending = true;
+    if (!scanRequest()) {
+        _scanWsPending = false;
+        _ws.sendTXT(clientId, "{\"type\":\"scan\",\"nets\":[]}");
+        TKWM_METRIC(_mWsTx++);
+    }
+}
+
+// =================== Таймлайн загрузки ==================
+void TKWifiManager::bootMark(const char* name) {
+    if (_bootN >= sizeof(_boot) / sizeof(_boot[0])) return;
+    _boot[_bootN++] = { name, (uint32_t)millis() };
+    Serial.printf("[TKWM] boot %s @%lu ms\n", name, (unsigned long)millis());
+}
+
+void TKWifiManager::handleBoot() {
+    TkwmJson j(_server);
+    j.begin();
+    j.objOpen().kvb("ok", true).kvb("async", TKWM_ASYNC_BEGIN != 0).key("stages").arrOpen();
+    for (uint8_t i = 0; i < _bootN; i++) j.objOpen().kv("name", _boot[i].name).kvu("ms", _boot[i].at).objClose();
+    j.arrClose().objClose().end();
 }
 
 // =================== UDP discovery =====================
@@ -2197,12 +4290,162 @@ void TKWifiManager::udpTick() {
     int n = _udp.read(buf, sizeof(buf) - 1);
     buf[n] = 0;
     if (!String(buf).startsWith(TKWM_DISCOVERY_SIGNATURE)) return;
-    String payload = String("{\"id\":\"") + _apSsid + "\",\"name\":\"" + _apSsid + "\",\"ip\":\"" + ip().toString() + "\",\"model\":\"ESP32\",\"web\":\"/\"}";
+    String payload;
+    {
+        TkwmJson j(payload);
+        j.objOpen().kv("id", _apSsid).kv("name", _apSsid).kv("ip", ip().toString()).kv("model", "ESP32").kv("web", "/").objClose().end();
+    }
     _udp.beginPacket(_udp.remoteIP(), _udp.remotePort());
     _udp.print(payload);
     _udp.endPacket();
 }
 
+#if TKWM_METRICS
+// =================== Метрики (/api/metrics) ==================
+static const char* const TKWM_METRIC_STAGE_NAMES[] = { "dns", "http", "ws", "udp", "scan", "link", "conn", "tick" };
+
+void TKWifiManager::MetricHist::add(uint32_t us) {
+    if (!n || us < minUs) minUs = us;
+    if (us > maxUs) maxUs = us;
+    n++;
+    sumUs += us;
+    uint8_t i = us ? (uint8_t)(31 - __builtin_clz(us)) : 0;
+    if (i >= sizeof(b) / sizeof(b[0])) i = sizeof(b) / sizeof(b[0]) - 1;
+    b[i]++;
+}
+
+uint32_t TKWifiManager::MetricHist::pct(uint8_t p) const {
+    if (!n) return 0;
+    const uint32_t need = (uint32_t)(((uint64_t)n * p + 99) / 100);
+    uint32_t       acc  = 0;
+    for (uint8_t i = 0; i < sizeof(b) / sizeof(b[0]) - 1; i++) {
+        acc += b[i];
+        if (acc >= need) {
+            const uint32_t hi = (2u << i) - 1;
+            return hi < maxUs ? hi : maxUs;
+        }
+    }
+    return maxUs;
+}
+
+TKWifiManager::Route TKWifiManager::metricWrap(const String& uri, HTTPMethod method, Route h) {
+    if (_mRouteN >= TKWM_METRICS_MAX_ROUTES) return h; // маршрут работает, просто без метрик
+    const uint8_t slot = _mRouteN++;
+    _mRoute[slot].uri    = uri;
+    _mRoute[slot].method = method;
+    return [this, slot, h] {
+        const uint32_t t0 = micros();
+        h();
+        _mRoute[slot].h.add(micros() - t0);
+    };
+}
+
+static const char* tkwmMethodName_(HTTPMethod m) {
+    switch (m) {
+    case HTTP_GET: return "GET";
+    case HTTP_POST: return "POST";
+    case HTTP_PUT: return "PUT";
+    case HTTP_DELETE: return "DELETE";
+    case HTTP_ANY: return "ANY";
+    default: return "OTHER";
+    }
+}
+
+static void tkwmJsonHist_(TkwmJson& j, uint32_t n, uint64_t sumUs, uint32_t minUs, uint32_t p99Us, uint32_t maxUs) {
+    j.kvu("n", n).kvu("minUs", minUs).kvu("avgUs", n ? (unsigned long)(sumUs / n) : 0UL).kvu("p99Us", p99Us).kvu("maxUs", maxUs);
+}
+
+void TKWifiManager::handleMetrics() {
+    const uint32_t freeHeap = ESP.getFreeHeap(), minFree = ESP.getMinFreeHeap(), maxAlloc = ESP.getMaxAllocHeap();
+    long           stackFree = -1; // байт; -1 — фоновой задачи нет
+#if TKWM_USE_BACKGROUND_TASK
+    if (_bgTaskHandle) stackFree = (long)uxTaskGetStackHighWaterMark(_bgTaskHandle);
+#endif
+
+    if (_server.arg("format") == "prometheus") {
+        // Текстовый формат Prometheus 0.0.4; длительности — в микросекундах, квантили — оценка по корзинам.
+        _server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+        _server.send(200, "text/plain; version=0.0.4", "");
+        String o;
+        o.reserve(TKWM_JSON_CHUNK + 160);
+        auto flush = [&](bool force) {
+            if (o.length() && (force || o.length() >= TKWM_JSON_CHUNK)) {
+                _server.sendContent(o);
+                o = "";
+            }
+        };
+        auto summary = [&](const char* name, const String& labels, const MetricHist& h) {
+            o += name; o += "{"; o += labels; o += ",quantile=\"0.5\"} "; o += h.pct(50); o += "\n";
+            o += name; o += "{"; o += labels; o += ",quantile=\"0.99\"} "; o += h.pct(99); o += "\n";
+            o += name; o += "_sum{"; o += labels; o += "} "; o += String((unsigned long)h.sumUs); o += "\n";
+            o += name; o += "_count{"; o += labels; o += "} "; o += h.n; o += "\n";
+            o += name; o += "_max{"; o += labels; o += "} "; o += h.maxUs; o += "\n";
+            flush(false);
+        };
+        o += "# TYPE tkwm_uptime_seconds gauge\ntkwm_uptime_seconds "; o += (unsigned long)(millis() / 1000); o += "\n";
+        o += "# TYPE tkwm_heap_free_bytes gauge\ntkwm_heap_free_bytes "; o += freeHeap; o += "\n";
+        o += "# TYPE tkwm_heap_min_free_bytes gauge\ntkwm_heap_min_free_bytes "; o += minFree; o += "\n";
+        o += "# TYPE tkwm_heap_max_alloc_bytes gauge\ntkwm_heap_max_alloc_bytes "; o += maxAlloc; o += "\n";
+        if (stackFree >= 0) {
+            o += "# TYPE tkwm_task_stack_free_bytes gauge\ntkwm_task_stack_free_bytes "; o += stackFree; o += "\n";
+        }
+        if (_connPath[0]) {
+            o += "# TYPE tkwm_connect_time_to_ip_milliseconds gauge\ntkwm_connect_time_to_ip_milliseconds{path=\"";
+            o += _connPath; o += "\"} "; o += _connMs; o += "\n";
+        }
+        o += "# TYPE tkwm_ws_clients gauge\ntkwm_ws_clients "; o += (unsigned long)_ws.connectedClients(); o += "\n";
+        o += "# TYPE tkwm_ws_messages_total counter\ntkwm_ws_messages_total{dir=\"rx\"} "; o += _mWsRx;
+        o += "\ntkwm_ws_messages_total{dir=\"tx\"} "; o += _mWsTx; o += "\n";
+        o += "# TYPE tkwm_ws_rx_bytes_total counter\ntkwm_ws_rx_bytes_total "; o += _mWsRxBytes; o += "\n";
+        o += "# TYPE tkwm_stage_duration_microseconds summary\n";
+        for (uint8_t i = 0; i < MS_COUNT; i++)
+            summary("tkwm_stage_duration_microseconds", String("stage=\"") + TKWM_METRIC_STAGE_NAMES[i] + "\"", _mStage[i]);
+        o += "# TYPE tkwm_http_request_duration_microseconds summary\n";
+        for (uint8_t i = 0; i < _mRouteN; i++) {
+            String lbl = "route=\"";
+            for (size_t k = 0; k < _mRoute[i].uri.length(); k++) {
+                const char c = _mRoute[i].uri[k];
+                if (c == '"' || c == '\\') lbl += '\\';
+                lbl += c;
+            }
+            lbl += "\",method=\"";
+            lbl += tkwmMethodName_(_mRoute[i].method);
+            lbl += "\"";
+            summary("tkwm_http_request_duration_microseconds", lbl, _mRoute[i].h);
+        }
+        flush(true);
+        _server.sendContent("");
+        return;
+    }
+
+    TkwmJson j(_server);
+    j.begin();
+    j.objOpen().kvb("ok", true).kvu("uptimeMs", millis());
+    j.key("heap").objOpen().kvu("free", freeHeap).kvu("minFree", minFree).kvu("maxAlloc", maxAlloc).objClose();
+    j.key("taskStackFree");
+    if (stackFree >= 0) j.num(stackFree);
+    else j.raw("null", 4);
+    j.key("connect").objOpen().kv("path", _connPath).kvu("ms", _connMs).objClose();
+    j.key("ws").objOpen().kvu("clients", _ws.connectedClients()).kvu("rx", _mWsRx).kvu("tx", _mWsTx).kvu("rxBytes", _mWsRxBytes).objClose();
+    j.key("stages").objOpen();
+    for (uint8_t i = 0; i < MS_COUNT; i++) {
+        const MetricHist& h = _mStage[i];
+        j.key(TKWM_METRIC_STAGE_NAMES[i]).objOpen();
+        tkwmJsonHist_(j, h.n, h.sumUs, h.minUs, h.pct(99), h.maxUs);
+        j.objClose();
+    }
+    j.objClose();
+    j.key("routes").arrOpen();
+    for (uint8_t i = 0; i < _mRouteN; i++) {
+        const MetricHist& h = _mRoute[i].h;
+        j.objOpen().kv("uri", _mRoute[i].uri).kv("method", tkwmMethodName_(_mRoute[i].method));
+        tkwmJsonHist_(j, h.n, h.sumUs, h.minUs, h.pct(99), h.maxUs);
+        j.objClose();
+    }
+    j.arrClose().objClose().end();
+}
+#endif
+
 // =================== FS helpers ========================
 String TKWifiManager::contentType(const String& path) {
     if (path.endsWith(".htm") || path.endsWith(".html")) return "text/html";
@@ -2235,16 +4478,178 @@ bool TKWifiManager::looksText(File& f) {
     return true;
 }
 
+/** HTTP-date (RFC 7231) для Last-Modified; пусто, если часы не были синхронизированы при записи. */
+static String tkwmHttpDate_(time_t t) {
+    if (t < 1700000000) return String();
+    struct tm tmv;
+    gmtime_r(&t, &tmv);
+    char buf[40];
+    strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tmv);
+    return String(buf);
+}
+
+bool TKWifiManager::setCacheControl(const String& ext, const String& value) {
+    for (uint8_t i = 0; i < _cacheRuleN; ++i) {
+        if (_cacheRules[i].ext != ext) continue;
+        if (value.length()) {
+            _cacheRules[i].value = value;
+        } else {
+            for (uint8_t k = i + 1; k < _cacheRuleN; ++k) _cacheRules[k - 1] = _cacheRules[k];
+            _cacheRules[--_cacheRuleN] = CacheRule();
+        }
+        return true;
+    }
+    if (!value.length()) return true;
+    if (_cacheRuleN >= TKWM_MAX_CACHE_RULES) return false;
+    _cacheRules[_cacheRuleN++] = { ext, value };
+    return true;
+}
+
+String TKWifiManager::cacheControlFor(const String& path) const {
+    for (uint8_t i = 0; i < _cacheRuleN; ++i)
+        if (path.endsWith(_cacheRules[i].ext)) return _cacheRules[i].value;
+    return F(TKWM_STATIC_CACHE_CONTROL);
+}
+
+// Статика из FS: при Accept-Encoding: gzip предпочитаем path.gz; валидаторы — ETag из размера и mtime
+// (+ "-gz" для сжатого представления) и Last-Modified; совпадение If-None-Match / If-Modified-Since → 304.
 bool TKWifiManager::streamIfExists(const String& uri) {
     String path = uri;
     if (!path.startsWith("/")) path = "/" + path;
     if (path.endsWith("/")) path += "index.html";
     if (tkwmFsPathIsOtaConf_(path)) return false;
-    if (!TKWM_FS.exists(path)) return false;
-    File f = TKWM_FS.open(path, "r");
+    const String gzPath = path + ".gz";
+    const bool   hasGz  = TKWM_FS.exists(gzPath);
+    const bool   hasRaw = TKWM_FS.exists(path);
+    if (!hasRaw && !hasGz) return false;
+    // Только .gz без оригинала — отдаём его любому клиенту (распаковать на устройстве нечем).
+    const bool useGz = hasGz && (!hasRaw || _server.header("Accept-Encoding").indexOf("gzip") >= 0);
+    File f = TKWM_FS.open(useGz ? gzPath : path, "r");
     if (!f) return false;
-    _server.streamFile(f, contentType(path));
-    f.close();
+    if (f.isDirectory()) {
+        f.close();
+        return false;
+    }
+    if (hasGz && hasRaw) _server.sendHeader(F("Vary"), F("Accept-Encoding"));
+    sendFile(f, contentType(path), cacheControlFor(path), useGz);
+    return true;
+}
+
+/**
+ * Range: bytes=a-b | a- | -n. 1 — один удовлетворимый диапазон [from, to]; 0 — заголовок не по форме
+ * (игнорируем, отдаём целиком); -1 — несколько диапазонов или за пределами файла (416).
+ */
+static int tkwmParseRange_(String h, size_t size, size_t& from, size_t& to) {
+    h.trim();
+    if (!h.startsWith("bytes=")) return 0;
+    h.remove(0, 6);
+    if (h.indexOf(',') >= 0) return -1;
+    const int dash = h.indexOf('-');
+    if (dash < 0) return 0;
+    String a = h.substring(0, dash), b = h.substring(dash + 1);
+    a.trim();
+    b.trim();
+    for (uint32_t i = 0; i < a.length(); ++i) if (a[i] < '0' || a[i] > '9') return 0;
+    for (uint32_t i = 0; i < b.length(); ++i) if (b[i] < '0' || b[i] > '9') return 0;
+    if (!a.length()) {
+        // суффикс: последние n байт
+        const size_t n = (size_t)strtoul(b.c_str(), nullptr, 10);
+        if (!b.length() || n == 0 || size == 0) return -1;
+        from = n >= size ? 0 : size - n;
+        to   = size - 1;
+        return 1;
+    }
+    from = (size_t)strtoul(a.c_str(), nullptr, 10);
+    if (from >= size) return -1;
+    to = b.length() ? (size_t)strtoul(b.c_str(), nullptr, 10) : size - 1;
+    if (to < from) return 0;
+    if (to >= size) to = size - 1;
+    return 1;
+}
+
+// Отдать открытый файл с валидаторами (ETag из размера+mtime, Last-Modified), 304 по
+// If-None-Match / If-Modified-Since и Range/If-Range → 206 (один диапазон) или 416.
+// gz — файл хранится сжатым (Content-Encoding: gzip), диапазоны считаются по сжатым байтам.
+// f не закрываем: с TKWM_HTTP_ASYNC его дочитывает соединение, и закроется он с последней копией File.
+void TKWifiManager::sendFile(File& f, const String& mime, const String& cacheControl, bool gz) {
+    const size_t size  = f.size();
+    const time_t mtime = f.getLastWrite();
+    char etag[40];
+    snprintf(etag, sizeof(etag), "\"%x-%lx%s\"", (unsigned)size, (unsigned long)mtime, gz ? "-gz" : "");
+    const String lastMod = tkwmHttpDate_(mtime);
+
+    _server.sendHeader(F("ETag"), etag);
+    if (lastMod.length()) _server.sendHeader(F("Last-Modified"), lastMod);
+    _server.sendHeader(F("Cache-Control"), cacheControl);
+    _server.sendHeader(F("Accept-Ranges"), F("bytes"));
+
+    // If-Modified-Since учитывается только без If-None-Match; браузер возвращает ровно наш Last-Modified.
+    const String inm = _server.header("If-None-Match");
+    const bool notModified = inm.length() ? tkwmEtagMatches_(inm, etag)
+                                          : (lastMod.length() && _server.header("If-Modified-Since") == lastMod);
+    if (notModified) {
+        _server.send(304);
+        return;
+    }
+
+    size_t from = 0, to = 0;
+    int    rng  = 0;
+    const String range = _server.header("Range");
+    if (range.length()) {
+        // If-Range не совпал — файл изменился, докачка невозможна: отдаём целиком.
+        const String ifRange = _server.header("If-Range");
+        if (!ifRange.length() || ifRange == etag || (lastMod.length() && ifRange == lastMod))
+            rng = tkwmParseRange_(range, size, from, to);
+    }
+    char cr[48];
+    if (rng < 0) {
+        snprintf(cr, sizeof(cr), "bytes */%u", (unsigned)size);
+        _server.sendHeader(F("Content-Range"), cr);
+        _server.send(416, "text/plain", "");
+        return;
+    }
+    // Content-Encoding ставим сами и для полного ответа: WebServer::streamFile решает по имени файла
+    // и для application/octet-stream заголовок пропускает — клиент получил бы сырой gzip.
+    if (gz) _server.sendHeader(F("Content-Encoding"), F("gzip"));
+    size_t left = size;
+    if (rng > 0) {
+        snprintf(cr, sizeof(cr), "bytes %u-%u/%u", (unsigned)from, (unsigned)to, (unsigned)size);
+        _server.sendHeader(F("Content-Range"), cr);
+        left = to - from + 1;
+    }
+    _server.setContentLength(left);
+    _server.send(rng > 0 ? 206 : 200, mime, "");
+    if (!left || (from && !f.seek(from))) return;
+#if TKWM_HTTP_ASYNC
+    // тело уходит из handleClient() по мере того, как клиент читает: медленный клиент не держит остальных
+    _server.sendContent(f, left);
+#else
+    uint8_t buf[1024];
+    while (left) {
+        size_t n = f.read(buf, left < sizeof(buf) ? left : sizeof(buf));
+        if (!n) break;
+        _server.sendContent((const char*)buf, n);
+        left -= n;
+    }
+#endif
+}
+
+// Встроенный ресурс: всегда gzip (его понимают все браузеры), ETag + 304 по If-None-Match.
+bool TKWifiManager::sendBuiltin(const String& path) {
+    const TkwmAsset* a = tkwmFindAsset_(path.c_str());
+    if (!a) return false;
+#if TKWM_WS_PORT != TKWM_ASSETS_WS_PORT
+    // В страницы зашит порт генератора; фактический TKWM_WS_PORT их JS читает из cookie.
+    _server.sendHeader(F("Set-Cookie"), F("tkwm_ws=" TKWM_XSTR(TKWM_WS_PORT) "; Path=/"));
+#endif
+    _server.sendHeader(F("ETag"), a->etag);
+    _server.sendHeader(F("Cache-Control"), F(TKWM_BUILTIN_CACHE_CONTROL));
+    if (tkwmEtagMatches_(_server.header("If-None-Match"), a->etag)) {
+        _server.send(304);
+        return true;
+    }
+    _server.sendHeader(F("Content-Encoding"), F("gzip"));
+    _server.send_P(200, a->mime, (const char*)a->gz, a->gzLen);
     return true;
 }
 
@@ -59,21 +59,179 @@
 #define TKWM_TASK_TICK_MS 5
 #endif
 
-/** Интервал попыток переподключения в STA-режиме */
+/** HTTP-сервер: 1 — TkwmAsyncServer (несколько соединений сразу, keep-alive; см. TkwmAsyncServer.h),
+ *  0 — WebServer ядра (одно соединение за handleClient()) */
+#ifndef TKWM_HTTP_ASYNC
+#define TKWM_HTTP_ASYNC 0
+#endif
+
+#if TKWM_HTTP_ASYNC
+#include "TkwmAsyncServer.h"
+typedef TkwmAsyncServer TkwmWebServer;
+#else
+typedef WebServer TkwmWebServer;
+#endif
+
+/** Сколько HTTP-запросов из очереди соединений обслужить подряд за один тик */
+#ifndef TKWM_HTTP_BURST
+#define TKWM_HTTP_BURST 4
+#endif
+
+/** После последнего HTTP-запроса фоновая задача столько мс тикает каждый системный тик, а не раз в TKWM_TASK_TICK_MS */
+#ifndef TKWM_HTTP_ACTIVE_MS
+#define TKWM_HTTP_ACTIVE_MS 300
+#endif
+
+/** Интервал попыток переподключения в STA-режиме (для экспоненциальной политики — первая пауза) */
 #ifndef TKWM_RECONNECT_INTERVAL_MS
 #define TKWM_RECONNECT_INTERVAL_MS 4000
 #endif
 
-/** Интервал «тяжёлой» перепривязки через scan + подбор профиля */
+/** Интервал «тяжёлой» перепривязки через scan + подбор профиля (фиксированная политика) */
 #ifndef TKWM_FULL_SCAN_RECONNECT_MS
 #define TKWM_FULL_SCAN_RECONNECT_MS 20000
 #endif
 
-/** Время ожидания до возврата в AP при длительном оффлайне */
+/**
+ * Политика переподключения по умолчанию: 1 — экспоненциальная пауза с джиттером от MAC
+ * (reconnectBackoff), 0 — фиксированные интервалы (reconnectFixed). Меняется и в рантайме: setReconnectPolicy().
+ */
+#ifndef TKWM_RECONNECT_POLICY
+#define TKWM_RECONNECT_POLICY 1
+#endif
+
+/** Потолок паузы экспоненциальной политики (до джиттера), мс */
+#ifndef TKWM_RECONNECT_MAX_MS
+#define TKWM_RECONNECT_MAX_MS 60000
+#endif
+
+/** Таймаут одной попытки в неблокирующем движке подключения (от WiFi.begin до IP), мс */
+#ifndef TKWM_CONNECT_ATTEMPT_MS
+#define TKWM_CONNECT_ATTEMPT_MS 8000
+#endif
+
+/** Общий бюджет одного подбора сети (все кандидаты и попытки вместе), мс; 0 — без ограничения */
+#ifndef TKWM_CONNECT_BUDGET_MS
+#define TKWM_CONNECT_BUDGET_MS 45000
+#endif
+
+/** На столько мс BSSID с проваленной попыткой уходит в конец очереди кандидатов */
+#ifndef TKWM_BSSID_BAN_MS
+#define TKWM_BSSID_BAN_MS 300000
+#endif
+
+/** Провалы подключений копятся в RAM и пишутся в NVS не чаще раза в столько мс (успех — сразу) */
+#ifndef TKWM_STATS_SAVE_MS
+#define TKWM_STATS_SAVE_MS 600000
+#endif
+
+/** Период выборки качества STA-линка (RSSI + ping шлюза), мс; 0 — монитор и роуминг выключены */
+#ifndef TKWM_LINK_SAMPLE_MS
+#define TKWM_LINK_SAMPLE_MS 2000
+#endif
+
+/** 1 = выборка включает ICMP ping шлюза (esp_ping): задержка и потери; 0 — только RSSI */
+#ifndef TKWM_LINK_PING
+#define TKWM_LINK_PING 1
+#endif
+
+/** Линк плохой, если сглаженный RSSI ниже, дБм (или 3 ping подряд без ответа) */
+#ifndef TKWM_ROAM_RSSI
+#define TKWM_ROAM_RSSI -72
+#endif
+
+/** ...или сглаженная задержка до шлюза выше, мс */
+#ifndef TKWM_ROAM_RTT_MS
+#define TKWM_ROAM_RTT_MS 300
+#endif
+
+/** Гистерезис: переход только на точку сильнее текущей на столько дБ (на другую сохранённую сеть — на вдвое больше) */
+#ifndef TKWM_ROAM_DELTA_DB
+#define TKWM_ROAM_DELTA_DB 8
+#endif
+
+/** Пока линк плохой, фоновый скан в поисках лучшей точки — не чаще раза в столько мс */
+#ifndef TKWM_ROAM_SCAN_MS
+#define TKWM_ROAM_SCAN_MS 60000
+#endif
+
+/** После подключения или роуминга столько мс линк только наблюдаем */
+#ifndef TKWM_ROAM_HOLD_MS
+#define TKWM_ROAM_HOLD_MS 30000
+#endif
+
+/**
+ * 1 = begin() не ждёт Wi-Fi: HTTP/WS поднимаются сразу, подключение (прямое → скан → AP)
+ * идёт в фоне через serviceTick(); итог — setEventHook() и WS {"type":"conn"}.
+ * 0 = как раньше: begin() возвращается после попыток подключения.
+ */
+#ifndef TKWM_ASYNC_BEGIN
+#define TKWM_ASYNC_BEGIN 0
+#endif
+
+/** После подключения из портала AP живёт ещё столько мс, чтобы страница получила итог и новый IP */
+#ifndef TKWM_AP_LINGER_MS
+#define TKWM_AP_LINGER_MS 15000
+#endif
+
+/** Таймаут прямого подключения по запомненным BSSID/каналу (без скана); после него — обычный путь со сканом */
+#ifndef TKWM_FAST_CONNECT_MS
+#define TKWM_FAST_CONNECT_MS 4000
+#endif
+
+/**
+ * 1 = при прямом подключении сразу выставлять прошлые IP/шлюз/маску/DNS (без DHCP, ещё −0.3…1 с).
+ * Адрес остаётся статическим до переподключения; включайте, только если роутер резервирует IP за MAC.
+ */
+#ifndef TKWM_FAST_CONNECT_STATIC_IP
+#define TKWM_FAST_CONNECT_STATIC_IP 0
+#endif
+
+/** Максимальное ожидание асинхронного скана, после которого он считается неудачным, мс */
+#ifndef TKWM_SCAN_TIMEOUT_MS
+#define TKWM_SCAN_TIMEOUT_MS 10000
+#endif
+
+/** Сколько сетей хранит кэш последнего скана (сильнейшие по RSSI) */
+#ifndef TKWM_SCAN_CACHE_MAX
+#define TKWM_SCAN_CACHE_MAX 32
+#endif
+
+/** Возраст кэша скана по умолчанию для GET /api/wifi/scan (параметр maxAge переопределяет), мс */
+#ifndef TKWM_SCAN_MAX_AGE_MS
+#define TKWM_SCAN_MAX_AGE_MS 10000
+#endif
+
+/** WS "scan" не запускает новый скан, если предыдущий завершился не раньше, чем столько мс назад */
+#ifndef TKWM_SCAN_MIN_INTERVAL_MS
+#define TKWM_SCAN_MIN_INTERVAL_MS 3000
+#endif
+
+/** Время ожидания до возврата в AP при длительном оффлайне (экспоненциальная политика — нижняя граница, плюс джиттер до 50 %) */
 #ifndef TKWM_STA_FAIL_TO_AP_MS
 #define TKWM_STA_FAIL_TO_AP_MS 25000
 #endif
 
+/** Потолок срока ухода в AP у экспоненциальной политики (с джиттером), мс */
+#ifndef TKWM_STA_FAIL_TO_AP_MAX_MS
+#define TKWM_STA_FAIL_TO_AP_MAX_MS 60000
+#endif
+
+/** Cache-Control для встроенных страниц; "no-cache" = кэшировать, но проверять ETag (ответ 304) */
+#ifndef TKWM_BUILTIN_CACHE_CONTROL
+#define TKWM_BUILTIN_CACHE_CONTROL "no-cache"
+#endif
+
+/** Cache-Control статики из FS по умолчанию (если нет правила setCacheControl для расширения) */
+#ifndef TKWM_STATIC_CACHE_CONTROL
+#define TKWM_STATIC_CACHE_CONTROL "no-cache"
+#endif
+
+/** Максимум правил Cache-Control по расширению */
+#ifndef TKWM_MAX_CACHE_RULES
+#define TKWM_MAX_CACHE_RULES 8
+#endif
+
 /** Версия прошивки для OTA/ESPConnect (в проекте: -DTKWM_FW_VERSION=\\\"1.2.3\\\") */
 #ifndef TKWM_FW_VERSION
 #define TKWM_FW_VERSION "0.0.0"
@@ -88,16 +246,102 @@
 #define TKWM_OTA_INSECURE 1
 #endif
 
+/** 1 = OTA принимает образы .bin.gz (inflate из ROM, +43 КБ RAM на время записи); 0 — только .bin и TKLZ */
+#ifndef TKWM_OTA_GZIP
+#define TKWM_OTA_GZIP 1
+#endif
+
+/** Блок конвейера OTA-загрузки (сеть → flash) — размер сектора flash */
+#ifndef TKWM_OTA_BLOCK
+#define TKWM_OTA_BLOCK 4096
+#endif
+
+/** Блоков в кольце конвейера OTA (приём из сокета и Update.write() в разных задачах); 0/1 — синхронная запись */
+#ifndef TKWM_OTA_RING_BLOCKS
+#define TKWM_OTA_RING_BLOCKS 4
+#endif
+
+/** Автообновление ESPConnect (ota.conf auto=1): интервал проверок, мс (6 ч); ota.conf interval=<мин> переопределяет; 0 — без планировщика */
+#ifndef TKWM_OTA_AUTO_MS
+#define TKWM_OTA_AUTO_MS 21600000UL
+#endif
+
+/** Первая автопроверка после загрузки, мс (плюс разброс по MAC) */
+#ifndef TKWM_OTA_AUTO_FIRST_MS
+#define TKWM_OTA_AUTO_FIRST_MS 300000UL
+#endif
+
+/** SNTP: синхронизация моложе этого не повторяется (lwIP и сам пересинхронизирует раз в час) */
+#ifndef TKWM_TIME_FRESH_MS
+#define TKWM_TIME_FRESH_MS 3600000UL
+#endif
+
+/** SNTP: сколько ждать ответа на запрос, прежде чем считать его неудачным */
+#ifndef TKWM_TIME_WAIT_MS
+#define TKWM_TIME_WAIT_MS 12000UL
+#endif
+
+/** Сколько живёт ответ resolve-download (check → install, автопроверки); дальше — условный запрос с If-None-Match */
+#ifndef TKWM_OTA_RESOLVE_TTL_MS
+#define TKWM_OTA_RESOLVE_TTL_MS 300000UL
+#endif
+
+/** ESPConnect: сколько держать открытым простаивающее keep-alive соединение (TLS — ~40 КБ RAM) */
+#ifndef TKWM_OTA_KEEPALIVE_MS
+#define TKWM_OTA_KEEPALIVE_MS 30000UL
+#endif
+
+/** ESPConnect: сколько помнить IP хоста (без повторного DNS-запроса) */
+#ifndef TKWM_OTA_DNS_TTL_MS
+#define TKWM_OTA_DNS_TTL_MS 600000UL
+#endif
+
+/** Стек задачи фоновой OTA-установки (в ней идут TLS-рукопожатия resolve и скачивания) */
+#ifndef TKWM_OTA_JOB_STACK
+#define TKWM_OTA_JOB_STACK 12288
+#endif
+
+/** OTA-скачивание: столько мс без единого байта — обрыв; докачка с того же места (Range) */
+#ifndef TKWM_OTA_STALL_MS
+#define TKWM_OTA_STALL_MS 15000
+#endif
+
+/** OTA-скачивание: сколько раз докачивать после обрыва, прежде чем сдаться */
+#ifndef TKWM_OTA_RESUME_TRIES
+#define TKWM_OTA_RESUME_TRIES 5
+#endif
+
 /**
  * Синхрон с полем *controller* в ESPConnect: один идентификатор токеном (без кавычек),
  * напр. -D TKWM_OTA_CONTROLLER=ESP32 или `custom_upload_controller` в platformio.ini (см. README).
  * Если не задано — в запросах OTA/ESPConnect подставляется `ESP.getChipModel()`.
  */
 
+/** Размер буфера потокового JSON-писателя (один chunk HTTP-ответа), байт */
+#ifndef TKWM_JSON_CHUNK
+#define TKWM_JSON_CHUNK 512
+#endif
+
+/** Метрики тика, маршрутов, WS и heap на GET /api/metrics (0 — ни кода, ни полей) */
+#ifndef TKWM_METRICS
+#define TKWM_METRICS 0
+#endif
+
+/** Сколько маршрутов (вместе с addRoute и 404) получают свою гистограмму */
+#ifndef TKWM_METRICS_MAX_ROUTES
+#define TKWM_METRICS_MAX_ROUTES 40
+#endif
+
+class TkwmJson;   // потоковый JSON-писатель (TKWifiManager.cpp)
+struct TkwmOtaJob; // фоновая установка ESPConnect OTA (TKWifiManager.cpp)
+
 class TKWifiManager {
 public:
     
     explicit TKWifiManager(uint16_t httpPort = 80);
+    ~TKWifiManager();
+    TKWifiManager(const TKWifiManager&) = delete;
+    TKWifiManager& operator=(const TKWifiManager&) = delete;
 
     // formatFSIfNeeded=true — смонтировать FS c форматированием при первом фейле
     // apSsidPrefix — префикс SSID точки, суффикс MAC добавится автоматически
@@ -110,7 +354,7 @@ public:
     bool isFilesystemOk() const { return _fsOk; }
 
     // доступ к веб-объектам/состоянию
-    WebServer& web() { return _server; }
+    TkwmWebServer& web() { return _server; } // WebServer или TkwmAsyncServer (TKWM_HTTP_ASYNC)
     WebSocketsServer& ws() { return _ws; }
     bool inCaptive()  const { return _captiveMode; }
     IPAddress ip()    const { return _captiveMode ? WiFi.softAPIP() : WiFi.localIP(); }
@@ -118,23 +362,67 @@ public:
     // возможность добавить свои роуты
     using Route = std::function<void(void)>;
     void addRoute(const String& path, HTTPMethod method, Route handler) {
-        _server.on(path.c_str(), method, handler);
+        route(path.c_str(), method, std::move(handler));
     }
 
+    // Cache-Control для статики из FS по расширению: setCacheControl(".css", "max-age=86400").
+    // Пустое value удаляет правило. false — таблица правил заполнена.
+    bool setCacheControl(const String& ext, const String& value);
+
+    // События подключения. Вызываются из контекста serviceTick() (tkwm_task или loop()) либо из begin().
+    enum class Event : uint8_t { StaConnected, ApStarted, Roam }; // Roam — начат переход на лучшую точку
+    using EventHook = std::function<void(Event)>;
+    void setEventHook(EventHook h) { _eventHook = std::move(h); }
+
+    // политика переподключения после потери STA
+    struct ReconnectStep {
+        uint32_t delayMs;   // пауза перед попыткой (от предыдущей или от потери линка)
+        bool     fullScan;  // true — скан + подбор сети, false — мягкий WiFi.reconnect()
+        uint32_t apAfterMs; // столько мс без связи с потери линка — поднять AP; 0 — TKWM_STA_FAIL_TO_AP_MS, UINT32_MAX — никогда
+    };
+    /** attempt — номер попытки с момента потери линка (0 — первая); seed — постоянное для устройства число из MAC */
+    using ReconnectPolicy = std::function<ReconnectStep(uint16_t attempt, uint32_t seed)>;
+    /** nullptr — вернуть политику по умолчанию (TKWM_RECONNECT_POLICY) */
+    void setReconnectPolicy(ReconnectPolicy p) { _reconnectPolicy = p ? std::move(p) : defaultReconnectPolicy(); }
+    /** Пауза TKWM_RECONNECT_INTERVAL_MS ×2 на попытку до TKWM_RECONNECT_MAX_MS, ×0.5…1.5 по seed; скан — на нечётных;
+     *  AP — через TKWM_STA_FAIL_TO_AP_MS ×1…1.5 по seed, не позже TKWM_STA_FAIL_TO_AP_MAX_MS */
+    static ReconnectStep reconnectBackoff(uint16_t attempt, uint32_t seed);
+    /** Прежнее поведение: попытка каждые TKWM_RECONNECT_INTERVAL_MS, скан — первая и раз в TKWM_FULL_SCAN_RECONNECT_MS,
+     *  AP — ровно через TKWM_STA_FAIL_TO_AP_MS */
+    static ReconnectStep reconnectFixed(uint16_t attempt, uint32_t seed);
+
     // хук для пользовательских WS сообщений (не «scan/status»)
     using WsHook = std::function<void(uint8_t, WStype_t, const uint8_t*, size_t)>;
     void setUserWsHook(WsHook h) { _userWsHook = std::move(h); }
 
 private:
     // ===== хранилище сетей =====
-    struct Cred { String ssid, pass; };
+    struct Cred {
+        String   ssid, pass;
+        // подсказка для быстрого подключения — с последнего успешного (ch == 0: нет)
+        uint8_t  bssid[6];
+        uint8_t  ch;
+        bool     last;                 // к этой сети подключались последней
+        uint32_t ip, gw, mask, dns;    // аренда DHCP (для TKWM_FAST_CONNECT_STATIC_IP)
+        // статистика для ранжирования кандидатов (хранится в блобе вместе с подсказкой)
+        uint8_t  hist;                 // исходы последних попыток, бит 0 — последняя (1 — успех)
+        uint8_t  histN;                // сколько исходов в hist (до 8)
+        uint8_t  lastFail;             // WIFI_REASON_* последнего провала (0 — последней был успех)
+        uint8_t  ttiPos;
+        uint16_t tti[4];               // кольцо последних времён от WiFi.begin до IP, мс (0 — пусто)
+    };
     Preferences _prefs;
     Cred        _creds[TKWM_MAX_CRED];
     int         _credN = 0;
+    uint32_t    _credBlobCrc = 0;   // CRC32 блоба в NVS (пропуск записи без изменений)
+    uint32_t    _credDirtyAt = 0;   // millis() первого несохранённого провала (0 — всё в NVS)
+    struct BadBssid { uint8_t bssid[6]; uint32_t until; };
+    BadBssid    _badBssid[4] = {};  // временно исключённые BSSID (только RAM)
+    uint8_t     _badBssidPos = 0;
 
     // ===== веб =====
     uint16_t        _httpPort;
-    WebServer       _server;
+    TkwmWebServer   _server;
     WebSocketsServer _ws;
     DNSServer       _dns;
     bool            _captiveMode = false;
@@ -144,9 +432,51 @@ private:
     volatile bool _bgTaskRunning = false;
     TaskHandle_t _bgTaskHandle = nullptr;
     int8_t _bgTaskCore = TKWM_TASK_CORE;
-    uint32_t _lastReconnectAttemptMs = 0;
-    uint32_t _lastFullScanReconnectMs = 0;
+    ReconnectPolicy _reconnectPolicy = defaultReconnectPolicy();
+    uint32_t _reconnectAt = 0;    // millis() следующей попытки
+    uint32_t _reconnectSeed = 0;  // из MAC (0 — ещё не считали)
+    uint16_t _reconnectN = 0;     // попыток с потери линка
+    bool     _reconnectFull = false; // следующая попытка — скан + подбор
+    uint32_t _reconnectApAfter = 0;  // срок ухода в AP от политики (0 — TKWM_STA_FAIL_TO_AP_MS)
+    bool     _apRetrySta = false;    // AP поднят из-за потери сети: STA пробуем дальше по политике
+    static ReconnectPolicy defaultReconnectPolicy() { return TKWM_RECONNECT_POLICY ? reconnectBackoff : reconnectFixed; }
+    void reconnectSchedule(uint32_t now); // спросить политику о следующей попытке
     uint32_t _staLostSinceMs = 0;
+    uint32_t _httpReqN = 0;       // вызовов обработчиков маршрутов (растёт внутри handleClient)
+    uint32_t _httpActiveAt = 0;   // millis() последнего обслуженного запроса
+
+    // ===== планировщик сканов: один асинхронный скан на всех + кэш результата =====
+    struct ScanNet { String ssid; int8_t rssi; uint8_t ch; bool open; uint8_t bssid[6]; };
+    ScanNet  _scanNets[TKWM_SCAN_CACHE_MAX];
+    uint8_t  _scanN = 0;
+    uint32_t _scanAt = 0;          // millis() завершения последнего скана (0 — кэша ещё нет)
+    uint32_t _scanStartedAt = 0;
+    bool     _scanRunning = false;
+    bool     _scanWsPending = false; // по завершении разослать результат WS-клиентам
+
+    // ===== неблокирующий движок подключения (scan → лучшие по RSSI → остальные сохранённые) =====
+    enum class ConnPhase : uint8_t { Idle, FastSettle, Fast, Scan, Settle, Attempt };
+    ConnPhase _connPhase = ConnPhase::Idle;
+    int8_t   _connOrder[TKWM_MAX_CRED];  // индексы _creds в порядке попыток
+    uint8_t  _connBssid[TKWM_MAX_CRED][6]; // точка для кандидата из скана
+    uint8_t  _connCh[TKWM_MAX_CRED];     // её канал (0 — не видна: begin без BSSID)
+    uint8_t  _connOrderN = 0;
+    uint8_t  _connPos = 0;               // текущий кандидат в _connOrder
+    uint8_t  _connTry = 0;               // номер попытки для текущего кандидата
+    uint8_t  _connVisibleN = 0;          // сколько кандидатов найдено сканом (им даём 2 попытки на лучший)
+    uint32_t _connPhaseAt = 0;
+    uint32_t _connStartedAt = 0;         // начало подбора (для времени до IP и бюджета)
+    uint32_t _connAttemptAt = 0;         // последний WiFi.begin (время до IP в статистике сети)
+    int8_t   _connFastIdx = -1;          // сеть прямой попытки (фаза Fast)
+    uint32_t _connMs = 0;                // время до IP последнего успешного подключения
+    const char* _connPath = "";          // его путь: "fast" | "scan" | "saved"
+    volatile bool    _connGotIp = false;       // ARDUINO_EVENT_WIFI_STA_GOT_IP
+    volatile uint8_t _connDiscReason = 0;      // причина последнего STA_DISCONNECTED (0 — нет)
+    wifi_event_id_t _wifiEventId = 0;       // подписка hookWifiEvents() (0 — нет), снимается в деструкторе
+    // правила Cache-Control для streamIfExists (расширение → значение)
+    struct CacheRule { String ext, value; };
+    CacheRule _cacheRules[TKWM_MAX_CACHE_RULES];
+    uint8_t   _cacheRuleN = 0;
     // upload (состояние multipart)
     File   _uploadFile;
     String _uploadToPath; // полный итоговый путь файла для ответа
@@ -156,35 +486,136 @@ private:
 
     // пользовательский WS-хук
     WsHook _userWsHook = nullptr;
+    EventHook _eventHook = nullptr;
+
+    // таймлайн загрузки (GET /api/boot): millis() этапов begin() и первого итога подключения
+    struct BootMark { const char* name; uint32_t at; };
+    BootMark _boot[12];
+    uint8_t  _bootN = 0;
+    bool     _bootLinked = false;    // первый итог (sta/ap) уже отмечен
+    bool     _connFallbackAp = false; // провал фонового подбора при загрузке → сразу AP
+    bool     _connRoam = false;       // идёт переход монитора линка (путь "roam", при провале — connStart)
+    uint32_t _apDropAt = 0;           // millis() выключения AP после подключения из портала (0 — нет)
+
+    // монитор STA-линка и роуминг
+    uint32_t _linkSampleAt = 0;
+    uint32_t _linkSince = 0;         // millis() подключения (роуминг не раньше TKWM_ROAM_HOLD_MS)
+    int16_t  _linkRssi4 = 0;         // сглаженный RSSI ×4 (0 — выборок ещё нет)
+    uint16_t _linkRttMs = 0;         // сглаженная задержка до шлюза (0 — нет данных)
+    uint8_t  _linkLoss = 0;          // ping без ответа подряд
+    uint32_t _roamScanAt = 0;        // millis() последнего фонового скана для роуминга
+    bool     _roamScanWait = false;  // ждём его результат
+    uint16_t _roamN = 0;             // переходов с загрузки
+#if TKWM_LINK_PING
+    void*    _ping = nullptr;        // esp_ping_handle_t; пересоздаётся при смене шлюза
+    uint32_t _pingGw = 0;
+    volatile uint16_t _pingRtt = 0;
+    volatile uint8_t  _pingRes = 0;  // 0 — не запускали, 1 — ответ, 2 — таймаут, 3 — в полёте
+    static void pingOk_(void* hdl, void* arg);   // колбэки задачи esp_ping — только флаги
+    static void pingLost_(void* hdl, void* arg);
+#endif
+    void linkSample();               // выборка RSSI/ping; плохой линк → редкий фоновый скан
+    bool linkDegraded() const;
+    void roamEval();                 // итог скана → переход на заметно лучшую точку
+    void handleWifiLink();           // GET /api/wifi/link
+    void bootMark(const char* name);
+    void handleBoot();
 
     bool     _otaRestartPending = false;
     uint32_t _otaRestartAt     = 0;
 
+    // Фоновая установка ESPConnect OTA: задача tkwm_ota; последняя держится для /api/ota/progress
+    TkwmOtaJob* _otaJob    = nullptr;
+    uint32_t    _otaJobSeq = 0;
+    static void otaJobTask_(void* arg);
+    void        otaJobTick();                    // WS-рассылка прогресса, перезагрузка после успеха
+    bool        otaJobRunning() const;           // задача ещё работает (Update занят ею)
+    bool        otaJobStart(const String& host, const String& token, bool autoMode, String& err);
+    uint32_t    _otaPoolCloseAt = 0;             // закрыть тёплое соединение ESPConnect (после check)
+    void        otaPoolClose();
+
+    // Планировщик автообновления (ota.conf: auto, interval, window); тик без проверки — одно сравнение
+    uint32_t _otaAutoAt    = 0;      // срок следующей проверки; 0 — не запланирована (идёт задача)
+    uint8_t  _otaAutoFails = 0;      // подряд неудачных — экспоненциальная пауза
+    uint16_t _otaAutoRound = 0;
+    String   _otaFileWindow;         // окна обслуживания "HH:MM-HH:MM[,…]", местное время; пусто — всегда
+    uint16_t _otaFileIntervalMin = 0; // 0 — TKWM_OTA_AUTO_MS
+    void     otaAutoSchedule(uint32_t delayMs, uint32_t spreadMs);
+    void     otaAutoTick();
+    uint32_t otaAutoWindowWaitMs();  // 0 — сейчас в окне (или окна не заданы)
+    uint32_t otaAutoIntervalMs() const;
+    void        otaJobWrite(TkwmJson& j) const;  // поля прогресса (общие для REST и WS)
+
     // ota.conf (кэш после loadOtaConf_)
     String  _otaFileHost, _otaFileToken, _otaFileNtp, _otaFileTimezone;
-    int16_t _otaFileTzOffsetMin = 0; // смещение от UTC в минутах
+    int16_t _otaFileTzOffsetMin = 0; // tz= из ota.conf: смещение от UTC в минутах, если зоны нет в таблице
     int8_t  _otaFileAuto = -1; // -1: ключа auto в файле не было
     bool    _otaConfLoaded = false;
     bool    _uploadOtaConfBlocked = false;
     bool    _wasStaConnected = false;
     uint32_t _lastAutoTimeSyncMs = 0;
 
+#if TKWM_METRICS
+    // ===== метрики (/api/metrics) =====
+    /** Гистограмма длительностей, мкс: корзина i — [2^i, 2^(i+1)), последняя — всё больше. */
+    struct MetricHist {
+        uint32_t n = 0, minUs = 0, maxUs = 0;
+        uint64_t sumUs = 0;
+        uint32_t b[20] = {};
+        void     add(uint32_t us);
+        uint32_t pct(uint8_t p) const; // оценка перцентиля сверху (граница корзины, не больше maxUs)
+    };
+    enum MetricStage : uint8_t { MS_DNS, MS_HTTP, MS_WS, MS_UDP, MS_SCAN, MS_LINK, MS_CONN, MS_TICK, MS_COUNT };
+    struct MetricRoute { String uri; HTTPMethod method; MetricHist h; };
+    MetricHist  _mStage[MS_COUNT];
+    MetricRoute _mRoute[TKWM_METRICS_MAX_ROUTES];
+    uint8_t     _mRouteN = 0;
+    uint32_t    _mWsRx = 0, _mWsTx = 0, _mWsRxBytes = 0;
+    Route metricWrap(const String& uri, HTTPMethod method, Route h);
+    void  handleMetrics();  // GET /api/metrics[?format=prometheus]
+#endif
+
     // ===== внутреннее =====
-    void  loadCreds();
-    void  saveCount();
-    void  saveAt(int idx, const String& ssid, const String& pass);
+    void  loadCreds();               // блоб tkw_net/"creds"; старые count/s<i>/p<i> переносятся в него
+    bool  saveCreds();               // один putBytes; без записи, если блоб не изменился
     int   findBySsid(const String& ssid) const;
 
     bool  tryConnectBestKnown(uint32_t timeoutMs = 12000);
     bool  tryConnectBySavedOrder(uint32_t timeoutMs = 8000);
-    bool  connectWithCred(const String& ssid, const String& pass, uint32_t timeoutMs, uint8_t attempts = 2);
-    void  startAPCaptive();
+    bool  connectWithCred(const String& ssid, const String& pass, uint32_t timeoutMs, uint8_t attempts = 2,
+                          uint8_t ch = 0, const uint8_t* bssid = nullptr);
+    bool  tryConnectFast(uint32_t timeoutMs = TKWM_FAST_CONNECT_MS); // по BSSID/каналу, без скана
+    int   fastCandidate() const;     // сеть с подсказкой, к которой подключались последней; -1 — нет
+    void  fastBegin(int idx);        // WiFi.begin(ssid, pass, ch, bssid) (+ статический IP)
+    void  fastDrop();                // вернуть DHCP после неудачной прямой попытки
+    void  connDone(int idx, const char* path); // успех: лог, подсказка в NVS, время до IP
+    void  connScanStart();
+    int   credScore(int idx, int rssi, bool banned) const; // RSSI + история сети; больше — раньше
+    void  credRecord(int idx, bool ok, uint8_t reason);    // исход попытки в статистику сети
+    void  connRank(bool useScan);    // _connOrder/_connBssid/_connCh: видимые, затем невидимые, по оценке
+    void  connFail(uint8_t pos);     // провал кандидата: статистика + бан BSSID
+    bool  connOverBudget() const;
+    void  bssidBan(const uint8_t* bssid);
+    bool  bssidBanned(const uint8_t* bssid) const;
+    void  hookWifiEvents();
+    void  connStart();               // запустить стратегию подключения без блокировки
+    void  connAbort();
+    void  connTick();                // один шаг машины состояний (вызывается из serviceTick)
+    bool  connBusy() const { return _connPhase != ConnPhase::Idle; }
+    void  connBeginCandidate();
+    void  connNextCandidate();
+    void  connPublish(const char* phase, int credIdx);
+    void  startAPCaptive(bool retrySta = false); // retrySta — AP от потери сети, подключение пробовать дальше
     void  serviceTick();
+    void  httpTick();                // до TKWM_HTTP_BURST запросов подряд, пока есть очередь
+    bool  httpActive() const;        // был запрос за последние TKWM_HTTP_ACTIVE_MS
+    void  linkTick();                // потеря STA: reconnect / scan+switch / уход в AP
     static void bgTaskEntry(void* arg);
 
     // ==== роутинг/обработчики ====
     void setupRoutes();
     void setupWebSocket();
+    void route(const char* uri, HTTPMethod method, Route h, Route upload = nullptr); // _server.on + метрики
 
     void handleRoot();
     void handleNotFound();
@@ -195,6 +626,7 @@ private:
     // FS API + страницы
     void handleFsList();
     void handleFsGet();
+    void handleFsDownload(); // GET /api/fs/download?path=... (сырые байты, Range)
     void handleFsPut();
     void handleFsDelete();
     void handleFsMkdir();
@@ -209,7 +641,9 @@ private:
     void   handleOtaInfo();
     void   handleOtaConfig();
     void   handleOtaCheck();
-    void   handleOtaInstall();
+    void   handleOtaInstall();    // ставит фоновую задачу, сразу отвечает её id
+    void   handleOtaProgress();   // GET /api/ota/progress
+    void   handleOtaCancel();     // POST /api/ota/cancel
     void   handleOtaSaveSettings();
     void   handleOtaSyncTime();
     void   handleOtaTimezones();
@@ -218,10 +652,8 @@ private:
     String otaConfigNtp_();
     String otaConfigTimezone_();
     int16_t otaConfigTzOffsetMin_();
-    bool   syncTimeWithNtp_(const String& ntpServer, uint32_t timeoutMs = 12000);
-    bool   fetchTimezoneOffsetMin_(const String& timezone, int16_t& outMin);
-    bool   ensureTimezoneListCache_();
-    String readTimezoneListJson_();
+    bool   timeSyncStart_(const String& ntpServer, bool force = false); // без ожидания; false — свежо или нет сети
+    void   tzApply_();   // зона ota.conf → TZ/tzset (летнее время считает libc)
     String otaConfigHost_();   // merge file
     String otaConfigToken_();
     bool   otaConfigAuto_();   // file или Preferences
@@ -236,9 +668,17 @@ private:
     void handleWifiScan();       // GET /api/wifi/scan  (REST-версия для polling-клиентов)
 
 
+    // Сканирование (общий планировщик для REST, WS и движка подключения)
+    bool     scanRequest();                 // запустить асинхронный скан или присоединиться к текущему
+    void     scanTick();                    // забрать результат, когда скан завершится
+    void     scanCollect(int16_t n);        // результат WiFi.scanNetworks → кэш (сильнейшие, по убыванию RSSI)
+    uint32_t scanAgeMs() const;             // возраст кэша; UINT32_MAX — кэша нет
+    void     scanWriteNets(TkwmJson& j) const;      // "nets":[...] из кэша (общий для REST и WS)
+
     // WS служебное
     void wsSendStatus(uint8_t clientId);
-    void wsRunScanAndPublish(); // sync scan (AP не выключаем)
+    String wsStatusMessage() const;  // {"type":"status",...}
+    void wsRunScanAndPublish(uint8_t clientId); // кэш свежий — ответ сразу, иначе рассылка по завершении скана
 
     // UDP discovery
     void udpTick();
@@ -247,12 +687,11 @@ private:
     static String contentType(const String& path);
     static void   ensureDirs(const String& path);
     static bool   looksText(File& f);
-    bool streamIfExists(const String& uri);
+    bool streamIfExists(const String& uri);  // + path.gz, ETag/Last-Modified, 304
+    String cacheControlFor(const String& path) const;
+    void sendFile(File& f, const String& mime, const String& cacheControl, bool gz); // ETag/304 + Range/206
     void sendUpload404(const String& missingPath);
 
-    // Встроенные страницы (если в FS нет файлов)
-    static const char* builtinIndex();
-    static const char* builtinWifi(); // WS-сканер
-    static const char* builtinFs();
-    static const char* builtinOta();
+    // Встроенные страницы и theme.css/theme.js (если в FS нет файлов): gzip + ETag/304
+    bool sendBuiltin(const String& path);
 };
@@ -0,0 +1,874 @@
+// Асинхронный HTTP-сервер: см. TkwmAsyncServer.h. Разбор и ответы — как у WebServer ядра 2.x (порядок
+// заголовков, arg("plain"), multipart с буфером HTTP_UPLOAD_BUFLEN), но каждое соединение хранит своё
+// состояние, а handleClient() не ждёт ни одного сокета.
+#include "TkwmAsyncServer.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// Фазы разбора multipart (Conn::mp).
+enum : uint8_t { TKWM_MP_START, TKWM_MP_DELIM, TKWM_MP_HEAD, TKWM_MP_DATA, TKWM_MP_DONE };
+
+static const char* tkwmHttpText_(int code) {
+    switch (code) {
+    case 100: return "Continue";
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 206: return "Partial Content";
+    case 301: return "Moved Permanently";
+    case 302: return "Found";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 411: return "Length Required";
+    case 413: return "Request Entity Too Large";
+    case 416: return "Range Not Satisfiable";
+    case 429: return "Too Many Requests";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default: return "";
+    }
+}
+
+static int tkwmHex_(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Строка из куска приёмного буфера (он не завершается нулём).
+static String tkwmStr_(const char* p, size_t n) {
+    String s;
+    s.concat(p, (unsigned)n);
+    return s;
+}
+
+static String tkwmUrlDecode_(const char* s, size_t n) {
+    String r;
+    r.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        if (s[i] == '+') r += ' ';
+        else if (s[i] == '%' && i + 2 < n && tkwmHex_(s[i + 1]) >= 0 && tkwmHex_(s[i + 2]) >= 0) {
+            r += (char)(tkwmHex_(s[i + 1]) * 16 + tkwmHex_(s[i + 2]));
+            i += 2;
+        } else r += s[i];
+    }
+    return r;
+}
+
+static const char* tkwmMemFind_(const char* h, size_t hn, const char* n, size_t nn) {
+    if (nn == 0 || hn < nn) return nullptr;
+    for (const char* p = h; (p = (const char*)memchr(p, n[0], hn - nn + 1 - (size_t)(p - h))) != nullptr; p++)
+        if (!memcmp(p, n, nn)) return p;
+    return nullptr;
+}
+
+// Значение атрибута key="…" в заголовке части multipart; key — отдельное слово (name= не внутри filename=).
+static String tkwmMpAttr_(const char* h, size_t n, const char* key) {
+    const size_t kn = strlen(key);
+    for (const char* p = h; (p = tkwmMemFind_(p, n - (size_t)(p - h), key, kn)) != nullptr; p += kn) {
+        if (p != h && p[-1] != ' ' && p[-1] != ';') continue;
+        const char* v = p + kn;
+        const char* e = (const char*)memchr(v, '"', n - (size_t)(v - h));
+        return e ? tkwmStr_(v, (size_t)(e - v)) : String();
+    }
+    return String();
+}
+
+// ===================== сокеты =====================
+void TkwmAsyncServer::begin(uint16_t port) {
+    if (_listenFd >= 0) ::close(_listenFd);
+    _listenFd = -1;
+    _port     = port;
+    begin();
+}
+
+void TkwmAsyncServer::begin() {
+    if (_listenFd >= 0) return;
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return;
+    const int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in a{};
+    a.sin_family      = AF_INET;
+    a.sin_port        = htons(_port);
+    a.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(fd, (sockaddr*)&a, sizeof(a)) != 0 || listen(fd, TKWM_HTTP_MAX_CONN) != 0) {
+        ::close(fd);
+        return;
+    }
+    socklen_t len = sizeof(a);
+    if (getsockname(fd, (sockaddr*)&a, &len) == 0) _port = ntohs(a.sin_port);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    _listenFd = fd;
+}
+
+void TkwmAsyncServer::close() {
+    for (Conn& c : _conns)
+        if (c.st != St::Free) drop(c);
+    if (_listenFd >= 0) ::close(_listenFd);
+    _listenFd = -1;
+}
+
+uint8_t TkwmAsyncServer::clients() const {
+    uint8_t n = 0;
+    for (const Conn& c : _conns) n += c.st != St::Free;
+    return n;
+}
+
+// Сокет готов к чтению (для слушающего — есть соединение в очереди), без ожидания.
+static bool tkwmReadable_(int fd) {
+    fd_set rd;
+    FD_ZERO(&rd);
+    FD_SET(fd, &rd);
+    timeval tv{0, 0};
+    return select(fd + 1, &rd, nullptr, nullptr, &tv) > 0;
+}
+
+bool TkwmAsyncServer::acceptOne() {
+    Conn* slot = nullptr;
+    for (Conn& c : _conns)
+        if (c.st == St::Free) {
+            slot = &c;
+            break;
+        }
+    if (!slot) {
+        // Все заняты — уступает то keep-alive соединение, что дольше всех простаивает между запросами;
+        // иначе новое ждёт в очереди listen.
+        for (Conn& c : _conns)
+            if (c.st == St::Head && c.served && !c.rxN && !c.sending() && (!slot || (int32_t)(c.at - slot->at) < 0)) slot = &c;
+        // и только если в очереди listen правда кто-то есть: иначе закрыли бы живое соединение зря
+        if (!slot || !tkwmReadable_(_listenFd)) return false;
+        drop(*slot);
+    }
+    const int fd = accept(_listenFd, nullptr, nullptr);
+    if (fd < 0) return false;
+    slot->rx = new (std::nothrow) char[TKWM_HTTP_RX_BUF];
+    slot->tx = new (std::nothrow) char[TKWM_HTTP_TX_BUF];
+    if (!slot->rx || !slot->tx) {
+        delete[] slot->rx;
+        delete[] slot->tx;
+        slot->rx = slot->tx = nullptr;
+        ::close(fd);
+        return false;
+    }
+    const int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    slot->fd     = fd;
+    slot->st     = St::Head;
+    slot->at     = millis();
+    slot->served = 0;
+    slot->rxN = slot->txN = 0;
+    slot->broken = false;
+    return true;
+}
+
+void TkwmAsyncServer::drop(Conn& c) {
+    if (c.up && c.mpFile) uploadEnd(c, UPLOAD_FILE_ABORTED);
+    if (_uploading == &c) _uploading = nullptr;
+    if (c.fd >= 0) ::close(c.fd);
+    c.fd = -1;
+    delete[] c.rx;
+    delete[] c.tx;
+    c.rx = c.tx = nullptr;
+    c.rxN = c.txN = 0;
+    c.q.clear(); // файлы ответа закрываются вместе с копиями File
+    c.qMem = 0;
+    reset(c);
+    c.st = St::Free;
+}
+
+// Состояние запроса — к следующему запросу того же соединения.
+void TkwmAsyncServer::reset(Conn& c) {
+    c.uri = String();
+    c.hostHeader = String();
+    c.method = HTTP_ANY;
+    c.handler = -1;
+    c.args.clear();
+    c.headers.clear();
+    c.need = c.bodyRx = 0;
+    c.body = String();
+    c.form = false;
+    c.boundary = String();
+    c.mp = TKWM_MP_START;
+    c.mpFile = false;
+    c.mpName = c.mpValue = String();
+    delete c.up;
+    c.up = nullptr;
+    c.replied = c.chunked = false;
+}
+
+bool TkwmAsyncServer::recvSome(Conn& c) {
+    size_t cap = TKWM_HTTP_RX_BUF - c.rxN;
+    const bool inBody = c.st == St::Body || c.st == St::Multipart;
+    if (inBody && c.need < cap) cap = c.need; // за телом может идти следующий запрос — его байты пока не берём
+    if (!cap) return false;
+    const ssize_t n = recv(c.fd, c.rx + c.rxN, cap, 0);
+    if (n > 0) {
+        c.rxN += (size_t)n;
+        if (inBody) {
+            c.bodyRx += (size_t)n;
+            c.need -= (size_t)n;
+        }
+        c.at = millis();
+        return true;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return false;
+    // Клиент закрыл соединение (или ошибка): недочитанный запрос бросаем, загрузка — ABORTED.
+    drop(c);
+    return false;
+}
+
+static void tkwmRxConsume_(char* rx, size_t& rxN, size_t n) {
+    memmove(rx, rx + n, rxN - n);
+    rxN -= n;
+}
+
+// ===================== разбор =====================
+bool TkwmAsyncServer::parseHead(Conn& c, size_t headLen) {
+    const char* p   = c.rx;
+    const char* end = c.rx + headLen;
+    const char* eol = tkwmMemFind_(p, headLen, "\r\n", 2);
+    if (!eol) eol = end; // только строка запроса
+    const char* s1  = (const char*)memchr(p, ' ', (size_t)(eol - p));
+    const char* s2  = s1 ? (const char*)memchr(s1 + 1, ' ', (size_t)(eol - s1 - 1)) : nullptr;
+    if (!s2) return false;
+    const size_t ml = (size_t)(s1 - p);
+    auto is = [&](const char* m) { return ml == strlen(m) && !memcmp(p, m, ml); };
+    c.method = is("GET") ? HTTP_GET : is("HEAD") ? HTTP_HEAD : is("POST") ? HTTP_POST : is("PUT") ? HTTP_PUT
+             : is("PATCH") ? HTTP_PATCH : is("DELETE") ? HTTP_DELETE : is("OPTIONS") ? HTTP_OPTIONS : HTTP_ANY;
+    c.http11 = (size_t)(eol - s2 - 1) == 8 && !memcmp(s2 + 1, "HTTP/1.1", 8);
+    const char* q = (const char*)memchr(s1 + 1, '?', (size_t)(s2 - s1 - 1));
+    c.uri = tkwmStr_(s1 + 1, (size_t)((q ? q : s2) - s1 - 1));
+    if (q) parseArgs(c, q + 1, (size_t)(s2 - q - 1));
+
+    c.headers.clear();
+    for (const String& k : _collect) c.headers.push_back(Kv{k, String()});
+    String     ctype, conn;
+    size_t     clen = 0;
+    bool       expect = false, te = false;
+    for (p = eol + 2; p < end;) {
+        const char* e = tkwmMemFind_(p, (size_t)(end - p), "\r\n", 2);
+        if (!e) e = end;
+        const char* colon = (const char*)memchr(p, ':', (size_t)(e - p));
+        if (colon) {
+            const size_t kn = (size_t)(colon - p);
+            const char*  v  = colon + 1;
+            while (v < e && *v == ' ') v++;
+            const String value = tkwmStr_(v, (size_t)(e - v));
+            auto key = [&](const char* k) { return kn == strlen(k) && !strncasecmp(p, k, kn); };
+            for (Kv& h : c.headers)
+                if (kn == h.key.length() && !strncasecmp(p, h.key.c_str(), kn)) h.value = value;
+            if (key("Host")) c.hostHeader = value;
+            else if (key("Content-Type")) ctype = value;
+            else if (key("Content-Length")) clen = (size_t)strtoul(value.c_str(), nullptr, 10);
+            else if (key("Connection")) conn = value;
+            else if (key("Expect")) expect = value.equalsIgnoreCase("100-continue");
+            else if (key("Transfer-Encoding")) te = true;
+        }
+        p = e + 2;
+    }
+    conn.toLowerCase();
+    c.keep    = c.http11 ? conn.indexOf("close") < 0 : conn.indexOf("keep-alive") >= 0;
+    c.handler = findHandler(c);
+    const size_t total = headLen + 4;
+    tkwmRxConsume_(c.rx, c.rxN, total);
+    if (te) {
+        fail(c, 411); // chunked-тело запроса WebServer тоже не принимает
+        return true;
+    }
+    const bool withBody = c.method == HTTP_POST || c.method == HTTP_PUT || c.method == HTTP_PATCH || c.method == HTTP_DELETE;
+    if (!withBody || !clen) {
+        if (withBody && !ctype.startsWith("application/x-www-form-urlencoded")) c.args.push_back(Kv{"plain", String()});
+        dispatch(c);
+        return true;
+    }
+    c.bodyRx = c.rxN < clen ? c.rxN : clen;
+    c.need   = clen - c.bodyRx;
+    if (ctype.startsWith("multipart/form-data")) {
+        const int b = ctype.indexOf("boundary=");
+        if (b < 0) {
+            fail(c, 400);
+            return true;
+        }
+        String bd = ctype.substring(b + 9);
+        if (bd.startsWith("\"")) bd = bd.substring(1, bd.length() - 1);
+        if (bd.length() + 8 > TKWM_HTTP_RX_BUF / 2) {
+            fail(c, 400);
+            return true;
+        }
+        c.boundary = "\r\n--" + bd;
+        c.mp       = TKWM_MP_START;
+        c.st       = St::Multipart;
+    } else {
+        if (clen > TKWM_HTTP_MAX_BODY) {
+            fail(c, 413);
+            return true;
+        }
+        c.form = ctype.startsWith("application/x-www-form-urlencoded");
+        c.body.reserve(clen);
+        c.st = St::Body;
+    }
+    if (expect && c.need) {
+        static const char cont[] = "HTTP/1.1 100 Continue\r\n\r\n";
+        Conn* was = _cur;
+        _cur      = &c;
+        out(cont, sizeof(cont) - 1);
+        _cur = was;
+    }
+    return true;
+}
+
+void TkwmAsyncServer::parseArgs(Conn& c, const char* q, size_t n) {
+    for (size_t i = 0; i < n;) {
+        const char*  a  = q + i;
+        const char*  e  = (const char*)memchr(a, '&', n - i);
+        const size_t pn = e ? (size_t)(e - a) : n - i;
+        if (pn) {
+            const char* eq = (const char*)memchr(a, '=', pn);
+            const size_t kn = eq ? (size_t)(eq - a) : pn;
+            c.args.push_back(Kv{tkwmUrlDecode_(a, kn), eq ? tkwmUrlDecode_(eq + 1, pn - kn - 1) : String()});
+        }
+        i += pn + 1;
+    }
+}
+
+bool TkwmAsyncServer::feedBody(Conn& c) {
+    if (c.bodyRx) {
+        c.body.concat(c.rx, c.bodyRx);
+        tkwmRxConsume_(c.rx, c.rxN, c.bodyRx);
+        c.bodyRx = 0;
+    }
+    if (c.need) return false;
+    if (c.form) parseArgs(c, c.body.c_str(), c.body.length());
+    else c.args.push_back(Kv{"plain", c.body});
+    c.body = String();
+    dispatch(c);
+    return true;
+}
+
+void TkwmAsyncServer::uploadWrite(Conn& c, const char* p, size_t n) {
+    const THandlerFunction up = uploadHandler(c);
+    while (n) {
+        size_t k = HTTP_UPLOAD_BUFLEN - c.up->currentSize;
+        if (k > n) k = n;
+        memcpy(c.up->buf + c.up->currentSize, p, k);
+        c.up->currentSize += k;
+        p += k;
+        n -= k;
+        // как _uploadWriteByte ядра: полный буфер — WRITE, totalSize растёт после обработчика
+        if (c.up->currentSize == HTTP_UPLOAD_BUFLEN) {
+            c.up->status = UPLOAD_FILE_WRITE;
+            _cur         = &c;
+            if (up) up();
+            _cur = nullptr;
+            c.up->totalSize += c.up->currentSize;
+            c.up->currentSize = 0;
+        }
+    }
+}
+
+void TkwmAsyncServer::uploadEnd(Conn& c, HTTPUploadStatus st) {
+    const THandlerFunction up = uploadHandler(c);
+    _cur = &c;
+    if (st == UPLOAD_FILE_END && c.up->currentSize) {
+        c.up->status = UPLOAD_FILE_WRITE;
+        if (up) up();
+    }
+    c.up->totalSize += c.up->currentSize;
+    c.up->currentSize = 0;
+    c.up->status      = st;
+    if (up) up();
+    _cur     = nullptr;
+    c.mpFile = false;
+    if (_uploading == &c) _uploading = nullptr;
+}
+
+// Части multipart по мере прихода: поля — в args, файлы — обработчику загрузки блоками HTTP_UPLOAD_BUFLEN.
+bool TkwmAsyncServer::feedMultipart(Conn& c) {
+    const char*  bd = c.boundary.c_str();
+    const size_t bn = c.boundary.length();
+    bool         progress = false, queued = false;
+    for (;;) {
+        const size_t n = c.bodyRx;
+        if (c.mp == TKWM_MP_START) {
+            // первая граница — без ведущего \r\n
+            const char* f = tkwmMemFind_(c.rx, n, bd + 2, bn - 2);
+            if (!f) {
+                const size_t keep = n < bn - 2 ? n : bn - 3;
+                if (n - keep) {
+                    tkwmRxConsume_(c.rx, c.rxN, n - keep);
+                    c.bodyRx = keep;
+                }
+                break;
+            }
+            const size_t k = (size_t)(f - c.rx) + bn - 2;
+            tkwmRxConsume_(c.rx, c.rxN, k);
+            c.bodyRx -= k;
+            c.mp = TKWM_MP_DELIM;
+        } else if (c.mp == TKWM_MP_DELIM) {
+            if (n < 2) break;
+            if (!memcmp(c.rx, "--", 2)) c.mp = TKWM_MP_DONE;
+            else if (!memcmp(c.rx, "\r\n", 2)) c.mp = TKWM_MP_HEAD;
+            else {
+                fail(c, 400);
+                return true;
+            }
+            tkwmRxConsume_(c.rx, c.rxN, 2);
+            c.bodyRx -= 2;
+        } else if (c.mp == TKWM_MP_HEAD) {
+            const char* e = tkwmMemFind_(c.rx, n, "\r\n\r\n", 4);
+            if (!e) {
+                if (c.rxN == TKWM_HTTP_RX_BUF) {
+                    fail(c, 431);
+                    return true;
+                }
+                break;
+            }
+            const size_t hn = (size_t)(e - c.rx);
+            const bool   file = tkwmMemFind_(c.rx, hn, "filename=\"", 10) != nullptr;
+            if (file && _uploading && _uploading != &c) {
+                c.at   = millis(); // ждём свою очередь, а не клиента
+                queued = true;
+                break;
+            }
+            c.mpName  = tkwmMpAttr_(c.rx, hn, "name=\"");
+            c.mpValue = String();
+            c.mpFile  = file;
+            if (file) {
+                if (!c.up) c.up = new HTTPUpload();
+                c.up->filename = tkwmMpAttr_(c.rx, hn, "filename=\"");
+                c.up->name     = c.mpName;
+                c.up->type     = String();
+                const char* ct = tkwmMemFind_(c.rx, hn, "Content-Type:", 13);
+                if (ct) {
+                    const char* v = ct + 13;
+                    while (v < e && *v == ' ') v++;
+                    const char* ve = tkwmMemFind_(v, (size_t)(e - v), "\r\n", 2);
+                    c.up->type     = tkwmStr_(v, (size_t)((ve ? ve : e) - v));
+                }
+            }
+            tkwmRxConsume_(c.rx, c.rxN, hn + 4);
+            c.bodyRx -= hn + 4;
+            c.mp = TKWM_MP_DATA;
+            if (file) {
+                _uploading          = &c;
+                c.up->status        = UPLOAD_FILE_START;
+                c.up->totalSize     = 0;
+                c.up->currentSize   = 0;
+                const THandlerFunction up = uploadHandler(c);
+                _cur = &c;
+                if (up) up();
+                _cur = nullptr;
+            }
+        } else if (c.mp == TKWM_MP_DATA) {
+            const char*  f    = tkwmMemFind_(c.rx, n, bd, bn);
+            // без найденной границы хвост длиной в неё придерживаем: граница может прийти следующим пакетом
+            const size_t data = f ? (size_t)(f - c.rx) : (n >= bn ? n - bn + 1 : 0);
+            if (data) {
+                if (c.mpFile) uploadWrite(c, c.rx, data);
+                else if (c.mpValue.length() + data > TKWM_HTTP_MAX_BODY) {
+                    fail(c, 413);
+                    return true;
+                } else c.mpValue.concat(c.rx, data);
+            }
+            const size_t k = data + (f ? bn : 0);
+            if (!k) break;
+            tkwmRxConsume_(c.rx, c.rxN, k);
+            c.bodyRx -= k;
+            if (!f) {
+                progress = true;
+                continue;
+            }
+            if (c.mpFile) uploadEnd(c, UPLOAD_FILE_END);
+            else c.args.push_back(Kv{c.mpName, c.mpValue});
+            c.mpValue = String();
+            c.mp      = TKWM_MP_DELIM;
+        } else { // TKWM_MP_DONE: эпилог не нужен
+            tkwmRxConsume_(c.rx, c.rxN, n);
+            c.bodyRx = 0;
+            if (c.need) break;
+            dispatch(c);
+            return true;
+        }
+        progress = true;
+    }
+    // Тело пришло целиком, а разбор встал не на очереди загрузки — закрывающей границы нет.
+    if (!c.need && c.mp != TKWM_MP_DONE && !queued) {
+        fail(c, 400);
+        return true;
+    }
+    return progress;
+}
+
+// ===================== обработка =====================
+int TkwmAsyncServer::findHandler(const Conn& c) const {
+    for (size_t i = 0; i < _handlers.size(); i++)
+        if ((_handlers[i].method == HTTP_ANY || _handlers[i].method == c.method) && _handlers[i].uri == c.uri) return (int)i;
+    return -1;
+}
+
+TkwmAsyncServer::THandlerFunction TkwmAsyncServer::uploadHandler(const Conn& c) const {
+    return c.handler >= 0 && _handlers[c.handler].ufn ? _handlers[c.handler].ufn : _fileUpload;
+}
+
+void TkwmAsyncServer::dispatch(Conn& c) {
+    _cur             = &c;
+    _contentLength   = CONTENT_LENGTH_NOT_SET;
+    _responseHeaders = String();
+    c.replied = c.chunked = false;
+    if (c.handler >= 0 && _handlers[c.handler].fn) _handlers[c.handler].fn();
+    else if (_notFound) _notFound();
+    else send(404, "text/html", String("Not found: ") + c.uri);
+    if (c.chunked) sendContent("", 0);
+    _cur = nullptr;
+    c.served++;
+    // Без ответа WebServer просто закрывает соединение — так же.
+    if (!c.replied) c.keep = false;
+    reset(c);
+    c.at = millis();
+    c.st = (c.keep && !c.broken) ? St::Head : St::Flush;
+}
+
+void TkwmAsyncServer::fail(Conn& c, int code) {
+    if (c.up && c.mpFile) uploadEnd(c, UPLOAD_FILE_ABORTED);
+    char      h[96];
+    const int n = snprintf(h, sizeof(h), "HTTP/1.1 %d %s\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", code, tkwmHttpText_(code));
+    Conn*     was = _cur;
+    _cur          = &c;
+    out(h, (size_t)n);
+    _cur = was;
+    reset(c);
+    c.keep = false;
+    c.rxN  = 0;
+    c.at   = millis();
+    c.st   = St::Flush;
+}
+
+// Буфер ответа и очередь за ним — в сокет. waitMs = 0: сколько сокет возьмёт сейчас; иначе — всё, ожидая
+// сокет не дольше waitMs. false — ответ не доставить (ошибка сокета или истекло ожидание), он сброшен.
+bool TkwmAsyncServer::flush(Conn& c, uint32_t waitMs) {
+    const uint32_t t0 = millis();
+    for (refill(c); c.txN; refill(c)) {
+        const ssize_t k = ::send(c.fd, c.tx, c.txN, MSG_NOSIGNAL);
+        if (k > 0) {
+            memmove(c.tx, c.tx + k, c.txN - (size_t)k);
+            c.txN -= (size_t)k;
+            c.at = millis();
+            continue;
+        }
+        if (k < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) break;
+        if (!waitMs) return true;
+        const uint32_t spent = millis() - t0;
+        if (spent >= waitMs) break;
+        fd_set wr;
+        FD_ZERO(&wr);
+        FD_SET(c.fd, &wr);
+        timeval tv{(time_t)((waitMs - spent) / 1000), (suseconds_t)((waitMs - spent) % 1000 * 1000)};
+        select(c.fd + 1, nullptr, &wr, nullptr, &tv);
+    }
+    if (!c.txN) return true;
+    c.txN = 0;
+    c.q.clear();
+    c.qMem = 0;
+    return false;
+}
+
+// Дополнить буфер ответа из очереди.
+void TkwmAsyncServer::refill(Conn& c) {
+    while (c.txN < TKWM_HTTP_TX_BUF && !c.q.empty()) {
+        Seg&   s = c.q.front();
+        size_t k = TKWM_HTTP_TX_BUF - c.txN;
+        if (k > s.left) k = s.left;
+        if (s.file) {
+            k = s.file.read((uint8_t*)c.tx + c.txN, k);
+            if (!k) {
+                // файл короче обещанной длины: ответ не дописать — отдаём, что есть, и закрываем
+                c.q.clear();
+                c.qMem = 0;
+                c.keep = false;
+                if (c.st == St::Head) c.st = St::Flush;
+                return;
+            }
+        } else memcpy(c.tx + c.txN, (s.rom ? s.rom : s.mem.c_str()) + s.off, k);
+        if (s.inMem()) c.qMem -= k;
+        c.txN += k;
+        s.off += k;
+        s.left -= k;
+        if (!s.left) c.q.erase(c.q.begin());
+    }
+}
+
+void TkwmAsyncServer::out(const char* p, size_t n) {
+    Conn* c = _cur;
+    while (n && c && !c->broken && c->fd >= 0) {
+        // за очередью ничего не обгоняем: пока она не пуста, новые байты — в её конец
+        if (c->q.empty() && c->txN < TKWM_HTTP_TX_BUF) {
+            size_t k = TKWM_HTTP_TX_BUF - c->txN;
+            if (k > n) k = n;
+            memcpy(c->tx + c->txN, p, k);
+            c->txN += k;
+            p += k;
+            n -= k;
+            continue;
+        }
+        // буфер полон — сокету, сколько возьмёт сразу; остальное ждёт в памяти соединения, его допишет
+        // handleClient(). Сверх TKWM_HTTP_TX_QUEUE — ждём сокет здесь (обработчик синхронный, как у WebServer).
+        if (!flush(*c, 0) || (c->qMem >= TKWM_HTTP_TX_QUEUE && !flush(*c, TKWM_HTTP_SEND_WAIT_MS))) {
+            c->broken = true;
+            c->keep   = false;
+            return;
+        }
+        if (c->q.empty() && c->txN < TKWM_HTTP_TX_BUF) continue;
+        size_t k = TKWM_HTTP_TX_QUEUE - c->qMem;
+        if (k > n) k = n;
+        if (c->q.empty() || !c->q.back().inMem()) c->q.emplace_back();
+        Seg& s = c->q.back();
+        if (s.off) {
+            s.mem.remove(0, (unsigned)s.off); // отправленное начало больше не держим
+            s.off = 0;
+        }
+        s.mem.concat(p, (unsigned)k);
+        s.left += k;
+        c->qMem += k;
+        p += k;
+        n -= k;
+    }
+}
+
+// Тело из ROM или файла не копируется: сегмент очереди дочитывается, пока клиент принимает ответ.
+void TkwmAsyncServer::enqueue(Seg&& s) {
+    Conn* c = _cur;
+    if (!c || c->method == HTTP_HEAD || !s.left) return;
+    char head[16];
+    if (c->chunked) out(head, (size_t)snprintf(head, sizeof(head), "%x\r\n", (unsigned)s.left));
+    if (c->broken || c->fd < 0) return;
+    c->q.push_back(std::move(s));
+    refill(*c);
+    if (c->chunked) out("\r\n", 2);
+}
+
+void TkwmAsyncServer::step(Conn& c) {
+    for (;;) {
+        if (c.st == St::Head) {
+            // следующий ответ — после текущего целиком: хвост из файла или ROM ещё в очереди
+            if (!c.rxN || !c.q.empty()) return;
+            // пустые строки между запросами (CRLF после тела POST) пропускаем
+            size_t lead = 0;
+            while (lead < c.rxN && (c.rx[lead] == '\r' || c.rx[lead] == '\n')) lead++;
+            if (lead) tkwmRxConsume_(c.rx, c.rxN, lead);
+            const char* e = tkwmMemFind_(c.rx, c.rxN, "\r\n\r\n", 4);
+            if (!e) {
+                if (c.rxN == TKWM_HTTP_RX_BUF) fail(c, 431);
+                return;
+            }
+            if (!parseHead(c, (size_t)(e - c.rx))) fail(c, 400);
+            if (c.st != St::Body && c.st != St::Multipart) return; // один ответ за проход
+        } else if (c.st == St::Body) {
+            feedBody(c);
+            return;
+        } else if (c.st == St::Multipart) {
+            if (!feedMultipart(c) || c.st != St::Multipart) return;
+        } else return;
+    }
+}
+
+void TkwmAsyncServer::handleClient() {
+    if (_listenFd < 0) return;
+    fd_set rd, wr;
+    FD_ZERO(&rd);
+    FD_ZERO(&wr);
+    FD_SET(_listenFd, &rd);
+    int mx = _listenFd;
+    for (Conn& c : _conns) {
+        if (c.st == St::Free) continue;
+        if (c.sending()) FD_SET(c.fd, &wr);
+        // Следующий запрос читаем, когда ответ на предыдущий ушёл; тело — пока есть место в буфере.
+        const bool wantRx = c.st == St::Head ? !c.sending() && c.rxN < TKWM_HTTP_RX_BUF
+                          : (c.st == St::Body || c.st == St::Multipart) && c.need && c.rxN < TKWM_HTTP_RX_BUF;
+        if (wantRx) FD_SET(c.fd, &rd);
+        if (c.fd > mx) mx = c.fd;
+    }
+    timeval tv{0, 0};
+    if (select(mx + 1, &rd, &wr, nullptr, &tv) < 0) return;
+    if (FD_ISSET(_listenFd, &rd))
+        while (acceptOne()) {
+        }
+
+    const uint32_t now = millis();
+    for (Conn& c : _conns) {
+        if (c.st == St::Free) continue;
+        const int fd = c.fd;
+        if (FD_ISSET(fd, &wr) && !flush(c, 0)) {
+            drop(c);
+            continue;
+        }
+        // Загрузку дочитываем несколькими порциями за проход, но не бесконечно — остальным тоже нужен тик.
+        if (FD_ISSET(fd, &rd))
+            for (int k = 0; k < 4 && recvSome(c); k++) step(c);
+        if (c.st == St::Free) continue;
+        step(c); // уже принятое: следующий запрос конвейера, загрузка после очереди
+        if (c.st == St::Flush) {
+            if (c.sending()) flush(c, 0);
+            if (!c.sending() || (int32_t)(now - c.at) > TKWM_HTTP_SEND_WAIT_MS) drop(c);
+            continue;
+        }
+        // c.at мог обновиться в этом же проходе, позже now: разность со знаком
+        const int32_t idle = (int32_t)(now - c.at);
+        const bool    ka   = c.st == St::Head && !c.rxN && c.served;
+        // пока ответ уходит, c.at — его последний успешный кусок: закрываем, только если клиент перестал читать
+        if (idle > (c.sending() ? TKWM_HTTP_SEND_WAIT_MS : ka ? TKWM_HTTP_KEEPALIVE_MS : HTTP_MAX_DATA_WAIT)) drop(c);
+    }
+}
+
+// ===================== запрос и ответ текущего соединения =====================
+void TkwmAsyncServer::on(const String& uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn) {
+    _handlers.push_back(Handler{uri, method, fn, ufn});
+}
+
+String TkwmAsyncServer::uri() { return _cur ? _cur->uri : String(); }
+HTTPMethod TkwmAsyncServer::method() { return _cur ? _cur->method : HTTP_ANY; }
+
+HTTPUpload& TkwmAsyncServer::upload() {
+    if (!_cur->up) _cur->up = new HTTPUpload();
+    return *_cur->up;
+}
+
+String TkwmAsyncServer::arg(const String& name) {
+    if (_cur)
+        for (const Kv& a : _cur->args)
+            if (a.key == name) return a.value;
+    return String();
+}
+String TkwmAsyncServer::arg(int i) { return _cur && i >= 0 && i < (int)_cur->args.size() ? _cur->args[i].value : String(); }
+String TkwmAsyncServer::argName(int i) { return _cur && i >= 0 && i < (int)_cur->args.size() ? _cur->args[i].key : String(); }
+int    TkwmAsyncServer::args() { return _cur ? (int)_cur->args.size() : 0; }
+bool   TkwmAsyncServer::hasArg(const String& name) {
+    if (_cur)
+        for (const Kv& a : _cur->args)
+            if (a.key == name) return true;
+    return false;
+}
+
+void TkwmAsyncServer::collectHeaders(const char* keys[], const size_t n) {
+    _collect.clear();
+    _collect.push_back("Authorization"); // ядро собирает его всегда
+    for (size_t i = 0; i < n; i++) _collect.push_back(keys[i]);
+}
+
+String TkwmAsyncServer::header(const String& name) {
+    if (_cur)
+        for (const Kv& h : _cur->headers)
+            if (h.key.equalsIgnoreCase(name)) return h.value;
+    return String();
+}
+String TkwmAsyncServer::header(int i) { return _cur && i >= 0 && i < (int)_cur->headers.size() ? _cur->headers[i].value : String(); }
+String TkwmAsyncServer::headerName(int i) { return _cur && i >= 0 && i < (int)_cur->headers.size() ? _cur->headers[i].key : String(); }
+int    TkwmAsyncServer::headers() { return _cur ? (int)_cur->headers.size() : 0; }
+bool   TkwmAsyncServer::hasHeader(const String& name) {
+    if (_cur)
+        for (const Kv& h : _cur->headers)
+            if (h.key.equalsIgnoreCase(name)) return h.value.length() > 0;
+    return false;
+}
+String TkwmAsyncServer::hostHeader() { return _cur ? _cur->hostHeader : String(); }
+
+void TkwmAsyncServer::sendHeader(const String& name, const String& value, bool first) {
+    String line = name + ": " + value + "\r\n";
+    if (first) _responseHeaders = line + _responseHeaders;
+    else _responseHeaders += line;
+}
+
+void TkwmAsyncServer::send(int code, const char* type, const String& content) { send(code, type, content.c_str(), content.length()); }
+
+void TkwmAsyncServer::send(int code, const char* type, const char* content, size_t len) {
+    head(code, type, len);
+    if (len) sendContent(content, len);
+}
+
+void TkwmAsyncServer::send_P(int code, PGM_P type, PGM_P content, size_t len) {
+    head(code, type, len);
+    if (len) sendContent_P(content, len);
+}
+
+// Строка статуса и заголовки; len — длина тела, если обработчик не задал её через setContentLength().
+void TkwmAsyncServer::head(int code, const char* type, size_t len) {
+    if (!_cur) return;
+    Conn& c = *_cur;
+    // Длина неизвестна: HTTP/1.1 — chunked, HTTP/1.0 — тело до закрытия соединения.
+    String h = String("HTTP/1.1 ") + String(code) + " " + tkwmHttpText_(code) + "\r\n";
+    sendHeader("Content-Type", type ? type : "text/html", true);
+    if (_contentLength == CONTENT_LENGTH_NOT_SET) sendHeader("Content-Length", String((unsigned long)len));
+    else if (_contentLength != CONTENT_LENGTH_UNKNOWN) sendHeader("Content-Length", String((unsigned long)_contentLength));
+    else if (c.http11) {
+        c.chunked = true;
+        sendHeader("Accept-Ranges", "none");
+        sendHeader("Transfer-Encoding", "chunked");
+    } else c.keep = false;
+    if (_cors) sendHeader("Access-Control-Allow-Origin", "*");
+    sendHeader("Connection", c.keep ? "keep-alive" : "close");
+    h += _responseHeaders;
+    h += "\r\n";
+    _responseHeaders = String();
+    c.replied        = true;
+    out(h.c_str(), h.length());
+}
+
+void TkwmAsyncServer::sendContent(const char* content, size_t len) {
+    if (!_cur || _cur->method == HTTP_HEAD) return; // у HEAD тела нет — иначе поток keep-alive сбился бы
+    if (!_cur->chunked) {
+        out(content, len);
+        return;
+    }
+    char      head[16];
+    const int n = snprintf(head, sizeof(head), "%x\r\n", (unsigned)len);
+    out(head, (size_t)n);
+    out(content, len);
+    out("\r\n", 2);
+    if (!len) _cur->chunked = false;
+}
+
+void TkwmAsyncServer::sendContent_P(PGM_P content, size_t len) {
+    if (!len) {
+        sendContent(content, 0); // конец chunked
+        return;
+    }
+    Seg s;
+    s.rom  = content;
+    s.left = len;
+    enqueue(std::move(s));
+}
+
+void TkwmAsyncServer::sendContent(File& file, size_t len) {
+    if (!file) return;
+    Seg s;
+    s.file = file;
+    s.left = len;
+    enqueue(std::move(s));
+}
+
+size_t TkwmAsyncServer::streamFile(File& file, const String& contentType, const int code) {
+    const String n = file.name();
+    if (n.endsWith(".gz") && contentType != "application/x-gzip" && contentType != "application/octet-stream")
+        sendHeader("Content-Encoding", "gzip");
+    const size_t size = file.size();
+    setContentLength(size);
+    send(code, contentType.c_str(), "", 0);
+    sendContent(file, size);
+    return size;
+}
@@ -0,0 +1,204 @@
+#pragma once
+// Асинхронный HTTP/1.1-сервер для TKWifiManager (TKWM_HTTP_ASYNC=1): несколько соединений сразу,
+// keep-alive, состояние разбора у каждого соединения. Сокеты BSD (lwIP на ESP32) + select() без ожидания:
+// handleClient() обходит все сокеты и возвращается. Интерфейс повторяет WebServer ядра в той части, что
+// нужна маршрутам (on/arg/header/send/sendHeader/sendContent/upload…), поэтому addRoute() и web() не меняются.
+#include <Arduino.h>
+#include <FS.h>
+#include <WebServer.h> // HTTPMethod, HTTPUpload, CONTENT_LENGTH_*
+#include <functional>
+#include <vector>
+
+/** Одновременных соединений (каждое — сокет lwIP и буферы TKWM_HTTP_RX_BUF + TKWM_HTTP_TX_BUF) */
+#ifndef TKWM_HTTP_MAX_CONN
+#define TKWM_HTTP_MAX_CONN 4
+#endif
+
+/** Простой keep-alive соединения между запросами до закрытия, мс */
+#ifndef TKWM_HTTP_KEEPALIVE_MS
+#define TKWM_HTTP_KEEPALIVE_MS 5000
+#endif
+
+/** Приёмный буфер соединения: строка запроса и заголовки должны в него поместиться (иначе 431) */
+#ifndef TKWM_HTTP_RX_BUF
+#define TKWM_HTTP_RX_BUF 2048
+#endif
+
+/** Буфер ответа соединения: из него handleClient() отправляет, когда сокет готов */
+#ifndef TKWM_HTTP_TX_BUF
+#define TKWM_HTTP_TX_BUF 1460
+#endif
+
+/**
+ * Сколько байт ответа из ОЗУ соединение держит сверх TKWM_HTTP_TX_BUF, пока клиент не дочитал; больше —
+ * обработчик ждёт сокет, как WebServer. Тело из файла (streamFile/sendContent(File)) и ROM (send_P)
+ * не копируется и сюда не считается.
+ */
+#ifndef TKWM_HTTP_TX_QUEUE
+#define TKWM_HTTP_TX_QUEUE 8192
+#endif
+
+/** Предел тела запроса без multipart (собирается в arg("plain") целиком, как у WebServer), байт */
+#ifndef TKWM_HTTP_MAX_BODY
+#define TKWM_HTTP_MAX_BODY 32768
+#endif
+
+/** Ответ не уходит в сокет дольше этого (клиент не читает) — соединение закрывается, мс */
+#ifndef TKWM_HTTP_SEND_WAIT_MS
+#define TKWM_HTTP_SEND_WAIT_MS 5000
+#endif
+
+class TkwmAsyncServer {
+public:
+    typedef std::function<void(void)> THandlerFunction;
+
+    explicit TkwmAsyncServer(int port = 80) : _port((uint16_t)port) {}
+    ~TkwmAsyncServer() { close(); }
+    TkwmAsyncServer(const TkwmAsyncServer&) = delete;
+    TkwmAsyncServer& operator=(const TkwmAsyncServer&) = delete;
+
+    void begin();
+    void begin(uint16_t port); // повторный вызов переоткрывает слушающий сокет (0 — любой свободный порт)
+    void handleClient();       // один проход по всем сокетам, без ожидания
+    void close();
+    void stop() { close(); }
+
+    void on(const String& uri, THandlerFunction fn) { on(uri, HTTP_ANY, fn); }
+    void on(const String& uri, HTTPMethod method, THandlerFunction fn) { on(uri, method, fn, nullptr); }
+    void on(const String& uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn);
+    void onNotFound(THandlerFunction fn) { _notFound = fn; }
+    void onFileUpload(THandlerFunction fn) { _fileUpload = fn; }
+
+    // Запрос — того соединения, чей обработчик сейчас выполняется.
+    String      uri();
+    HTTPMethod  method();
+    HTTPUpload& upload();
+
+    String arg(const String& name);
+    String arg(int i);
+    String argName(int i);
+    int    args();
+    bool   hasArg(const String& name);
+
+    void   collectHeaders(const char* headerKeys[], const size_t headerKeysCount);
+    String header(const String& name);
+    String header(int i);
+    String headerName(int i);
+    int    headers();
+    bool   hasHeader(const String& name);
+    String hostHeader();
+
+    void send(int code, const char* content_type = nullptr, const String& content = String(""));
+    void send(int code, char* content_type, const String& content) { send(code, (const char*)content_type, content); }
+    void send(int code, const String& content_type, const String& content) { send(code, content_type.c_str(), content); }
+    void send(int code, const char* content_type, const char* content) { send(code, content_type, content, strlen(content)); }
+    void send(int code, const char* content_type, const char* content, size_t len);
+    void send(int code, const char* content_type, const uint8_t* content, size_t len) { send(code, content_type, (const char*)content, len); }
+    void send_P(int code, PGM_P content_type, PGM_P content) { send_P(code, content_type, content, strlen(content)); }
+    void send_P(int code, PGM_P content_type, PGM_P content, size_t len);
+
+    void enableDelay(bool) {} // handleClient() и так не ждёт
+    void enableCORS(bool value = true) { _cors = value; }
+    void enableCrossOrigin(bool value = true) { enableCORS(value); }
+
+    void setContentLength(const size_t contentLength) { _contentLength = contentLength; }
+    void sendHeader(const String& name, const String& value, bool first = false);
+    void sendContent(const String& content) { sendContent(content.c_str(), content.length()); }
+    void sendContent(const char* content, size_t len);
+    void sendContent_P(PGM_P content) { sendContent_P(content, strlen(content)); }
+    void sendContent_P(PGM_P content, size_t len);
+    // len байт файла с текущей позиции. Файл читается из handleClient(), пока клиент принимает ответ,
+    // поэтому закрывать его после вызова нельзя: копия File в соединении закроет его сама.
+    void sendContent(File& file, size_t len);
+
+    size_t streamFile(File& file, const String& contentType, const int code = 200); // байт поставлено в ответ
+
+    uint16_t port() const { return _port; } // фактический порт после begin()
+    uint8_t  clients() const;               // открытых соединений
+
+private:
+    enum class St : uint8_t { Free, Head, Body, Multipart, Flush };
+    struct Kv {
+        String key, value;
+    };
+    // Часть ответа, ждущая сокета: байты из ОЗУ, ROM (send_P) или файл — в порядке отправки.
+    struct Seg {
+        String mem;
+        PGM_P  rom = nullptr;
+        File   file;
+        size_t off = 0, left = 0;
+        bool   inMem() const { return !rom && !file; }
+    };
+    struct Conn {
+        int      fd = -1;
+        St       st = St::Free;
+        uint32_t at = 0;            // последняя активность
+        uint16_t served = 0;        // запросов по этому соединению
+        bool     keep = false;      // keep-alive после ответа
+        bool     http11 = false;
+        bool     broken = false;    // сокет не принял ответ — только закрыть
+        bool     replied = false;   // заголовки ответа отправлены
+        bool     chunked = false;
+        char*    rx = nullptr;
+        size_t   rxN = 0;
+        char*    tx = nullptr;
+        size_t   txN = 0;
+        std::vector<Seg> q;         // продолжение ответа за tx
+        size_t           qMem = 0;  // байт ОЗУ в q (предел TKWM_HTTP_TX_QUEUE)
+        bool sending() const { return txN || !q.empty(); }
+        // запрос
+        String          uri, hostHeader;
+        HTTPMethod      method = HTTP_ANY;
+        int             handler = -1;
+        std::vector<Kv> args, headers;
+        size_t          need = 0;   // байт тела ещё ждём из сокета
+        size_t          bodyRx = 0; // байт тела в rx (за ними может лежать следующий запрос)
+        String          body;
+        bool            form = false;
+        // multipart
+        String      boundary;       // "\r\n--" + граница
+        uint8_t     mp = 0;         // фаза разбора частей
+        bool        mpFile = false;
+        String      mpName, mpValue;
+        HTTPUpload* up = nullptr;
+    };
+
+    bool  acceptOne();
+    void  drop(Conn& c);
+    void  reset(Conn& c);
+    bool  recvSome(Conn& c);
+    void  step(Conn& c);
+    bool  parseHead(Conn& c, size_t headLen);
+    void  parseArgs(Conn& c, const char* q, size_t n);
+    bool  feedBody(Conn& c);
+    bool  feedMultipart(Conn& c);
+    void  uploadWrite(Conn& c, const char* p, size_t n);
+    void  uploadEnd(Conn& c, HTTPUploadStatus st);
+    void  dispatch(Conn& c);
+    void  fail(Conn& c, int code);
+    void  head(int code, const char* type, size_t len);
+    bool  flush(Conn& c, uint32_t waitMs);
+    void  refill(Conn& c);
+    void  out(const char* p, size_t n);
+    void  enqueue(Seg&& s);
+    int   findHandler(const Conn& c) const;
+    THandlerFunction uploadHandler(const Conn& c) const;
+
+    struct Handler {
+        String           uri;
+        HTTPMethod       method;
+        THandlerFunction fn, ufn;
+    };
+
+    uint16_t             _port;
+    int                  _listenFd = -1;
+    bool                 _cors = false;
+    std::vector<Handler> _handlers;
+    THandlerFunction     _notFound, _fileUpload;
+    std::vector<String>  _collect;
+    Conn                 _conns[TKWM_HTTP_MAX_CONN];
+    Conn*                _cur = nullptr;      // соединение, чей обработчик выполняется
+    Conn*                _uploading = nullptr; // загрузки по одной: обработчики WebServer-кода рассчитаны на одну
+    String               _responseHeaders;
+    size_t               _contentLength = CONTENT_LENGTH_NOT_SET;
+};
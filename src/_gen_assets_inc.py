@@ -0,0 +1,51 @@
+# run from repo: py src/_gen_assets_inc.py [--ws-port 81]
+# Встроенные страницы/ресурсы → TKWifiManager_assets.inc: gzip-массивы PROGMEM + строгий ETag по содержимому.
+import argparse
+import gzip
+import hashlib
+import pathlib
+
+root = pathlib.Path(__file__).resolve().parent
+
+# (URL, исходник, MIME) — порядок = порядок в таблице TKWM_ASSETS
+ASSETS = [
+    ("/index.html", "embed/index.html", "text/html; charset=utf-8"),
+    ("/wifi.html", "embed/wifi.html", "text/html; charset=utf-8"),
+    ("/fs.html", "embed/fs.html", "text/html; charset=utf-8"),
+    ("/ota.html", "ota.html", "text/html; charset=utf-8"),
+    ("/theme.css", "theme.css", "text/css"),
+    ("/theme.js", "theme.js", "application/javascript"),
+]
+
+ap = argparse.ArgumentParser()
+ap.add_argument("--ws-port", type=int, default=81, help="порт WS по умолчанию, зашитый в страницы")
+args = ap.parse_args()
+
+out = [
+    "// Сгенерировано src/_gen_assets_inc.py — не редактировать вручную.",
+    "// Исходники: src/embed/*.html, src/ota.html, src/theme.css, src/theme.js",
+    "#define TKWM_ASSETS_WS_PORT %d" % args.ws_port,
+    "",
+]
+table = []
+total_raw = total_gz = 0
+for url, src, mime in ASSETS:
+    raw = (root / src).read_text(encoding="utf-8").replace("%TKWM_WS_PORT%", str(args.ws_port)).encode("utf-8")
+    gz = gzip.compress(raw, compresslevel=9, mtime=0)
+    etag = '"' + hashlib.sha1(gz).hexdigest()[:16] + '"'
+    ident = "TKWM_ASSET_" + url.strip("/").replace(".", "_").upper()
+    out.append("static const uint8_t %s[] PROGMEM = {" % ident)
+    for i in range(0, len(gz), 20):
+        out.append("    " + ",".join("0x%02x" % b for b in gz[i:i + 20]) + ",")
+    out.append("};")
+    table.append('    { "%s", "%s", %s, sizeof(%s), %d, "%s" },' % (url, mime, ident, ident, len(raw), etag.replace('"', '\\"')))
+    total_raw += len(raw)
+    total_gz += len(gz)
+    print("%-12s %7d -> %6d bytes (%.0f%%)  ETag %s" % (url, len(raw), len(gz), 100.0 * len(gz) / len(raw), etag))
+
+out.append("")
+out.append("static const TkwmAsset TKWM_ASSETS[] = {")
+out += table
+out.append("};")
+(root / "TKWifiManager_assets.inc").write_text("\n".join(out) + "\n", encoding="utf-8", newline="\n")
+print("OK total %d -> %d bytes, saved %d" % (total_raw, total_gz, total_raw - total_gz))
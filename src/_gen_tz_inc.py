@@ -0,0 +1,124 @@
+# run from repo: py src/_gen_tz_inc.py [--zoneinfo /usr/share/zoneinfo]
+# IANA-зоны → TKWifiManager_tz.inc: отсортированные имена + POSIX-правила TZ (с переходом на летнее время)
+# в компактных PROGMEM-таблицах; на устройстве — двоичный поиск по имени и setenv("TZ") / tzset().
+# Правило берётся из хвоста TZif-файла системной tzdata; каждое сверяется со смещениями tzdata на 2026–2035.
+import argparse
+import calendar
+import os
+import pathlib
+import time
+import zoneinfo
+from datetime import datetime, timezone
+
+root = pathlib.Path(__file__).resolve().parent
+
+# Сверх zone1970.tab: прежние имена из ota.conf/страницы (ссылки backward) и фиксированные Etc/*.
+EXTRA = [
+    "UTC", "GMT", "Etc/UTC", "Etc/GMT",
+    "America/Buenos_Aires", "America/Godthab", "Asia/Kolkata", "Europe/Kiev",
+] + ["Etc/GMT%+d" % h for h in range(-14, 13) if h]
+
+# Переходы не описываются POSIX-правилом (Марокко: летнее время снимается на Рамадан по явному списку дат) —
+# на устройстве только основное смещение, сверка пропускается.
+APPROX = {"Africa/Casablanca", "Africa/El_Aaiun"}
+
+ap = argparse.ArgumentParser()
+ap.add_argument("--zoneinfo", type=pathlib.Path, default=pathlib.Path("/usr/share/zoneinfo"))
+args = ap.parse_args()
+zi = args.zoneinfo
+
+
+def footer(name):
+    # TZif v2+: после двоичных данных — "\n<POSIX TZ>\n"
+    data = (zi / name).read_bytes()
+    if not data.startswith(b"TZif") or data[4:5] < b"2":
+        raise SystemExit("%s: нет TZif v2+" % name)
+    rule = data[data.rindex(b"\n", 0, len(data) - 1) + 1:-1].decode("ascii")
+    if not rule:
+        raise SystemExit("%s: пустое POSIX-правило" % name)
+    return rule
+
+
+def check(name, rule):
+    # Смещение по правилу (libc, та же грамматика, что у newlib) против tzdata — 1 и 15 число, 00:00 и 12:00 UTC.
+    z = zoneinfo.ZoneInfo(name)
+    os.environ["TZ"] = rule
+    time.tzset()
+    for y in range(2026, 2036):
+        for m in range(1, 13):
+            for d in (1, 15):
+                for h in (0, 12):
+                    t = calendar.timegm((y, m, d, h, 0, 0))
+                    want = datetime.fromtimestamp(t, timezone.utc).astimezone(z).utcoffset().total_seconds()
+                    got = time.localtime(t).tm_gmtoff
+                    if got != want:
+                        raise SystemExit("%s: %r даёт %+d с, tzdata %+d с на %04d-%02d-%02d %02d:00Z" % (name, rule, got, want, y, m, d, h))
+
+
+names = set(EXTRA)
+for line in (zi / "zone1970.tab").read_text(encoding="utf-8").splitlines():
+    if line and not line.startswith("#"):
+        names.add(line.split("\t")[2])
+names = sorted(n for n in names if (zi / n).is_file())
+
+version = "?"
+tzdata = zi / "tzdata.zi"
+if tzdata.is_file():
+    version = tzdata.read_text(encoding="utf-8").splitlines()[0].replace("# version", "").strip()
+
+rules, rule_idx = [], {}
+zones = []
+for n in names:
+    r = footer(n)
+    if n not in APPROX:
+        check(n, r)
+    if r not in rule_idx:
+        rule_idx[r] = len(rules)
+        rules.append(r)
+    zones.append((n, rule_idx[r]))
+
+
+def cstr_blob(items):
+    # Строки подряд через \0 + смещения начала каждой
+    offs, pos = [], 0
+    for s in items:
+        offs.append(pos)
+        pos += len(s) + 1
+    return offs, pos
+
+
+name_offs, name_bytes = cstr_blob([n for n, _ in zones])
+rule_offs, rule_bytes = cstr_blob(rules)
+assert name_bytes < 65536 and rule_bytes < 65536
+idx_t = "uint8_t" if len(rules) <= 256 else "uint16_t"
+
+out = [
+    "// Сгенерировано src/_gen_tz_inc.py — не редактировать вручную.",
+    "// tzdata %s: %d зон, %d различных POSIX-правил." % (version, len(zones), len(rules)),
+    "#define TKWM_TZ_COUNT %d" % len(zones),
+    "",
+    "// Имена зон по возрастанию (strcmp), через \\0",
+    "static const char TKWM_TZ_NAMES[] PROGMEM =",
+]
+out += ['    "%s\\0"' % n for n, _ in zones]
+out[-1] += ";"
+out.append("static const uint16_t TKWM_TZ_NAME_OFF[] PROGMEM = {")
+for i in range(0, len(name_offs), 16):
+    out.append("    " + ",".join(str(v) for v in name_offs[i:i + 16]) + ",")
+out.append("};")
+out.append("// Номер правила для каждой зоны")
+out.append("static const %s TKWM_TZ_RULE_OF[] PROGMEM = {" % idx_t)
+for i in range(0, len(zones), 24):
+    out.append("    " + ",".join(str(r) for _, r in zones[i:i + 24]) + ",")
+out.append("};")
+out.append("// POSIX TZ (для setenv), через \\0")
+out.append("static const char TKWM_TZ_RULES[] PROGMEM =")
+out += ['    "%s\\0"' % r for r in rules]
+out[-1] += ";"
+out.append("static const uint16_t TKWM_TZ_RULE_OFF[] PROGMEM = {")
+for i in range(0, len(rule_offs), 16):
+    out.append("    " + ",".join(str(v) for v in rule_offs[i:i + 16]) + ",")
+out.append("};")
+(root / "TKWifiManager_tz.inc").write_text("\n".join(out) + "\n", encoding="utf-8", newline="\n")
+total = name_bytes + rule_bytes + 2 * len(zones) + (1 if idx_t == "uint8_t" else 2) * len(zones) + 2 * len(rules)
+print("OK tzdata %s: %d zones, %d rules, %d bytes PROGMEM" % (version, len(zones), len(rules), total))